@@ -1,8 +1,13 @@
 #include <Core.h>
+#include <Scheduler.h>
+#include <IdleManager.h>
 #include <Thermistor.h>
 #include <FPS.h>
 #include <TinyGPS.h>
+#include <GPSConfigurator.h>
 #include <BMP085.h>
+#include <MatrixMath.h>
+#include <AltitudeFilter.h>
 #include <Flash.h>
 #include "Jonah.h"
 #include <CRC.h>
@@ -11,12 +16,25 @@
 #include <TimerOne.h>
 
 #include <Wire.h>
-#include <SoftwareSerial.h>
+#include <BufferedSerial.h>
+#include <CaptureSerial.h>
 
 #define LoggingInterval 1000ul
-uint32_t loggingLastSend = 0;
 
-uint32_t lastFrameTime = 0;
+// how often everything else is done
+const uint32_t c_LEDInterval = 50ul;
+const uint32_t c_SensorInterval = 100ul;         // battery and thermistors
+const uint32_t c_AltitudeInterval = 5ul;         // polling the BMP085 for the end of a conversion, and the altitude filter
+const uint32_t c_JonahInterval = 10ul;           // JonahSerial fills its 32 byte buffer in 67 ms at 4800
+const uint32_t c_APRSCheckInterval = 1000ul;     // whether it's time for a packet
+const uint32_t c_GPSPollDeadline = 10ul;         // at 115200 the GPS fills the 128 byte receive buffer in 11 ms
+const uint16_t c_SerialRxBufferSize = 128;       // the GPS's, powers of two
+const uint16_t c_SerialTxBufferSize = 64;        // logging's
+
+BufferedSerialPort<c_SerialRxBufferSize, c_SerialTxBufferSize> Serial0(0);
+
+Scheduler scheduler;
+IdleManager idle;
 FPS fps(0);
 
 #define BatteryMonitorPin A3
@@ -29,12 +47,19 @@ float thermTempsFiltered[_countof(therms)];
 
 TinyGPS gps;
 
+// MTK receiver, sharing Serial0 with logging
+const char c_GPSConfigScript[] PROGMEM =
+    "PMTK314,0,1,0,1,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0\n"   // RMC and GGA only
+    "PMTK220,1000\n"                                     // 1 Hz
+    "PMTK886,3\n";                                       // balloon mode, so fixes keep coming above 18 km
+const char c_GPSResetBanner[] PROGMEM = "$PMTK010,001";
+GPSConfigurator gpsConfig(&Serial0, GPSConfigurator::EProtocol::MTK, 115200, c_GPSConfigScript, c_GPSResetBanner, true);
+
 #define I2CEnablePin 12
 BMP085 pressure;
-float pressureFiltered;
 
 #define JonahBaud 4800
-SoftwareSerial JonahSerial(11, 9);
+CaptureSerial JonahSerial(11, -1);     // listening only, Timer1's TimerOne's
 JonahRX jonahRX;
 
 bool jonahListening = false;
@@ -56,10 +81,17 @@ struct JonahPacket
 JonahPacket lastJonahPacket;
 uint32_t lastJonahPacketReceiveTime = 0;
 
-// data for tracking the ascent rate
-const uint32_t c_AscentRateInterval = 30000ul;
-uint32_t ascentRateTime = 0;
-float ascentRateAlt = 0.0f;
+// altitude & ascent rate, from the BMP085 and GPS
+const AltitudeFilter::Config c_AltitudeFilterConfig = {
+    0.1f,   // baroSigma (m), 32 samples averaged
+    5.0f,   // gpsSigma (m)
+    1.0f,   // accelSigma (m/s^2), there's no accelerometer so this is all unmodeled
+    0.5f,   // baroDriftSigma (m/sqrt(s))
+    837,    // baroPeriod (ms), OSS 3 averaging 32 samples
+    1000,   // gpsPeriod (ms)
+};
+AltitudeFilter altitudeFilter;
+unsigned long lastGPSTime = TinyGPS::GPS_INVALID_TIME;
 float ascentRate = 0.0f;
 
 #define APRSPTTPin 4
@@ -87,13 +119,23 @@ const uint32_t TransmitIntervalFast = 30000ul;
 const uint32_t TransmitIntervalVeryFast = 15000ul;
 uint32_t lastTransmit = 0;
 
+// the fullest the buffers have been, against their sizes in the Memory row
+uint8_t jonahSerialPeak = 0;
+uint16_t packetBitsPeak = 0;
 
-void jonahUpdate(uint32_t now);
+
+void pollGPS(uint32_t now, uint32_t dt);
+void updateAltitude(uint32_t now, uint32_t dt);
+void readSensors(uint32_t now, uint32_t dt);
+void updateLED(uint32_t now, uint32_t dt);
+void jonahUpdate(uint32_t now, uint32_t dt);
 void jonahListen(uint32_t now);
 void jonahIgnore();
 void onJonahReceive(const uint8_t* data, size_t size);
 void transmitLoggingHeadings();
-void transmitLogging(uint32_t now);
+void transmitMemory();
+void transmitLogging(uint32_t now, uint32_t dt);
+void checkAPRS(uint32_t now, uint32_t dt);
 void transmitAPRS(uint32_t now);
 
 void setup()
@@ -101,7 +143,7 @@ void setup()
     pinMode(13, OUTPUT);
     digitalWrite(13, HIGH);
 
-    Serial.begin(115200);
+    Serial0.begin(115200);
 
     pinMode(I2CEnablePin, OUTPUT);
     digitalWrite(I2CEnablePin, HIGH);
@@ -109,18 +151,21 @@ void setup()
 
     delay(2000);
 
+    gpsConfig.setup();
+
     pinMode(BatteryMonitorPin, INPUT);
     batteryVoltage = analogRead(BatteryMonitorPin) / 1023.0f * 5.0f;
     batteryVoltageSmooth = batteryVoltage;
 
     for (uint8_t i=0; i<_countof(therms); ++i)
-        thermTempsFiltered[i] = Clamp(therms[i].getTemp(), -99.0, 99.0);
+        thermTempsFiltered[i] = Clamp(therms[i].getTemp(), -99.0f, 99.0f);
 
     pressure.setup();
     pressure.SetOversamplingSetting(3);
+    pressure.SetAveraging(32);
     pressure.SetReferencePressure(101325);
     pressure.loop();
-    pressureFiltered = pressure.GetPressureInPa();
+    altitudeFilter.setup(c_AltitudeFilterConfig);
 
     packet.setPTTPin(APRSPTTPin);
     pinMode(APRSTXPin, OUTPUT);
@@ -130,65 +175,87 @@ void setup()
     OCR2B = 0;
 
     uint32_t now = millis();
-    lastFrameTime = now;
-    loggingLastSend = now;
     lastJonahListenStart = now - c_JonahListenPeriod;
     lastTransmit = now - TransmitInterval + 5000;
 
+    scheduler.Add(pollGPS, 0, 0, c_GPSPollDeadline);
+    scheduler.Add(updateAltitude, c_AltitudeInterval);
+    scheduler.Add(readSensors, c_SensorInterval);
+    scheduler.Add(updateLED, c_LEDInterval);
+    scheduler.Add(jonahUpdate, c_JonahInterval);
+    scheduler.Add(transmitLogging, LoggingInterval, LoggingInterval);
+    scheduler.Add(checkAPRS, c_APRSCheckInterval);
+    scheduler.Start(now);
+
     transmitLoggingHeadings();
+    transmitMemory();
 
     digitalWrite(13, LOW);
 }
 
 void loop()
 {
-    const uint32_t now = millis();
-    const float dt = (now - lastFrameTime) * 0.001f;
-    lastFrameTime = now;
+    if (scheduler.loop())
+        fps.increment();
 
-    fps.increment();
+    fps.loop();
+    idle.loop(scheduler.GetTimeUntilNext(millis()));
+}
 
-    bool ledStatus =
-        (now % 1000) < 100 ||
-        (now - lastJonahPacketReceiveTime) < 500ul;
-    digitalWrite(13, ledStatus);
-    
-    batteryVoltage = analogRead(BatteryMonitorPin) / 1023.0f * 5.0f;
-    batteryVoltageSmooth = LowPassFilter(batteryVoltage, batteryVoltageSmooth, dt, 2.5f);
+void pollGPS(uint32_t now, uint32_t dt)
+{
+    bool gpsUpdated = false;
+    const unsigned short gpsSentences = gps.valid_sentences();
+    while (Serial0.available())
+    {
+        const char c = Serial0.read();
+        gpsConfig.Monitor(c);
+        gpsUpdated |= gps.encode(c);
+    }
+    gpsConfig.loop(gps.valid_sentences() != gpsSentences);
 
-    for (uint8_t i=0; i<_countof(therms); ++i)
-        thermTempsFiltered[i] = LowPassFilter((float)Clamp(therms[i].getTemp(), -99.0, 99.0), thermTempsFiltered[i], dt, 2.5f);
+    // ascent rate -- feed the filter once per GPS fix
+    unsigned long gpsTime;
+    if (gpsUpdated && gps.get_position(NULL, NULL) && gps.get_datetime(NULL, &gpsTime) && 
+        gpsTime != lastGPSTime && gps.altitude() != TinyGPS::GPS_INVALID_ALTITUDE)
+    {
+        lastGPSTime = gpsTime;
+        altitudeFilter.updateGPS(gps.altitude() * 10);
+    }
+}
 
-    while (Serial.available())
-        gps.encode((char)Serial.read());
+void updateAltitude(uint32_t now, uint32_t dt)
+{
+    altitudeFilter.predict(dt, 0);
 
-    pressure.loopAsync();
-    pressureFiltered = LowPassFilter((float)pressure.GetPressureInPa(), pressureFiltered, dt, 2.5f);
+    if (pressure.loopAsync())
+        altitudeFilter.updateBaro(pressure.GetAltitudeInMM());
 
-    jonahUpdate(now);
+    ascentRate = altitudeFilter.GetVerticalVelocityInMPerS();
+}
 
-    // ascent rate
-    if (gps.get_position(NULL, NULL))
-    {
-        if (ascentRateTime == 0)
-        {
-            ascentRateTime = now;
-            ascentRateAlt = gps.f_altitude();
-        }
-        else if (now - ascentRateTime > c_AscentRateInterval)
-        {
-            const float alt = gps.f_altitude();
-            ascentRate = (alt - ascentRateAlt) * 1000 / (now - ascentRateTime);
-            ascentRateTime = now;
-            ascentRateAlt = alt;
-        }
-    }
+void readSensors(uint32_t now, uint32_t dtInMS)
+{
+    const float dt = dtInMS * 0.001f;
+
+    batteryVoltage = analogRead(BatteryMonitorPin) / 1023.0f * 5.0f;
+    batteryVoltageSmooth = LowPassFilter(batteryVoltage, batteryVoltageSmooth, dt, 2.5f);
+
+    for (uint8_t i=0; i<_countof(therms); ++i)
+        thermTempsFiltered[i] = LowPassFilter(Clamp(therms[i].getTemp(), -99.0f, 99.0f), thermTempsFiltered[i], dt, 2.5f);
+}
 
+void updateLED(uint32_t now, uint32_t dt)
+{
+    bool ledStatus =
+        (now % 1000) < 100 ||
+        (now - lastJonahPacketReceiveTime) < 500ul;
+    digitalWrite(13, ledStatus);
+}
+
+void checkAPRS(uint32_t now, uint32_t dt)
+{
     // time to transmit?
-    if (now - loggingLastSend >= LoggingInterval)
-    {
-        transmitLogging(now);
-    }
     if (gps.get_position(NULL, NULL) && gps.get_datetime(NULL, NULL) &&
         (now - lastTransmit >= TransmitInterval ||
          now - lastTransmit >= TransmitIntervalFast && 
@@ -200,11 +267,9 @@ void loop()
     {
         transmitAPRS(now);
     }
-    
-    fps.loop();
 }
 
-void jonahUpdate(uint32_t now)
+void jonahUpdate(uint32_t now, uint32_t dt)
 {
     // handle jonah
     if (jonahListening && now - lastJonahListenStart >= c_JonahListenTimeout)
@@ -213,6 +278,8 @@ void jonahUpdate(uint32_t now)
     }
     else if (jonahListening)
     {
+        jonahSerialPeak = max(jonahSerialPeak, (uint8_t)JonahSerial.available());
+
         while (JonahSerial.available() && millis() - lastJonahListenStart < c_JonahListenTimeout)
         {
             if (jonahRX.onReceive(JonahSerial.read()))
@@ -255,138 +322,212 @@ void onJonahReceive(const uint8_t* data, size_t size)
     lastJonahPacketReceiveTime = millis();
 
 #if 0
-    Serial << F("Jonah,");
-    Serial.print(millis());
-    Serial.print(',');
-    Serial.print(lastJonahPacket.now);
-    Serial.print(',');
-    Serial.print(lastJonahPacket.batteryVoltage * 0.001, 3);
-    Serial.print(',');
-    Serial.print(lastJonahPacket.bmpPressure);
-    Serial.print(',');
-    Serial.print(lastJonahPacket.bmpTemp * 0.1, 1);
-    Serial.print(',');
-    Serial.print(lastJonahPacket.thermTemp * 0.001, 3);
-    Serial.println();
+    Serial0 << F("Jonah,");
+    Serial0.print(millis());
+    Serial0.print(',');
+    Serial0.print(lastJonahPacket.now);
+    Serial0.print(',');
+    Serial0.print(lastJonahPacket.batteryVoltage * 0.001, 3);
+    Serial0.print(',');
+    Serial0.print(lastJonahPacket.bmpPressure);
+    Serial0.print(',');
+    Serial0.print(lastJonahPacket.bmpTemp * 0.1, 1);
+    Serial0.print(',');
+    Serial0.print(lastJonahPacket.thermTemp * 0.001, 3);
+    Serial0.println();
 #endif
 }
 
 void transmitLoggingHeadings()
 {
-    Serial << F("now (ms),");
-    Serial << F("battery (V),");
-
-    Serial << F("gpsTime,");
-    Serial << F("gpsLat (deg),");
-    Serial << F("gpsLon (deg),");
-    Serial << F("gpsAlt (m),");
-    Serial << F("gpsAscentRate (m/s),");
-    Serial << F("gpsCourse (deg),");
-    Serial << F("gpsCourse (cardinal),");
-    Serial << F("gpsSpeed (m/s),");
-    Serial << F("gpsSats,");
+    Serial0 << F("now (ms),");
+    Serial0 << F("awake (ms),");
+    Serial0 << F("asleep (ms),");
+    Serial0 << F("battery (V),");
+
+    Serial0 << F("gpsTime,");
+    Serial0 << F("gpsLat (deg),");
+    Serial0 << F("gpsLon (deg),");
+    Serial0 << F("gpsAlt (m),");
+    Serial0 << F("ascentRate (m/s),");
+    Serial0 << F("gpsCourse (deg),");
+    Serial0 << F("gpsCourse (cardinal),");
+    Serial0 << F("gpsSpeed (m/s),");
+    Serial0 << F("gpsSats,");
     
     for (uint8_t i=0; i<_countof(therms); ++i)
     {
-        Serial << F("thermistor");
-        Serial.print(i);
-        Serial << F(" (deg C),");
+        Serial0 << F("thermistor");
+        Serial0.print(i);
+        Serial0 << F(" (deg C),");
     }
 
-    Serial << F("bmpTemp (deg C),");
-    Serial << F("bmpPressure (Pa),");
-
-    Serial << F("jonah receive count,");
-    Serial << F("jonah listen count,");
-    Serial << F("jonah now (ms),");
-    Serial << F("jonah battery (V),");
-    Serial << F("balloon pressure (Pa),");
-    Serial << F("balloon bmpTemp (deg C),");
-    Serial << F("balloon thermistor (deg C),");
+    Serial0 << F("bmpTemp (deg C),");
+    Serial0 << F("bmpPressure (Pa),");
+
+    Serial0 << F("jonah receive count,");
+    Serial0 << F("jonah listen count,");
+    Serial0 << F("jonah now (ms),");
+    Serial0 << F("jonah battery (V),");
+    Serial0 << F("balloon pressure (Pa),");
+    Serial0 << F("balloon bmpTemp (deg C),");
+    Serial0 << F("balloon thermistor (deg C),");
+
+    Serial0 << F("minFree (bytes),");
+    Serial0 << F("serialPeak (bytes),");
+    Serial0 << F("serialOverflows,");
+    Serial0 << F("serialOverruns,");
+    Serial0 << F("serialFramingErrors,");
+    Serial0 << F("jonahSerialPeak (bytes),");
+    Serial0 << F("jonahSerialOverflows,");
+    Serial0 << F("jonahSerialFramingErrors,");
+    Serial0 << F("aprsBitsPeak,");
+
+    Serial0.println();
+}
 
-    Serial.println();
+void transmitMemory()
+{
+    // where the static RAM's gone, the biggest users of it anyway
+    Serial0 << F("Memory,");
+    Serial0 << F("free (bytes),");
+    Serial0 << F("minFree (bytes),");
+    Serial0 << F("serial (bytes),");
+    Serial0 << F("jonahSerial (bytes),");
+    Serial0 << F("jonahRX (bytes),");
+    Serial0 << F("aprsPacket (bytes),");
+    Serial0 << F("aprsBits,");
+    Serial0 << F("gps (bytes),");
+    Serial0 << F("altitudeFilter (bytes),");
+    Serial0 << F("scheduler (bytes),");
+    Serial0.println();
+
+    Serial0 << F("Memory,");
+    Serial0.print(GetFreeMemory());
+    Serial0.print(',');
+    Serial0.print(GetMinFreeMemory());
+    Serial0.print(',');
+    Serial0.print(sizeof(Serial0));
+    Serial0.print(',');
+    Serial0.print(sizeof(JonahSerial));
+    Serial0.print(',');
+    Serial0.print(sizeof(jonahRX));
+    Serial0.print(',');
+    Serial0.print(sizeof(packet));
+    Serial0.print(',');
+    Serial0.print(packet.getBitStream().capacity());
+    Serial0.print(',');
+    Serial0.print(sizeof(gps));
+    Serial0.print(',');
+    Serial0.print(sizeof(altitudeFilter));
+    Serial0.print(',');
+    Serial0.print(sizeof(scheduler));
+    Serial0.print(',');
+    Serial0.println();
 }
 
-void transmitLogging(uint32_t now)
+void transmitLogging(uint32_t now, uint32_t dt)
 {
-    loggingLastSend = now;
+    Serial0.print(now);
+    Serial0.print(',');
 
-    Serial.print(now);
-    Serial.print(',');
+    Serial0.print(idle.GetResidency(IdleManager::EState::Awake));
+    Serial0.print(',');
+    Serial0.print(idle.GetResidency(IdleManager::EState::Asleep));
+    Serial0.print(',');
 
-    Serial.print(batteryVoltageSmooth, 3);
-    Serial.print(',');
+    Serial0.print(batteryVoltageSmooth, 3);
+    Serial0.print(',');
 
     uint8_t hours, minutes, seconds, hundredths;
     if (gps.crack_datetime(NULL, NULL, NULL, &hours, &minutes, &seconds, &hundredths))
     {
-        Serial.print((int)hours);
-        Serial.print(':');
-        Serial.print((int)minutes);
-        Serial.print(':');
-        Serial.print(seconds + 0.01f * hundredths, 2);
+        Serial0.print((int)hours);
+        Serial0.print(':');
+        Serial0.print((int)minutes);
+        Serial0.print(':');
+        Serial0.print(seconds + 0.01f * hundredths, 2);
     }
-    Serial.print(',');
+    Serial0.print(',');
 
     float lat, lon;
     if (gps.f_get_position(&lat, &lon))
     {
-        Serial.print(lat, 6);
-        Serial.print(',');
-        Serial.print(lon, 6);
-        Serial.print(',');
-        Serial.print(gps.f_altitude(), 3);
-        Serial.print(',');
-        Serial.print(ascentRate, 3);
-        Serial.print(',');
-        Serial.print(gps.f_course(), 3);
-        Serial.print(',');
-        Serial.print(TinyGPS::cardinal(gps.f_course()));
-        Serial.print(',');
-        Serial.print(gps.f_speed_mps(), 3);
-        Serial.print(',');
-        Serial.print(gps.satellites());
-        Serial.print(',');
+        Serial0.print(lat, 6);
+        Serial0.print(',');
+        Serial0.print(lon, 6);
+        Serial0.print(',');
+        Serial0.print(gps.f_altitude(), 3);
+        Serial0.print(',');
+        Serial0.print(ascentRate, 3);
+        Serial0.print(',');
+        Serial0.print(gps.f_course(), 3);
+        Serial0.print(',');
+        Serial0.print(TinyGPS::cardinal(gps.f_course()));
+        Serial0.print(',');
+        Serial0.print(gps.f_speed_mps(), 3);
+        Serial0.print(',');
+        Serial0.print(gps.satellites());
+        Serial0.print(',');
     }
     else
     {
-        Serial.print(',');
-        Serial.print(',');
-        Serial.print(',');
-        Serial.print(',');
-        Serial.print(',');
-        Serial.print(',');
-        Serial.print(',');
-        Serial.print(',');
+        Serial0.print(',');
+        Serial0.print(',');
+        Serial0.print(',');
+        Serial0.print(',');
+        Serial0.print(',');
+        Serial0.print(',');
+        Serial0.print(',');
+        Serial0.print(',');
     }
 
     for (uint8_t i=0; i<_countof(therms); ++i)
     {
-        Serial.print(thermTempsFiltered[i], 2);
-        Serial.print(',');
+        Serial0.print(thermTempsFiltered[i], 2);
+        Serial0.print(',');
     }
 
-    Serial.print(pressure.GetTempInC(), 1);
-    Serial.print(',');
-    Serial.print(pressureFiltered, 0);
-    Serial.print(',');
-
-    Serial.print(jonahReceiveCount);
-    Serial.print(',');
-    Serial.print(jonahListenCount);
-    Serial.print(',');
-    Serial.print(lastJonahPacket.now);
-    Serial.print(',');
-    Serial.print(lastJonahPacket.batteryVoltage * 0.001, 3);
-    Serial.print(',');
-    Serial.print(lastJonahPacket.bmpPressure);
-    Serial.print(',');
-    Serial.print(lastJonahPacket.bmpTemp * 0.1, 1);
-    Serial.print(',');
-    Serial.print(lastJonahPacket.thermTemp * 0.001, 3);
-    Serial.print(',');
-
-    Serial.println();
+    Serial0.print(pressure.GetTempInC(), 1);
+    Serial0.print(',');
+    Serial0.print(pressure.GetPressureInPa());
+    Serial0.print(',');
+
+    Serial0.print(jonahReceiveCount);
+    Serial0.print(',');
+    Serial0.print(jonahListenCount);
+    Serial0.print(',');
+    Serial0.print(lastJonahPacket.now);
+    Serial0.print(',');
+    Serial0.print(lastJonahPacket.batteryVoltage * 0.001, 3);
+    Serial0.print(',');
+    Serial0.print(lastJonahPacket.bmpPressure);
+    Serial0.print(',');
+    Serial0.print(lastJonahPacket.bmpTemp * 0.1, 1);
+    Serial0.print(',');
+    Serial0.print(lastJonahPacket.thermTemp * 0.001, 3);
+    Serial0.print(',');
+
+    Serial0.print(GetMinFreeMemory());
+    Serial0.print(',');
+    Serial0.print(Serial0.GetRxPeak());
+    Serial0.print(',');
+    Serial0.print(Serial0.GetOverflowCount());
+    Serial0.print(',');
+    Serial0.print(Serial0.GetOverrunCount());
+    Serial0.print(',');
+    Serial0.print(Serial0.GetFramingErrorCount());
+    Serial0.print(',');
+    Serial0.print(jonahSerialPeak);
+    Serial0.print(',');
+    Serial0.print(JonahSerial.GetOverflowCount());
+    Serial0.print(',');
+    Serial0.print(JonahSerial.GetFramingErrorCount());
+    Serial0.print(',');
+    Serial0.print(packetBitsPeak);
+    Serial0.print(',');
+
+    Serial0.println();
 }
 
 void transmitAPRS(uint32_t now)
@@ -453,6 +594,7 @@ void transmitAPRS(uint32_t now)
             "/Pe=%.6ld"
             "/Pb=%.6ld"
             "/A'=%+.2ld"
+            "/M=%u"
             "/#%lu"),
             miceInfo,
             (int32_t)thermTempsFiltered[0],
@@ -464,9 +606,10 @@ void transmitAPRS(uint32_t now)
             (int32_t)fabs(batteryVoltageSmooth * 100) % 100,
             (int32_t)(lastJonahPacket.batteryVoltage / 1000),
             (int32_t)(lastJonahPacket.batteryVoltage / 10) % 100,
-            (int32_t)pressureFiltered,
+            pressure.GetPressureInPa(),
             (int32_t)lastJonahPacket.bmpPressure,
             (int32_t)(ascentRate * 10),
+            GetMinFreeMemory(),
             msgNum
         );
 #else
@@ -501,42 +644,44 @@ void transmitAPRS(uint32_t now)
     }
 
 #if 1
-    Serial.print(now);
-    Serial.print(',');
-    Serial.print(c_SrcAddress.m_CallSign);
-    Serial.print('-');
-    Serial.print((int)c_SrcAddress.m_SSID);
+    Serial0.print(now);
+    Serial0.print(',');
+    Serial0.print(c_SrcAddress.m_CallSign);
+    Serial0.print('-');
+    Serial0.print((int)c_SrcAddress.m_SSID);
 
     for (int i=0; i<pathCount; ++i)
     {
-        Serial.print('/');
-        Serial.print(c_FullPath[i].m_CallSign);
-        Serial.print('-');
-        Serial.print((int)c_FullPath[i].m_SSID);
+        Serial0.print('/');
+        Serial0.print(c_FullPath[i].m_CallSign);
+        Serial0.print('-');
+        Serial0.print((int)c_FullPath[i].m_SSID);
     }
 
-    Serial.print('>');
-    Serial.print(dest.m_CallSign);
-    Serial.print('-');
-    Serial.print((int)dest.m_SSID);
-    Serial.print(msg);
-    Serial.print(',');
+    Serial0.print('>');
+    Serial0.print(dest.m_CallSign);
+    Serial0.print('-');
+    Serial0.print((int)dest.m_SSID);
+    Serial0.print(msg);
+    Serial0.print(',');
 
-    Serial.print(strlen(msg));
-    Serial.print(',');
+    Serial0.print(strlen(msg));
+    Serial0.print(',');
 
-    Serial.print(GetFreeMemory());
-    Serial.print(',');
+    Serial0.print(GetMinFreeMemory());
+    Serial0.print(',');
 
-    Serial.println();
+    Serial0.println();
 #endif
 
     packet.build(c_SrcAddress, dest, c_FullPath, pathCount, msg);
+    packetBitsPeak = max(packetBitsPeak, (uint16_t)packet.getBitStream().size());
     packet.transmit(&sinewave);
 
-    // wait for the packet to be done transmitting
+    // wait for the packet to be done transmitting, asleep between the baud interrupts
     while (packet.transmitting())
     {
+        idle.Sleep();
     }
 }
 
@@ -1,31 +1,77 @@
 #include <Core.h>
 #include <Wire.h>
+#include <Scheduler.h>
+#include <IdleManager.h>
 #include <VectorMath.h>
 #include <MatrixMath.h>
 #include <Quaternion.h>
 #include <FPS.h>
+#include <CRC.h>
+#include <Profiler.h>
 #include <TinyGPS.h>
+#include <VenusGPS.h>
+#include <GPSConfigurator.h>
+#include <Timebase.h>
 #include <HMC5843.h>
 #include <ADXL345.h>
 #include <ITG3200.h>
 #include <BMP085.h>
+#include <AltitudeFilter.h>
+#include <Geodesy.h>
+#include <LandingPredictor.h>
+#include <FlightEvents.h>
+#include <EventCapture.h>
 #include <TMP102.h>
 #include <Thermistor.h>
-#include <SoftwareSerial.h>
+#include <BufferedSerial.h>
+#include <CaptureSerial.h>
+#include <SPI.h>
+#include <SPIFlash.h>
+#include <FlightRecorder.h>
+#include <BulkSender.h>
+#include <CommandAuth.h>
+#include <CommandReceiver.h>
 
 #include <XTendAPI.h>
 
 #include "Config.h"
 #include "Packets.h"
+#include "Records.h"
 
-uint32_t lastFrameTime = 0;
+BufferedSerialPort<SerialRxBufferSize, SerialTxBufferSize> Serial0(0);
+
+Scheduler scheduler;
+IdleManager idle;
+uint8_t loggingTask = Scheduler::c_InvalidTask;
+uint8_t telemetryTask = Scheduler::c_InvalidTask;
+uint16_t loggingInterval = LoggingInterval;             // ms, either can be changed by a command
+uint16_t telemetryInterval = TelemetryTransmitInterval;
 FPS fps(TargetFrameTime);
 
+#ifdef Profiling
+Profiler profiler;
+
+// in the order the tasks are added
+const char ProfilePollSerial[] PROGMEM = "pollSerial";
+const char ProfileReadIMU[] PROGMEM = "readIMU";
+const char ProfileReadPressure[] PROGMEM = "readPressure";
+const char ProfileReadMagneto[] PROGMEM = "readMagneto";
+const char ProfileReadEnvironment[] PROGMEM = "readEnvironment";
+const char ProfileTransmitLogging[] PROGMEM = "transmitLogging";
+const char ProfileTransmitTelemetry[] PROGMEM = "transmitTelemetry";
+const char ProfileTransmitProfile[] PROGMEM = "transmitProfile";
+#endif
+
 const float c_BatteryVoltageScale = 3.3f / 1024.0f / (3.9 / (3.9 + 1.2));
 float batteryVoltage = 0.0f;
 float batteryVoltageSmooth = 0.0f;
 
+#ifdef GPSBinary
+VenusGPS gps(&GPSSerial);
+#else
 TinyGPS gps;
+#endif
+GPSConfigurator gpsConfig(&GPSSerial, GPSConfigurator::EProtocol::Venus, GPSBaud, GPSConfigScript, GPSResetBanner, GPSSerialShared);
 HMC5843 magneto;
 ADXL345 accel;
 ITG3200 gyro;
@@ -37,25 +83,99 @@ float thermTempsFiltered[_countof(therms)];
 vec3 accelFiltered(0.0f, 0.0f, -9.8f);
 vec3 angVelFiltered(0.0f, 0.0f, 0.0f);
 
-SoftwareSerial XTendSerial(XTendSerialRXPin, XTendSerialTXPin);
+AltitudeFilter altitudeFilter;
+unsigned long lastGPSTime = TinyGPS::GPS_INVALID_TIME;
+
+#ifdef LandingPrediction
+LandingPredictor landingPredictor;
+#endif
+
+#ifdef FlightEventCapture
+FlightEvents flightEvents;
+EventCapture eventCapture;
+bool capturing = false;
+#endif
+
+#ifdef FlightRecording
+SPIFlash flash(FlightRecorderCSPin);
+FlightRecorder recorder;
+uint32_t lastRecordTime = 0;
+#endif
+
+#ifdef BulkDownlink
+BulkSender bulkSender;
+uint32_t lastBulkTime = 0;
+bool bulkPaused = false;
+#endif
+
+#ifdef CommandUplink
+CommandAuth commandAuth(CommandKey);
+CommandReceiver commandReceiver;
+uint16_t commandRejectedCount = 0;      // that didn't check out
+bool fastBeacon = false;
+uint32_t fastBeaconEnd = 0;
+
+// runs a command whose arg is in range, and returns an ECommandResult
+typedef uint8_t (*CommandFunction)(uint32_t now, uint32_t arg);
+
+struct CommandEntry
+{
+	uint8_t command;            // ECommand
+	uint32_t minArg;
+	uint32_t maxArg;
+	CommandFunction function;
+};
+
+uint8_t commandTelemetryInterval(uint32_t now, uint32_t arg);
+uint8_t commandLoggingInterval(uint32_t now, uint32_t arg);
+uint8_t commandFastBeacon(uint32_t now, uint32_t arg);
+uint8_t commandBulkEnable(uint32_t now, uint32_t arg);
+uint8_t commandBulkRewind(uint32_t now, uint32_t arg);
+
+const CommandEntry commandTable[] PROGMEM = {
+	{ECommand::TelemetryInterval, 250, 60000, commandTelemetryInterval},
+	{ECommand::LoggingInterval, 50, 60000, commandLoggingInterval},
+	{ECommand::FastBeacon, 0, 3600, commandFastBeacon},
+	{ECommand::BulkEnable, 0, 1, commandBulkEnable},
+	{ECommand::BulkRewind, 0, 0xFFFFFFFF, commandBulkRewind},
+};
+#endif
+
+CaptureSerial XTendSerial(XTendSerialRXPin, XTendSerialTXPin);
 XTendAPI xtend(&XTendSerial);
 uint32_t packetNum = 0;
 
-uint32_t loggingLastSend = 0;
-uint32_t telemetryLastSend = 0;
-
 
-void xtendReceive();
+void pollSerial(uint32_t now, uint32_t dt);
+void readIMU(uint32_t now, uint32_t dt);
+void readPressure(uint32_t now, uint32_t dt);
+void readMagneto(uint32_t now, uint32_t dt);
+void readEnvironment(uint32_t now, uint32_t dt);
+int32_t getVerticalAccelInMMPerS2();
+void updateFlightEvents(uint32_t now);
+void setIMURate(bool high);
+void xtendReceive(uint32_t now);
+void handleCommand(uint32_t now, const CommandPacket& packet);
+uint8_t runCommand(uint32_t now, uint8_t command, uint32_t arg);
 void transmitLoggingHeadings();
-void transmitLogging(uint32_t now);
-void transmitTelemetry(uint32_t now);
+void transmitMemory();
+void transmitTimestamp(uint32_t time);
+void transmitLogging(uint32_t now, uint32_t dt);
+void recordFlight(uint32_t now);
+void transmitTelemetry(uint32_t now, uint32_t dt);
+void transmitBulk(uint32_t now);
+void transmitEvent(uint32_t now, FlightEvents::EEvent::Enum event);
+void transmitCapture(uint32_t now, const EventCapture::Sample& sample);
+void transmitProfile(uint32_t now, uint32_t dt);
 
 void setup()
 {
+#ifndef FlightRecording
 	pinMode(13, OUTPUT);
 	digitalWrite(13, HIGH);
+#endif
 
-	Serial.begin(LoggingBaud);
+	Serial0.begin(LoggingBaud);
 
 	Wire.begin();
 
@@ -71,13 +191,15 @@ void setup()
 	batteryVoltage = analogRead(BatteryMonitorPin) * c_BatteryVoltageScale;
 	batteryVoltageSmooth = batteryVoltage;
 
-	GPSSerial.begin(GPSBaud);
+	gpsConfig.setup();
+	g_Timebase.setup();
 
 	magneto.setup(HMC5843::EOutputRate::FiftyHz);
 	accel.setup();
 	gyro.setup();
 	pressure.setup();
 	pressure.SetOversamplingSetting(3);
+	pressure.SetAveraging(4);
 	for (uint8_t i=0; i<ETMPs::EnumCount; ++i)
 		tmps[i].setup(true, TMP102::EConversionRate::Hz8);
 
@@ -87,63 +209,225 @@ void setup()
 	pressure.SetReferencePressure(101325);
 	pressure.loop();
 
-	uint32_t now = millis();
-	lastFrameTime = now;
-	loggingLastSend = now - LoggingStagger;
-	telemetryLastSend = now - TelemetryTransmitStagger;
+	altitudeFilter.setup(AltitudeFilterConfig);
+	altitudeFilter.updateBaro(pressure.GetAltitudeInMM());
+
+#ifdef LandingPrediction
+	landingPredictor.setup(LandingPredictorConfig);
+#endif
+
+#ifdef FlightEventCapture
+	flightEvents.setup(FlightEventsConfig);
+	eventCapture.setup(EventCaptureConfig);
+	setIMURate(false);
+#endif
+
+#ifdef FlightRecording
+	if (flash.setup())
+		recorder.setup(&flash);
+#endif
+#ifdef BulkDownlink
+	// from where this run of the log starts
+	bulkSender.setup(BulkSenderConfig, recorder.GetSealedPosition() / BulkPacket::c_ChunkSize);
+#endif
+#ifdef CommandUplink
+	// somewhere random to number the commands from: how long setup took, and the ADC's noise
+	uint16_t seed = micros();
+	for (uint8_t i=0; i<16; ++i)
+		seed = ((seed << 1) | (seed >> 15)) ^ analogRead(BatteryMonitorPin);
+	commandReceiver.setup(seed);
+#endif
+
+	scheduler.Add(pollSerial, 0, 0, SerialPollDeadline);
+	scheduler.Add(readIMU, IMUInterval);
+	scheduler.Add(readPressure, PressureInterval);
+	scheduler.Add(readMagneto, MagnetoInterval);
+	scheduler.Add(readEnvironment, EnvironmentInterval);
+	loggingTask = scheduler.Add(transmitLogging, loggingInterval, LoggingPhase);
+	telemetryTask = scheduler.Add(transmitTelemetry, telemetryInterval, TelemetryTransmitPhase);
+#ifdef Profiling
+	scheduler.Add(transmitProfile, ProfileInterval, ProfilePhase);
+
+	const char* const profileNames[] = {ProfilePollSerial, ProfileReadIMU, ProfileReadPressure, ProfileReadMagneto, ProfileReadEnvironment, ProfileTransmitLogging, ProfileTransmitTelemetry, ProfileTransmitProfile};
+	for (uint8_t i=0; i<_countof(profileNames); ++i)
+		profiler.SetName(i, profileNames[i]);
+	scheduler.SetProfiler(&profiler);
+#endif
+	scheduler.Start(millis());
 	
 	transmitLoggingHeadings();
+	transmitMemory();
 
+#ifndef FlightRecording
 	digitalWrite(13, LOW);
+#endif
 }
 
 void loop()
 {
-	const uint32_t now = millis();
-	const float dt = (now - lastFrameTime) * 0.001f;
-	lastFrameTime = now;
+	if (scheduler.loop())
+		fps.increment();
+	
+	fps.loop();
+#ifdef Profiling
+	profiler.loop();
+#endif
+#ifdef FlightRecording
+	recorder.loop();
+#endif
+
+	idle.loop(scheduler.GetTimeUntilNext(millis()));
+}
+
+
+
+void pollSerial(uint32_t now, uint32_t dt)
+{
+	g_Timebase.loop();
+
+	bool gpsUpdated = false;
+	const unsigned short gpsSentences = gps.valid_sentences();
+	while (GPSSerial.available())
+	{
+		const char c = GPSSerial.read();
+		gpsConfig.Monitor(c);
+		gpsUpdated |= gps.encode(c);
+	}
+	gpsConfig.loop(gps.valid_sentences() != gpsSentences);
+
+	unsigned long gpsTime, gpsAge;
+	if (gpsUpdated && gps.get_datetime(NULL, &gpsTime, &gpsAge))
+		g_Timebase.SetGPSTime(gpsTime, gpsAge);
+
+	// altitude & ascent rate
+	if (gpsUpdated && gps.get_position(NULL, NULL) && gps.get_datetime(NULL, &gpsTime) &&
+	    gpsTime != lastGPSTime && gps.altitude() != TinyGPS::GPS_INVALID_ALTITUDE)
+	{
+		lastGPSTime = gpsTime;
+		altitudeFilter.updateGPS(gps.altitude() * 10);
+
+#ifdef LandingPrediction
+		long lat, lon;
+		gps.get_position(&lat, &lon);
+		landingPredictor.AddFix(now, lat, lon, gps.altitude() / 100, (int16_t)Clamp<int32_t>(altitudeFilter.GetVerticalVelocityInMMPerS() / 10, -32767, 32767));
+#endif
+	}
+
+	// network receive, and a chunk of the log down if there's room
+	xtendReceive(now);
+	transmitBulk(now);
+}
+
+void readIMU(uint32_t now, uint32_t dt)
+{
+	accel.loop();
+	gyro.loop();
+
+	accelFiltered = accel.GetOutput();//LowPassFilter(accel.GetOutput(), accelFiltered, dt * 0.001f, 0.25f);
+	angVelFiltered = gyro.GetAngVel();//LowPassFilter(gyro.GetBiasedAngVel(), angVelFiltered, dt * 0.001f, 0.25f);
+
+	altitudeFilter.predict(dt, getVerticalAccelInMMPerS2());
+
+#ifdef FlightEventCapture
+	updateFlightEvents(now);
+#endif
+}
+
+void readPressure(uint32_t now, uint32_t dt)
+{
+	if (!pressure.loopAsync())
+		return;
+
+	altitudeFilter.updateBaro(pressure.GetAltitudeInMM());
+#ifdef FlightEventCapture
+	flightEvents.UpdatePressure(pressure.GetReadingTime(), pressure.GetPressureInPa());
+#endif
+}
+
+void readMagneto(uint32_t now, uint32_t dt)
+{
+	magneto.loop();
+}
 
-	fps.increment();
+void readEnvironment(uint32_t now, uint32_t dtInMS)
+{
+	const float dt = dtInMS * 0.001f;
 
+#ifndef FlightRecording
 	digitalWrite(13, (now / 250) % 2);
-	
-	// update sensors
+#endif
+
 	batteryVoltage = analogRead(BatteryMonitorPin) * c_BatteryVoltageScale;
 	batteryVoltageSmooth = LowPassFilter(batteryVoltage, batteryVoltageSmooth, dt, 2.5f);
 
 	for (uint8_t i=0; i<_countof(therms); ++i)
-		thermTempsFiltered[i] = LowPassFilter((float)therms[i].getTemp(), thermTempsFiltered[i], dt, 2.5f);
+		thermTempsFiltered[i] = LowPassFilter(therms[i].getTemp(), thermTempsFiltered[i], dt, 2.5f);
 
-	while (GPSSerial.available())
-		gps.encode(GPSSerial.read());
-	
-	magneto.loop();
-	accel.loop();
-	gyro.loop();
-	pressure.loopAsync();
 	for (uint8_t i=0; i<ETMPs::EnumCount; ++i)
 		tmps[i].loop();
+}
 
-	accelFiltered = accel.GetOutput();//LowPassFilter(accel.GetOutput(), accelFiltered, dt, 0.25f);
-	angVelFiltered = gyro.GetAngVel();//LowPassFilter(gyro.GetBiasedAngVel(), angVelFiltered, dt, 0.25f);
 
-	// network receive
-	xtendReceive();
 
-	// time to transmit?
-	if (now - loggingLastSend >= LoggingInterval)
-		transmitLogging(now);
-	if (now - telemetryLastSend >= TelemetryTransmitInterval)
-		transmitTelemetry(now);
-	
-	fps.loop();
+int32_t getVerticalAccelInMMPerS2()
+{
+	// the accelerometer's Z axis points down, and it's in full resolution mode (256 LSB/g)
+	const int32_t g = 9807;
+	return -((int32_t)accel.GetOutputRaw().z * g / 256) - g;
 }
 
+void updateFlightEvents(uint32_t now)
+{
+#ifdef FlightEventCapture
+	const ADXL345::OutputRaw accelRaw = accel.GetOutputRaw();
+	const int16_t ascentRate = (int16_t)Clamp<int32_t>(altitudeFilter.GetVerticalVelocityInMMPerS() / 10, -32767, 32767);
+
+	const FlightEvents::EEvent::Enum event = flightEvents.Update(now, altitudeFilter.GetAltitudeInMM(), altitudeFilter.GetVerticalVelocityInMMPerS(), accelRaw.x, accelRaw.y, accelRaw.z);
+	if (event != FlightEvents::EEvent::None)
+	{
+		eventCapture.Trigger(now);
+		transmitEvent(now, event);
+	}
+
+	// write some out before sampling, so a full buffer from before the trigger has room
+	EventCapture::Sample sample;
+	for (uint8_t i=0; i<CaptureRowsPerLoop && eventCapture.Read(&sample); ++i)
+		transmitCapture(now, sample);
+
+	if (eventCapture.IsSampleDue(now))
+	{
+		const ITG3200::OutputRaw gyroRaw = gyro.GetOutputRaw();
+		sample.time = (uint16_t)now;
+		sample.accel[0] = accelRaw.x;
+		sample.accel[1] = accelRaw.y;
+		sample.accel[2] = accelRaw.z;
+		sample.gyro[0] = gyroRaw.x;
+		sample.gyro[1] = gyroRaw.y;
+		sample.gyro[2] = gyroRaw.z;
+		sample.ascentRate = ascentRate;
+		eventCapture.AddSample(now, sample);
+	}
 
+	// the IMU and logging run faster while we're capturing
+	const bool wasCapturing = capturing;
+	capturing = eventCapture.IsCapturing(now);
+	if (capturing != wasCapturing)
+	{
+		setIMURate(capturing);
+		scheduler.SetPeriod(loggingTask, capturing ? LoggingCaptureInterval : loggingInterval);
+	}
+#endif
+}
+
+// normally what setup() leaves them at, and twice the bandwidth while capturing an event
+void setIMURate(bool high)
+{
+	accel.SetOutputRate(high ? ADXL345::EOutputRate::Hz200 : ADXL345::EOutputRate::Hz100);
+	gyro.SetLowPassFilterConfig(high ? ITG3200::ELowPassFilterConfig::Filter188Hz_Sample1kHz : ITG3200::ELowPassFilterConfig::Filter98Hz_Sample1kHz);
+}
 
-void xtendReceive()
+void xtendReceive(uint32_t now)
 {
-/*
 	const XTendAPI::Frame* pFrame;
 	while (xtend.Receive(&pFrame))
 	{
@@ -154,167 +438,539 @@ void xtendReceive()
 			case EPacketType::Ping:
 				if (pFrame->m_PayloadLength == sizeof(PingPacket))
 				{
+					// stamped when its last byte came in, unless more has come in since, rather than when we got round
+					// to reading it, and as the answer goes, so that the poll loop's latency isn't counted as the air's
 					const PingPacket* pPacket = reinterpret_cast<const PingPacket*>(pFrame->m_Payload);
 					PongPacket pong;
-					pong.time = pPacket->time;
+					pong.originate = pPacket->originate;
+					pong.receive = (XTendSerial.available() ? millis() : XTendSerial.GetLastRxTime());
+					pong.transmit = millis();
 					xtend.SendTo(XTendDest, (uint8_t*)&pong, sizeof(pong));
 				}
 				break;
+
+#ifdef BulkDownlink
+			case EPacketType::BulkAck:
+				if (pFrame->m_PayloadLength == sizeof(BulkAckPacket))
+				{
+					const BulkAckPacket* pPacket = reinterpret_cast<const BulkAckPacket*>(pFrame->m_Payload);
+					bulkSender.OnAck(now, pPacket->base, pPacket->received, pPacket->latestStamp);
+				}
+				break;
+#endif
+#ifdef CommandUplink
+			case EPacketType::Command:
+				if (pFrame->m_PayloadLength == sizeof(CommandPacket))
+					handleCommand(now, *reinterpret_cast<const CommandPacket*>(pFrame->m_Payload));
+				break;
+#endif
 			}
 		}
 	}
-*/
 }
 
+void handleCommand(uint32_t now, const CommandPacket& packet)
+{
+#ifdef CommandUplink
+	if (!commandAuth.Verify(&packet, sizeof(packet) - sizeof(packet.mac), packet.mac))
+	{
+		++commandRejectedCount;
+		return;
+	}
+
+	// the tracker sends it again until it hears back, so one that's been run is only answered again
+	CommandAnswerPacket answer;
+	answer.sequence = packet.sequence;
+	switch (commandReceiver.OnCommand(packet.sequence))
+	{
+	case CommandReceiver::EVerdict::New:
+		commandReceiver.SetResult(runCommand(now, packet.command, packet.arg));
+
+		Serial0.print(F("Command,"));
+		Serial0.print(now);
+		Serial0.print(',');
+		transmitTimestamp(now);
+		Serial0.print(packet.sequence);
+		Serial0.print(',');
+		Serial0.print(packet.command);
+		Serial0.print(',');
+		Serial0.print(packet.arg);
+		Serial0.print(',');
+		Serial0.print(commandReceiver.GetLastResult());
+		Serial0.print(',');
+		Serial0.println();
+		// fall through
+
+	case CommandReceiver::EVerdict::Repeat:
+		answer.result = commandReceiver.GetLastResult();
+		break;
+
+	case CommandReceiver::EVerdict::Stale:
+		answer.sequence = commandReceiver.GetLastSequence();
+		answer.result = ECommandResult::Stale;
+		break;
+	}
+
+	answer.mac = commandAuth.Sign(&answer, sizeof(answer) - sizeof(answer.mac));
+	xtend.SendTo(XTendDest, (uint8_t*)&answer, sizeof(answer));
+#endif
+}
+
+uint8_t runCommand(uint32_t now, uint8_t command, uint32_t arg)
+{
+#ifdef CommandUplink
+	for (uint8_t i=0; i<_countof(commandTable); ++i)
+	{
+		CommandEntry entry;
+		memcpy_P(&entry, &commandTable[i], sizeof(entry));
+		if (entry.command != command)
+			continue;
+
+		if (arg < entry.minArg || arg > entry.maxArg)
+			return ECommandResult::BadArg;
+		return entry.function(now, arg);
+	}
+#endif
+	return ECommandResult::UnknownCommand;
+}
+
+#ifdef CommandUplink
+uint8_t commandTelemetryInterval(uint32_t now, uint32_t arg)
+{
+	// a fast beacon carries on, and this takes over once it's done
+	telemetryInterval = arg;
+	if (!fastBeacon)
+		scheduler.SetPeriod(telemetryTask, telemetryInterval);
+	return ECommandResult::Done;
+}
+
+uint8_t commandLoggingInterval(uint32_t now, uint32_t arg)
+{
+	loggingInterval = arg;
+#ifdef FlightEventCapture
+	if (capturing)
+		return ECommandResult::Done;
+#endif
+	scheduler.SetPeriod(loggingTask, loggingInterval);
+	return ECommandResult::Done;
+}
+
+uint8_t commandFastBeacon(uint32_t now, uint32_t arg)
+{
+	fastBeacon = arg > 0;
+	fastBeaconEnd = now + arg * 1000;
+	scheduler.SetPeriod(telemetryTask, fastBeacon ? FastBeaconInterval : telemetryInterval);
+	return ECommandResult::Done;
+}
+
+uint8_t commandBulkEnable(uint32_t now, uint32_t arg)
+{
+#ifdef BulkDownlink
+	bulkPaused = !arg;
+	return ECommandResult::Done;
+#else
+	return ECommandResult::Unavailable;
+#endif
+}
+
+uint8_t commandBulkRewind(uint32_t now, uint32_t arg)
+{
+#ifdef BulkDownlink
+	bulkSender.Rewind(arg);
+	return ECommandResult::Done;
+#else
+	return ECommandResult::Unavailable;
+#endif
+}
+#endif
+
 
 
 void transmitLoggingHeadings()
 {
-	Serial.print("now (ms),");
-	Serial.print("fps,");
-	Serial.print("battery (V),");
-
-	Serial.print("gpsTime,");
-	Serial.print("gpsLat (deg),");
-	Serial.print("gpsLon (deg),");
-	Serial.print("gpsAlt (m),");
-	Serial.print("gpsCourse (deg),");
-	Serial.print("gpsCourse (cardinal),");
-	Serial.print("gpsSpeed (m/s),");
-	Serial.print("gpsSats,");
+	Serial0.print(F("now (ms),"));
+	Serial0.print(F("ppsTime (s),"));
+	Serial0.print(F("fps,"));
+	Serial0.print(F("awake (ms),"));
+	Serial0.print(F("asleep (ms),"));
+	Serial0.print(F("battery (V),"));
+
+	Serial0.print(F("gpsTime,"));
+	Serial0.print(F("gpsLat (deg),"));
+	Serial0.print(F("gpsLon (deg),"));
+	Serial0.print(F("gpsAlt (m),"));
+	Serial0.print(F("gpsCourse (deg),"));
+	Serial0.print(F("gpsCourse (cardinal),"));
+	Serial0.print(F("gpsSpeed (m/s),"));
+	Serial0.print(F("gpsSats,"));
 	
-	Serial.print("bmpTemp (deg C),");
-	Serial.print("bmpPressure (Pa),");
-	Serial.print("bmpAlt (m),");
+	Serial0.print(F("bmpTime (s),"));
+	Serial0.print(F("bmpTemp (deg C),"));
+	Serial0.print(F("bmpPressure (Pa),"));
+	Serial0.print(F("bmpAlt (m),"));
+	Serial0.print(F("altitude (m),"));
+	Serial0.print(F("ascentRate (m/s),"));
 
 	for (uint8_t i=0; i<EThermistors::EnumCount; ++i)
-		serprintf(Serial, "thermistor%hu (deg C),", i);
+		serprintf(Serial0, "thermistor%hu (deg C),", i);
 	
 	for (uint8_t i=0; i<ETMPs::EnumCount; ++i)
-		serprintf(Serial, "tmp%hu (deg C),", i);
+		serprintf(Serial0, "tmp%hu (deg C),", i);
+	
+	Serial0.print(F("gyroTemp (deg C),"));
 	
-	Serial.print("gyroTemp (deg C),");
+	Serial0.print(F("accelX (m/s^2),"));
+	Serial0.print(F("accelY (m/s^2),"));
+	Serial0.print(F("accelZ (m/s^2),"));
 	
-	Serial.print("accelX (m/s^2),");
-	Serial.print("accelY (m/s^2),");
-	Serial.print("accelZ (m/s^2),");
+	Serial0.print(F("angVelX (deg/s),"));
+	Serial0.print(F("angVelY (deg/s),"));
+	Serial0.print(F("angVelZ (deg/s),"));
 	
-	Serial.print("angVelX (deg/s),");
-	Serial.print("angVelY (deg/s),");
-	Serial.print("angVelZ (deg/s),");
+	Serial0.print(F("magX (Gauss),"));
+	Serial0.print(F("magY (Gauss),"));
+	Serial0.print(F("magZ (Gauss),"));
 	
-	Serial.print("magX (Gauss),");
-	Serial.print("magY (Gauss),");
-	Serial.print("magZ (Gauss),");
+	Serial0.print(F("minFree (bytes),"));
+	Serial0.print(F("serialPeak (bytes),"));
+	Serial0.print(F("serialOverflows,"));
+	Serial0.print(F("serialOverruns,"));
+	Serial0.print(F("serialFramingErrors,"));
+	Serial0.print(F("recorderDropped,"));
+	Serial0.print(F("bulkSent,"));
+	Serial0.print(F("bulkResent,"));
+	Serial0.print(F("bulkSkipped,"));
+	Serial0.print(F("bulkBase,"));
+	Serial0.print(F("commandsRejected,"));
+	Serial0.print(F("commandsStale,"));
 	
-	Serial.print("\n");
+	Serial0.print(F("\n"));
+
+#ifdef FlightEventCapture
+	// for Event rows:
+	Serial0.print(F("Event,"));
+	Serial0.print(F("now (ms),"));
+	Serial0.print(F("ppsTime (s),"));
+	Serial0.print(F("event,"));
+	Serial0.print(F("altitude (m),"));
+	Serial0.print(F("maxAltitude (m),"));
+	Serial0.print(F("ascentRate (m/s),"));
+	Serial0.print(F("pressureTrend (ppm/s),"));
+	Serial0.print(F("captureDropped,"));
+	Serial0.print(F("\n"));
+
+	// for Capture rows:
+	Serial0.print(F("Capture,"));
+	Serial0.print(F("now (ms),"));
+	Serial0.print(F("accelX (raw),"));
+	Serial0.print(F("accelY (raw),"));
+	Serial0.print(F("accelZ (raw),"));
+	Serial0.print(F("angVelX (raw),"));
+	Serial0.print(F("angVelY (raw),"));
+	Serial0.print(F("angVelZ (raw),"));
+	Serial0.print(F("ascentRate (m/s),"));
+	Serial0.print(F("\n"));
+#endif
+
+#ifdef CommandUplink
+	// for Command rows:
+	Serial0.print(F("Command,"));
+	Serial0.print(F("now (ms),"));
+	Serial0.print(F("ppsTime (s),"));
+	Serial0.print(F("sequence,"));
+	Serial0.print(F("command,"));
+	Serial0.print(F("arg,"));
+	Serial0.print(F("result,"));
+	Serial0.print(F("\n"));
+#endif
 }
 
-void transmitLogging(uint32_t now)
+void transmitLogging(uint32_t now, uint32_t dt)
 {
-	loggingLastSend = now;
+	Serial0.print(now);
+	Serial0.print(',');
+	transmitTimestamp(now);
+	Serial0.print(fps.GetFramerate());
+	Serial0.print(',');
+	Serial0.print(idle.GetResidency(IdleManager::EState::Awake));
+	Serial0.print(',');
+	Serial0.print(idle.GetResidency(IdleManager::EState::Asleep));
+	Serial0.print(',');
 
-	Serial.print(now);
-	Serial.print(',');
-	Serial.print(fps.GetFramerate());
-	Serial.print(',');
-
-	Serial.print(batteryVoltageSmooth, 3);
-	Serial.print(',');
+	Serial0.print(batteryVoltageSmooth, 3);
+	Serial0.print(',');
 
 	uint8_t hours, minutes, seconds, hundredths;
 	if (gps.crack_datetime(NULL, NULL, NULL, &hours, &minutes, &seconds, &hundredths))
 	{
-		Serial.print((int)hours);
-		Serial.print(':');
-		Serial.print((int)minutes);
-		Serial.print(':');
-		Serial.print(seconds + 0.01f * hundredths, 2);
+		Serial0.print((int)hours);
+		Serial0.print(':');
+		Serial0.print((int)minutes);
+		Serial0.print(':');
+		Serial0.print(seconds + 0.01f * hundredths, 2);
 	}
-	Serial.print(',');
+	Serial0.print(',');
 
 	float lat, lon;
 	if (gps.f_get_position(&lat, &lon))
 	{
-		Serial.print(lat, 6);
-		Serial.print(',');
-		Serial.print(lon, 6);
-		Serial.print(',');
-		Serial.print(gps.f_altitude(), 3);
-		Serial.print(',');
-		Serial.print(gps.f_course(), 3);
-		Serial.print(',');
-		Serial.print(TinyGPS::cardinal(gps.f_course()));
-		Serial.print(',');
-		Serial.print(gps.f_speed_mps(), 3);
-		Serial.print(',');
-		Serial.print(gps.satellites());
-		Serial.print(',');
+		Serial0.print(lat, 6);
+		Serial0.print(',');
+		Serial0.print(lon, 6);
+		Serial0.print(',');
+		Serial0.print(gps.f_altitude(), 3);
+		Serial0.print(',');
+		Serial0.print(gps.f_course(), 3);
+		Serial0.print(',');
+		Serial0.print(TinyGPS::cardinal(gps.f_course()));
+		Serial0.print(',');
+		Serial0.print(gps.f_speed_mps(), 3);
+		Serial0.print(',');
+		Serial0.print(gps.satellites());
+		Serial0.print(',');
 	}
 	else
 	{
-		Serial.print(',');
-		Serial.print(',');
-		Serial.print(',');
-		Serial.print(',');
-		Serial.print(',');
-		Serial.print(',');
-		Serial.print(',');
+		Serial0.print(',');
+		Serial0.print(',');
+		Serial0.print(',');
+		Serial0.print(',');
+		Serial0.print(',');
+		Serial0.print(',');
+		Serial0.print(',');
 	}
 
-	Serial.print(pressure.GetTempInC(), 3);
-	Serial.print(',');
-	Serial.print(pressure.GetPressureInPa());
-	Serial.print(',');
-	Serial.print(pressure.GetAltitudeInM(), 3);
-	Serial.print(',');
+	transmitTimestamp(pressure.GetReadingTime());
+	Serial0.print(pressure.GetTempInC(), 3);
+	Serial0.print(',');
+	Serial0.print(pressure.GetPressureInPa());
+	Serial0.print(',');
+	Serial0.print(pressure.GetAltitudeInM(), 3);
+	Serial0.print(',');
+	Serial0.print(altitudeFilter.GetAltitudeInM(), 3);
+	Serial0.print(',');
+	Serial0.print(altitudeFilter.GetVerticalVelocityInMPerS(), 3);
+	Serial0.print(',');
 	
 	for (uint8_t i=0; i<EThermistors::EnumCount; ++i)
 	{
-		Serial.print(thermTempsFiltered[i], 2);
-		Serial.print(',');
+		Serial0.print(thermTempsFiltered[i], 2);
+		Serial0.print(',');
 	}
 	
 	for (uint8_t i=0; i<ETMPs::EnumCount; ++i)
 	{
-		Serial.print(tmps[i].GetTemp(), 3);
-		Serial.print(',');
+		Serial0.print(tmps[i].GetTemp(), 3);
+		Serial0.print(',');
 	}
 	
-	Serial.print(gyro.GetTemp(), 3);
-	Serial.print(',');
+	Serial0.print(gyro.GetTemp(), 3);
+	Serial0.print(',');
 	
-	Serial.print(accelFiltered.x, 6);
-	Serial.print(',');
-	Serial.print(accelFiltered.y, 6);
-	Serial.print(',');
-	Serial.print(accelFiltered.z, 6);
-	Serial.print(',');
+	Serial0.print(accelFiltered.x, 6);
+	Serial0.print(',');
+	Serial0.print(accelFiltered.y, 6);
+	Serial0.print(',');
+	Serial0.print(accelFiltered.z, 6);
+	Serial0.print(',');
 	
-	Serial.print(angVelFiltered.x, 6);
-	Serial.print(',');
-	Serial.print(angVelFiltered.y, 6);
-	Serial.print(',');
-	Serial.print(angVelFiltered.z, 6);
-	Serial.print(',');
+	Serial0.print(angVelFiltered.x, 6);
+	Serial0.print(',');
+	Serial0.print(angVelFiltered.y, 6);
+	Serial0.print(',');
+	Serial0.print(angVelFiltered.z, 6);
+	Serial0.print(',');
 	
 	const vec3 mag = magneto.GetOutput();
-	Serial.print(mag.x, 6);
-	Serial.print(',');
-	Serial.print(mag.y, 6);
-	Serial.print(',');
-	Serial.print(mag.z, 6);
-	Serial.print(',');
+	Serial0.print(mag.x, 6);
+	Serial0.print(',');
+	Serial0.print(mag.y, 6);
+	Serial0.print(',');
+	Serial0.print(mag.z, 6);
+	Serial0.print(',');
+	
+	Serial0.print(GetMinFreeMemory());
+	Serial0.print(',');
+	Serial0.print(GPSSerial.GetRxPeak());
+	Serial0.print(',');
+	Serial0.print(GPSSerial.GetOverflowCount());
+	Serial0.print(',');
+	Serial0.print(GPSSerial.GetOverrunCount());
+	Serial0.print(',');
+	Serial0.print(GPSSerial.GetFramingErrorCount());
+	Serial0.print(',');
+#ifdef FlightRecording
+	Serial0.print(recorder.GetDroppedCount());
+#endif
+	Serial0.print(',');
+#ifdef BulkDownlink
+	Serial0.print(bulkSender.GetSentCount());
+	Serial0.print(',');
+	Serial0.print(bulkSender.GetResentCount());
+	Serial0.print(',');
+	Serial0.print(bulkSender.GetSkippedCount());
+	Serial0.print(',');
+	Serial0.print(bulkSender.GetBase());
+#else
+	Serial0.print(',');
+	Serial0.print(',');
+	Serial0.print(',');
+#endif
+	Serial0.print(',');
+#ifdef CommandUplink
+	Serial0.print(commandRejectedCount);
+	Serial0.print(',');
+	Serial0.print(commandReceiver.GetStaleCount());
+#else
+	Serial0.print(',');
+#endif
+	Serial0.print(',');
 	
-	Serial.println();
+	Serial0.println();
+
+#ifdef FlightRecording
+	recordFlight(now);
+#endif
 }
 
-void transmitTelemetry(uint32_t now)
+void recordFlight(uint32_t now)
 {
-	telemetryLastSend = now;
-	
+#ifdef FlightRecording
+	// events and captures all go in, but only every few Logging rows
+	if (now - lastRecordTime < RecordingInterval)
+		return;
+	lastRecordTime = (now - lastRecordTime < 2 * RecordingInterval ? lastRecordTime + RecordingInterval : now);
+
+	FlightRecord record;
+	record.now = now;
+
+	long lat, lon;
+	if (gps.get_position(&lat, &lon))
+	{
+		record.gpsLat = lat;
+		record.gpsLon = lon;
+		record.gpsAlt = gps.altitude();
+	}
+	else
+	{
+		record.gpsLat = 0;
+		record.gpsLon = 0;
+		record.gpsAlt = 0;
+	}
+
+	record.bmpPressure = pressure.GetPressureInPa();
+	record.altitude = altitudeFilter.GetAltitudeInMM();
+	record.ascentRate = (int16_t)Clamp<int32_t>(altitudeFilter.GetVerticalVelocityInMMPerS() / 10, -32767, 32767);
+
+	const ADXL345::OutputRaw accelRaw = accel.GetOutputRaw();
+	const ITG3200::OutputRaw gyroRaw = gyro.GetOutputRaw();
+	const HMC5843::OutputRaw magRaw = magneto.GetOutputRaw();
+	record.accel[0] = accelRaw.x;
+	record.accel[1] = accelRaw.y;
+	record.accel[2] = accelRaw.z;
+	record.gyro[0] = gyroRaw.x;
+	record.gyro[1] = gyroRaw.y;
+	record.gyro[2] = gyroRaw.z;
+	record.mag[0] = magRaw.x;
+	record.mag[1] = magRaw.y;
+	record.mag[2] = magRaw.z;
+
+	for (uint8_t i=0; i<EThermistors::EnumCount; ++i)
+		record.thermTemps[i] = (int16_t)(thermTempsFiltered[i] * 100.0f);
+	record.batteryVoltage = (uint16_t)fabs(batteryVoltageSmooth * 1000.0f + 0.5f);
+
+	recorder.Append(ERecordType::Flight, &record, sizeof(record));
+#endif
+}
+
+void transmitMemory()
+{
+	// where the static RAM's gone, the biggest users of it anyway
+	Serial0.print(F("Memory,"));
+	Serial0.print(F("free (bytes),"));
+	Serial0.print(F("minFree (bytes),"));
+	Serial0.print(F("serial (bytes),"));
+	Serial0.print(F("xtendSerial (bytes),"));
+	Serial0.print(F("xtend (bytes),"));
+	Serial0.print(F("gps (bytes),"));
+	Serial0.print(F("altitudeFilter (bytes),"));
+	Serial0.print(F("scheduler (bytes),"));
+	Serial0.print(F("landingPredictor (bytes),"));
+	Serial0.print(F("flightEvents (bytes),"));
+	Serial0.print(F("eventCapture (bytes),"));
+	Serial0.print(F("profiler (bytes),"));
+	Serial0.print(F("recorder (bytes),"));
+	Serial0.print(F("recorderSize (bytes),"));
+	Serial0.print(F("recorderEraseCount,"));
+	Serial0.print(F("\n"));
+
+	Serial0.print(F("Memory,"));
+	Serial0.print(GetFreeMemory());
+	Serial0.print(',');
+	Serial0.print(GetMinFreeMemory());
+	Serial0.print(',');
+	Serial0.print(sizeof(Serial0));
+	Serial0.print(',');
+	Serial0.print(sizeof(XTendSerial));
+	Serial0.print(',');
+	Serial0.print(sizeof(xtend));
+	Serial0.print(',');
+	Serial0.print(sizeof(gps));
+	Serial0.print(',');
+	Serial0.print(sizeof(altitudeFilter));
+	Serial0.print(',');
+	Serial0.print(sizeof(scheduler));
+	Serial0.print(',');
+#ifdef LandingPrediction
+	Serial0.print(sizeof(landingPredictor));
+#endif
+	Serial0.print(',');
+#ifdef FlightEventCapture
+	Serial0.print(sizeof(flightEvents));
+	Serial0.print(',');
+	Serial0.print(sizeof(eventCapture));
+#else
+	Serial0.print(',');
+#endif
+	Serial0.print(',');
+#ifdef Profiling
+	Serial0.print(sizeof(profiler));
+#endif
+	Serial0.print(',');
+#ifdef FlightRecording
+	Serial0.print(sizeof(recorder));
+	Serial0.print(',');
+	Serial0.print(recorder.IsWriting() ? flash.GetSize() : 0);
+	Serial0.print(',');
+	Serial0.print(recorder.GetEraseCount());
+#else
+	Serial0.print(',');
+	Serial0.print(',');
+#endif
+	Serial0.print(',');
+	Serial0.println();
+}
+
+void transmitTimestamp(uint32_t time)
+{
+	Timebase::Timestamp timestamp;
+	if (g_Timebase.MillisToTime(time, &timestamp))
+		serprintf(Serial0, "%lu.%06lu", timestamp.seconds, timestamp.micros);
+	Serial0.print(',');
+}
+
+void transmitTelemetry(uint32_t now, uint32_t dt)
+{
+#ifdef CommandUplink
+	if (fastBeacon && (int32_t)(now - fastBeaconEnd) >= 0)
+	{
+		fastBeacon = false;
+		scheduler.SetPeriod(telemetryTask, telemetryInterval);
+	}
+#endif
+
 	TelemetryPacket packet;
-	packet.time = now / 1000;
+	packet.time = now;
 
 	if (gps.f_get_position(&packet.gpsLat, &packet.gpsLon))
 	{
@@ -332,6 +988,7 @@ void transmitTelemetry(uint32_t now)
 	}
 
 	packet.bmpPressure = pressure.GetPressureInPa();
+	packet.ascentRate = (int16_t)Clamp<int32_t>(altitudeFilter.GetVerticalVelocityInMMPerS() / 10, -32767, 32767);
 
 	//packet.tmpInternal = (int8_t)(tmps[ETMPs::Internal].GetTemp() + 0.5f);
 	//packet.tmpExternal = (int8_t)(tmps[ETMPs::External].GetTemp() + 0.5f);
@@ -339,7 +996,149 @@ void transmitTelemetry(uint32_t now)
 	packet.tmpExternal = (int8_t)(thermTempsFiltered[EThermistors::External1] + 0.5f);
 
 	packet.batteryVoltage = (uint16_t)fabs(batteryVoltageSmooth * 1000.0f + 0.5f);
+
+	packet.landingLat = 0.0f;
+	packet.landingLon = 0.0f;
+	packet.landingTime = 0;
+#ifdef LandingPrediction
+	LandingPredictor::Prediction landing;
+	if (landingPredictor.Predict(&landing))
+	{
+		packet.landingLat = landing.lat * 1.0e-5f;
+		packet.landingLon = landing.lon * 1.0e-5f;
+		packet.landingTime = (uint16_t)min(landing.time, (uint32_t)0xFFFF);
+	}
+#endif
+
+	packet.minFreeMemory = GetMinFreeMemory();
+	packet.serialPeak = GPSSerial.GetRxPeak();
+	packet.serialLost = GPSSerial.GetOverflowCount() + GPSSerial.GetOverrunCount() + GPSSerial.GetFramingErrorCount();
+
+	packet.features = 0;
+#ifdef LandingPrediction
+	packet.features |= EFeature::Prediction;
+#endif
+#ifdef FlightEventCapture
+	packet.features |= EFeature::Capture;
+#endif
+#ifdef FlightRecording
+	packet.features |= EFeature::Recording;
+#endif
+#ifdef BulkDownlink
+	packet.features |= EFeature::Bulk;
+#endif
+#ifdef CommandUplink
+	packet.features |= EFeature::Uplink;
+#endif
 	
 	xtend.SendTo(XTendDest, (uint8_t*)&packet, sizeof(packet));
 }
 
+void transmitBulk(uint32_t now)
+{
+#ifdef BulkDownlink
+	if (bulkPaused)
+		return;
+
+	// the telemetry always goes first: nothing while the last chunk's still going out, or
+	// if it wouldn't be gone before the next telemetry packet's due
+	if (now - lastBulkTime < BulkInterval ||
+	    XTendSerial.GetTxSpace() < sizeof(BulkPacket) + XTendAPI::c_TransmitOverhead ||
+	    scheduler.GetTimeUntil(telemetryTask, now) < BulkGuardTime)
+		return;
+
+	uint32_t chunk;
+	const uint32_t oldest = (recorder.GetOldestPosition() + BulkPacket::c_ChunkSize - 1) / BulkPacket::c_ChunkSize;
+	if (!bulkSender.GetNext(now, oldest, recorder.GetSealedPosition() / BulkPacket::c_ChunkSize, &chunk))
+		return;
+
+	// the flash is often busy writing, so it's tried again next time
+	BulkPacket packet;
+	if (!recorder.ReadLog(chunk * BulkPacket::c_ChunkSize, packet.data, sizeof(packet.data)))
+		return;
+
+	packet.base = bulkSender.GetBase();
+	packet.chunk = chunk;
+	packet.stamp = bulkSender.OnSent(now, chunk);
+	xtend.SendTo(XTendDest, (uint8_t*)&packet, sizeof(packet));
+	lastBulkTime = now;
+#endif
+}
+
+void transmitEvent(uint32_t now, FlightEvents::EEvent::Enum event)
+{
+#ifdef FlightEventCapture
+	Serial0.print(F("Event,"));
+	Serial0.print(now);
+	Serial0.print(',');
+	transmitTimestamp(now);
+	Serial0.print(FlightEvents::GetName(event));
+	Serial0.print(',');
+	Serial0.print(altitudeFilter.GetAltitudeInM(), 3);
+	Serial0.print(',');
+	Serial0.print(flightEvents.GetMaxAltitude() * 0.001f, 3);
+	Serial0.print(',');
+	Serial0.print(altitudeFilter.GetVerticalVelocityInMPerS(), 3);
+	Serial0.print(',');
+	Serial0.print(flightEvents.GetPressureTrend());
+	Serial0.print(',');
+	Serial0.print(eventCapture.GetDroppedCount());
+	Serial0.print(',');
+	Serial0.println();
+#endif
+
+#if defined(FlightEventCapture) && defined(FlightRecording)
+	EventRecord record;
+	record.now = now;
+	record.altitude = altitudeFilter.GetAltitudeInMM();
+	record.maxAltitude = flightEvents.GetMaxAltitude();
+	record.pressureTrend = flightEvents.GetPressureTrend();
+	record.ascentRate = (int16_t)Clamp<int32_t>(altitudeFilter.GetVerticalVelocityInMMPerS() / 10, -32767, 32767);
+	record.captureDropped = eventCapture.GetDroppedCount();
+	record.event = event;
+	record.recorderDropped = recorder.GetDroppedCount();
+	recorder.Append(ERecordType::Event, &record, sizeof(record));
+#endif
+}
+
+void transmitCapture(uint32_t now, const EventCapture::Sample& sample)
+{
+	Serial0.print(F("Capture,"));
+	Serial0.print(EventCapture::GetSampleTime(now, sample));
+	Serial0.print(',');
+	for (uint8_t i=0; i<3; ++i)
+	{
+		Serial0.print(sample.accel[i]);
+		Serial0.print(',');
+	}
+	for (uint8_t i=0; i<3; ++i)
+	{
+		Serial0.print(sample.gyro[i]);
+		Serial0.print(',');
+	}
+	Serial0.print(sample.ascentRate * 0.01f, 2);
+	Serial0.print(',');
+	Serial0.println();
+
+#ifdef FlightRecording
+	CaptureRecord record;
+	record.time = sample.time;
+	for (uint8_t i=0; i<3; ++i)
+	{
+		record.accel[i] = sample.accel[i];
+		record.gyro[i] = sample.gyro[i];
+	}
+	record.ascentRate = sample.ascentRate;
+	recorder.Append(ERecordType::Capture, &record, sizeof(record));
+#endif
+}
+
+void transmitProfile(uint32_t now, uint32_t dt)
+{
+#ifdef Profiling
+	// binary, for tools/ProfileDump; the newline puts the next row back at the start of a line
+	profiler.Dump(Serial0, now);
+	Serial0.println();
+#endif
+}
+
@@ -2,20 +2,118 @@
 
 #include <Core.h>
 #include <XTendAPI.h>
+#include <AltitudeFilter.h>
+#include <LandingPredictor.h>
+#include <FlightEvents.h>
+#include <EventCapture.h>
+#include <BulkSender.h>
+#include <CommandAuth.h>
 
 const uint32_t TargetFrameTime           = 0ul;
 const uint32_t LoggingInterval           = 100ul;
-const uint32_t LoggingStagger            = 0ul;
+const uint32_t LoggingCaptureInterval    = 50ul;    // while capturing a flight event
+const uint32_t LoggingPhase              = 0ul;
 const uint32_t TelemetryTransmitInterval = 1000ul;
-const uint32_t TelemetryTransmitStagger  = 250ul;
+const uint32_t TelemetryTransmitPhase    = 250ul;
+const uint32_t ProfileInterval           = 60000ul;
+const uint32_t ProfilePhase              = 750ul;
+
+// how often the sensors are read
+const uint32_t IMUInterval               = 10ul;    // accelerometer and gyro, and the altitude filter's prediction
+const uint32_t PressureInterval          = 5ul;     // polling the BMP085 for the end of a conversion
+const uint32_t MagnetoInterval           = 20ul;    // the HMC5843's output rate is 50 Hz
+const uint32_t EnvironmentInterval       = 125ul;   // battery and temperatures, the TMP102s convert at 8 Hz
+const uint32_t SerialPollDeadline        = 10ul;    // at 115200 the GPS fills the 128 byte receive buffer in 11 ms
+const uint16_t SerialRxBufferSize        = 128;     // the GPS's, powers of two
+const uint16_t SerialTxBufferSize        = 64;      // logging's
 
 #define LoggingBaud 115200
 
-#define GPSSerial Serial
+#define GPSSerial Serial0
+#define GPSSerialShared true    // with logging, so it's never re-bauded and the GPS has to be at GPSBaud already
 #define GPSBaud 115200
+#define GPSBinary       // SkyTraq Venus binary navigation messages instead of NMEA
+#ifdef GPSBinary
+const char GPSConfigScript[] PROGMEM =
+	"#0E0A00\n"              // 10 Hz position rate
+	"#090200\n";             // binary output
+const char GPSResetBanner[] PROGMEM = "$GP";  // it's come back up talking NMEA
+#else
+const char GPSConfigScript[] PROGMEM =
+	"#0E0A00\n"              // 10 Hz position rate
+	"#080100000001000000\n"  // GGA and RMC only
+	"#090100\n";             // NMEA output
+const char* const GPSResetBanner = NULL;
+#endif
+// the GPS's PPS output goes to digital pin 8 (ICP1) for the Timebase
 
 #define BatteryMonitorPin A3
 
+const AltitudeFilter::Config AltitudeFilterConfig = {
+	0.25f,  // baroSigma (m), 4 samples averaged
+	5.0f,   // gpsSigma (m)
+	2.0f,   // accelSigma (m/s^2), mostly swinging under the balloon
+	0.5f,   // baroDriftSigma (m/sqrt(s))
+	109,    // baroPeriod (ms), OSS 3 averaging 4 samples
+	100,    // gpsPeriod (ms)
+};
+
+// The optional features below all ship off, which is the build that's flown. Their RAM costs
+// are estimates, on top of that build, and haven't been checked against an avr-size of the
+// base, so turn on only what's needed and fly nothing that hasn't been run on the bench first:
+// the telemetry's minFreeMemory is the least free RAM since reset, and has to stay well clear
+// of zero after each feature has had its busiest moment (an event capture, a sector erase,
+// a command). The telemetry also sends down which features are built in, so the tracker
+// won't send commands to a balloon without CommandUplink. The only dependency is
+// BulkDownlink needing FlightRecording.
+
+//#define LandingPrediction // predict the landing onboard and send it down with the telemetry, costs ~250 bytes of RAM
+const LandingPredictor::Config LandingPredictorConfig = {
+	1000,   // binHeight (m)
+	30000,  // burstAlt (m)
+	765,    // groundAlt (m), around the launch site
+	1500,   // mass (g), payload and line under the parachute
+	10000,  // dragArea (cm^2), ~5 m/s at sea level
+};
+
+//#define Profiling         // time each task and the loop, and dump the histograms into the log every ProfileInterval, costs ~300 bytes of RAM
+
+//#define FlightEventCapture // log burst, apogee, free fall and landing at a high rate, with the half second before, costs ~450 bytes of RAM
+const FlightEvents::Config FlightEventsConfig = {
+	256,    // accelPerG, full resolution mode
+};
+const EventCapture::Config EventCaptureConfig = {
+	20,     // sampleInterval (ms)
+	10000,  // window (ms), after the latest event
+};
+const uint8_t CaptureRowsPerLoop = 4;  // so writing out the samples from before an event doesn't hold up everything else
+
+//#define FlightRecording   // write the logging, events and captures to a SPI flash chip as well, so they survive the logger or the radio going, costs ~300 bytes of RAM
+#define FlightRecorderCSPin 10
+const uint32_t RecordingInterval         = 500ul;   // between Flight records, a fifth of the logging's, so BulkDownlink can keep up with the log at 9600 baud (tools/BulkSim)
+// the chip's on the hardware SPI pins, so the LED on pin 13 (SCK) stops blinking; the log
+// runs at ~110 bytes/s, and ~10 KB more for each event captured, so a 3 hour flight fits
+// in 2 MB (a W25Q16) before it wraps around
+
+//#define BulkDownlink      // send the flight recorder's log down between the telemetry packets, as the tracker acks it, needs FlightRecording, costs ~60 bytes of RAM
+const uint32_t BulkInterval              = 60ul;    // between chunks at most, ~400 bytes/s at 9600 baud, leaving the air clear between them for the acks
+const uint32_t BulkGuardTime             = 100ul;   // no chunk this close before a telemetry packet, so it goes out on time
+const BulkSender::Config BulkSenderConfig = {
+	2000,   // ackTimeout (ms)
+};
+
+//#define CommandUplink     // take signed commands from the tracker, to change the telemetry and logging rates and the bulk downlink in flight, costs ~40 bytes of RAM
+const uint32_t FastBeaconInterval        = 250ul;   // telemetry, for a while after a FastBeacon command, to find the payload after landing
+#ifdef CommandUplink
+// the key's kept out of git: copy CommandKey.h.example to CommandKey.h and put yours in it
+#if defined(__has_include)
+#if !__has_include("CommandKey.h")
+#error "CommandUplink needs a CommandKey.h, copied from CommandKey.h.example with your own key in it"
+#endif
+#endif
+#include "CommandKey.h"
+#endif
+
 struct EThermistors
 {
 	enum Enum
@@ -9,16 +9,23 @@ struct EPacketType
 		None,
 		Ping,
 		Pong,
-		Telemetry
+		Telemetry,
+		Bulk,
+		BulkAck,
+		Command,
+		CommandAnswer
 	};
 };
 
+// NTP style, for the tracker's ClockSync; the ping's the same size as the pong, so they take as long on the air
 struct PingPacket
 {
-	PingPacket() : packetType(EPacketType::Ping) {}
+	PingPacket() : packetType(EPacketType::Ping), receive(0), transmit(0) {}
 	
 	uint8_t packetType;
-	uint32_t time;
+	uint32_t originate;          // in ms, the tracker's millis() as it went
+	uint32_t receive;            // unused
+	uint32_t transmit;           // unused
 };
 
 struct PongPacket
@@ -26,7 +33,22 @@ struct PongPacket
 	PongPacket() : packetType(EPacketType::Pong) {}
 	
 	uint8_t packetType;
-	uint32_t time;
+	uint32_t originate;          // the ping's
+	uint32_t receive;            // in ms, the balloon's millis() when the ping came in
+	uint32_t transmit;           // in ms, the balloon's millis() as this went
+};
+
+// what the balloon was built with, the optional features in its Config.h
+struct EFeature
+{
+	enum Enum
+	{
+		Prediction = 0x01,      // LandingPrediction
+		Capture    = 0x02,      // FlightEventCapture
+		Recording  = 0x04,      // FlightRecording
+		Bulk       = 0x08,      // BulkDownlink
+		Uplink     = 0x10,      // CommandUplink
+	};
 };
 
 struct TelemetryPacket
@@ -34,17 +56,97 @@ struct TelemetryPacket
 	TelemetryPacket() : packetType(EPacketType::Telemetry) {}
 
 	uint8_t packetType;
-	uint16_t time;               // in s
+	uint32_t time;               // in ms, the balloon's millis()
 
 	float gpsLat, gpsLon;        // in degrees
 	int32_t gpsAlt : 18;         // in m
 	int32_t gpsCourse : 10;      // in degrees
 	uint32_t gpsSpeed : 8;       // in m/s
 	uint32_t bmpPressure : 24;   // in Pa
+	int16_t ascentRate;          // in cm/s
 	
 	int8_t tmpInternal;          // in deg C
 	int8_t tmpExternal;          // in deg C
 
 	uint16_t batteryVoltage;     // in mV
+
+	float landingLat, landingLon; // in degrees, predicted onboard, 0 when there's no prediction
+	uint16_t landingTime;        // in s from now
+
+	uint16_t minFreeMemory;      // in bytes, the least there's been since reset
+	uint8_t serialPeak;          // in bytes, the fullest the GPS's receive buffer has been
+	uint16_t serialLost;         // bytes the GPS's serial port has dropped since reset, overflowed, overrun or misframed
+
+	uint8_t features;            // EFeature bits
+};
+
+// a chunk of the flight recorder's log, see BulkSender; chunk * c_ChunkSize is its position in the log
+struct BulkPacket
+{
+	BulkPacket() : packetType(EPacketType::Bulk) {}
+
+	static const uint8_t c_ChunkSize = 32;  // with the rest, fits in CaptureSerial's transmit buffer, so sending it doesn't wait
+
+	uint8_t packetType;
+	uint32_t base;               // the oldest chunk the balloon hasn't had acked
+	uint32_t chunk;
+	uint8_t stamp;
+	uint8_t data[c_ChunkSize];
+};
+
+struct BulkAckPacket
+{
+	BulkAckPacket() : packetType(EPacketType::BulkAck) {}
+
+	uint8_t packetType;
+	uint32_t base;               // the oldest chunk the tracker hasn't had
+	uint32_t received;           // a bit for each chunk from base on
+	uint8_t latestStamp;         // of the latest chunk it's had
+};
+
+struct ECommand
+{
+	enum Enum
+	{
+		None,
+		TelemetryInterval,          // ms
+		LoggingInterval,            // ms
+		FastBeacon,                 // s of telemetry every FastBeaconInterval, 0 to stop
+		BulkEnable,                 // 0 to pause the bulk downlink, 1 to carry on
+		BulkRewind,                 // the chunk to send the log from again
+	};
 };
 
+struct ECommandResult
+{
+	enum Enum
+	{
+		Done,
+		UnknownCommand,
+		BadArg,
+		Unavailable,                // not built into the balloon
+		Stale = 0xFF,               // CommandReceiver::c_StaleResult, the sequence is the balloon's last
+	};
+};
+
+// signed by CommandAuth, and sent again until it's answered, see CommandSender
+struct CommandPacket
+{
+	CommandPacket() : packetType(EPacketType::Command) {}
+
+	uint8_t packetType;
+	uint16_t sequence;
+	uint8_t command;             // ECommand
+	uint32_t arg;
+	uint32_t mac;                // of everything before it
+};
+
+struct CommandAnswerPacket
+{
+	CommandAnswerPacket() : packetType(EPacketType::CommandAnswer) {}
+
+	uint8_t packetType;
+	uint16_t sequence;
+	uint8_t result;              // ECommandResult
+	uint32_t mac;                // of everything before it
+};
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <Core.h>
+
+// What the balloon writes to its FlightRecorder, read back by tools/FlightLog.
+//
+// These are copied straight to flash and back into the same structs on a PC, so each one
+// is laid out with its bigger fields first and comes to a whole number of 4 bytes, which
+// leaves nothing for either compiler to pad.
+
+struct ERecordType
+{
+	enum Enum
+	{
+		None,
+		Flight,
+		Event,
+		Capture
+	};
+};
+
+// every RecordingInterval, the fields of a Logging row that matter after the flight
+struct FlightRecord
+{
+	uint32_t now;                // in ms
+	int32_t gpsLat, gpsLon;      // in 1e-5 degrees, 0 without a fix
+	int32_t gpsAlt;              // in cm
+	uint32_t bmpPressure;        // in Pa
+	int32_t altitude;            // in mm, the altitude filter's
+	int16_t ascentRate;          // in cm/s
+
+	int16_t accel[3];            // raw
+	int16_t gyro[3];             // raw
+	int16_t mag[3];              // raw
+
+	int16_t thermTemps[3];       // in 0.01 deg C, EThermistors
+	uint16_t batteryVoltage;     // in mV
+};
+
+struct EventRecord
+{
+	uint32_t now;                // in ms
+	int32_t altitude;            // in mm
+	int32_t maxAltitude;         // in mm
+	int32_t pressureTrend;       // in ppm/s
+	int16_t ascentRate;          // in cm/s
+	uint16_t captureDropped;
+	uint16_t event;              // FlightEvents::EEvent
+	uint16_t recorderDropped;    // records the recorder's dropped so far, so gaps in the log can be told from quiet
+};
+
+// one EventCapture sample
+struct CaptureRecord
+{
+	uint16_t time;               // in ms, the bottom 16 bits of millis(), the rest's from the records around it
+	int16_t accel[3];            // raw
+	int16_t gyro[3];             // raw
+	int16_t ascentRate;          // in cm/s
+};
@@ -1,40 +1,105 @@
 #include <Core.h>
 #include <Wire.h>
+#include <BufferedSerial.h>
+#include <Scheduler.h>
+#include <IdleManager.h>
+#include <CRC.h>
+#include <Profiler.h>
 #include <VectorMath.h>
 #include <MatrixMath.h>
 #include <Quaternion.h>
 #include <TinyGPS.h>
+#include <GPSConfigurator.h>
+#include <Timebase.h>
+#include <Geodesy.h>
+#include <AntennaMount.h>
+#include <MountServos.h>
+#include <LandingPredictor.h>
+#include <BulkSender.h>
+#include <BulkReceiver.h>
+#include <CommandAuth.h>
+#include <CommandReceiver.h>
+#include <CommandSender.h>
+#include <ClockSync.h>
 
 #include <XTendAPI.h>
 
 #include "Config.h"
 #include "Packets.h"
 
-uint32_t lastFrameTime = 0;
+BufferedSerialPort<LoggingRxBufferSize, LoggingTxBufferSize> Serial0(0);
+BufferedSerialPort<GPSRxBufferSize, GPSTxBufferSize> GPSSerial(GPSSerialPort);
+BufferedSerialPort<LCDRxBufferSize, LCDTxBufferSize> LCDSerial(LCDSerialPort);
+BufferedSerialPort<XTendRxBufferSize, XTendTxBufferSize> XTendSerial(XTendSerialPort);
+
+Scheduler scheduler;
+IdleManager idle;
+Profiler profiler;
+
+// in the order the tasks are added
+const char ProfilePollSerial[] PROGMEM = "pollSerial";
+const char ProfileUpdateMount[] PROGMEM = "updateMount";
+const char ProfileUpdateLCDButton[] PROGMEM = "updateLCDButton";
+const char ProfileUpdateLEDs[] PROGMEM = "updateLEDs";
+const char ProfileTransmitLogging[] PROGMEM = "transmitLogging";
+const char ProfileTransmitLCD[] PROGMEM = "transmitLCD";
+const char ProfileTransmitProfile[] PROGMEM = "transmitProfile";
 
 TinyGPS gps;
+GPSConfigurator gpsConfig(&GPSSerial, GPSConfigurator::EProtocol::MTK, GPSBaud, GPSConfigScript, GPSResetBanner);
 
 XTendAPI xtend(&XTendSerial);
 
-uint32_t loggingLastSend = 0;
-uint32_t lcdLastSend = 0;
+AntennaMount antennaMount(AntennaMountConfig);
+MountServos mountServos;
+
 bool lcdPageButtonPressed = false;
 uint32_t lcdPageButtonLastChange = 0;
 uint32_t lcdPage = LCDPageCount;
 
-uint32_t pingLastSend = 0;
 uint32_t pingSendCount = 0;
 uint32_t pingReceiveCount = 0;
 uint32_t pingRTT = 0;
 uint32_t pingRTTMin = 0;
 uint32_t pingRTTMax = 0;
+uint32_t lastPingTime = 0;
+ClockSync clockSync;
 
 uint32_t telemetryReceiveCount = 0;
 uint32_t latestTelemetryReceiveTime = 0;
 TelemetryPacket latestTelemetryPacket;
 
+LandingPredictor landingPredictor;
+bool hasLandingPrediction = false;
+LandingPredictor::Prediction landingPrediction;
+
 uint8_t latestSignalStrength = 0;
 
+BulkReceiver bulkReceiver;
+
+CommandAuth commandAuth(CommandKey);
+CommandSender commandSender;
+char commandLine[24];
+uint8_t commandLineLength = 0;
+uint32_t telemetryInterval = TelemetryInterval;     // the balloon's, as far as we've told it
+uint32_t fastBeaconEnd = 0;
+bool fastBeacon = false;
+
+struct CommandName
+{
+	const char* name;
+	uint8_t command;                // ECommand
+};
+
+const CommandName commandNames[] = {
+	{"telemetry", ECommand::TelemetryInterval},     // ms
+	{"logging", ECommand::LoggingInterval},         // ms
+	{"beacon", ECommand::FastBeacon},               // s
+	{"bulk", ECommand::BulkEnable},                 // 0 or 1
+	{"rewind", ECommand::BulkRewind},               // chunk
+};
+const char* const commandResultNames[] = {"done", "unknownCommand", "badArg", "unavailable"};
+
 // data for tracking the ascent rate
 struct AscentRateData
 {
@@ -49,13 +114,29 @@ AscentRateData ascentRateData[_countof(AscentTrackingIntervals)];
 
 
 
+void pollSerial(uint32_t now, uint32_t dt);
+void updateMount(uint32_t now, uint32_t dt);
+void updateLCDButton(uint32_t now, uint32_t dt);
+void updateLEDs(uint32_t now, uint32_t dt);
 void xtendReceive(uint32_t now);
 void handlePong(uint32_t now, const PongPacket& packet);
 void handleTelemetry(uint32_t now, const TelemetryPacket& packet);
+void handleBulk(uint32_t now, const BulkPacket& packet);
+void handleCommandAnswer(uint32_t now, const CommandAnswerPacket& packet);
+bool isTelemetryDue(uint32_t now);
+const char* getCommandName(uint8_t command);
+void queueCommand(uint32_t now, char* line);
+void transmitCommand(uint32_t now);
+void transmitCommandResult(uint32_t now, const char* command, uint32_t arg, const char* result);
+void transmitBulkAck(uint32_t now);
 void transmitHeadings();
-void transmitLogging(uint32_t now);
-void transmitLCD(uint32_t now);
+void transmitTimestamp(uint32_t time);
+bool getLookAngle(Geodesy::LookAngle* pLook);
+bool getLandingPrediction(uint32_t now, LandingPredictor::Prediction* pPrediction);
+void transmitLogging(uint32_t now, uint32_t dt);
+void transmitLCD(uint32_t now, uint32_t dt = 0);
 void transmitPing(uint32_t now);
+void transmitProfile(uint32_t now, uint32_t dt);
 
 void setup()
 {
@@ -68,23 +149,39 @@ void setup()
 	pinMode(LCDPagePin, INPUT);
 	digitalWrite(LCDPagePin, HIGH);
 
-	Serial.begin(LoggingBaud);
+	mountServos.setup();
+	landingPredictor.setup(LandingPredictorConfig);
+	bulkReceiver.setup(BulkReceiverConfig);
+	commandSender.setup(CommandSenderConfig);
+	clockSync.setup(ClockSyncConfig);
+
+	Serial0.begin(LoggingBaud);
 
 	LCDSerial.begin(LCDBaud);
-	GPSSerial.begin(GPSBaud);
+	gpsConfig.setup();
+	g_Timebase.setup();
 
 	// xtend setup
 	XTendSerial.begin(XTendBaud);
+	XTendSerial.SetRxTimeEnabled(true);   // for stamping pongs as they came in
 	pinMode(XTendPTTPin, OUTPUT);
 	digitalWrite(XTendPTTPin, HIGH);
 	
 	delay(1000);
 
-	uint32_t now = millis();
-	lastFrameTime = now;
-	loggingLastSend = now - LoggingStagger;
-	lcdLastSend = now - LCDStagger;
-	pingLastSend = now - PingStagger;
+	scheduler.Add(pollSerial, 0, 0, SerialPollDeadline);
+	scheduler.Add(updateMount, AntennaMountConfig.controlPeriod);
+	scheduler.Add(updateLCDButton, LCDButtonInterval);
+	scheduler.Add(updateLEDs, LEDInterval);
+	scheduler.Add(transmitLogging, LoggingInterval, LoggingPhase);
+	scheduler.Add(transmitLCD, LCDInterval, LCDPhase);
+	scheduler.Add(transmitProfile, ProfileInterval, ProfilePhase);
+
+	const char* const profileNames[] = {ProfilePollSerial, ProfileUpdateMount, ProfileUpdateLCDButton, ProfileUpdateLEDs, ProfileTransmitLogging, ProfileTransmitLCD, ProfileTransmitProfile};
+	for (uint8_t i=0; i<_countof(profileNames); ++i)
+		profiler.SetName(i, profileNames[i]);
+	scheduler.SetProfiler(&profiler);
+	scheduler.Start(millis());
 	
 	transmitHeadings();
 
@@ -93,18 +190,76 @@ void setup()
 
 void loop()
 {
-	uint32_t now = millis();
-	float dt = (now - lastFrameTime) * 0.001f;
-	lastFrameTime = now;
+	scheduler.loop();
+	profiler.loop();
+	idle.loop(scheduler.GetTimeUntilNext(millis()));
+}
 
-	//digitalWrite(13, (now / 250) % 2);
-	digitalWrite(12, (now - latestTelemetryReceiveTime) < 550);
+void pollSerial(uint32_t now, uint32_t dt)
+{
+	g_Timebase.loop();
 
-	// update sensors
+	bool gpsUpdated = false;
+	const unsigned short gpsSentences = gps.valid_sentences();
 	while (GPSSerial.available())
-		gps.encode(GPSSerial.read());
+	{
+		const char c = GPSSerial.read();
+		gpsConfig.Monitor(c);
+		gpsUpdated |= gps.encode(c);
+	}
+	gpsConfig.loop(gps.valid_sentences() != gpsSentences);
+
+	unsigned long gpsTime, gpsAge;
+	if (gpsUpdated && gps.get_datetime(NULL, &gpsTime, &gpsAge))
+		g_Timebase.SetGPSTime(gpsTime, gpsAge);
+
+	long lat, lon;
+	if (gpsUpdated && gps.get_position(&lat, &lon) && gps.altitude() != TinyGPS::GPS_INVALID_ALTITUDE)
+		antennaMount.SetOrigin(lat, lon, gps.altitude() / 100);
+
+	// network receive, and ack the log's chunks, send commands and ping when it won't get in the telemetry's way
+	xtendReceive(now);
+	transmitBulkAck(now);
+	transmitCommand(now);
+	transmitPing(now);
+
+	// a P from the laptop asks for the profile now, and a line starting with ! is a command for the balloon
+	while (Serial0.available())
+	{
+		const char c = Serial0.read();
+		if (commandLineLength)
+		{
+			if (c == '\r' || c == '\n')
+			{
+				commandLine[commandLineLength] = '\0';
+				queueCommand(now, commandLine + 1);
+				commandLineLength = 0;
+			}
+			else if (commandLineLength < sizeof(commandLine) - 1)
+			{
+				commandLine[commandLineLength++] = c;
+			}
+		}
+		else if (c == '!')
+		{
+			commandLine[commandLineLength++] = c;
+		}
+		else if (c == 'P')
+		{
+			transmitProfile(now, 0);
+		}
+	}
+}
+
+void updateMount(uint32_t now, uint32_t dt)
+{
+	// keep the antenna on the balloon
+	if (antennaMount.loop(now))
+		mountServos.Write(antennaMount.GetPulseInUS(AntennaMount::EAxis::Azimuth), antennaMount.GetPulseInUS(AntennaMount::EAxis::Elevation));
+}
 
-	// update LCD page button
+void updateLCDButton(uint32_t now, uint32_t dt)
+{
 	if (now - lcdPageButtonLastChange >= 150 && (digitalRead(LCDPagePin) == LOW) != lcdPageButtonPressed)
 	{
 		lcdPageButtonPressed = !lcdPageButtonPressed;
@@ -115,17 +270,12 @@ void loop()
 			transmitLCD(now);
 		}
 	}
+}
 
-	// network receive
-	xtendReceive(now);
-
-	// time to transmit?
-	if (now - loggingLastSend >= LoggingInterval)
-		transmitLogging(now);
-	if (now - lcdLastSend >= LCDInterval)
-		transmitLCD(now);
-	//if (now - pingLastSend >= PingInterval)
-	//	transmitPing(now);
+void updateLEDs(uint32_t now, uint32_t dt)
+{
+	//digitalWrite(13, (now / 250) % 2);
+	digitalWrite(12, (now - latestTelemetryReceiveTime) < 550);
 }
 
 void xtendReceive(uint32_t now)
@@ -148,6 +298,16 @@ void xtendReceive(uint32_t now)
 				if (pFrame->m_PayloadLength == sizeof(TelemetryPacket))
 					handleTelemetry(now, *reinterpret_cast<const TelemetryPacket*>(pFrame->m_Payload));
 				break;
+
+			case EPacketType::Bulk:
+				if (pFrame->m_PayloadLength == sizeof(BulkPacket))
+					handleBulk(now, *reinterpret_cast<const BulkPacket*>(pFrame->m_Payload));
+				break;
+
+			case EPacketType::CommandAnswer:
+				if (pFrame->m_PayloadLength == sizeof(CommandAnswerPacket))
+					handleCommandAnswer(now, *reinterpret_cast<const CommandAnswerPacket*>(pFrame->m_Payload));
+				break;
 			}
 		}
 	}
@@ -155,7 +315,11 @@ void xtendReceive(uint32_t now)
 
 void handlePong(uint32_t now, const PongPacket& packet)
 {
-	pingRTT = millis() - packet.time;
+	// when its last byte came in, unless more has come in since, not now, which was before the GPS was read
+	const uint32_t received = (XTendSerial.available() ? millis() : XTendSerial.GetLastRxTime());
+	clockSync.AddSample(packet.originate, packet.receive, packet.transmit, received);
+
+	pingRTT = (received - packet.originate) - (packet.transmit - packet.receive);
 	
 	if (!pingReceiveCount)
 	{
@@ -180,6 +344,15 @@ void handleTelemetry(uint32_t now, const TelemetryPacket& packet)
 	latestTelemetryReceiveTime = now;
 	latestTelemetryPacket = packet;
 
+	if (packet.gpsLat != 0.0f && packet.gpsLon != 0.0f)
+	{
+		const int32_t lat = (int32_t)floor(packet.gpsLat * 1.0e5f + 0.5f);
+		const int32_t lon = (int32_t)floor(packet.gpsLon * 1.0e5f + 0.5f);
+		antennaMount.SetTarget(now, lat, lon, packet.gpsAlt, packet.gpsSpeed, packet.gpsCourse, packet.ascentRate);
+		landingPredictor.AddFix(now, lat, lon, packet.gpsAlt, packet.ascentRate);
+	}
+	hasLandingPrediction = landingPredictor.Predict(&landingPrediction);
+
 	for (uint32_t i=0; i<_countof(AscentTrackingIntervals); ++i)
 	{
 		if (ascentRateData[i].m_Time == 0)
@@ -197,181 +370,526 @@ void handleTelemetry(uint32_t now, const TelemetryPacket& packet)
 		}
 	}
 
-	Serial.print("Telemetry,");
-	Serial.print(now);
-	Serial.print(',');
-	Serial.print(-(int)latestSignalStrength);
-	Serial.print(',');
-	Serial.print(telemetryReceiveCount);
-	Serial.print(',');
-	Serial.print(packet.time);
-	Serial.print(',');
-	Serial.print(packet.gpsLat, 6);
-	Serial.print(',');
-	Serial.print(packet.gpsLon, 6);
-	Serial.print(',');
-	Serial.print(packet.gpsAlt);
-	Serial.print(',');
+	Serial0.print("Telemetry,");
+	Serial0.print(now);
+	Serial0.print(',');
+	transmitTimestamp(now);
+	Serial0.print(-(int)latestSignalStrength);
+	Serial0.print(',');
+	Serial0.print(telemetryReceiveCount);
+	Serial0.print(',');
+	serprintf(Serial0, "%lu.%03lu", packet.time / 1000, packet.time % 1000);
+	Serial0.print(',');
+	Serial0.print(packet.gpsLat, 6);
+	Serial0.print(',');
+	Serial0.print(packet.gpsLon, 6);
+	Serial0.print(',');
+	Serial0.print(packet.gpsAlt);
+	Serial0.print(',');
+	Serial0.print(packet.ascentRate / 100.0f, 2);
+	Serial0.print(',');
 
 	for (uint32_t i=0; i<_countof(AscentTrackingIntervals); ++i)
 	{
-		Serial.print(ascentRateData[i].m_AscentRate, 3);
-		Serial.print(',');
+		Serial0.print(ascentRateData[i].m_AscentRate, 3);
+		Serial0.print(',');
 	}
 
-	Serial.print(packet.gpsCourse);
-	Serial.print(',');
-	Serial.print(TinyGPS::cardinal(packet.gpsCourse));
-	Serial.print(',');
-	Serial.print(packet.gpsSpeed);
-	Serial.print(',');
-	Serial.print(packet.bmpPressure);
-	Serial.print(',');
-	Serial.print((int)packet.tmpInternal);
-	Serial.print(',');
-	Serial.print((int)packet.tmpExternal);
-	Serial.print(',');
-	Serial.print(packet.batteryVoltage / 1000.0f, 3);
-	Serial.print(',');
+	Serial0.print(packet.gpsCourse);
+	Serial0.print(',');
+	Serial0.print(TinyGPS::cardinal(packet.gpsCourse));
+	Serial0.print(',');
+	Serial0.print(packet.gpsSpeed);
+	Serial0.print(',');
+	Serial0.print(packet.bmpPressure);
+	Serial0.print(',');
+	Serial0.print((int)packet.tmpInternal);
+	Serial0.print(',');
+	Serial0.print((int)packet.tmpExternal);
+	Serial0.print(',');
+	Serial0.print(packet.batteryVoltage / 1000.0f, 3);
+	Serial0.print(',');
+
+	if (hasLandingPrediction)
+	{
+		Serial0.print(landingPrediction.lat * 1.0e-5f, 6);
+		Serial0.print(',');
+		Serial0.print(landingPrediction.lon * 1.0e-5f, 6);
+		Serial0.print(',');
+		Serial0.print(landingPrediction.time);
+		Serial0.print(',');
+	}
+	else
+	{
+		Serial0.print(',');
+		Serial0.print(',');
+		Serial0.print(',');
+	}
 
-	Serial.println();
+	if (packet.landingLat != 0.0f && packet.landingLon != 0.0f)
+	{
+		Serial0.print(packet.landingLat, 6);
+		Serial0.print(',');
+		Serial0.print(packet.landingLon, 6);
+		Serial0.print(',');
+		Serial0.print(packet.landingTime);
+		Serial0.print(',');
+	}
+	else
+	{
+		Serial0.print(',');
+		Serial0.print(',');
+		Serial0.print(',');
+	}
+
+	Serial0.print(packet.minFreeMemory);
+	Serial0.print(',');
+	Serial0.print(packet.serialPeak);
+	Serial0.print(',');
+	Serial0.print(packet.serialLost);
+	Serial0.print(',');
+	Serial0.print(packet.features, HEX);
+	Serial0.print(',');
+
+	// when the balloon sent it, by our clock, and how long it took to get here
+	if (clockSync.IsSynced())
+	{
+		const uint32_t sent = clockSync.ToLocal(packet.time);
+		Serial0.print(sent);
+		Serial0.print(',');
+		transmitTimestamp(sent);
+		Serial0.print((int32_t)(now - sent));
+		Serial0.print(',');
+	}
+	else
+	{
+		Serial0.print(',');
+		Serial0.print(',');
+		Serial0.print(',');
+	}
+
+	Serial0.println();
 
 	// make sure the LCD is up to date
 	transmitLCD(now);
 }
 
+void handleBulk(uint32_t now, const BulkPacket& packet)
+{
+	if (!bulkReceiver.OnChunk(now, packet.base, packet.chunk, packet.stamp))
+		return;
+
+	// each new chunk goes to the laptop once, for FlightLog -b to put back together
+	static const char hex[] = "0123456789abcdef";
+	Serial0.print("Bulk,");
+	Serial0.print(now);
+	Serial0.print(',');
+	Serial0.print(packet.chunk);
+	Serial0.print(',');
+	for (uint8_t i=0; i<BulkPacket::c_ChunkSize; ++i)
+	{
+		Serial0.print(hex[packet.data[i] >> 4]);
+		Serial0.print(hex[packet.data[i] & 0xF]);
+	}
+	Serial0.print(',');
+	Serial0.println();
+}
+
+void handleCommandAnswer(uint32_t now, const CommandAnswerPacket& packet)
+{
+	if (!commandAuth.Verify(&packet, sizeof(packet) - sizeof(packet.mac), packet.mac) ||
+	    !commandSender.OnAnswer(packet.sequence, packet.result))
+		return;
+
+	// keep up with what the balloon's doing now
+	const uint32_t arg = commandSender.GetArg();
+	if (packet.result == ECommandResult::Done)
+	{
+		switch (commandSender.GetCommand())
+		{
+		case ECommand::TelemetryInterval:
+			telemetryInterval = arg;
+			break;
+
+		case ECommand::FastBeacon:
+			fastBeacon = arg > 0;
+			fastBeaconEnd = now + arg * 1000;
+			break;
+
+		case ECommand::BulkRewind:
+			bulkReceiver.Rewind(arg);
+			break;
+		}
+	}
+
+	transmitCommandResult(now, getCommandName(commandSender.GetCommand()), arg, packet.result < _countof(commandResultNames) ? commandResultNames[packet.result] : "unknownResult");
+}
+
+bool isTelemetryDue(uint32_t now)
+{
+	// the balloon's telemetry comes in every so often, so stay off the air just before it's expected
+	if (fastBeacon && (int32_t)(now - fastBeaconEnd) >= 0)
+		fastBeacon = false;
+	const uint32_t interval = fastBeacon ? FastBeaconInterval : telemetryInterval;
+	return telemetryReceiveCount && (now - latestTelemetryReceiveTime) % interval + UplinkGuardTime >= interval;
+}
+
+const char* getCommandName(uint8_t command)
+{
+	for (uint8_t i=0; i<_countof(commandNames); ++i)
+	{
+		if (commandNames[i].command == command)
+			return commandNames[i].name;
+	}
+	return "";
+}
+
+void queueCommand(uint32_t now, char* line)
+{
+	// a name and an arg, like "telemetry 2000"
+	char* pArg = strchr(line, ' ');
+	if (pArg)
+		*pArg++ = '\0';
+	const uint32_t arg = pArg ? strtoul(pArg, NULL, 0) : 0;
+
+	for (uint8_t i=0; i<_countof(commandNames); ++i)
+	{
+		if (strcmp(line, commandNames[i].name) == 0)
+		{
+			// a balloon built without the uplink would never answer, so don't keep sending to it
+			if (telemetryReceiveCount && !(latestTelemetryPacket.features & EFeature::Uplink))
+				transmitCommandResult(now, line, arg, "unavailable");
+			else if (!commandSender.Queue(commandNames[i].command, arg))
+				transmitCommandResult(now, line, arg, "busy");
+			return;
+		}
+	}
+	transmitCommandResult(now, line, arg, "unknownCommand");
+}
+
+void transmitCommand(uint32_t now)
+{
+	if (commandSender.HasFailed(now))
+	{
+		transmitCommandResult(now, getCommandName(commandSender.GetCommand()), commandSender.GetArg(), "failed");
+		return;
+	}
+
+	CommandPacket packet;
+	if (isTelemetryDue(now) || !commandSender.GetNext(now, &packet.sequence, &packet.command, &packet.arg))
+		return;
+
+	packet.mac = commandAuth.Sign(&packet, sizeof(packet) - sizeof(packet.mac));
+	xtend.SendTo(XTendDest, (uint8_t*)&packet, sizeof(packet));
+	commandSender.OnSent(now);
+}
+
+void transmitCommandResult(uint32_t now, const char* command, uint32_t arg, const char* result)
+{
+	Serial0.print("Command,");
+	Serial0.print(now);
+	Serial0.print(',');
+	transmitTimestamp(now);
+	Serial0.print(commandSender.GetSequence());
+	Serial0.print(',');
+	Serial0.print(command);
+	Serial0.print(',');
+	Serial0.print(arg);
+	Serial0.print(',');
+	Serial0.print(result);
+	Serial0.print(',');
+	Serial0.print(commandSender.GetTries());
+	Serial0.print(',');
+	Serial0.println();
+}
+
+void transmitBulkAck(uint32_t now)
+{
+	if (!bulkReceiver.IsAckDue(now) || isTelemetryDue(now))
+		return;
+
+	BulkAckPacket packet;
+	bulkReceiver.GetAck(&packet.base, &packet.received, &packet.latestStamp);
+	xtend.SendTo(XTendDest, (uint8_t*)&packet, sizeof(packet));
+}
+
 void transmitHeadings()
 {
 	// for Logging rows:
-	Serial.print("Logging,");
-	Serial.print("now (ms),");
+	Serial0.print("Logging,");
+	Serial0.print("now (ms),");
+	Serial0.print("ppsTime (s),");
 	
-	Serial.print("gpsTime,");
-	Serial.print("gpsLat (deg),");
-	Serial.print("gpsLon (deg),");
-	Serial.print("gpsAlt (m),");
-	Serial.print("gpsCourse (deg),");
-	Serial.print("gpsCourse (cardinal),");
-	Serial.print("gpsSpeed (m/s),");
-	Serial.print("gpsSats,");
-	Serial.print("range (m),");
-	Serial.print("bearing (deg),");
-	Serial.print("bearing (cardinal),");
+	Serial0.print("gpsTime,");
+	Serial0.print("gpsLat (deg),");
+	Serial0.print("gpsLon (deg),");
+	Serial0.print("gpsAlt (m),");
+	Serial0.print("gpsCourse (deg),");
+	Serial0.print("gpsCourse (cardinal),");
+	Serial0.print("gpsSpeed (m/s),");
+	Serial0.print("gpsSats,");
+	Serial0.print("range (m),");
+	Serial0.print("bearing (deg),");
+	Serial0.print("bearing (cardinal),");
+	Serial0.print("elevation (deg),");
+	Serial0.print("mountAz (deg),");
+	Serial0.print("mountEl (deg),");
+	Serial0.print("gpsSerialPeak (bytes),");
+	Serial0.print("gpsSerialLost,");
+	Serial0.print("xtendSerialPeak (bytes),");
+	Serial0.print("xtendSerialLost,");
+	Serial0.print("bulkChunks,");
+	Serial0.print("bulkBase,");
+	Serial0.print("bulkDuplicates,");
+	Serial0.print("bulkLost,");
+	Serial0.print("clockOffset (ms),");
+	Serial0.print("clockDrift (ppm),");
+	Serial0.print("clockDelay (ms),");
+	Serial0.print("clockSamples,");
 	
-	Serial.println();
+	Serial0.println();
 
 	// for Telemetry rows:
-	Serial.print("Telemetry,");
-	Serial.print("now (ms),");
-	Serial.print("signal strength (-dBm),");
-	Serial.print("recvNum,");
-	Serial.print("uptime (s),");
-	Serial.print("gpsLat (deg),");
-	Serial.print("gpsLon (deg),");
-	Serial.print("gpsAlt (m),");
+	Serial0.print("Telemetry,");
+	Serial0.print("now (ms),");
+	Serial0.print("ppsTime (s),");
+	Serial0.print("signal strength (-dBm),");
+	Serial0.print("recvNum,");
+	Serial0.print("uptime (s),");
+	Serial0.print("gpsLat (deg),");
+	Serial0.print("gpsLon (deg),");
+	Serial0.print("gpsAlt (m),");
+	Serial0.print("ascentRate (m/s),");
 
 	for (uint32_t i=0; i<_countof(AscentTrackingIntervals); ++i)
 	{
-		Serial.print("gpsAsc (m/s@");
-		Serial.print(AscentTrackingIntervals[i] / 1000);
-		Serial.print("s),");
+		Serial0.print("gpsAsc (m/s@");
+		Serial0.print(AscentTrackingIntervals[i] / 1000);
+		Serial0.print("s),");
 	}
 
-	Serial.print("gpsCourse (deg),");
-	Serial.print("gpsCourse (cardinal),");
-	Serial.print("gpsSpeed (m/s),");
-	Serial.print("bmpPressure (Pa),");
-	Serial.print("tmpInt (C),");
-	Serial.print("tmpExt (C),");
-	Serial.print("battery (V),");
-
-	Serial.println();
+	Serial0.print("gpsCourse (deg),");
+	Serial0.print("gpsCourse (cardinal),");
+	Serial0.print("gpsSpeed (m/s),");
+	Serial0.print("bmpPressure (Pa),");
+	Serial0.print("tmpInt (C),");
+	Serial0.print("tmpExt (C),");
+	Serial0.print("battery (V),");
+	Serial0.print("landingLat (deg),");
+	Serial0.print("landingLon (deg),");
+	Serial0.print("landingTime (s),");
+	Serial0.print("onboard landingLat (deg),");
+	Serial0.print("onboard landingLon (deg),");
+	Serial0.print("onboard landingTime (s),");
+	Serial0.print("minFree (bytes),");
+	Serial0.print("serialPeak (bytes),");
+	Serial0.print("serialLost,");
+	Serial0.print("features (hex),");
+	Serial0.print("sentTime (ms),");
+	Serial0.print("sentPpsTime (s),");
+	Serial0.print("latency (ms),");
+
+	Serial0.println();
+
+	// for Bulk rows:
+	Serial0.print("Bulk,");
+	Serial0.print("now (ms),");
+	Serial0.print("chunk,");
+	Serial0.print("data (hex),");
+
+	Serial0.println();
+
+	// for Command rows:
+	Serial0.print("Command,");
+	Serial0.print("now (ms),");
+	Serial0.print("ppsTime (s),");
+	Serial0.print("sequence,");
+	Serial0.print("command,");
+	Serial0.print("arg,");
+	Serial0.print("result,");
+	Serial0.print("tries,");
+
+	Serial0.println();
 }
 
-void transmitLogging(uint32_t now)
+void transmitLogging(uint32_t now, uint32_t dt)
 {
-	loggingLastSend = now;
-
-	Serial.print("Logging,");
-	Serial.print(now);	
-	Serial.print(',');
+	Serial0.print("Logging,");
+	Serial0.print(now);	
+	Serial0.print(',');
+	transmitTimestamp(now);
 
 	uint8_t hours, minutes, seconds, hundredths;
 	if (gps.crack_datetime(NULL, NULL, NULL, &hours, &minutes, &seconds, &hundredths))
 	{
-		Serial.print((int)hours);
-		Serial.print(':');
-		Serial.print((int)minutes);
-		Serial.print(':');
-		Serial.print(seconds + 0.01f * hundredths, 2);
+		Serial0.print((int)hours);
+		Serial0.print(':');
+		Serial0.print((int)minutes);
+		Serial0.print(':');
+		Serial0.print(seconds + 0.01f * hundredths, 2);
 	}
-	Serial.print(',');
+	Serial0.print(',');
 
 	float lat, lon;
 	const bool hasPosition = gps.f_get_position(&lat, &lon);
 
 	if (hasPosition)
 	{
-		Serial.print(lat, 6);
-		Serial.print(',');
-		Serial.print(lon, 6);
-		Serial.print(',');
-		Serial.print(gps.f_altitude(), 3);
-		Serial.print(',');
-		Serial.print(gps.f_course(), 3);
-		Serial.print(',');
-		Serial.print(TinyGPS::cardinal(gps.f_course()));
-		Serial.print(',');
-		Serial.print(gps.f_speed_mps(), 3);
-		Serial.print(',');
-		Serial.print(gps.satellites());
-		Serial.print(',');
+		Serial0.print(lat, 6);
+		Serial0.print(',');
+		Serial0.print(lon, 6);
+		Serial0.print(',');
+		Serial0.print(gps.f_altitude(), 3);
+		Serial0.print(',');
+		Serial0.print(gps.f_course(), 3);
+		Serial0.print(',');
+		Serial0.print(TinyGPS::cardinal(gps.f_course()));
+		Serial0.print(',');
+		Serial0.print(gps.f_speed_mps(), 3);
+		Serial0.print(',');
+		Serial0.print(gps.satellites());
+		Serial0.print(',');
+	}
+	else
+	{
+		Serial0.print(',');
+		Serial0.print(',');
+		Serial0.print(',');
+		Serial0.print(',');
+		Serial0.print(',');
+		Serial0.print(',');
+		Serial0.print(',');
+	}
+
+
+	Geodesy::LookAngle look;
+	if (getLookAngle(&look))
+	{
+		Serial0.print(look.groundRange);
+		Serial0.print(',');
+		Serial0.print(look.azimuth / 100.0f, 2);
+		Serial0.print(',');
+		Serial0.print(TinyGPS::cardinal(look.azimuth / 100.0f));
+		Serial0.print(',');
+		Serial0.print(look.elevation / 100.0f, 2);
+		Serial0.print(',');
 	}
 	else
 	{
-		Serial.print(',');
-		Serial.print(',');
-		Serial.print(',');
-		Serial.print(',');
-		Serial.print(',');
-		Serial.print(',');
-		Serial.print(',');
+		Serial0.print(',');
+		Serial0.print(',');
+		Serial0.print(',');
+		Serial0.print(',');
 	}
 
+	if (antennaMount.HasTarget())
+	{
+		Serial0.print(antennaMount.GetAngle(AntennaMount::EAxis::Azimuth) / 100.0f, 2);
+		Serial0.print(',');
+		Serial0.print(antennaMount.GetAngle(AntennaMount::EAxis::Elevation) / 100.0f, 2);
+		Serial0.print(',');
+	}
+	else
+	{
+		Serial0.print(',');
+		Serial0.print(',');
+	}
 
-	if (hasPosition && 
-	    telemetryReceiveCount > 0 &&
-	    latestTelemetryPacket.gpsLat != 0.0f &&
-	    latestTelemetryPacket.gpsLon != 0.0f)
+	Serial0.print(GPSSerial.GetRxPeak());
+	Serial0.print(',');
+	Serial0.print(GPSSerial.GetOverflowCount() + GPSSerial.GetOverrunCount() + GPSSerial.GetFramingErrorCount());
+	Serial0.print(',');
+	Serial0.print(XTendSerial.GetRxPeak());
+	Serial0.print(',');
+	Serial0.print(XTendSerial.GetOverflowCount() + XTendSerial.GetOverrunCount() + XTendSerial.GetFramingErrorCount());
+	Serial0.print(',');
+	Serial0.print(bulkReceiver.GetReceivedCount());
+	Serial0.print(',');
+	Serial0.print(bulkReceiver.GetBase());
+	Serial0.print(',');
+	Serial0.print(bulkReceiver.GetDuplicateCount());
+	Serial0.print(',');
+	Serial0.print(bulkReceiver.GetLostCount());
+	Serial0.print(',');
+	if (clockSync.IsSynced())
 	{
-		Serial.print(TinyGPS::distance_between(lat, lon, latestTelemetryPacket.gpsLat, latestTelemetryPacket.gpsLon), 3);
-		Serial.print(',');
-		Serial.print(TinyGPS::course_to(lat, lon, latestTelemetryPacket.gpsLat, latestTelemetryPacket.gpsLon), 0);
-		Serial.print(',');
-		Serial.print(TinyGPS::cardinal(TinyGPS::course_to(lat, lon, latestTelemetryPacket.gpsLat, latestTelemetryPacket.gpsLon)));
-		Serial.print(',');
+		Serial0.print(clockSync.GetOffset(now));
+		Serial0.print(',');
+		Serial0.print(clockSync.GetDrift(), 1);
+		Serial0.print(',');
+		Serial0.print(clockSync.GetDelay());
+		Serial0.print(',');
 	}
 	else
 	{
-		Serial.print(',');
-		Serial.print(',');
-		Serial.print(',');
+		Serial0.print(',');
+		Serial0.print(',');
+		Serial0.print(',');
 	}
+	Serial0.print(clockSync.GetSampleCount());
+	Serial0.print(',');
+
+	Serial0.println();
+}
+
+void transmitTimestamp(uint32_t time)
+{
+	Timebase::Timestamp timestamp;
+	if (g_Timebase.MillisToTime(time, &timestamp))
+		serprintf(Serial0, "%lu.%06lu", timestamp.seconds, timestamp.micros);
+	Serial0.print(',');
+}
 
-	Serial.println();
+bool getLookAngle(Geodesy::LookAngle* pLook)
+{
+	long lat, lon;
+	if (!gps.get_position(&lat, &lon) ||
+	    telemetryReceiveCount == 0 ||
+	    latestTelemetryPacket.gpsLat == 0.0f ||
+	    latestTelemetryPacket.gpsLon == 0.0f)
+		return false;
+
+	const long alt = gps.altitude() != TinyGPS::GPS_INVALID_ALTITUDE ? gps.altitude() / 100 : 0;
+	Geodesy::GetLookAngle(lat, lon, alt,
+		(int32_t)floor(latestTelemetryPacket.gpsLat * 1.0e5f + 0.5f), (int32_t)floor(latestTelemetryPacket.gpsLon * 1.0e5f + 0.5f), latestTelemetryPacket.gpsAlt,
+		pLook);
+	return true;
 }
 
-void transmitLCD(uint32_t now)
+bool getLandingPrediction(uint32_t now, LandingPredictor::Prediction* pPrediction)
 {
-	lcdLastSend = now;
+	// our own, or failing that the balloon's
+	if (hasLandingPrediction)
+	{
+		*pPrediction = landingPrediction;
+	}
+	else if (latestTelemetryPacket.landingLat != 0.0f && latestTelemetryPacket.landingLon != 0.0f)
+	{
+		pPrediction->lat = (int32_t)floor(latestTelemetryPacket.landingLat * 1.0e5f + 0.5f);
+		pPrediction->lon = (int32_t)floor(latestTelemetryPacket.landingLon * 1.0e5f + 0.5f);
+		pPrediction->time = latestTelemetryPacket.landingTime;
+		pPrediction->landingSpeed = 0;
+	}
+	else
+	{
+		return false;
+	}
+
+	// count down from when the packet came in
+	const uint32_t age = (now - latestTelemetryReceiveTime) / 1000;
+	pPrediction->time = pPrediction->time > age ? pPrediction->time - age : 0;
+	return true;
+}
 
+void transmitLCD(uint32_t now, uint32_t dt)
+{
 	const char* c_Clear = "\xFE\x01";
 	const char* c_GoToLine2 = "\xFE\xC0";
 
 	// clear
 	LCDSerial.print(c_Clear);
 
-	switch (lcdPage < LCDPageCount ? lcdPage : now / LCDPageTime % 6)
+	switch (lcdPage < LCDPageCount ? lcdPage : now / LCDPageTime % LCDPageCount)
 	{
 	case 0:
 		LCDSerial.print("Pos ");
@@ -396,17 +914,9 @@ void transmitLCD(uint32_t now)
 
 		LCDSerial.print(c_GoToLine2);
 		LCDSerial.print("Asc ");
-
-		for (uint32_t i=0; i<_countof(AscentTrackingIntervals); ++i)
-		{
-			if (i)
-			{
-				LCDSerial.print('/');
-			}
-
-			LCDSerial.print(ascentRateData[i].m_AscentRate, 1);
-		}
-
+		LCDSerial.print(latestTelemetryPacket.ascentRate / 100.0f, 1);
+		LCDSerial.print('/');
+		LCDSerial.print(ascentRateData[_countof(AscentTrackingIntervals) - 1].m_AscentRate, 1);
 		LCDSerial.print("m/s");
 
 		break;
@@ -434,15 +944,14 @@ void transmitLCD(uint32_t now)
 	
 	case 3:
 		LCDSerial.print("Rng ");
-		float lat, lon;
-		if (gps.f_get_position(&lat, &lon) && 
-		    telemetryReceiveCount > 0 &&
-		    latestTelemetryPacket.gpsLat != 0.0f &&
-		    latestTelemetryPacket.gpsLon != 0.0f)
+		Geodesy::LookAngle look;
+		bool hasLook;
+		hasLook = getLookAngle(&look);
+		if (hasLook)
 		{
-			LCDSerial.print(TinyGPS::distance_between(lat, lon, latestTelemetryPacket.gpsLat, latestTelemetryPacket.gpsLon), 0);
+			LCDSerial.print(look.groundRange);
 			LCDSerial.print("m ");
-			LCDSerial.print(TinyGPS::cardinal(TinyGPS::course_to(lat, lon, latestTelemetryPacket.gpsLat, latestTelemetryPacket.gpsLon)));
+			LCDSerial.print(TinyGPS::cardinal(look.azimuth / 100.0f));
 		}
 		else
 		{
@@ -450,7 +959,12 @@ void transmitLCD(uint32_t now)
 		}
 
 		LCDSerial.print(c_GoToLine2);
-		LCDSerial.print("Sig ");
+		LCDSerial.print("El ");
+		if (hasLook)
+			LCDSerial.print(look.elevation / 100.0f, 1);
+		else
+			LCDSerial.print("---");
+		LCDSerial.print(' ');
 		LCDSerial.print(-(int)latestSignalStrength);
 		LCDSerial.print("dBm");
 
@@ -472,7 +986,7 @@ void transmitLCD(uint32_t now)
 
 	case 5:
 		LCDSerial.print("Upt ");
-		LCDSerial.print(latestTelemetryPacket.time);
+		LCDSerial.print(latestTelemetryPacket.time / 1000);
 		LCDSerial.print('+');
 
 		LCDSerial.print((now - latestTelemetryReceiveTime) / 1000);
@@ -484,6 +998,43 @@ void transmitLCD(uint32_t now)
 
 		break;
 
+	case 6:
+		LCDSerial.print("Lnd ");
+		LandingPredictor::Prediction landing;
+		bool hasLanding;
+		hasLanding = getLandingPrediction(now, &landing);
+		long trackerLat, trackerLon;
+		if (hasLanding && gps.get_position(&trackerLat, &trackerLon))
+		{
+			LCDSerial.print(Geodesy::HaversineRangeInM(trackerLat, trackerLon, landing.lat, landing.lon) / 1000.0f, 1);
+			LCDSerial.print("km ");
+			LCDSerial.print(TinyGPS::cardinal(Geodesy::BearingInCentiDeg(trackerLat, trackerLon, landing.lat, landing.lon) / 100.0f));
+		}
+		else
+		{
+			LCDSerial.print("---");
+		}
+
+		LCDSerial.print(c_GoToLine2);
+		LCDSerial.print("in ");
+		if (hasLanding)
+		{
+			LCDSerial.print(landing.time / 60);
+			LCDSerial.print('m');
+			if (landing.landingSpeed)
+			{
+				LCDSerial.print(' ');
+				LCDSerial.print(landing.landingSpeed / 100.0f, 1);
+				LCDSerial.print("m/s");
+			}
+		}
+		else
+		{
+			LCDSerial.print("---");
+		}
+
+		break;
+
 	case LCDPageCount:
 		break;
 	}
@@ -491,13 +1042,22 @@ void transmitLCD(uint32_t now)
 
 void transmitPing(uint32_t now)
 {
-	pingLastSend = now;
-	
+	if (now - lastPingTime < PingInterval || isTelemetryDue(now))
+		return;
+	lastPingTime = now;
+
 	PingPacket packet;
-	packet.time = millis();
+	packet.originate = millis();
 
 	++pingSendCount;
 
 	xtend.SendTo(XTendDest, (uint8_t*)&packet, sizeof(packet));
 }
 
+void transmitProfile(uint32_t now, uint32_t dt)
+{
+	// binary, for tools/ProfileDump; the newline puts the next row back at the start of a line
+	profiler.Dump(Serial0, now);
+	Serial0.println();
+}
+
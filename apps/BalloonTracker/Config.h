@@ -2,29 +2,102 @@
 
 #include <Core.h>
 #include <XTendAPI.h>
+#include <GPSConfigurator.h>
+#include <AntennaMount.h>
+#include <LandingPredictor.h>
+#include <BulkReceiver.h>
+#include <CommandAuth.h>
+#include <CommandSender.h>
+#include <ClockSync.h>
 
-const uint32_t LoggingInterval = 1000ul;
-const uint32_t LoggingStagger  = 250ul;
-const uint32_t LCDInterval     = 1000ul;
-const uint32_t LCDStagger      = 0ul;
-const uint32_t PingInterval    = 30000ul;
-const uint32_t PingStagger     = 500ul;
+const uint32_t LoggingInterval    = 1000ul;
+const uint32_t LoggingPhase       = 250ul;
+const uint32_t LCDInterval        = 1000ul;
+const uint32_t LCDPhase           = 0ul;
+const uint32_t PingInterval       = 5000ul;   // between the pings ClockSync times the balloon's clock with, when the air's clear
+const uint32_t LCDButtonInterval  = 10ul;
+const uint32_t LEDInterval        = 50ul;
+const uint32_t ProfileInterval    = 60000ul;
+const uint32_t ProfilePhase       = 750ul;
+const uint32_t SerialPollDeadline = 20ul;  // at 115200 the GPS or XTend fills a 256 byte receive buffer in 22 ms
 
 #define LoggingBaud 115200
+const uint16_t LoggingRxBufferSize = 16;    // powers of two, up to 256
+const uint16_t LoggingTxBufferSize = 256;
 
-#define LCDSerial Serial2
+#define LCDSerialPort 2
+const uint16_t LCDRxBufferSize = 2;         // it never says anything
+const uint16_t LCDTxBufferSize = 64;
 #define LCDBaud 9600
 #define LCDPagePin 2
-#define LCDPageCount 6
+#define LCDPageCount 7
 #define LCDPageTime 3000
 
-#define GPSSerial Serial1
+#define GPSSerialPort 1
+const uint16_t GPSRxBufferSize = 256;
+const uint16_t GPSTxBufferSize = 64;
 #define GPSBaud 115200
+const char GPSConfigScript[] PROGMEM =
+	"PMTK314,0,1,0,1,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0\n"	// RMC and GGA only
+	"PMTK220,1000\n";									// 1 Hz
+const char GPSResetBanner[] PROGMEM = "$PMTK010,001";
+// the GPS's PPS output goes to digital pin 48 (ICP5) for the Timebase
 
-#define XTendSerial Serial3
+#define XTendSerialPort 3
+const uint16_t XTendRxBufferSize = 256;
+const uint16_t XTendTxBufferSize = 64;
 #define XTendBaud 115200
 #define XTendPTTPin 52
 const XTendAPI::Address XTendDest = 0x6905;
 
+// the balloon's flight recorder log, as it sends it down with BulkDownlink
+const BulkReceiver::Config BulkReceiverConfig = {
+	500,    // ackInterval (ms)
+	8,      // ackEvery (chunks)
+};
+const uint32_t TelemetryInterval  = 1000ul;  // should match the balloon's TelemetryTransmitInterval, until it's changed by a command
+const uint32_t FastBeaconInterval = 250ul;   // should match the balloon's
+const uint32_t UplinkGuardTime    = 150ul;   // no ack, command or ping this close before the next telemetry packet's expected, so they don't collide
+
+// the balloon's clock against ours, to put its telemetry on our timeline
+const ClockSync::Config ClockSyncConfig = {
+	500,    // maxDelay (ms), a ping's round trip at 9600 baud is ~80 ms when nothing holds it up
+	30000,  // historySpacing (ms), so the drift's fitted over the last 8 minutes
+};
+
+// commands for the balloon, typed into the laptop as a line like "!beacon 600"
+const CommandSender::Config CommandSenderConfig = {
+	1500,   // retryInterval (ms)
+	5,      // maxTries
+};
+// the key's kept out of git: copy CommandKey.h.example to CommandKey.h and put the balloon's in it
+#if defined(__has_include)
+#if !__has_include("CommandKey.h")
+#error "BalloonTracker needs a CommandKey.h, copied from CommandKey.h.example with the balloon's key in it"
+#endif
+#endif
+#include "CommandKey.h"
+
 const uint32_t AscentTrackingIntervals[] = {5000, 30000};
 
+// pan/tilt servos on digital pins 6 (azimuth) and 7 (elevation)
+const AntennaMount::Config AntennaMountConfig = {
+	{
+		{-9000, 9000, 600, 2400, 18000},    // azimuth: 180 degree servo, centered on heading
+		{0, 18000, 600, 2400, 18000},       // elevation: 180 degree servo, so it can flip over the top
+	},
+	0,      // heading (centidegrees), point the mount's center at the predicted track when setting up
+	true,   // canFlip
+	20,     // controlPeriod (ms), every servo frame
+	5000,   // maxPrediction (ms)
+};
+
+// should match the balloon's
+const LandingPredictor::Config LandingPredictorConfig = {
+	1000,   // binHeight (m)
+	30000,  // burstAlt (m)
+	765,    // groundAlt (m), around the launch site
+	1500,   // mass (g), payload and line under the parachute
+	10000,  // dragArea (cm^2), ~5 m/s at sea level
+};
+
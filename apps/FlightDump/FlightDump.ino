@@ -0,0 +1,123 @@
+// Reads the balloon's flight recorder back out over the serial port once it's down, for
+// tools/FlightLog. Load it onto the balloon's board in place of Balloon.ino and send:
+//   'D'  to dump every sector with a good header, each as a frame: 0xA5 0x5A 'F', the
+//        sector's index (2 bytes), its 4096 bytes and a CRC32 of the index and the bytes
+//   'X'  then 'Y' to erase the whole chip; the next flight's log carries on after this
+//        one's without it, keeping count of each sector's erases, so it's only to start clean
+// Everything else it sends is text, which FlightLog skips.
+
+#include <Core.h>
+#include <CRC.h>
+#include <SPI.h>
+#include <SPIFlash.h>
+#include <FlightRecorder.h>
+
+#define LoggingBaud 115200
+#define FlightRecorderCSPin 10
+
+const uint8_t c_Sync[] = {0xA5, 0x5A, 'F'};
+const uint8_t c_ReadChunk = 64;
+
+SPIFlash flash(FlightRecorderCSPin);
+bool eraseArmed = false;
+
+void dump();
+void erase();
+void waitWhileBusy();
+
+void setup()
+{
+	Serial.begin(LoggingBaud);
+
+	if (!flash.setup())
+	{
+		Serial.println("No flash chip");
+		return;
+	}
+
+	Serial.print("Flash ");
+	Serial.print(flash.GetManufacturer(), HEX);
+	Serial.print(' ');
+	Serial.print(flash.GetDeviceID(), HEX);
+	Serial.print(", ");
+	Serial.print(flash.GetSize());
+	Serial.println(" bytes");
+}
+
+void loop()
+{
+	if (!Serial.available())
+		return;
+
+	const char c = Serial.read();
+	if (c == 'D')
+		dump();
+	else if (c == 'X')
+		Serial.println("Send Y to erase the chip");
+	else if (c == 'Y' && eraseArmed)
+		erase();
+
+	eraseArmed = (c == 'X');
+}
+
+void dump()
+{
+	const uint16_t sectors = flash.GetSize() / FlashDevice::c_SectorSize;
+	uint16_t dumped = 0;
+	for (uint16_t i=0; i<sectors; ++i)
+	{
+		const uint32_t address = (uint32_t)i * FlashDevice::c_SectorSize;
+
+		FlightRecorder::SectorHeader header;
+		flash.Read(address, (uint8_t*)&header, sizeof(header));
+		if (!FlightRecorder::IsHeaderValid(header))
+			continue;
+
+		Serial.write(c_Sync, sizeof(c_Sync));
+		Serial.write((const uint8_t*)&i, sizeof(i));
+
+		uint32_t crc = crc32_init();
+		crc = crc32_update(crc, (uint8_t)i);
+		crc = crc32_update(crc, (uint8_t)(i >> 8));
+
+		uint8_t chunk[c_ReadChunk];
+		for (uint16_t offset=0; offset<FlashDevice::c_SectorSize; offset+=c_ReadChunk)
+		{
+			flash.Read(address + offset, chunk, c_ReadChunk);
+			for (uint8_t j=0; j<c_ReadChunk; ++j)
+				crc = crc32_update(crc, chunk[j]);
+			Serial.write(chunk, c_ReadChunk);
+		}
+
+		crc = crc32_finish(crc);
+		Serial.write((const uint8_t*)&crc, sizeof(crc));
+		++dumped;
+	}
+
+	Serial.println();
+	Serial.print("Dumped ");
+	Serial.print(dumped);
+	Serial.println(" sectors");
+}
+
+void erase()
+{
+	const uint16_t sectors = flash.GetSize() / FlashDevice::c_SectorSize;
+	for (uint16_t i=0; i<sectors; ++i)
+	{
+		flash.EraseSector((uint32_t)i * FlashDevice::c_SectorSize);
+		waitWhileBusy();
+		if (i % 64 == 63)
+			Serial.print('.');
+	}
+
+	Serial.println();
+	Serial.println("Erased");
+}
+
+void waitWhileBusy()
+{
+	while (flash.IsBusy())
+	{
+	}
+}
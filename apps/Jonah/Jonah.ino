@@ -1,11 +1,14 @@
 #include <Core.h>
 #include <Wire.h>
+#include <Scheduler.h>
+#include <IdleManager.h>
 #include <FPS.h>
 #include <BMP085.h>
 #include <Thermistor.h>
 #include <CRC.h>
 
-uint32_t lastFrameTime = 0;
+Scheduler scheduler;
+IdleManager idle;
 FPS fps(0);
 
 const int c_BatteryMonitorPin = A3;
@@ -17,11 +20,16 @@ Thermistor therm(A0);
 float thermTempFiltered;
 
 BMP085 pressure;
-float pressureFiltered;
 
-uint32_t lastSend = 0;
+const uint32_t c_LEDInterval = 50ul;
+const uint32_t c_SensorInterval = 100ul;      // battery and thermistor
+const uint32_t c_PressureInterval = 5ul;      // polling the BMP085 for the end of a conversion
+const uint32_t c_TransmitInterval = 100ul;    // a packet takes 65 ms at 4800, and the APRS board listens for 250 ms at a time
 
-void transmit(uint32_t now);
+void updateLED(uint32_t now, uint32_t dt);
+void readSensors(uint32_t now, uint32_t dt);
+void readPressure(uint32_t now, uint32_t dt);
+void transmit(uint32_t now, uint32_t dt);
 
 void setup()
 {
@@ -43,46 +51,50 @@ void setup()
 
 	pressure.setup();
 	pressure.SetOversamplingSetting(3);
+	pressure.SetAveraging(32);
 	pressure.SetReferencePressure(101325);
 	pressure.loop();
-	pressureFiltered = pressure.GetPressureInPa();
 
-	uint32_t now = millis();
-	lastFrameTime = now;
-	lastSend = now;
+	scheduler.Add(updateLED, c_LEDInterval);
+	scheduler.Add(readSensors, c_SensorInterval);
+	scheduler.Add(readPressure, c_PressureInterval);
+	scheduler.Add(transmit, c_TransmitInterval);
+	scheduler.Start(millis());
 	
 	digitalWrite(13, LOW);
 }
 
 void loop()
 {
-	const uint32_t now = millis();
-	const float dt = (now - lastFrameTime) * 0.001f;
-	lastFrameTime = now;
-
-	fps.increment();
+	if (scheduler.loop())
+		fps.increment();
+	
+	fps.loop();
+	idle.loop(scheduler.GetTimeUntilNext(millis()));
+}
 
+void updateLED(uint32_t now, uint32_t dt)
+{
 	digitalWrite(13, (now % 1000) < 100);
-	
-	// update sensors
+}
+
+void readSensors(uint32_t now, uint32_t dtInMS)
+{
+	const float dt = dtInMS * 0.001f;
+
 	batteryVoltage = analogRead(c_BatteryMonitorPin) * c_BatteryVoltageScale;
 	batteryVoltageSmooth = LowPassFilter(batteryVoltage, batteryVoltageSmooth, dt, 2.5f);
 
-	thermTempFiltered = LowPassFilter((float)therm.getTemp(), thermTempFiltered, dt, 2.5f);
+	thermTempFiltered = LowPassFilter(therm.getTemp(), thermTempFiltered, dt, 2.5f);
+}
 
+void readPressure(uint32_t now, uint32_t dt)
+{
 	pressure.loopAsync();
-	pressureFiltered = LowPassFilter((float)pressure.GetPressureInPa(), pressureFiltered, dt, 2.5f);
-
-	// transmit
-	transmit(now);
-	
-	fps.loop();
 }
 
-void transmit(uint32_t now)
+void transmit(uint32_t now, uint32_t dt)
 {
-	lastSend = now;
-
 	struct JonahPacket
 	{
 		uint32_t now;
@@ -95,7 +107,7 @@ void transmit(uint32_t now)
 	JonahPacket p;
 	p.now = now;
 	p.batteryVoltage = floor(batteryVoltageSmooth * 1000.0f + 0.5f);
-	p.bmpPressure = floor(pressureFiltered + 0.5f);
+	p.bmpPressure = pressure.GetPressureInPa();
 	p.bmpTemp = pressure.GetTempInDeciC();
 	p.thermTemp = floor(thermTempFiltered * 1000.0f + 0.5f);
 
@@ -12,41 +12,91 @@
 #include "Arduino.h"
 #include "Thermistor.h"
 
+namespace {
+  struct Segment {
+    uint16_t start;  // first ADC code in the segment
+    uint8_t shift;   // log2 of the ADC codes per table entry
+    uint8_t index;   // table entry for start
+  };
+
+  const Segment c_Segments[] PROGMEM = {
+    {    0, 0,  0 },
+    {   16, 2, 16 },
+    {   64, 4, 28 },
+    {  192, 5, 36 },
+    {  832, 4, 56 },
+    {  960, 2, 64 },
+    { 1008, 0, 76 },
+  };
+  const uint8_t c_SegmentCount = sizeof(c_Segments) / sizeof(c_Segments[0]);
+}
+
+/******************************************************************/
+/* Steinhart-Hart, as getTemp() used to evaluate it per reading:	*/
+/*    Temperature in Kelvin = 1 / {A + B[ln(R)] + C[ln(R)]^3}		*/
+/*    where A = 0.001129148, B = 0.000234125 and C = 8.76741E-08	*/
+/*    and R = 10240000 / ADC - 10000								*/
+/* evaluated at the start of each table entry (ADC clamped to		*/
+/* 1..1023), in milli-degrees C.  Within -70..120C, interpolating	*/
+/* is within 0.25C of the equation.  Generated, and checked, by	*/
+/* tools/ThermistorTable, which takes other coefficients too.		*/
+/******************************************************************/
+const int32_t Thermistor::c_Table10k[Thermistor::c_TableSize] PROGMEM = {
+	 -83641,  -83641,  -75862,  -71078,  -67571,  -64782,  -62457,  -60457,
+	 -58699,  -57127,  -55704,  -54403,  -53203,  -52089,  -51048,  -50071,
+	 -49150,  -45911,  -43196,  -40851,  -38779,  -36919,  -35228,  -33674,
+	 -32236,  -30894,  -29636,  -28450,  -27327,  -23338,  -19940,  -16954,
+	 -14273,  -11825,   -9561,   -7445,   -5450,   -1747,    1667,    4872,
+	   7926,   10870,   13740,   16563,   19366,   22170,   25000,   27877,
+	  30827,   33876,   37058,   40409,   43979,   47829,   52042,   56738,
+	  62091,   65094,   68376,   72004,   76068,   80697,   86085,   92541,
+	 100598,  102965,  105516,  108280,  111295,  114610,  118288,  122412,
+	 127101,  132521,  138926,  146719,  156604,  159538,  162713,  166171,
+	 169960,  174146,  178814,  184079,  190098,  197101,  205434,  215652,
+	 228732,  246607,  273975,  327828,  327828,
+};
+
 //--------------------------
-Thermistor::Thermistor(int pin) {
+Thermistor::Thermistor(int pin, const int32_t* table) {
   _pin = pin;
+  _table = table;
+  _oversampling = 0;
+}
+
+//--------------------------
+void Thermistor::setOversampling(uint8_t bits) {
+  _oversampling = bits < c_MaxOversampling ? bits : (uint8_t)c_MaxOversampling;
+}
+
+//--------------------------
+int32_t Thermistor::getTempInMilliC() {
+  // Sum 4^n readings, which is n bits of extra resolution once the noise is averaged out
+  uint16_t sum = 0;
+  for (uint8_t i = 0; i < (1 << (2 * _oversampling)); ++i)
+    sum += analogRead(_pin);
+
+  return codeToMilliC(_table, sum << (6 - 2 * _oversampling));
+}
+
+//--------------------------
+float Thermistor::getTemp() {
+  return getTempInMilliC() * 0.001f;
 }
 
 //--------------------------
-double Thermistor::getTemp() {
-  // Inputs ADC Value from Thermistor and outputs Temperature in Celsius
-  int RawADC = analogRead(_pin);
-
-  long Resistance;
-  double Temp;
-
-  // Assuming a 10k Thermistor.  Calculation is actually: Resistance = (1024/ADC)
-  Resistance=((10240000/RawADC) - 10000);
-
-  /******************************************************************/
-  /* Utilizes the Steinhart-Hart Thermistor Equation:				*/
-  /*    Temperature in Kelvin = 1 / {A + B[ln(R)] + C[ln(R)]^3}		*/
-  /*    where A = 0.001129148, B = 0.000234125 and C = 8.76741E-08	*/
-  /******************************************************************/
-  Temp = log(Resistance);
-  Temp = 1 / (0.001129148 + (0.000234125 * Temp) + (0.0000000876741 * Temp * Temp * Temp));
-  Temp = Temp - 273.15;  // Convert Kelvin to Celsius
-
-  /* - TESTING OUTPUT - remove lines with * to get serial print of data
-  Serial.print("ADC: "); Serial.print(RawADC); Serial.print("/1024");  // Print out RAW ADC Number
-  Serial.print(", Volts: "); printDouble(((RawADC*4.860)/1024.0),3);   // 4.860 volts is what my USB Port outputs.
-  Serial.print(", Resistance: "); Serial.print(Resistance); Serial.print("ohms");
-  */
-
-  // Uncomment this line for the function to return Fahrenheit instead.
-  // Temp = (Temp * 9.0)/ 5.0 + 32.0; // Convert to Fahrenheit
-
-  return Temp;  // Return the Temperature
+int32_t Thermistor::codeToMilliC(const int32_t* table, uint16_t code) {
+  uint8_t s = c_SegmentCount - 1;
+  while (s > 0 && code < (uint16_t)(pgm_read_word(&c_Segments[s].start) << 6))
+    --s;
+
+  const uint8_t shift = pgm_read_byte(&c_Segments[s].shift) + 6;
+  const uint16_t offset = code - (uint16_t)(pgm_read_word(&c_Segments[s].start) << 6);
+  const uint8_t index = pgm_read_byte(&c_Segments[s].index) + (offset >> shift);
+  const int32_t frac = offset & ((1 << shift) - 1);
+
+  const int32_t a = pgm_read_dword(&table[index]);
+  const int32_t b = pgm_read_dword(&table[index + 1]);
+  return a + (((b - a) * frac) >> shift);
 }
 
 /* ======================================================== */
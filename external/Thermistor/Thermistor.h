@@ -17,15 +17,34 @@
 #define Thermistor_h
 
 #include "Arduino.h"
-#include "math.h"
 
 
+// Temperatures come from a PROGMEM table of milli-degrees C, indexed by ADC code in segments
+// that get finer towards the ends of the range, where the curve is steepest, and linearly
+// interpolated in between.  No log() or floating point is needed per reading.
 class Thermistor {
 	public:
-		Thermistor(int pin);
-		double getTemp();
+		static const uint8_t c_TableSize = 93;
+		static const uint8_t c_MaxOversampling = 3;
+
+		// the table for a 10k thermistor against a 10k pull-down, with the Steinhart-Hart
+		// coefficients from the Arduino playground; tools/ThermistorTable makes the table
+		// for any other thermistor from its coefficients
+		static const int32_t c_Table10k[c_TableSize] PROGMEM;
+
+		Thermistor(int pin, const int32_t* table = c_Table10k);
+
+		// reads 4^bits samples per conversion and keeps bits of extra resolution
+		void setOversampling(uint8_t bits);
+
+		int32_t getTempInMilliC();
+		float getTemp();
+
+		static int32_t codeToMilliC(const int32_t* table, uint16_t code); // code in 1/64 ADC counts
 	private:
 		int _pin;
+		const int32_t* _table;
+		uint8_t _oversampling;
 };
 
 #endif
@@ -21,9 +21,10 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 */
 
 #include "TinyGPS.h"
+#include <avr/pgmspace.h>
 
-#define _GPRMC_TERM   "GPRMC"
-#define _GPGGA_TERM   "GPGGA"
+// Sentence names (minus the talker ID), in _GPS_SENTENCE_xxx order
+static const char _gps_sentence_names[] PROGMEM = "GGA" "RMC" "GSA" "GSV" "VTG" "ZDA";
 
 TinyGPS::TinyGPS()
   :  _time(GPS_INVALID_TIME)
@@ -34,15 +35,25 @@ TinyGPS::TinyGPS()
   ,  _speed(GPS_INVALID_SPEED)
   ,  _course(GPS_INVALID_ANGLE)
   ,  _hdop(GPS_INVALID_HDOP)
+  ,  _pdop(GPS_INVALID_DOP)
+  ,  _vdop(GPS_INVALID_DOP)
   ,  _numsats(GPS_INVALID_SATELLITES)
+  ,  _fix_quality(0)
+  ,  _fix_type(GPS_INVALID_FIX_TYPE)
+  ,  _sats_in_view(GPS_INVALID_SATELLITES)
+  ,  _sats_tracked(GPS_INVALID_SATELLITES)
+  ,  _average_snr(GPS_INVALID_SNR)
   ,  _last_time_fix(GPS_INVALID_FIX_TIME)
   ,  _last_position_fix(GPS_INVALID_FIX_TIME)
+  ,  _gsv_tracked(0)
+  ,  _gsv_snr_sum(0)
   ,  _parity(0)
   ,  _is_checksum_term(false)
   ,  _sentence_type(_GPS_SENTENCE_OTHER)
   ,  _term_number(0)
   ,  _term_offset(0)
   ,  _gps_data_good(false)
+  ,  _valid_sentences(0)
 #ifndef _GPS_NO_STATS
   ,  _encoded_characters(0)
   ,  _good_sentences(0)
@@ -166,110 +177,222 @@ bool TinyGPS::term_complete()
   if (_is_checksum_term)
   {
     byte checksum = 16 * from_hex(_term[0]) + from_hex(_term[1]);
-    if (checksum == _parity)
+    if (checksum != _parity)
     {
-      if (_gps_data_good)
-      {
 #ifndef _GPS_NO_STATS
-        ++_good_sentences;
+      ++_failed_checksum;
 #endif
-        _last_time_fix = _new_time_fix;
-        _last_position_fix = _new_position_fix;
+      return false;
+    }
 
-        switch(_sentence_type)
-        {
-        case _GPS_SENTENCE_GPRMC:
-          _time      = _new_time;
-          _date      = _new_date;
-          _latitude  = _new_latitude;
-          _longitude = _new_longitude;
-          _speed     = _new_speed;
-          _course    = _new_course;
-          break;
-        case _GPS_SENTENCE_GPGGA:
-          _altitude  = _new_altitude;
-          _time      = _new_time;
-          _latitude  = _new_latitude;
-          _longitude = _new_longitude;
-          _numsats   = _new_numsats;
-          _hdop      = _new_hdop;
-          break;
-        }
+    ++_valid_sentences;
+    if (!_gps_data_good)
+      return false;
 
-        return true;
+#ifndef _GPS_NO_STATS
+    ++_good_sentences;
+#endif
+
+    switch(_sentence_type)
+    {
+    case _GPS_SENTENCE_RMC:
+      _last_time_fix = _new_time_fix;
+      _last_position_fix = _new_position_fix;
+      _time      = _new_time;
+      _date      = _new_date;
+      _latitude  = _new_latitude;
+      _longitude = _new_longitude;
+      _speed     = _new_speed;
+      _course    = _new_course;
+      break;
+    case _GPS_SENTENCE_GGA:
+      _last_time_fix = _new_time_fix;
+      _last_position_fix = _new_position_fix;
+      _altitude  = _new_altitude;
+      _time      = _new_time;
+      _latitude  = _new_latitude;
+      _longitude = _new_longitude;
+      _numsats   = _new_numsats;
+      _hdop      = _new_hdop;
+      _fix_quality = _new_fix_quality;
+      break;
+    case _GPS_SENTENCE_GSA:
+      _fix_type  = _new_fix_type;
+      _pdop      = _new_pdop;
+      _hdop      = _new_hdop;
+      _vdop      = _new_vdop;
+      break;
+    case _GPS_SENTENCE_GSV:
+      if (_gsv_message_number <= 1)
+      {
+        _gsv_tracked = 0;
+        _gsv_snr_sum = 0;
       }
+      _gsv_tracked += _new_gsv_tracked;
+      _gsv_snr_sum += _new_gsv_snr_sum;
+      if (_gsv_message_number >= _gsv_message_count)
+      {
+        _sats_in_view = _new_sats_in_view;
+        _sats_tracked = _gsv_tracked;
+        _average_snr  = _gsv_tracked ? _gsv_snr_sum / _gsv_tracked : GPS_INVALID_SNR;
+      }
+      break;
+    case _GPS_SENTENCE_VTG:
+      _speed     = _new_speed;
+      _course    = _new_course;
+      break;
+    case _GPS_SENTENCE_ZDA:
+      _last_time_fix = _new_time_fix;
+      _time      = _new_time;
+      _date      = _new_date;
+      break;
     }
 
-#ifndef _GPS_NO_STATS
-    else
-      ++_failed_checksum;
-#endif
-    return false;
+    return true;
   }
 
-  // the first term determines the sentence type
+  // the first term determines the sentence type, from the last three letters so that any
+  // two letter talker ID will do
   if (_term_number == 0)
   {
-    if (!gpsstrcmp(_term, _GPRMC_TERM))
-      _sentence_type = _GPS_SENTENCE_GPRMC;
-    else if (!gpsstrcmp(_term, _GPGGA_TERM))
-      _sentence_type = _GPS_SENTENCE_GPGGA;
-    else
-      _sentence_type = _GPS_SENTENCE_OTHER;
+    _sentence_type = _GPS_SENTENCE_OTHER;
+    if (_term_offset == 5)
+    {
+      for (byte i=0; i<_GPS_SENTENCE_OTHER; ++i)
+      {
+        const char *name = _gps_sentence_names + 3 * i;
+        if (_term[2] == (char)pgm_read_byte(name) && 
+            _term[3] == (char)pgm_read_byte(name + 1) && 
+            _term[4] == (char)pgm_read_byte(name + 2))
+        {
+          _sentence_type = i;
+          break;
+        }
+      }
+    }
+
+    switch(_sentence_type)
+    {
+    case _GPS_SENTENCE_GSA:
+      _gps_data_good = true;
+      _new_hdop = _new_pdop = _new_vdop = GPS_INVALID_DOP;
+      break;
+    case _GPS_SENTENCE_GSV:
+      _gps_data_good = true;
+      _new_gsv_tracked = 0;
+      _new_gsv_snr_sum = 0;
+      break;
+    case _GPS_SENTENCE_ZDA:
+      _new_date = GPS_INVALID_DATE;
+      break;
+    }
     return false;
   }
 
   if (_sentence_type != _GPS_SENTENCE_OTHER && _term[0])
     switch(COMBINE(_sentence_type, _term_number))
   {
-    case COMBINE(_GPS_SENTENCE_GPRMC, 1): // Time in both sentences
-    case COMBINE(_GPS_SENTENCE_GPGGA, 1):
+    case COMBINE(_GPS_SENTENCE_RMC, 1): // Time in both sentences
+    case COMBINE(_GPS_SENTENCE_GGA, 1):
+    case COMBINE(_GPS_SENTENCE_ZDA, 1):
       _new_time = parse_decimal();
       _new_time_fix = millis();
       break;
-    case COMBINE(_GPS_SENTENCE_GPRMC, 2): // GPRMC validity
+    case COMBINE(_GPS_SENTENCE_RMC, 2): // GPRMC validity
       _gps_data_good = _term[0] == 'A';
       break;
-    case COMBINE(_GPS_SENTENCE_GPRMC, 3): // Latitude
-    case COMBINE(_GPS_SENTENCE_GPGGA, 2):
+    case COMBINE(_GPS_SENTENCE_RMC, 3): // Latitude
+    case COMBINE(_GPS_SENTENCE_GGA, 2):
       _new_latitude = parse_degrees();
       _new_position_fix = millis();
       break;
-    case COMBINE(_GPS_SENTENCE_GPRMC, 4): // N/S
-    case COMBINE(_GPS_SENTENCE_GPGGA, 3):
+    case COMBINE(_GPS_SENTENCE_RMC, 4): // N/S
+    case COMBINE(_GPS_SENTENCE_GGA, 3):
       if (_term[0] == 'S')
         _new_latitude = -_new_latitude;
       break;
-    case COMBINE(_GPS_SENTENCE_GPRMC, 5): // Longitude
-    case COMBINE(_GPS_SENTENCE_GPGGA, 4):
+    case COMBINE(_GPS_SENTENCE_RMC, 5): // Longitude
+    case COMBINE(_GPS_SENTENCE_GGA, 4):
       _new_longitude = parse_degrees();
       break;
-    case COMBINE(_GPS_SENTENCE_GPRMC, 6): // E/W
-    case COMBINE(_GPS_SENTENCE_GPGGA, 5):
+    case COMBINE(_GPS_SENTENCE_RMC, 6): // E/W
+    case COMBINE(_GPS_SENTENCE_GGA, 5):
       if (_term[0] == 'W')
         _new_longitude = -_new_longitude;
       break;
-    case COMBINE(_GPS_SENTENCE_GPRMC, 7): // Speed (GPRMC)
+    case COMBINE(_GPS_SENTENCE_RMC, 7): // Speed (GPRMC)
       _new_speed = parse_decimal();
       break;
-    case COMBINE(_GPS_SENTENCE_GPRMC, 8): // Course (GPRMC)
+    case COMBINE(_GPS_SENTENCE_RMC, 8): // Course (GPRMC)
+    case COMBINE(_GPS_SENTENCE_VTG, 1): // True course (GPVTG)
       _new_course = parse_decimal();
       break;
-    case COMBINE(_GPS_SENTENCE_GPRMC, 9): // Date (GPRMC)
+    case COMBINE(_GPS_SENTENCE_RMC, 9): // Date (GPRMC)
       _new_date = gpsatol(_term);
       break;
-    case COMBINE(_GPS_SENTENCE_GPGGA, 6): // Fix data (GPGGA)
-      _gps_data_good = _term[0] > '0';
+    case COMBINE(_GPS_SENTENCE_GGA, 6): // Fix data (GPGGA)
+      _new_fix_quality = gpsatol(_term);
+      _gps_data_good = _new_fix_quality > 0;
       break;
-    case COMBINE(_GPS_SENTENCE_GPGGA, 7): // Satellites used (GPGGA)
+    case COMBINE(_GPS_SENTENCE_GGA, 7): // Satellites used (GPGGA)
       _new_numsats = (unsigned char)atoi(_term);
       break;
-    case COMBINE(_GPS_SENTENCE_GPGGA, 8): // HDOP
+    case COMBINE(_GPS_SENTENCE_GGA, 8): // HDOP
+    case COMBINE(_GPS_SENTENCE_GSA, 16):
       _new_hdop = parse_decimal();
       break;
-    case COMBINE(_GPS_SENTENCE_GPGGA, 9): // Altitude (GPGGA)
+    case COMBINE(_GPS_SENTENCE_GGA, 9): // Altitude (GPGGA)
       _new_altitude = parse_decimal();
       break;
+    case COMBINE(_GPS_SENTENCE_GSA, 2): // Fix type (GPGSA), then 12 satellite PRNs
+      _new_fix_type = gpsatol(_term);
+      break;
+    case COMBINE(_GPS_SENTENCE_GSA, 15): // PDOP
+      _new_pdop = parse_decimal();
+      break;
+    case COMBINE(_GPS_SENTENCE_GSA, 17): // VDOP
+      _new_vdop = parse_decimal();
+      break;
+    case COMBINE(_GPS_SENTENCE_GSV, 1): // Sentence count (GPGSV)
+      _gsv_message_count = gpsatol(_term);
+      break;
+    case COMBINE(_GPS_SENTENCE_GSV, 2): // Sentence number
+      _gsv_message_number = gpsatol(_term);
+      break;
+    case COMBINE(_GPS_SENTENCE_GSV, 3): // Satellites in view
+      _new_sats_in_view = gpsatol(_term);
+      break;
+    case COMBINE(_GPS_SENTENCE_GSV, 7): // SNR, after each satellite's PRN, elevation and azimuth
+    case COMBINE(_GPS_SENTENCE_GSV, 11):
+    case COMBINE(_GPS_SENTENCE_GSV, 15):
+    case COMBINE(_GPS_SENTENCE_GSV, 19):
+    {
+      const long snr = gpsatol(_term);
+      if (snr > 0)
+      {
+        ++_new_gsv_tracked;
+        _new_gsv_snr_sum += snr;
+      }
+      break;
+    }
+    case COMBINE(_GPS_SENTENCE_VTG, 5): // Speed in knots (GPVTG)
+      _new_speed = parse_decimal();
+      _gps_data_good = true;
+      break;
+    case COMBINE(_GPS_SENTENCE_VTG, 9): // Mode, NMEA 2.3 and up
+      if (_term[0] == 'N')
+        _gps_data_good = false;
+      break;
+    case COMBINE(_GPS_SENTENCE_ZDA, 2): // Day (GPZDA)
+      _new_date = gpsatol(_term) * 10000;
+      break;
+    case COMBINE(_GPS_SENTENCE_ZDA, 3): // Month
+      _new_date += gpsatol(_term) * 100;
+      break;
+    case COMBINE(_GPS_SENTENCE_ZDA, 4): // Year
+      _new_date += gpsatol(_term) % 100;
+      _gps_data_good = _new_date >= 10000;
+      break;
   }
 
   return false;
@@ -283,13 +406,6 @@ long TinyGPS::gpsatol(const char *str)
   return ret;
 }
 
-int TinyGPS::gpsstrcmp(const char *str1, const char *str2)
-{
-  while (*str1 && *str1 == *str2)
-    ++str1, ++str2;
-  return *str1;
-}
-
 /* static */
 float TinyGPS::distance_between (float lat1, float long1, float lat2, float long2) 
 {
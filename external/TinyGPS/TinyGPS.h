@@ -45,7 +45,8 @@ public:
     GPS_INVALID_ALTITUDE = 999999999,  GPS_INVALID_DATE = 0,
     GPS_INVALID_TIME = 0xFFFFFFFF,     GPS_INVALID_SPEED = 999999999, 
     GPS_INVALID_FIX_TIME = 0xFFFFFFFF, GPS_INVALID_SATELLITES = 0xFF,
-    GPS_INVALID_HDOP = 0xFFFFFFFF
+    GPS_INVALID_HDOP = 0xFFFFFFFF,     GPS_INVALID_DOP = 0xFFFFFFFF,
+    GPS_INVALID_FIX_TYPE = 0,          GPS_INVALID_SNR = 0
   };
 
   static const float GPS_INVALID_F_ANGLE, GPS_INVALID_F_ALTITUDE, GPS_INVALID_F_SPEED;
@@ -75,6 +76,24 @@ public:
   // horizontal dilution of precision in 100ths
   inline unsigned long hdop() { return _hdop; }
 
+  // position and vertical dilution of precision in 100ths (from GPGSA sentence)
+  inline unsigned long pdop() { return _pdop; }
+  inline unsigned long vdop() { return _vdop; }
+
+  // 0 = invalid, 1 = GPS, 2 = DGPS, ... (from GPGGA sentence)
+  inline byte fix_quality() { return _fix_quality; }
+
+  // 1 = no fix, 2 = 2D, 3 = 3D (from GPGSA sentence)
+  inline byte fix_type() { return _fix_type; }
+
+  // satellites in view, how many of those have a signal, and their mean SNR in dB-Hz (from the last full set of GPGSV sentences)
+  inline unsigned short satellites_in_view() { return _sats_in_view; }
+  inline unsigned short satellites_tracked() { return _sats_tracked; }
+  inline byte average_snr() { return _average_snr; }
+
+  // sentences that have passed their checksum, fix or no fix (wraps), for telling whether the receiver's talking
+  inline unsigned short valid_sentences() { return _valid_sentences; }
+
   bool f_get_position(float *latitude, float *longitude, unsigned long *fix_age = 0);
   bool crack_datetime(int *year, byte *month, byte *day, 
     byte *hour, byte *minute, byte *second, byte *hundredths = 0, unsigned long *fix_age = 0);
@@ -95,8 +114,10 @@ public:
   void stats(unsigned long *chars, unsigned short *good_sentences, unsigned short *failed_cs);
 #endif
 
-private:
-  enum {_GPS_SENTENCE_GPGGA, _GPS_SENTENCE_GPRMC, _GPS_SENTENCE_OTHER};
+protected:
+  // Sentences are recognised by the last three letters of the address, so any talker ID (GP, GN, GL, ...) works
+  enum {_GPS_SENTENCE_GGA, _GPS_SENTENCE_RMC, _GPS_SENTENCE_GSA, _GPS_SENTENCE_GSV,
+        _GPS_SENTENCE_VTG, _GPS_SENTENCE_ZDA, _GPS_SENTENCE_OTHER};
 
   // properties
   unsigned long _time, _new_time;
@@ -107,11 +128,23 @@ private:
   unsigned long  _speed, _new_speed;
   unsigned long  _course, _new_course;
   unsigned long  _hdop, _new_hdop;
+  unsigned long  _pdop, _new_pdop;
+  unsigned long  _vdop, _new_vdop;
   unsigned short _numsats, _new_numsats;
+  byte _fix_quality, _new_fix_quality;
+  byte _fix_type, _new_fix_type;
+  unsigned short _sats_in_view, _new_sats_in_view;
+  unsigned short _sats_tracked;
+  byte _average_snr;
 
   unsigned long _last_time_fix, _new_time_fix;
   unsigned long _last_position_fix, _new_position_fix;
 
+  // GPGSV comes in groups of sentences, which are summed up here and published after the last one
+  byte _gsv_message_count, _gsv_message_number;
+  byte _gsv_tracked, _new_gsv_tracked;
+  unsigned short _gsv_snr_sum, _new_gsv_snr_sum;
+
   // parsing state variables
   byte _parity;
   bool _is_checksum_term;
@@ -120,13 +153,13 @@ private:
   byte _term_number;
   byte _term_offset;
   bool _gps_data_good;
+  unsigned short _valid_sentences;
 
 #ifndef _GPS_NO_STATS
   // statistics
   unsigned long _encoded_characters;
   unsigned short _good_sentences;
   unsigned short _failed_checksum;
-  unsigned short _passed_checksum;
 #endif
 
   // internal utilities
@@ -136,7 +169,6 @@ private:
   bool term_complete();
   bool gpsisdigit(char c) { return c >= '0' && c <= '9'; }
   long gpsatol(const char *str);
-  int gpsstrcmp(const char *str1, const char *str2);
 };
 
 #if !defined(ARDUINO) 
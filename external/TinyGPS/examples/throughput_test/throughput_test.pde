@@ -0,0 +1,60 @@
+#include <TinyGPS.h>
+#include <avr/pgmspace.h>
+
+/* This sample code times TinyGPS's encode() over a typical one second 
+   burst of sentences from a receiver, and reports sentences per second 
+   and CPU cycles per byte.
+*/
+const char str1[] PROGMEM = "$GPGGA,201548.000,3014.5529,N,09749.5808,W,1,07,1.5,225.6,M,-22.5,M,18.8,0000*78";
+const char str2[] PROGMEM = "$GPGSA,A,3,04,05,,09,12,,,24,,,,,2.5,1.3,2.1*39";
+const char str3[] PROGMEM = "$GPGSV,2,1,08,01,40,083,46,02,17,308,41,12,07,344,39,14,22,228,45*75";
+const char str4[] PROGMEM = "$GPGSV,2,2,08,15,10,100,,16,05,200,30,17,30,050,35,18,45,270,40*79";
+const char str5[] PROGMEM = "$GPRMC,201548.000,A,3014.5529,N,09749.5808,W,0.17,53.25,040109,,*2B";
+const char str6[] PROGMEM = "$GPVTG,054.7,T,034.4,M,005.5,N,010.2,K*48";
+const char str7[] PROGMEM = "$GPZDA,201530.00,04,07,2002,00,00*60";
+const char str8[] PROGMEM = "$GNGGA,201560.000,3014.5533,N,09749.5812,W,2,12,0.9,300.0,M,-22.5,M,18.8,0000*66";
+const char *teststrs[] = {str1, str2, str3, str4, str5, str6, str7, str8};
+const int numstrs = sizeof(teststrs) / sizeof(teststrs[0]);
+const int passes = 50;
+
+char buffer[128];
+
+void setup()
+{
+  Serial.begin(115200);
+
+  Serial.print("Testing TinyGPS library v. "); Serial.println(TinyGPS::library_version());
+  Serial.println();
+
+  unsigned long bytes = 0, sentences = 0, elapsed = 0;
+  for (int pass=0; pass<passes; ++pass)
+  {
+    TinyGPS test_gps;
+    for (int i=0; i<numstrs; ++i)
+    {
+      // copy out of flash first so that only encode() gets timed
+      strcpy_P(buffer, teststrs[i]);
+      int len = strlen(buffer);
+      buffer[len++] = '\r';
+      buffer[len++] = '\n';
+
+      unsigned long start = micros();
+      for (int j=0; j<len; ++j)
+        test_gps.encode(buffer[j]);
+      elapsed += micros() - start;
+
+      bytes += len;
+      ++sentences;
+    }
+  }
+
+  Serial.print("Bytes: "); Serial.println(bytes);
+  Serial.print("Sentences: "); Serial.println(sentences);
+  Serial.print("Time (us): "); Serial.println(elapsed);
+  Serial.print("Sentences/s: "); Serial.println(sentences * 1000000.0 / elapsed, 0);
+  Serial.print("Cycles/byte: "); Serial.println((float)elapsed * (F_CPU / 1000000) / bytes, 1);
+}
+
+void loop()
+{
+}
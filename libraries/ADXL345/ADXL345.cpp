@@ -5,6 +5,7 @@ namespace
 {
 	const uint8_t I2C_ADDRESS          = 0x1D; // alternate = 0x53;
 
+	const uint8_t REGISTER_BW_RATE     = 0x2C;
 	const uint8_t REGISTER_POWER_CTL   = 0x2D;
 	const uint8_t REGISTER_DATA_FORMAT = 0x31;
 	const uint8_t REGISTER_DATAX0      = 0x32;
@@ -56,6 +57,14 @@ void ADXL345::SetDataFormat(bool fullResolution, uint8_t range)
 	Wire.endTransmission();
 }
 
+void ADXL345::SetOutputRate(EOutputRate::Enum outputRate)
+{
+	Wire.beginTransmission(I2C_ADDRESS);
+	Wire.write(REGISTER_BW_RATE);
+	Wire.write((uint8_t)Clamp((int)outputRate, (int)EOutputRate::Hz6_25, (int)EOutputRate::Hz3200));
+	Wire.endTransmission();
+}
+
 ADXL345::OutputRaw ADXL345::GetOutputRaw() const
 {
 	return m_OutputRaw;
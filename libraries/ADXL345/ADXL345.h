@@ -7,6 +7,8 @@
 class ADXL345
 {
 public:
+	struct EOutputRate { enum Enum { Hz6_25 = 0x06, Hz12_5, Hz25, Hz50, Hz100, Hz200, Hz400, Hz800, Hz1600, Hz3200 }; };
+
 	struct OutputRaw
 	{
 		int16_t x, y, z;
@@ -18,6 +20,7 @@ public:
 	void loop();
 	
 	void SetDataFormat(bool fullResolution, uint8_t range); // range: -/+2^(n+1)g
+	void SetOutputRate(EOutputRate::Enum outputRate);        // bandwidth is half the output rate
 
 	OutputRaw GetOutputRaw() const;
 	vec3 GetOutput() const;				// in m/s^2
@@ -0,0 +1,186 @@
+#include "AltitudeFilter.h"
+#include <MatrixMath.h>
+
+namespace
+{
+	const uint16_t c_MaxStep          = 250;    // ms, longer predictions are split up so that the fixed point math can't overflow
+	const int32_t c_MaxAccel          = 50000;  // mm/s^2
+	const int32_t c_MaxInnovation     = 50000;  // mm, readings further than this from the estimate only pull it this far
+	const float c_GainSettleTime      = 30.0f;  // s, how long to run the covariance recursion for in setup()
+
+	const float c_BaroH[3]            = {1.0f, 0.0f, 1.0f};
+	const float c_GPSH[3]             = {1.0f, 0.0f, 0.0f};
+
+	// Kalman update of P for a scalar measurement z = H x, writing out the gain in 16.16 fixed point
+	void ScalarUpdate(SymMatrix<3>& P, const float* H, float R, int32_t* gain)
+	{
+		float PH[3];
+		for (uint8_t r=0; r<3; ++r)
+			PH[r] = P(r, 0) * H[0] + P(r, 1) * H[1] + P(r, 2) * H[2];
+
+		const float invS = 1.0f / (R + H[0] * PH[0] + H[1] * PH[1] + H[2] * PH[2]);
+
+		for (uint8_t r=0; r<3; ++r)
+			for (uint8_t c=0; c<=r; ++c)
+				P(r, c) -= PH[r] * PH[c] * invS;
+
+		for (uint8_t r=0; r<3; ++r)
+			gain[r] = (int32_t)floor(PH[r] * invS * 65536.0f + 0.5f);
+	}
+}
+
+AltitudeFilter::AltitudeFilter() :
+	m_HasBaro(false),
+	m_HasGPS(false),
+	m_Altitude(0),
+	m_Velocity(0),
+	m_BaroOffset(0),
+	m_AltitudeRemainder(0),
+	m_VelocityRemainder(0)
+{
+	for (uint8_t i=0; i<3; ++i)
+	{
+		m_BaroGain[i] = 0;
+		m_GPSGain[i] = 0;
+	}
+}
+
+void AltitudeFilter::setup(const Config& config)
+{
+	const float dt = config.baroPeriod * 0.001f;
+	const float gpsPeriod = config.gpsPeriod * 0.001f;
+	const float qa = pow2(config.accelSigma);
+
+	Matrix<3,3> F = Matrix<3,3>::Identity();
+	F.m[0][1] = dt;
+
+	SymMatrix<3> Q = SymMatrix<3>::Zero();
+	Q(0, 0) = qa * pow2(dt * dt) * 0.25f;
+	Q(1, 0) = qa * dt * dt * dt * 0.5f;
+	Q(1, 1) = qa * dt * dt;
+	Q(2, 2) = pow2(config.baroDriftSigma) * dt;
+
+	SymMatrix<3> P = SymMatrix<3>::Zero();
+	P(0, 0) = 1.0e4f;
+	P(1, 1) = 1.0e2f;
+	P(2, 2) = 1.0e4f;
+
+	// run the filter's covariance over the nominal schedule until it settles, and keep the gains it ends up with
+	float sinceGPS = 0.0f;
+	for (float t=0.0f; t<c_GainSettleTime; t+=dt)
+	{
+		P = Sandwich(F, P) + Q;
+		ScalarUpdate(P, c_BaroH, pow2(config.baroSigma), m_BaroGain);
+
+		sinceGPS += dt;
+		if (sinceGPS >= gpsPeriod)
+		{
+			sinceGPS -= gpsPeriod;
+			ScalarUpdate(P, c_GPSH, pow2(config.gpsSigma), m_GPSGain);
+		}
+	}
+}
+
+void AltitudeFilter::predict(uint32_t dt, int32_t accelInMMPerS2)
+{
+	if (!IsValid())
+		return;
+
+	accelInMMPerS2 = Clamp(accelInMMPerS2, -c_MaxAccel, c_MaxAccel);
+
+	while (dt > c_MaxStep)
+	{
+		step(c_MaxStep, accelInMMPerS2);
+		dt -= c_MaxStep;
+	}
+	step(dt, accelInMMPerS2);
+}
+
+void AltitudeFilter::updateBaro(int32_t altInMM)
+{
+	if (!m_HasBaro)
+	{
+		m_HasBaro = true;
+		if (m_HasGPS)
+		{
+			m_BaroOffset = altInMM - m_Altitude;
+		}
+		else
+		{
+			m_Altitude = altInMM;
+			m_BaroOffset = 0;
+		}
+		return;
+	}
+
+	correct(m_BaroGain, altInMM - (m_Altitude + m_BaroOffset));
+}
+
+void AltitudeFilter::updateGPS(int32_t altInMM)
+{
+	if (!m_HasGPS)
+	{
+		m_HasGPS = true;
+
+		// move over to GPS altitude, keeping the baro prediction where it was
+		const int32_t delta = altInMM - m_Altitude;
+		m_Altitude = altInMM;
+		if (m_HasBaro)
+			m_BaroOffset -= delta;
+		return;
+	}
+
+	correct(m_GPSGain, altInMM - m_Altitude);
+}
+
+bool AltitudeFilter::IsValid() const
+{
+	return m_HasBaro || m_HasGPS;
+}
+
+int32_t AltitudeFilter::GetAltitudeInMM() const
+{
+	return m_Altitude;
+}
+
+float AltitudeFilter::GetAltitudeInM() const
+{
+	return m_Altitude * 0.001f;
+}
+
+int32_t AltitudeFilter::GetVerticalVelocityInMMPerS() const
+{
+	return m_Velocity;
+}
+
+float AltitudeFilter::GetVerticalVelocityInMPerS() const
+{
+	return m_Velocity * 0.001f;
+}
+
+int32_t AltitudeFilter::GetBaroOffsetInMM() const
+{
+	return m_BaroOffset;
+}
+
+void AltitudeFilter::step(uint16_t dt, int32_t accelInMMPerS2)
+{
+	// everything here is in um or um/s so that the remainders can be carried to the next step
+	const int32_t halfAccelDt = accelInMMPerS2 * (int32_t)dt / 2;
+	const int32_t dAlt = m_Velocity * (int32_t)dt + halfAccelDt * (int32_t)dt / 1000 + m_AltitudeRemainder;
+	const int32_t dVel = accelInMMPerS2 * (int32_t)dt + m_VelocityRemainder;
+
+	m_Altitude += dAlt / 1000;
+	m_AltitudeRemainder = dAlt % 1000;
+	m_Velocity += dVel / 1000;
+	m_VelocityRemainder = dVel % 1000;
+}
+
+void AltitudeFilter::correct(const int32_t* gain, int32_t innovation)
+{
+	innovation = Clamp(innovation, -c_MaxInnovation, c_MaxInnovation);
+
+	m_Altitude   += (int32_t)(((int64_t)gain[0] * innovation + 0x8000) >> 16);
+	m_Velocity   += (int32_t)(((int64_t)gain[1] * innovation + 0x8000) >> 16);
+	m_BaroOffset += (int32_t)(((int64_t)gain[2] * innovation + 0x8000) >> 16);
+}
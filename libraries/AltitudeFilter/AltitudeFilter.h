@@ -0,0 +1,60 @@
+#ifndef _ALTITUDE_FILTER_H
+#define _ALTITUDE_FILTER_H
+
+#include <Core.h>
+
+// Kalman filter for altitude and vertical velocity, fusing barometric altitude,
+// GPS altitude and vertical acceleration.
+//
+// State is [altitude, vertical velocity, baro offset], where the baro offset is the
+// (slowly wandering) difference between pressure altitude and GPS altitude. The
+// gains are computed once in setup() by running the covariance recursion in float
+// over the nominal sensor schedule; after that, predict() and the updates are
+// integer-only, so the filter can run at the loop rate.
+class AltitudeFilter
+{
+public:
+	struct Config
+	{
+		float baroSigma;       // m, noise on each baro altitude reading
+		float gpsSigma;        // m, noise on each GPS altitude reading
+		float accelSigma;      // m/s^2, noise on the vertical acceleration (including anything we don't measure)
+		float baroDriftSigma;  // m/sqrt(s), how quickly the baro offset can wander
+		uint16_t baroPeriod;   // ms, nominal time between baro readings
+		uint16_t gpsPeriod;    // ms, nominal time between GPS readings
+	};
+
+public:
+	AltitudeFilter();
+	void setup(const Config& config);
+
+	void predict(uint32_t dt, int32_t accelInMMPerS2);  // dt in ms, acceleration is up-positive with gravity removed
+	void updateBaro(int32_t altInMM);
+	void updateGPS(int32_t altInMM);
+
+	bool IsValid() const;
+	int32_t GetAltitudeInMM() const;
+	float GetAltitudeInM() const;
+	int32_t GetVerticalVelocityInMMPerS() const;
+	float GetVerticalVelocityInMPerS() const;
+	int32_t GetBaroOffsetInMM() const;
+
+private:
+	void step(uint16_t dt, int32_t accelInMMPerS2);
+	void correct(const int32_t* gain, int32_t innovation);
+
+	// gains in 16.16 fixed point, ordered [altitude, velocity, baro offset]
+	int32_t m_BaroGain[3];
+	int32_t m_GPSGain[3];
+
+	bool m_HasBaro;
+	bool m_HasGPS;
+
+	int32_t m_Altitude;            // mm
+	int32_t m_Velocity;            // mm/s
+	int32_t m_BaroOffset;          // mm
+	int16_t m_AltitudeRemainder;   // um, carried between steps so that slow velocities still integrate
+	int16_t m_VelocityRemainder;   // um/s
+};
+
+#endif
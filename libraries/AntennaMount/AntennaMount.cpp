@@ -0,0 +1,157 @@
+#include "AntennaMount.h"
+
+namespace
+{
+	const uint32_t c_LatPerCm         = 150837;     // 1e-5 degrees of latitude per cm in 8.24 fixed point, on the same sphere as Geodesy
+	const int32_t c_MinCosLat         = 1l << 24;   // 2.30 fixed point, don't fly things forward any closer to the poles than 89 degrees
+	const int32_t c_HalfTurn          = 18000;      // centidegrees
+	const int32_t c_FullTurn          = 36000;
+	const int32_t c_FlipMargin        = 1000;       // centidegrees past the end of the azimuth axis before we'll flip over, well inside the beam
+
+	int32_t WrapAngle(int32_t angle)
+	{
+		while (angle >= c_HalfTurn)
+			angle -= c_FullTurn;
+		while (angle < -c_HalfTurn)
+			angle += c_FullTurn;
+		return angle;
+	}
+
+	bool InRange(int32_t angle, const AntennaMount::AxisConfig& axis, int32_t margin)
+	{
+		return angle >= axis.minAngle - margin && angle <= axis.maxAngle + margin;
+	}
+}
+
+AntennaMount::AntennaMount(const Config& config) :
+	m_Config(config),
+	m_HasOrigin(false),
+	m_OriginLat(0),
+	m_OriginLon(0),
+	m_OriginAlt(0),
+	m_HasTarget(false),
+	m_TargetTime(0),
+	m_TargetLat(0),
+	m_TargetLon(0),
+	m_TargetAlt(0),
+	m_TargetVelNorth(0),
+	m_TargetVelEast(0),
+	m_TargetVelUp(0),
+	m_LonPerCm(c_LatPerCm),
+	m_LastControlTime(0),
+	m_Flipped(false)
+{
+	m_Look.groundRange = 0;
+	m_Look.slantRange = 0;
+	m_Look.azimuth = 0;
+	m_Look.elevation = 0;
+
+	for (uint8_t i=0; i<EAxis::EnumCount; ++i)
+		m_Angles[i] = Clamp<int32_t>(0, m_Config.axes[i].minAngle, m_Config.axes[i].maxAngle);
+}
+
+void AntennaMount::SetOrigin(int32_t lat, int32_t lon, int32_t alt)
+{
+	m_HasOrigin = true;
+	m_OriginLat = lat;
+	m_OriginLon = lon;
+	m_OriginAlt = alt;
+}
+
+void AntennaMount::SetTarget(uint32_t time, int32_t lat, int32_t lon, int32_t alt, uint16_t speed, int16_t course, int16_t ascentRate)
+{
+	m_HasTarget = true;
+	m_TargetTime = time;
+	m_TargetLat = lat;
+	m_TargetLon = lon;
+	m_TargetAlt = alt * 100;
+
+	const uint32_t courseAngle = Geodesy::DegE5ToAngle(course * 100000l);
+	m_TargetVelNorth = (int32_t)(((int64_t)speed * 100 * Geodesy::Cos(courseAngle)) >> 30);
+	m_TargetVelEast = (int32_t)(((int64_t)speed * 100 * Geodesy::Sin(courseAngle)) >> 30);
+	m_TargetVelUp = ascentRate;
+
+	const int32_t cosLat = max(Geodesy::Cos(Geodesy::DegE5ToAngle(lat)), c_MinCosLat);
+	m_LonPerCm = (uint32_t)(((uint64_t)c_LatPerCm << 30) / (uint32_t)cosLat);
+}
+
+bool AntennaMount::loop(uint32_t now)
+{
+	const uint32_t dt = now - m_LastControlTime;
+	if (dt < m_Config.controlPeriod)
+		return false;
+	m_LastControlTime = now;
+
+	if (!m_HasOrigin || !m_HasTarget)
+		return false;
+
+	int32_t lat, lon, alt;
+	predict(now, &lat, &lon, &alt);
+	Geodesy::GetLookAngle(m_OriginLat, m_OriginLon, m_OriginAlt, lat, lon, alt, &m_Look);
+
+	int32_t targets[EAxis::EnumCount];
+	toMountFrame(m_Look, targets);
+
+	// don't let a long gap between calls turn into one big jump
+	const uint32_t step = min(dt, (uint32_t)(4 * m_Config.controlPeriod));
+	for (uint8_t i=0; i<EAxis::EnumCount; ++i)
+	{
+		const int32_t maxStep = (int32_t)(m_Config.axes[i].maxSpeed * step / 1000);
+		m_Angles[i] += Clamp(targets[i] - m_Angles[i], -maxStep, maxStep);
+	}
+
+	return true;
+}
+
+bool AntennaMount::HasTarget() const
+{
+	return m_HasOrigin && m_HasTarget;
+}
+
+const Geodesy::LookAngle& AntennaMount::GetLookAngle() const
+{
+	return m_Look;
+}
+
+int16_t AntennaMount::GetAngle(EAxis::Enum axis) const
+{
+	return (int16_t)m_Angles[axis];
+}
+
+uint16_t AntennaMount::GetPulseInUS(EAxis::Enum axis) const
+{
+	const AxisConfig& config = m_Config.axes[axis];
+	return (uint16_t)(config.minPulse + (m_Angles[axis] - config.minAngle) * (int32_t)(config.maxPulse - config.minPulse) / (config.maxAngle - config.minAngle));
+}
+
+void AntennaMount::predict(uint32_t now, int32_t* pLat, int32_t* pLon, int32_t* pAlt) const
+{
+	// fly it forward in a straight line at the last reported velocity
+	const int32_t dt = (int32_t)min(now - m_TargetTime, (uint32_t)m_Config.maxPrediction);
+	const int32_t north = m_TargetVelNorth * dt / 1000;
+	const int32_t east = m_TargetVelEast * dt / 1000;
+	const int32_t up = m_TargetVelUp * dt / 1000;
+
+	*pLat = m_TargetLat + (int32_t)(((int64_t)north * c_LatPerCm) >> 24);
+	*pLon = m_TargetLon + (int32_t)(((int64_t)east * m_LonPerCm) >> 24);
+	*pAlt = (m_TargetAlt + up) / 100;
+}
+
+void AntennaMount::toMountFrame(const Geodesy::LookAngle& look, int32_t* pAngles)
+{
+	const AxisConfig& azimuth = m_Config.axes[EAxis::Azimuth];
+	const AxisConfig& elevation = m_Config.axes[EAxis::Elevation];
+
+	const int32_t normal = WrapAngle((int32_t)look.azimuth - m_Config.heading);
+	const int32_t flipped = WrapAngle(normal + c_HalfTurn);
+
+	// flipping means swinging through the zenith, so stay the way we are until the target is well out
+	// of reach, even if that means pointing a little off for a while
+	if (!m_Config.canFlip)
+		m_Flipped = false;
+	else if (!InRange(m_Flipped ? flipped : normal, azimuth, c_FlipMargin) && InRange(m_Flipped ? normal : flipped, azimuth, 0))
+		m_Flipped = !m_Flipped;
+
+	pAngles[EAxis::Azimuth] = Clamp<int32_t>(m_Flipped ? flipped : normal, azimuth.minAngle, azimuth.maxAngle);
+	pAngles[EAxis::Elevation] = Clamp<int32_t>(m_Flipped ? c_HalfTurn - look.elevation : look.elevation, elevation.minAngle, elevation.maxAngle);
+}
@@ -0,0 +1,87 @@
+#ifndef _ANTENNA_MOUNT_H
+#define _ANTENNA_MOUNT_H
+
+#include <Core.h>
+#include <Geodesy.h>
+
+// Keeps a directional antenna on a pan/tilt mount pointed at the balloon.
+//
+// Telemetry only arrives once a second, so in between the balloon is flown forward
+// from its last fix using its ground speed, course and ascent rate. Every control
+// period the predicted position is turned into a look angle, into the mount's own
+// frame, and then each axis is slewed towards it no faster than its servo can follow.
+// This is all integer math and doesn't touch any hardware, so it can be run on a PC
+// against a simulated mount; MountServos drives the real one.
+class AntennaMount
+{
+public:
+	struct EAxis
+	{
+		enum Enum
+		{
+			Azimuth,
+			Elevation,
+			EnumCount
+		};
+	};
+
+	struct AxisConfig
+	{
+		int16_t minAngle;       // centidegrees, at minPulse
+		int16_t maxAngle;       // centidegrees, at maxPulse
+		uint16_t minPulse;      // us
+		uint16_t maxPulse;      // us
+		uint16_t maxSpeed;      // centidegrees/s
+	};
+
+	struct Config
+	{
+		AxisConfig axes[EAxis::EnumCount];
+		uint16_t heading;       // centidegrees, the true azimuth that the mount's azimuth 0 points at
+		bool canFlip;           // the elevation axis can go past 90 degrees, so the azimuth axis only has to cover half a turn
+		uint16_t controlPeriod; // ms
+		uint16_t maxPrediction; // ms, how far past the last fix we'll fly the balloon forward
+	};
+
+public:
+	AntennaMount(const Config& config);
+
+	void SetOrigin(int32_t lat, int32_t lon, int32_t alt);    // where the mount is, 1e-5 degrees and m
+	void SetTarget(uint32_t time, int32_t lat, int32_t lon, int32_t alt, uint16_t speed, int16_t course, int16_t ascentRate);   // time in ms, speed in m/s, course in degrees, ascent rate in cm/s
+
+	bool loop(uint32_t now);                                  // returns true when the axes were updated
+
+	bool HasTarget() const;
+	const Geodesy::LookAngle& GetLookAngle() const;           // to the predicted position, in true azimuth
+	int16_t GetAngle(EAxis::Enum axis) const;                 // centidegrees, where the axis has been commanded to
+	uint16_t GetPulseInUS(EAxis::Enum axis) const;
+
+private:
+	void predict(uint32_t now, int32_t* pLat, int32_t* pLon, int32_t* pAlt) const;
+	void toMountFrame(const Geodesy::LookAngle& look, int32_t* pAngles);
+
+private:
+	Config m_Config;
+
+	bool m_HasOrigin;
+	int32_t m_OriginLat;
+	int32_t m_OriginLon;
+	int32_t m_OriginAlt;
+
+	bool m_HasTarget;
+	uint32_t m_TargetTime;
+	int32_t m_TargetLat;
+	int32_t m_TargetLon;
+	int32_t m_TargetAlt;           // cm
+	int32_t m_TargetVelNorth;      // cm/s
+	int32_t m_TargetVelEast;       // cm/s
+	int32_t m_TargetVelUp;         // cm/s
+	uint32_t m_LonPerCm;           // 1e-5 degrees of longitude per cm at the target's latitude, 8.24 fixed point
+
+	uint32_t m_LastControlTime;
+	Geodesy::LookAngle m_Look;
+	bool m_Flipped;                       // pointing over the top, with the azimuth axis turned half a turn
+	int32_t m_Angles[EAxis::EnumCount];   // centidegrees
+};
+
+#endif
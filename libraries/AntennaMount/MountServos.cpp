@@ -0,0 +1,32 @@
+#include "MountServos.h"
+#include <avr/io.h>
+
+namespace
+{
+	const uint16_t c_TicksPerUS = F_CPU / 8000000ul;   // Timer4 runs at clk/8
+	const uint16_t c_FramePeriod = 20000;              // us
+}
+
+void MountServos::setup()
+{
+	pinMode(6, OUTPUT);
+	pinMode(7, OUTPUT);
+
+	// fast PWM with ICR4 as TOP, clearing OC4A and OC4B on compare match
+	noInterrupts();
+	TCCR4A = _BV(COM4A1) | _BV(COM4B1) | _BV(WGM41);
+	TCCR4B = _BV(WGM43) | _BV(WGM42) | _BV(CS41);
+	ICR4 = c_FramePeriod * c_TicksPerUS - 1;
+	OCR4A = 0;
+	OCR4B = 0;
+	interrupts();
+}
+
+void MountServos::Write(uint16_t azimuthPulse, uint16_t elevationPulse)
+{
+	// 16 bit registers have to be written with interrupts off so the temp register isn't trashed
+	noInterrupts();
+	OCR4A = azimuthPulse * c_TicksPerUS;
+	OCR4B = elevationPulse * c_TicksPerUS;
+	interrupts();
+}
@@ -0,0 +1,17 @@
+#ifndef _MOUNT_SERVOS_H
+#define _MOUNT_SERVOS_H
+
+#include <Core.h>
+
+// Drives the pan/tilt servos from Timer4's hardware PWM on the Mega, so the pulses stay
+// exact no matter what the rest of the loop is doing. Azimuth is OC4A (digital pin 6)
+// and elevation is OC4B (digital pin 7). The Servo library can't be used here since it
+// takes over Timer5, which Timebase needs for the PPS.
+class MountServos
+{
+public:
+	void setup();
+	void Write(uint16_t azimuthPulse, uint16_t elevationPulse);   // in us
+};
+
+#endif
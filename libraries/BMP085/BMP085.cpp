@@ -1,6 +1,8 @@
 #include "BMP085.h"
 #include <Wire.h>
 
+const uint8_t BMP085::c_MaxAveraging;
+
 namespace
 {
 	const uint8_t I2C_ADDRESS                = 0x77;
@@ -12,6 +14,30 @@ namespace
 	// possible values for the control register
 	const uint8_t CONTROL_MEASURE_TEMP       = 0x2E;
 	const uint8_t CONTROL_MEASURE_PRESSURE   = 0x34;
+
+	// US Standard Atmosphere 1976: pressure (in 1/64 Pa) at c_AltitudeTableStep intervals of geopotential
+	// altitude, starting at c_AltitudeTableStart, for a reference pressure of 101325 Pa. This covers the
+	// troposphere (-6.5 K/km), the isothermal tropopause at 11 km, and the +1 K/km and +2.8 K/km layers
+	// of the stratosphere from 20 and 32 km, up to the stratopause at 47 km.
+	const int32_t c_AltitudeTableStart       = -500000; // mm
+	const int32_t c_AltitudeTableStep        = 500000;  // mm
+	const int32_t c_StandardPressure         = 101325;  // Pa
+
+	PROGMEM prog_uint32_t c_AltitudeTable[] = {
+		6878561, 6484800, 6109494, 5751972, 5411584, 5087693, 4779682, 4486946,
+		4208901, 3944975, 3694612, 3457274, 3232435, 3019585, 2818230, 2627887,
+		2448091, 2278387, 2118338, 1967517, 1825511, 1691921, 1566359, 1448452,
+		1338636, 1237146, 1143350, 1056666, 976553, 902515, 834090, 770852,
+		712409, 658397, 608480, 562347, 519712, 480310, 443895, 410240,
+		379137, 350393, 323857, 299385, 276812, 255987, 236770, 219036,
+		202665, 187551, 173595, 160705, 148799, 137798, 127633, 118237,
+		109552, 101523, 94097, 87230, 80877, 74999, 69561, 64527,
+		59867, 55553, 51566, 47887, 44490, 41352, 38452, 35771,
+		33291, 30996, 28872, 26903, 25080, 23389, 21821, 20366,
+		19016, 17761, 16596, 15513, 14506, 13570, 12698, 11887,
+		11132, 10428, 9772, 9161, 8590, 8058, 7562, 7098,
+	};
+	const uint8_t c_AltitudeTableCount       = sizeof(c_AltitudeTable) / sizeof(c_AltitudeTable[0]);
 }
 
 BMP085::BMP085() :
@@ -19,8 +45,15 @@ BMP085::BMP085() :
 	m_StateStart(0),
 	m_OSS(0),
 	m_ReferencePressureInPa(101325),
+	m_ReferencePressureScale((uint32_t)1 << 15),
+	m_Averaging(1),
+	m_SampleCount(0),
+	m_PressureSum(0),
+	m_WindowStart(0),
 	m_TempInDeciC(0),
-	m_PressureInPa(0)
+	m_PressureInPa(0),
+	m_FinePressure(0),
+	m_ReadingTime(0)
 {
 }
 
@@ -47,23 +80,33 @@ void BMP085::setup()
 
 void BMP085::loop()
 {
+	m_SampleCount = 0;
+	m_PressureSum = 0;
+
 	RequestTemp();
 	delay(5);
 	m_UT = GetRawTemp();
 	
-	RequestPressure();
-	delay(2 + (3 << m_OSS));
-	m_UP = GetRawPressure();
+	while (true)
+	{
+		RequestPressure();
+		const uint32_t conversionStart = millis();
+		delay(GetPressureConversionTime());
+		m_UP = GetRawPressure();
 
-	ProcessRawReadings();
+		if (AddSample(conversionStart))
+			break;
+	}
 	
 	// fix up the state stuff so that things don't go horribly wrong if we go back into async mode
 	m_State = EState::Start;
 	m_StateStart = millis();
 }
 
-void BMP085::loopAsync()
+bool BMP085::loopAsync()
 {
+	bool newReading = false;
+
 	switch(m_State)
 	{
 	case EState::WaitForTemp:
@@ -78,19 +121,29 @@ void BMP085::loopAsync()
 		break;
 		
 	case EState::WaitForPressure:
-		if (millis() - m_StateStart < (2 + ((uint32_t)3 << m_OSS)))
+		if (millis() - m_StateStart < GetPressureConversionTime())
 			break;
 		
 		m_UP = GetRawPressure();
-		ProcessRawReadings();
+		newReading = AddSample(m_StateStart);
 		
 	case EState::Start:
-		RequestTemp();
-		
-		m_State = EState::WaitForTemp;
+		// the temperature only gets read at the start of each averaging window
+		if (m_SampleCount == 0)
+		{
+			RequestTemp();
+			m_State = EState::WaitForTemp;
+		}
+		else
+		{
+			RequestPressure();
+			m_State = EState::WaitForPressure;
+		}
 		m_StateStart = millis();
 		break;
 	}
+
+	return newReading;
 }
 
 void BMP085::SetOversamplingSetting(uint8_t oss)
@@ -98,9 +151,17 @@ void BMP085::SetOversamplingSetting(uint8_t oss)
 	m_OSS = Clamp<uint8_t>(oss, 0, 3);
 }
 
+void BMP085::SetAveraging(uint8_t samples)
+{
+	m_Averaging = Clamp<uint8_t>(samples, 1, c_MaxAveraging);
+	m_SampleCount = 0;
+	m_PressureSum = 0;
+}
+
 void BMP085::SetReferencePressure(int32_t referencePressureInPa)
 {
 	m_ReferencePressureInPa = referencePressureInPa;
+	m_ReferencePressureScale = (((uint32_t)c_StandardPressure << 15) + referencePressureInPa / 2) / referencePressureInPa;
 }
 
 int32_t BMP085::GetReferencePressureInPa() const
@@ -120,12 +181,96 @@ float BMP085::GetTempInC() const
 
 int32_t BMP085::GetPressureInPa() const
 {
-	return m_PressureInPa;
+	return (m_FinePressure + 32) >> 6;
+}
+
+int32_t BMP085::GetFinePressure() const
+{
+	return m_FinePressure;
+}
+
+uint32_t BMP085::GetReadingTime() const
+{
+	return m_ReadingTime;
 }
 
 float BMP085::GetAltitudeInM() const
 {
-	return 44330.0f * (1.0f - pow(m_PressureInPa / (float)m_ReferencePressureInPa, 1 / 5.255f));
+	return GetAltitudeInMM() * 0.001f;
+}
+
+int32_t BMP085::GetAltitudeInMM() const
+{
+	// scale the reading to what it would be against the standard reference pressure (still in 1/64 Pa),
+	// splitting off the fractional Pa so that the multiply can't overflow
+	const uint32_t p = (uint32_t)max(m_FinePressure, (int32_t)0);
+	return PressureToAltitudeInMM((((p >> 6) * m_ReferencePressureScale) >> 9) + (((p & 63) * m_ReferencePressureScale) >> 15));
+}
+
+int32_t BMP085::PressureToAltitudeInMM(uint32_t p)
+{
+	if (p >= pgm_read_dword(&c_AltitudeTable[0]))
+		return c_AltitudeTableStart;
+	if (p <= pgm_read_dword(&c_AltitudeTable[c_AltitudeTableCount - 1]))
+		return c_AltitudeTableStart + (int32_t)(c_AltitudeTableCount - 1) * c_AltitudeTableStep;
+
+	// binary search for the segment with table[lo] > p >= table[lo + 1]
+	uint8_t lo = 0;
+	uint8_t hi = c_AltitudeTableCount - 1;
+	while (hi - lo > 1)
+	{
+		const uint8_t mid = (lo + hi) / 2;
+		if (pgm_read_dword(&c_AltitudeTable[mid]) > p)
+			lo = mid;
+		else
+			hi = mid;
+	}
+
+	const uint32_t p0 = pgm_read_dword(&c_AltitudeTable[lo]);
+	const uint32_t p1 = pgm_read_dword(&c_AltitudeTable[hi]);
+
+	uint32_t num = p0 - p;
+	uint32_t den = p0 - p1;
+	while (den >= ((uint32_t)1 << 16))
+	{
+		num >>= 1;
+		den >>= 1;
+	}
+
+	// Within a segment pressure falls off (nearly) exponentially, so a straight line between the
+	// table entries overshoots by about r * t * (1 - t) / 2 of a step, where r is the fractional
+	// pressure drop over the segment. Taking that back out brings the error down to 0.76 m.
+	const uint32_t t = (num << 16) / den;                           // 0.16 fixed point
+	const uint32_t r = ((p0 - p1) << 12) / (p0 >> 4);               // 0.16 fixed point
+	const uint32_t curvature = (r * ((t * (((uint32_t)1 << 16) - t)) >> 16)) >> 17;
+	const uint32_t frac = t - curvature;
+	const uint32_t offset = (frac * (c_AltitudeTableStep >> 5)) >> 11;   // == frac * step >> 16, without overflowing
+
+	return c_AltitudeTableStart + (int32_t)lo * c_AltitudeTableStep + (int32_t)offset;
+}
+
+uint32_t BMP085::GetPressureConversionTime() const
+{
+	return 2 + ((uint32_t)3 << m_OSS);
+}
+
+bool BMP085::AddSample(uint32_t conversionStart)
+{
+	ProcessRawReadings();
+
+	if (m_SampleCount == 0)
+		m_WindowStart = conversionStart;
+	m_PressureSum += m_PressureInPa;
+	if (++m_SampleCount < m_Averaging)
+		return false;
+
+	// decimate: the reading is the mean over the window, stamped with the middle of the window
+	m_FinePressure = ((m_PressureSum << 6) + m_Averaging / 2) / m_Averaging;
+	m_ReadingTime = m_WindowStart + (conversionStart - m_WindowStart + GetPressureConversionTime()) / 2;
+
+	m_SampleCount = 0;
+	m_PressureSum = 0;
+	return true;
 }
 
 void BMP085::RequestTemp()
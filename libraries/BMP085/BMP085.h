@@ -9,16 +9,29 @@ public:
 	BMP085();
 	void setup();
 	void loop();
-	void loopAsync();
+	bool loopAsync(); // returns true when a new reading is available
 
+	// Each reading is the average of this many pressure conversions (with a single temperature
+	// conversion at the start), so readings come out every ~(5 + samples * (2 + 3 << oss)) ms.
+	static const uint8_t c_MaxAveraging = 128;
 	void SetOversamplingSetting(uint8_t oss);
+	void SetAveraging(uint8_t samples);
 	void SetReferencePressure(int32_t referencePressureInPa);
 	int32_t GetReferencePressureInPa() const;
 
 	int32_t GetTempInDeciC() const;  // in deci-degrees-C
 	float GetTempInC() const;        // in degrees C
 	int32_t GetPressureInPa() const; // Pa
+	int32_t GetFinePressure() const; // 1/64 Pa
+	uint32_t GetReadingTime() const; // millis() at the middle of the conversions that made up the current reading
 	float GetAltitudeInM() const;    // meters
+	int32_t GetAltitudeInMM() const; // millimeters
+
+	// US Standard Atmosphere 1976 pressure altitude (from -0.5 to 47 km), for a pressure in 1/64 Pa
+	// against the standard 101325 Pa reference. Table-driven, no floating point. Within 0.8 m of the
+	// standard's own formulas, or 1.2 m if they're worked with today's gas constant rather than the
+	// 1976 one (tools/AltitudeCheck).
+	static int32_t PressureToAltitudeInMM(uint32_t pressure);
 
 private:
 	void RequestTemp();
@@ -26,6 +39,8 @@ private:
 	void RequestPressure();
 	int32_t GetRawPressure();
 	void ProcessRawReadings();
+	uint32_t GetPressureConversionTime() const;
+	bool AddSample(uint32_t conversionStart);
 
 	// Calibration coefficients -- read from EEPROM
 	int16_t m_AC1, m_AC2, m_AC3;
@@ -44,10 +59,19 @@ private:
 	// Configuration
 	uint8_t m_OSS;
 	int32_t m_ReferencePressureInPa;
+	uint32_t m_ReferencePressureScale; // 101325 / m_ReferencePressureInPa, in 1.15 fixed point
+	uint8_t m_Averaging;
+
+	// Averaging window
+	uint8_t m_SampleCount;
+	int32_t m_PressureSum;
+	uint32_t m_WindowStart;
 
 	// Data
 	int32_t m_TempInDeciC;
-	int32_t m_PressureInPa;
+	int32_t m_PressureInPa;   // from the latest conversion
+	int32_t m_FinePressure;   // averaged, in 1/64 Pa
+	uint32_t m_ReadingTime;
 };
 
-#endif
+#endif
@@ -0,0 +1,323 @@
+#include "BufferedSerial.h"
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+#if defined(UDR3)
+	#define BUFFERED_SERIAL_PORTS 4
+#elif defined(UDR1)
+	#define BUFFERED_SERIAL_PORTS 2
+#else
+	#define BUFFERED_SERIAL_PORTS 1
+#endif
+
+BufferedSerial* BufferedSerial::s_pPorts[BUFFERED_SERIAL_PORTS] = {NULL};
+
+#if defined(USART_RX_vect)
+ISR(USART_RX_vect)
+{
+	BufferedSerial::handleRx(0);
+}
+
+ISR(USART_UDRE_vect)
+{
+	BufferedSerial::handleTx(0);
+}
+#else
+ISR(USART0_RX_vect)
+{
+	BufferedSerial::handleRx(0);
+}
+
+ISR(USART0_UDRE_vect)
+{
+	BufferedSerial::handleTx(0);
+}
+#endif
+
+#if defined(UDR1)
+ISR(USART1_RX_vect)
+{
+	BufferedSerial::handleRx(1);
+}
+
+ISR(USART1_UDRE_vect)
+{
+	BufferedSerial::handleTx(1);
+}
+#endif
+
+#if defined(UDR2)
+ISR(USART2_RX_vect)
+{
+	BufferedSerial::handleRx(2);
+}
+
+ISR(USART2_UDRE_vect)
+{
+	BufferedSerial::handleTx(2);
+}
+#endif
+
+#if defined(UDR3)
+ISR(USART3_RX_vect)
+{
+	BufferedSerial::handleRx(3);
+}
+
+ISR(USART3_UDRE_vect)
+{
+	BufferedSerial::handleTx(3);
+}
+#endif
+
+BufferedSerial::BufferedSerial(uint8_t usart, uint8_t* pRxBuffer, uint8_t rxMask, uint8_t* pTxBuffer, uint8_t txMask) :
+	m_USART(usart),
+	m_pRxBuffer(pRxBuffer),
+	m_RxMask(rxMask),
+	m_RxHead(0),
+	m_RxTail(0),
+	m_RxPeak(0),
+	m_OverflowCount(0),
+	m_OverrunCount(0),
+	m_FramingErrorCount(0),
+	m_RxTimeEnabled(false),
+	m_LastRxTime(0),
+	m_pTxBuffer(pTxBuffer),
+	m_TxMask(txMask),
+	m_TxHead(0),
+	m_TxTail(0),
+	m_Transmitted(false)
+{
+	// the bits are where they are for USART0 on all of them
+	switch (usart)
+	{
+#if defined(UDR1)
+	case 1:
+		m_pUBRR = &UBRR1;
+		m_pUCSRA = &UCSR1A;
+		m_pUCSRB = &UCSR1B;
+		m_pUCSRC = &UCSR1C;
+		m_pUDR = &UDR1;
+		break;
+#endif
+#if defined(UDR2)
+	case 2:
+		m_pUBRR = &UBRR2;
+		m_pUCSRA = &UCSR2A;
+		m_pUCSRB = &UCSR2B;
+		m_pUCSRC = &UCSR2C;
+		m_pUDR = &UDR2;
+		break;
+#endif
+#if defined(UDR3)
+	case 3:
+		m_pUBRR = &UBRR3;
+		m_pUCSRA = &UCSR3A;
+		m_pUCSRB = &UCSR3B;
+		m_pUCSRC = &UCSR3C;
+		m_pUDR = &UDR3;
+		break;
+#endif
+	default:
+		m_USART = 0;
+		m_pUBRR = &UBRR0;
+		m_pUCSRA = &UCSR0A;
+		m_pUCSRB = &UCSR0B;
+		m_pUCSRC = &UCSR0C;
+		m_pUDR = &UDR0;
+		break;
+	}
+}
+
+void BufferedSerial::begin(uint32_t baud)
+{
+	end();
+
+	m_RxHead = m_RxTail = 0;
+	m_TxHead = m_TxTail = 0;
+	m_Transmitted = false;
+	s_pPorts[m_USART] = this;
+
+	// double speed, as HardwareSerial does, it's closer at 115200
+	*m_pUCSRA = _BV(U2X0);
+	*m_pUBRR = (uint16_t)((F_CPU / 4 / baud - 1) / 2);
+	*m_pUCSRC = _BV(UCSZ01) | _BV(UCSZ00);
+	*m_pUCSRB = _BV(RXEN0) | _BV(TXEN0) | _BV(RXCIE0);
+}
+
+void BufferedSerial::end()
+{
+	if (s_pPorts[m_USART] != this)
+		return;
+
+	flush();
+	*m_pUCSRB = 0;
+	s_pPorts[m_USART] = NULL;
+}
+
+int BufferedSerial::available()
+{
+	return (uint8_t)(m_RxHead - m_RxTail) & m_RxMask;
+}
+
+int BufferedSerial::read()
+{
+	const uint8_t tail = m_RxTail;
+	if (tail == m_RxHead)
+		return -1;
+
+	const uint8_t byte = m_pRxBuffer[tail];
+	m_RxTail = (tail + 1) & m_RxMask;
+	return byte;
+}
+
+int BufferedSerial::peek()
+{
+	const uint8_t tail = m_RxTail;
+	if (tail == m_RxHead)
+		return -1;
+	return m_pRxBuffer[tail];
+}
+
+void BufferedSerial::flush()
+{
+	if (!m_Transmitted)
+		return;
+
+	// the buffer emptying, then the last byte leaving the shift register
+	while (m_TxTail != m_TxHead || !(*m_pUCSRA & _BV(TXC0)))
+	{
+		if (!(SREG & _BV(SREG_I)) && (*m_pUCSRA & _BV(UDRE0)))
+			transmit();
+	}
+}
+
+size_t BufferedSerial::write(uint8_t byte)
+{
+	const uint8_t head = m_TxHead;
+	const uint8_t next = (head + 1) & m_TxMask;
+
+	// only waits when the buffer's full, and if that's with interrupts off, drives the USART itself
+	while (next == m_TxTail)
+	{
+		if (!(SREG & _BV(SREG_I)) && (*m_pUCSRA & _BV(UDRE0)))
+			transmit();
+	}
+
+	m_pTxBuffer[head] = byte;
+	m_TxHead = next;
+	m_Transmitted = true;
+
+	// the interrupt only ever clears this when it's found the buffer empty, which it can't be now
+	*m_pUCSRB |= _BV(UDRIE0);
+	return 1;
+}
+
+uint8_t BufferedSerial::GetRxCapacity() const
+{
+	return m_RxMask;
+}
+
+uint8_t BufferedSerial::GetRxPeak() const
+{
+	return m_RxPeak;
+}
+
+uint16_t BufferedSerial::GetOverflowCount() const
+{
+	noInterrupts();
+	const uint16_t count = m_OverflowCount;
+	interrupts();
+	return count;
+}
+
+uint16_t BufferedSerial::GetOverrunCount() const
+{
+	noInterrupts();
+	const uint16_t count = m_OverrunCount;
+	interrupts();
+	return count;
+}
+
+uint16_t BufferedSerial::GetFramingErrorCount() const
+{
+	noInterrupts();
+	const uint16_t count = m_FramingErrorCount;
+	interrupts();
+	return count;
+}
+
+void BufferedSerial::SetRxTimeEnabled(bool enabled)
+{
+	m_RxTimeEnabled = enabled;
+}
+
+uint32_t BufferedSerial::GetLastRxTime() const
+{
+	noInterrupts();
+	const uint32_t time = m_LastRxTime;
+	interrupts();
+	return time;
+}
+
+void BufferedSerial::handleRx(uint8_t usart)
+{
+	BufferedSerial* pPort = s_pPorts[usart];
+	if (pPort)
+		pPort->receive();
+}
+
+void BufferedSerial::handleTx(uint8_t usart)
+{
+	BufferedSerial* pPort = s_pPorts[usart];
+	if (pPort)
+		pPort->transmit();
+}
+
+void BufferedSerial::receive()
+{
+	// the status is for the byte at the front of the USART's FIFO, so it has to come first
+	const uint8_t status = *m_pUCSRA;
+	const uint8_t byte = *m_pUDR;
+
+	if (status & _BV(DOR0))
+		++m_OverrunCount;
+	if (status & _BV(FE0))
+	{
+		++m_FramingErrorCount;
+		return;
+	}
+
+	const uint8_t head = m_RxHead;
+	const uint8_t next = (head + 1) & m_RxMask;
+	if (next == m_RxTail)
+	{
+		++m_OverflowCount;
+		return;
+	}
+
+	m_pRxBuffer[head] = byte;
+	m_RxHead = next;
+	if (m_RxTimeEnabled)
+		m_LastRxTime = millis();
+
+	const uint8_t used = (uint8_t)(next - m_RxTail) & m_RxMask;
+	if (used > m_RxPeak)
+		m_RxPeak = used;
+}
+
+void BufferedSerial::transmit()
+{
+	const uint8_t tail = m_TxTail;
+	if (tail == m_TxHead)
+	{
+		*m_pUCSRB &= ~_BV(UDRIE0);
+		return;
+	}
+
+	*m_pUDR = m_pTxBuffer[tail];
+	m_TxTail = (tail + 1) & m_TxMask;
+
+	// cleared by writing a 1, so flush() can tell when this byte's gone
+	*m_pUCSRA = (*m_pUCSRA & _BV(U2X0)) | _BV(TXC0);
+}
@@ -0,0 +1,101 @@
+#ifndef _BUFFERED_SERIAL_H
+#define _BUFFERED_SERIAL_H
+
+#include <Core.h>
+#include <Stream.h>
+
+// A hardware USART with receive and transmit buffers sized per port.
+//
+// HardwareSerial gives every port 64 bytes each way, which the GPS fills in 5.5 ms at
+// 115200, so any loop that stalls longer than that silently loses NMEA. Here each port
+// gets the buffers it needs, from BufferedSerialPort<rxSize, txSize>, and counts what it
+// loses: bytes dropped with the receive buffer full, bytes the USART itself overran
+// because its interrupt was held off for two byte times, and bad stop bits.
+//
+// Each buffer has one writer and one reader, the interrupt and the app, and each index is
+// a single byte only ever written by one side, so neither side needs interrupts off.
+//
+// This takes the USART interrupts for every port there is, so a sketch using it can't
+// also use Serial, Serial1, ...: the linker will say so if it does. 8N1 only.
+class BufferedSerial : public Stream
+{
+public:
+	void begin(uint32_t baud);
+	void end();
+
+	virtual int available();
+	virtual int read();
+	virtual int peek();
+	virtual void flush();               // waits until everything's been sent
+	virtual size_t write(uint8_t byte);
+	using Print::write;
+
+	uint8_t GetRxCapacity() const;
+	uint8_t GetRxPeak() const;          // the fullest the receive buffer's been
+	uint16_t GetOverflowCount() const;  // bytes dropped with the receive buffer full
+	uint16_t GetOverrunCount() const;   // bytes lost in the USART before its interrupt ran
+	uint16_t GetFramingErrorCount() const;
+
+	// keep when the latest byte came in, for timing what it ended, at a few us a byte in the interrupt
+	void SetRxTimeEnabled(bool enabled);
+	uint32_t GetLastRxTime() const;     // millis() as the latest byte came in, if enabled
+
+	static void handleRx(uint8_t usart);   // called from the USART interrupts
+	static void handleTx(uint8_t usart);
+
+protected:
+	// the buffers' sizes are powers of two, passed as size - 1
+	BufferedSerial(uint8_t usart, uint8_t* pRxBuffer, uint8_t rxMask, uint8_t* pTxBuffer, uint8_t txMask);
+
+private:
+	void receive();
+	void transmit();
+
+private:
+	static BufferedSerial* s_pPorts[];
+
+	uint8_t m_USART;
+	volatile uint16_t* m_pUBRR;
+	volatile uint8_t* m_pUCSRA;
+	volatile uint8_t* m_pUCSRB;
+	volatile uint8_t* m_pUCSRC;
+	volatile uint8_t* m_pUDR;
+
+	uint8_t* m_pRxBuffer;
+	uint8_t m_RxMask;
+	volatile uint8_t m_RxHead;          // written by the interrupt
+	volatile uint8_t m_RxTail;          // written by the app
+	volatile uint8_t m_RxPeak;
+	volatile uint16_t m_OverflowCount;
+	volatile uint16_t m_OverrunCount;
+	volatile uint16_t m_FramingErrorCount;
+	bool m_RxTimeEnabled;
+	volatile uint32_t m_LastRxTime;
+
+	uint8_t* m_pTxBuffer;
+	uint8_t m_TxMask;
+	volatile uint8_t m_TxHead;          // written by the app
+	volatile uint8_t m_TxTail;          // written by the interrupt
+	bool m_Transmitted;                 // since begin(), so flush() knows there's a transmit complete to wait for
+};
+
+// rxSize and txSize are powers of two, up to 256; a buffer holds one less than its size
+template <uint16_t rxSize, uint16_t txSize>
+class BufferedSerialPort : public BufferedSerial
+{
+	typedef char RxSizeIsAPowerOfTwo[(rxSize & (rxSize - 1)) == 0 && rxSize >= 2 && rxSize <= 256 ? 1 : -1];
+	typedef char TxSizeIsAPowerOfTwo[(txSize & (txSize - 1)) == 0 && txSize >= 2 && txSize <= 256 ? 1 : -1];
+
+public:
+	// usart is the n of USARTn: 0 on the 328, 0 to 3 on the Mega
+	BufferedSerialPort(uint8_t usart) :
+		BufferedSerial(usart, m_RxBuffer, (uint8_t)(rxSize - 1), m_TxBuffer, (uint8_t)(txSize - 1))
+	{
+	}
+
+private:
+	uint8_t m_RxBuffer[rxSize];
+	uint8_t m_TxBuffer[txSize];
+};
+
+#endif
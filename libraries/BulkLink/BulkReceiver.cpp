@@ -0,0 +1,118 @@
+#include "BulkReceiver.h"
+
+BulkReceiver::BulkReceiver() :
+	m_Started(false),
+	m_Base(0),
+	m_Received(0),
+	m_LatestStamp(0),
+	m_AckDue(false),
+	m_SinceAck(0),
+	m_FirstSinceAck(0),
+	m_ReceivedCount(0),
+	m_DuplicateCount(0),
+	m_LostCount(0)
+{
+	m_Config.ackInterval = 500;
+	m_Config.ackEvery = 8;
+}
+
+void BulkReceiver::setup(const Config& config)
+{
+	m_Config = config;
+}
+
+void BulkReceiver::Rewind(uint32_t base)
+{
+	m_Started = true;
+	m_Base = base;
+	m_Received = 0;
+}
+
+bool BulkReceiver::OnChunk(uint32_t now, uint32_t senderBase, uint32_t chunk, uint8_t stamp)
+{
+	if (!m_Started)
+	{
+		m_Started = true;
+		m_Base = senderBase;
+	}
+	else if (senderBase > m_Base)
+	{
+		advance(senderBase);
+	}
+
+	if (!m_AckDue)
+		m_FirstSinceAck = now;
+	m_AckDue = true;
+	++m_SinceAck;
+	m_LatestStamp = stamp;
+
+	const uint32_t mask = (chunk >= m_Base && chunk - m_Base < BulkSender::c_WindowSize ? 1ul << (chunk - m_Base) : 0);
+	if (!mask || (m_Received & mask))
+	{
+		++m_DuplicateCount;
+		return false;
+	}
+
+	m_Received |= mask;
+	++m_ReceivedCount;
+	while (m_Received & 1)
+	{
+		m_Received >>= 1;
+		++m_Base;
+	}
+	return true;
+}
+
+bool BulkReceiver::IsAckDue(uint32_t now) const
+{
+	return m_AckDue && (m_SinceAck >= m_Config.ackEvery || now - m_FirstSinceAck >= m_Config.ackInterval);
+}
+
+void BulkReceiver::GetAck(uint32_t* pBase, uint32_t* pReceived, uint8_t* pLatestStamp)
+{
+	*pBase = m_Base;
+	*pReceived = m_Received;
+	*pLatestStamp = m_LatestStamp;
+
+	m_AckDue = false;
+	m_SinceAck = 0;
+}
+
+uint32_t BulkReceiver::GetBase() const
+{
+	return m_Base;
+}
+
+uint32_t BulkReceiver::GetReceivedCount() const
+{
+	return m_ReceivedCount;
+}
+
+uint16_t BulkReceiver::GetDuplicateCount() const
+{
+	return m_DuplicateCount;
+}
+
+uint32_t BulkReceiver::GetLostCount() const
+{
+	return m_LostCount;
+}
+
+void BulkReceiver::advance(uint32_t base)
+{
+	// everything we haven't had up to there is gone
+	while (m_Base < base)
+	{
+		if (!m_Received)
+		{
+			m_LostCount += base - m_Base;
+			m_Base = base;
+			break;
+		}
+
+		if (!(m_Received & 1))
+			++m_LostCount;
+		m_Received >>= 1;
+		++m_Base;
+	}
+}
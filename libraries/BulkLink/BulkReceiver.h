@@ -0,0 +1,62 @@
+#ifndef _BULK_RECEIVER_H
+#define _BULK_RECEIVER_H
+
+#include <Core.h>
+#include "BulkSender.h"
+
+// The ground's half of BulkSender's selective repeat ARQ.
+//
+// Keeps a bitmap of the chunks it's had in the window from its base, the oldest one it
+// hasn't, and says which are new, so the app can pass each one on exactly once, in
+// whatever order they turn up; putting them back in order is left to whatever reads them
+// back. An ack's due once a few chunks have come in since the last, or a while after the
+// first did, so a lost chunk's noticed quickly without the uplink being kept busy. If the
+// sender's base has moved past ours, because what we're missing is gone from the stream,
+// we move up to it and count the chunks we'll never get.
+class BulkReceiver
+{
+public:
+	struct Config
+	{
+		uint16_t ackInterval;   // ms, the longest a chunk waits to be acked
+		uint8_t ackEvery;       // chunks, to ack sooner than that
+	};
+
+public:
+	BulkReceiver();
+	void setup(const Config& config);
+	void Rewind(uint32_t base);         // along with the sender's, once it's said it has
+
+	// false if it's one we've had, or is out of the window
+	bool OnChunk(uint32_t now, uint32_t senderBase, uint32_t chunk, uint8_t stamp);
+
+	bool IsAckDue(uint32_t now) const;
+	// received is a bit for each chunk from base on
+	void GetAck(uint32_t* pBase, uint32_t* pReceived, uint8_t* pLatestStamp);
+
+	uint32_t GetBase() const;
+	uint32_t GetReceivedCount() const;
+	uint16_t GetDuplicateCount() const;
+	uint32_t GetLostCount() const;      // chunks the sender moved past before we had them
+
+private:
+	void advance(uint32_t base);
+
+private:
+	Config m_Config;
+	bool m_Started;
+
+	uint32_t m_Base;
+	uint32_t m_Received;                // a bit for each chunk from m_Base on
+	uint8_t m_LatestStamp;
+
+	bool m_AckDue;
+	uint8_t m_SinceAck;                 // chunks since the last ack
+	uint32_t m_FirstSinceAck;           // ms
+
+	uint32_t m_ReceivedCount;
+	uint16_t m_DuplicateCount;
+	uint32_t m_LostCount;
+};
+
+#endif
@@ -0,0 +1,158 @@
+#include "BulkSender.h"
+
+BulkSender::BulkSender() :
+	m_Base(0),
+	m_Next(0),
+	m_Acked(0),
+	m_Resend(0),
+	m_Stamp(0),
+	m_LastAck(0),
+	m_SentCount(0),
+	m_ResentCount(0),
+	m_SkippedCount(0)
+{
+	m_Config.ackTimeout = 2000;
+	memset(m_Stamps, 0, sizeof(m_Stamps));
+}
+
+void BulkSender::setup(const Config& config, uint32_t first)
+{
+	m_Config = config;
+	Rewind(first);
+}
+
+void BulkSender::Rewind(uint32_t first)
+{
+	m_Base = first;
+	m_Next = first;
+	m_Acked = 0;
+	m_Resend = 0;
+}
+
+bool BulkSender::GetNext(uint32_t now, uint32_t oldest, uint32_t end, uint32_t* pChunk)
+{
+	// whatever's dropped off the end of the stream can't be sent any more
+	if (oldest > m_Base)
+	{
+		uint32_t acked = 0;
+		for (uint32_t chunk=m_Base; chunk<min(oldest, m_Next); ++chunk)
+		{
+			if (m_Acked & (1ul << (chunk % c_WindowSize)))
+				++acked;
+		}
+		m_SkippedCount += oldest - m_Base - acked;
+		advance(oldest);
+	}
+
+	// nothing's been heard for a while, so try the base again to get an ack back
+	if (m_Next != m_Base && now - m_LastAck >= m_Config.ackTimeout)
+	{
+		m_Resend |= 1ul << (m_Base % c_WindowSize);
+		m_LastAck = now;
+	}
+
+	// anything that's been lost goes first, oldest first
+	if (m_Resend)
+	{
+		for (uint32_t chunk=m_Base; chunk<m_Next; ++chunk)
+		{
+			if (m_Resend & (1ul << (chunk % c_WindowSize)))
+			{
+				*pChunk = chunk;
+				return true;
+			}
+		}
+	}
+
+	if (m_Next < end && m_Next - m_Base < c_WindowSize)
+	{
+		*pChunk = m_Next;
+		return true;
+	}
+	return false;
+}
+
+uint8_t BulkSender::OnSent(uint32_t now, uint32_t chunk)
+{
+	// the ack timeout runs from when there's first something waiting on one
+	if (m_Next == m_Base)
+		m_LastAck = now;
+
+	const uint32_t mask = 1ul << (chunk % c_WindowSize);
+	m_Resend &= ~mask;
+	if (chunk == m_Next)
+		++m_Next;
+	else
+		++m_ResentCount;
+	++m_SentCount;
+
+	m_Stamps[chunk % c_WindowSize] = m_Stamp;
+	return m_Stamp++;
+}
+
+void BulkSender::OnAck(uint32_t now, uint32_t base, uint32_t received, uint8_t latestStamp)
+{
+	// one from before the last can't say anything new
+	if (base < m_Base)
+		return;
+
+	advance(base);
+	for (uint32_t chunk=m_Base; chunk<m_Next; ++chunk)
+	{
+		const uint32_t mask = 1ul << (chunk % c_WindowSize);
+		if (chunk - base < 32 && (received & (1ul << (chunk - base))))
+		{
+			m_Acked |= mask;
+			m_Resend &= ~mask;
+		}
+		else if (!(m_Acked & mask) && (int8_t)(latestStamp - m_Stamps[chunk % c_WindowSize]) > 0)
+		{
+			// sent before the latest chunk the ground's had, so it's not coming
+			m_Resend |= mask;
+		}
+	}
+	m_LastAck = now;
+}
+
+uint32_t BulkSender::GetBase() const
+{
+	return m_Base;
+}
+
+uint32_t BulkSender::GetSentCount() const
+{
+	return m_SentCount;
+}
+
+uint16_t BulkSender::GetResentCount() const
+{
+	return m_ResentCount;
+}
+
+uint32_t BulkSender::GetSkippedCount() const
+{
+	return m_SkippedCount;
+}
+
+void BulkSender::advance(uint32_t base)
+{
+	// the window's slots from the old base up to the new one are free again
+	const uint32_t end = min(base, m_Next);
+	if (end - m_Base >= c_WindowSize)
+	{
+		m_Acked = 0;
+		m_Resend = 0;
+	}
+	else
+	{
+		for (uint32_t chunk=m_Base; chunk<end; ++chunk)
+		{
+			const uint32_t mask = ~(1ul << (chunk % c_WindowSize));
+			m_Acked &= mask;
+			m_Resend &= mask;
+		}
+	}
+
+	m_Base = base;
+	m_Next = max(m_Next, base);
+}
@@ -0,0 +1,69 @@
+#ifndef _BULK_SENDER_H
+#define _BULK_SENDER_H
+
+#include <Core.h>
+
+// The balloon's half of a selective repeat ARQ for sending a long stream of chunks, the
+// flight recorder's log, down a lossy radio link a little at a time. BulkReceiver is the
+// ground's half.
+//
+// Chunks are numbered along the stream, and the app reads each one from wherever the
+// stream's kept when it's sent, so nothing's buffered here: a resend just reads it again.
+// Up to c_WindowSize chunks past the oldest one the ground hasn't got (the base) can be
+// out at once. The ground acks with its base and a bitmap of what it's got past it, and
+// the number stamped on the latest chunk it's had. A chunk that's still missing but was
+// sent before that one has been lost, since the link keeps chunks in order, so it's sent
+// again, ahead of new ones; one sent since is still on its way. If the acks stop, the
+// base is sent again every ackTimeout, so a lost ack can't stall it.
+//
+// The app decides when there's room on the link: GetNext() only says what to send, and
+// OnSent() is called once it's gone. Chunks that drop off the end of the stream before
+// they've been acked, overwritten in the flash, are skipped, and counted.
+class BulkSender
+{
+public:
+	static const uint8_t c_WindowSize = 32;         // the ack's bitmap has a bit for each
+
+	struct Config
+	{
+		uint16_t ackTimeout;    // ms, without an ack before the base is sent again
+	};
+
+public:
+	BulkSender();
+	void setup(const Config& config, uint32_t first);
+	void Rewind(uint32_t first);        // to send the stream again from there, forgetting what's been acked
+
+	// what to send next, if anything, given the chunks there are from oldest up to end
+	bool GetNext(uint32_t now, uint32_t oldest, uint32_t end, uint32_t* pChunk);
+	// returns the chunk's stamp, to go in its packet
+	uint8_t OnSent(uint32_t now, uint32_t chunk);
+
+	// received is a bit for each chunk from base on
+	void OnAck(uint32_t now, uint32_t base, uint32_t received, uint8_t latestStamp);
+
+	uint32_t GetBase() const;
+	uint32_t GetSentCount() const;
+	uint16_t GetResentCount() const;
+	uint32_t GetSkippedCount() const;   // chunks that were gone before they got there
+
+private:
+	void advance(uint32_t base);
+
+private:
+	Config m_Config;
+
+	uint32_t m_Base;
+	uint32_t m_Next;                    // the first chunk that's never been sent
+	uint32_t m_Acked;                   // a bit for each chunk in the window, by its number % c_WindowSize
+	uint32_t m_Resend;                  // likewise
+	uint8_t m_Stamps[c_WindowSize];     // each chunk's when it was last sent, likewise
+	uint8_t m_Stamp;
+	uint32_t m_LastAck;                 // ms, or when the base was last sent again
+
+	uint32_t m_SentCount;
+	uint16_t m_ResentCount;
+	uint32_t m_SkippedCount;
+};
+
+#endif
@@ -0,0 +1,226 @@
+#include "CaptureSerial.h"
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+namespace
+{
+	const uint32_t c_TimerTicksPerSecond = F_CPU / 8;   // Timer1 at clk/8
+	const uint16_t c_TxStartDelay        = 32;          // Timer1 ticks from write() to the first start bit
+}
+
+CaptureSerial* volatile CaptureSerial::s_pActive = NULL;
+
+#if defined(PCINT0_vect)
+ISR(PCINT0_vect)
+{
+	CaptureSerial::handleEdge();
+}
+#endif
+
+#if defined(PCINT1_vect)
+ISR(PCINT1_vect)
+{
+	CaptureSerial::handleEdge();
+}
+#endif
+
+#if defined(PCINT2_vect)
+ISR(PCINT2_vect)
+{
+	CaptureSerial::handleEdge();
+}
+#endif
+
+#if defined(PCINT3_vect)
+ISR(PCINT3_vect)
+{
+	CaptureSerial::handleEdge();
+}
+#endif
+
+ISR(TIMER1_COMPB_vect)
+{
+	CaptureSerial::handleTxTimer();
+}
+
+CaptureSerial::CaptureSerial(uint8_t rxPin, int8_t txPin) :
+	m_RxPin(rxPin),
+	m_pRxPort(portInputRegister(digitalPinToPort(rxPin))),
+	m_RxMask(digitalPinToBitMask(rxPin)),
+	m_TxPin(txPin),
+	m_pTxPort(txPin >= 0 ? portOutputRegister(digitalPinToPort(txPin)) : NULL),
+	m_TxMask(txPin >= 0 ? digitalPinToBitMask(txPin) : 0),
+	m_TxPeriod(0),
+	m_TxNext(0),
+	m_Transmitting(false)
+{
+}
+
+void CaptureSerial::begin(long baud)
+{
+	CaptureSerial* pActive = s_pActive;
+	if (pActive)
+		pActive->end();
+
+	// pulled up, so the line idles high with nothing on the other end
+	pinMode(m_RxPin, INPUT);
+	digitalWrite(m_RxPin, HIGH);
+
+	if (m_TxPin >= 0)
+	{
+		pinMode(m_TxPin, OUTPUT);
+		digitalWrite(m_TxPin, HIGH);
+		m_TxPeriod = (c_TimerTicksPerSecond * 16 + baud / 2) / baud;
+
+		// free running at clk/8, keeping Timebase's input capture settings if it's there too
+		noInterrupts();
+		TCCR1A = 0;
+		TCCR1B = (TCCR1B & (_BV(ICNC1) | _BV(ICES1))) | _BV(CS11);
+		interrupts();
+	}
+
+	noInterrupts();
+	m_UART.begin((1000000ul * 256 + baud / 2) / baud);
+	m_Transmitting = false;
+	s_pActive = this;
+	*digitalPinToPCMSK(m_RxPin) |= _BV(digitalPinToPCMSKbit(m_RxPin));
+	*digitalPinToPCICR(m_RxPin) |= _BV(digitalPinToPCICRbit(m_RxPin));
+	interrupts();
+}
+
+void CaptureSerial::end()
+{
+	noInterrupts();
+	*digitalPinToPCMSK(m_RxPin) &= ~_BV(digitalPinToPCMSKbit(m_RxPin));
+	if (m_Transmitting)
+	{
+		TIMSK1 &= ~_BV(OCIE1B);
+		*m_pTxPort |= m_TxMask;
+		m_Transmitting = false;
+	}
+	if (s_pActive == this)
+		s_pActive = NULL;
+	interrupts();
+}
+
+int CaptureSerial::available()
+{
+	poll();
+	return m_UART.available();
+}
+
+int CaptureSerial::read()
+{
+	poll();
+	return m_UART.read();
+}
+
+int CaptureSerial::peek()
+{
+	poll();
+	return m_UART.peek();
+}
+
+void CaptureSerial::flush()
+{
+	while (m_Transmitting)
+	{
+	}
+}
+
+size_t CaptureSerial::write(uint8_t byte)
+{
+	if (m_TxPin < 0 || s_pActive != this)
+		return 0;
+
+	// only waits when the buffer's full, and then with interrupts on
+	while (!m_UART.Write(byte))
+	{
+		if (!m_Transmitting)
+			startTransmit();
+	}
+
+	// after the byte's in, so the interrupt can't have just found the buffer empty and stopped
+	if (!m_Transmitting)
+		startTransmit();
+	return 1;
+}
+
+uint8_t CaptureSerial::GetTxSpace() const
+{
+	return m_TxPin >= 0 ? m_UART.GetTxSpace() : 0;
+}
+
+uint16_t CaptureSerial::GetOverflowCount() const
+{
+	return m_UART.GetOverflowCount();
+}
+
+uint16_t CaptureSerial::GetFramingErrorCount() const
+{
+	return m_UART.GetFramingErrorCount();
+}
+
+uint32_t CaptureSerial::GetLastRxTime() const
+{
+	// SoftUART's times are micros(), so back from millis() by as long ago as that was
+	noInterrupts();
+	const uint32_t elapsed = micros() - m_UART.GetLastRxTime();
+	const uint32_t now = millis();
+	interrupts();
+	return now - elapsed / 1000;
+}
+
+void CaptureSerial::handleEdge()
+{
+	CaptureSerial* pPort = s_pActive;
+	if (!pPort)
+		return;
+
+	const uint8_t level = (*pPort->m_pRxPort & pPort->m_RxMask) ? HIGH : LOW;
+	pPort->m_UART.OnEdge(micros(), level);
+}
+
+void CaptureSerial::handleTxTimer()
+{
+	CaptureSerial* pPort = s_pActive;
+	uint8_t level;
+	if (!pPort || !pPort->m_UART.TxBit(&level))
+	{
+		TIMSK1 &= ~_BV(OCIE1B);
+		if (pPort)
+			pPort->m_Transmitting = false;
+		return;
+	}
+
+	if (level == HIGH)
+		*pPort->m_pTxPort |= pPort->m_TxMask;
+	else
+		*pPort->m_pTxPort &= ~pPort->m_TxMask;
+
+	// the next bit's edge, kept in 1/16 ticks so the rounding doesn't add up over a byte
+	pPort->m_TxNext += pPort->m_TxPeriod;
+	OCR1B = (uint16_t)(pPort->m_TxNext >> 4);
+}
+
+void CaptureSerial::poll()
+{
+	noInterrupts();
+	m_UART.Poll(micros());
+	interrupts();
+}
+
+void CaptureSerial::startTransmit()
+{
+	noInterrupts();
+	if (!m_Transmitting)
+	{
+		const uint16_t start = TCNT1 + c_TxStartDelay;
+		m_TxNext = (uint32_t)start << 4;
+		OCR1B = start;
+		TIFR1 = _BV(OCF1B);
+		TIMSK1 |= _BV(OCIE1B);
+		m_Transmitting = true;
+	}
+	interrupts();
+}
@@ -0,0 +1,70 @@
+#ifndef _CAPTURE_SERIAL_H
+#define _CAPTURE_SERIAL_H
+
+#include <Core.h>
+#include <Stream.h>
+#include <SoftUART.h>
+
+// A software serial port that never holds interrupts off for more than a few us.
+//
+// SoftwareSerial times every bit with interrupts disabled, for the whole byte, which
+// drops bytes on the hardware Serial and upsets Sinewave's samples. Here the receive
+// pin's pin change interrupt just notes the time of each edge, micros() being the
+// capture, and SoftUART works out the bits from the times. Transmitting is driven by
+// Timer1's compare B interrupt, once a bit, with Timer1 free running at clk/8, the same
+// way Timebase runs it for the PPS input capture, so the two can share it. Both
+// directions are buffered, so write() only waits when the transmit buffer is full.
+//
+// Like SoftwareSerial, only one port listens at a time, the latest to begin(), and it
+// takes all of the pin change interrupt vectors. A txPin of -1 receives only, and
+// leaves Timer1 alone for TimerOne. 8N1, from 1200 to 19200 baud; tools/UARTSim checks
+// the timing.
+class CaptureSerial : public Stream
+{
+public:
+	static const uint8_t c_RxBufferSize = SoftUART::c_RxBufferSize;
+	static const uint8_t c_TxBufferSize = SoftUART::c_TxBufferSize;
+
+public:
+	CaptureSerial(uint8_t rxPin, int8_t txPin);
+
+	void begin(long baud);
+	void end();
+
+	virtual int available();
+	virtual int read();
+	virtual int peek();
+	virtual void flush();           // waits until everything's been sent
+	virtual size_t write(uint8_t byte);
+	using Print::write;
+	uint8_t GetTxSpace() const;     // bytes write() takes without waiting
+
+	uint16_t GetOverflowCount() const;
+	uint16_t GetFramingErrorCount() const;
+	uint32_t GetLastRxTime() const;  // millis() as the latest byte came in, from its edges rather than when it was polled
+
+	static void handleEdge();       // called from the pin change interrupts
+	static void handleTxTimer();    // called from the compare interrupt
+
+private:
+	void poll();
+	void startTransmit();
+
+private:
+	static CaptureSerial* volatile s_pActive;
+
+	SoftUART m_UART;
+
+	uint8_t m_RxPin;
+	volatile uint8_t* m_pRxPort;
+	uint8_t m_RxMask;
+
+	int8_t m_TxPin;
+	volatile uint8_t* m_pTxPort;
+	uint8_t m_TxMask;
+	uint32_t m_TxPeriod;            // Timer1 ticks, in 1/16s
+	uint32_t m_TxNext;              // Timer1 count for the next bit, in 1/16s
+	volatile bool m_Transmitting;
+};
+
+#endif
@@ -0,0 +1,209 @@
+#include "SoftUART.h"
+
+namespace
+{
+	const uint8_t c_StopBit = 9;       // after the start bit and 8 data bits
+	const uint8_t c_FrameBits = 10;
+}
+
+SoftUART::SoftUART() :
+	m_BitTime(256),
+	m_FrameTime(c_FrameBits),
+	m_RxStart(0),
+	m_RxLevel(HIGH),
+	m_RxBit(0),
+	m_RxByte(0),
+	m_RxHead(0),
+	m_RxTail(0),
+	m_OverflowCount(0),
+	m_FramingErrorCount(0),
+	m_RxEnd(0),
+	m_TxBit(0),
+	m_TxByte(0),
+	m_TxHead(0),
+	m_TxTail(0)
+{
+}
+
+void SoftUART::begin(uint32_t bitTime)
+{
+	m_BitTime = bitTime;
+	m_FrameTime = bitTime * c_FrameBits / 256;
+	clear();
+}
+
+void SoftUART::clear()
+{
+	m_RxLevel = HIGH;
+	m_RxBit = 0;
+	m_RxHead = m_RxTail = 0;
+	m_TxBit = 0;
+	m_TxHead = m_TxTail = 0;
+}
+
+void SoftUART::OnEdge(uint32_t time, uint8_t level)
+{
+	// another pin on the same port, or an edge and its return both missed
+	if (level == m_RxLevel)
+		return;
+	m_RxLevel = level;
+
+	if (m_RxBit == 0)
+	{
+		if (level == LOW)
+		{
+			m_RxStart = time;
+			m_RxByte = 0;
+			m_RxBit = 1;
+		}
+		return;
+	}
+
+	// which bit this edge starts, everything before it since the last edge had the other level
+	const uint32_t elapsed = time - m_RxStart;
+	const uint8_t bit = (elapsed >= m_FrameTime ? c_FrameBits : (uint8_t)((elapsed * 256 + m_BitTime / 2) / m_BitTime));
+	const uint8_t previous = (level == LOW ? HIGH : LOW);
+
+	// a start bit that was over too soon was just noise
+	if (bit == 0)
+	{
+		m_RxBit = 0;
+		return;
+	}
+
+	for (; m_RxBit < bit && m_RxBit < c_StopBit; ++m_RxBit)
+	{
+		if (previous == HIGH)
+			m_RxByte |= 1 << (m_RxBit - 1);
+	}
+
+	if (bit <= c_StopBit)
+	{
+		m_RxBit = max(m_RxBit, bit);
+		return;
+	}
+
+	// past the stop bit, so this can only be the next start bit
+	endFrame(previous);
+	if (level == LOW)
+	{
+		m_RxStart = time;
+		m_RxByte = 0;
+		m_RxBit = 1;
+	}
+}
+
+void SoftUART::Poll(uint32_t time)
+{
+	if (m_RxBit == 0 || time - m_RxStart < m_FrameTime)
+		return;
+
+	// no edges since the last one, so the rest of the frame was all the same
+	for (; m_RxBit < c_StopBit; ++m_RxBit)
+	{
+		if (m_RxLevel == HIGH)
+			m_RxByte |= 1 << (m_RxBit - 1);
+	}
+	endFrame(m_RxLevel);
+}
+
+uint8_t SoftUART::available() const
+{
+	return (m_RxHead - m_RxTail) & (c_RxBufferSize - 1);
+}
+
+int SoftUART::peek() const
+{
+	if (m_RxHead == m_RxTail)
+		return -1;
+	return m_RxBuffer[m_RxTail];
+}
+
+int SoftUART::read()
+{
+	if (m_RxHead == m_RxTail)
+		return -1;
+
+	const uint8_t byte = m_RxBuffer[m_RxTail];
+	m_RxTail = (m_RxTail + 1) & (c_RxBufferSize - 1);
+	return byte;
+}
+
+bool SoftUART::Write(uint8_t byte)
+{
+	const uint8_t head = (m_TxHead + 1) & (c_TxBufferSize - 1);
+	if (head == m_TxTail)
+		return false;
+
+	m_TxBuffer[m_TxHead] = byte;
+	m_TxHead = head;
+	return true;
+}
+
+uint8_t SoftUART::GetTxSpace() const
+{
+	return (m_TxTail - m_TxHead - 1) & (c_TxBufferSize - 1);
+}
+
+bool SoftUART::TxBit(uint8_t* pLevel)
+{
+	if (m_TxBit == 0)
+	{
+		// the last stop bit's done, so on to the next byte's start bit, if there is one
+		if (m_TxHead == m_TxTail)
+			return false;
+
+		m_TxByte = m_TxBuffer[m_TxTail];
+		m_TxTail = (m_TxTail + 1) & (c_TxBufferSize - 1);
+		*pLevel = LOW;
+		m_TxBit = 1;
+	}
+	else if (m_TxBit < c_StopBit)
+	{
+		*pLevel = (m_TxByte & 0x01 ? HIGH : LOW);
+		m_TxByte >>= 1;
+		++m_TxBit;
+	}
+	else
+	{
+		*pLevel = HIGH;
+		m_TxBit = 0;
+	}
+	return true;
+}
+
+uint16_t SoftUART::GetOverflowCount() const
+{
+	return m_OverflowCount;
+}
+
+uint16_t SoftUART::GetFramingErrorCount() const
+{
+	return m_FramingErrorCount;
+}
+
+uint32_t SoftUART::GetLastRxTime() const
+{
+	return m_RxEnd;
+}
+
+void SoftUART::endFrame(uint8_t stopLevel)
+{
+	m_RxBit = 0;
+	if (stopLevel != HIGH)
+	{
+		++m_FramingErrorCount;
+		return;
+	}
+
+	const uint8_t head = (m_RxHead + 1) & (c_RxBufferSize - 1);
+	if (head == m_RxTail)
+	{
+		++m_OverflowCount;
+		return;
+	}
+
+	m_RxBuffer[m_RxHead] = m_RxByte;
+	m_RxHead = head;
+	m_RxEnd = m_RxStart + m_FrameTime;
+}
@@ -0,0 +1,74 @@
+#ifndef _SOFT_UART_H
+#define _SOFT_UART_H
+
+#include <Core.h>
+
+// The timing half of CaptureSerial, 8N1 framing from edge times and to bit times, kept
+// apart from the hardware so that tools/UARTSim can run it against simulated lines.
+//
+// Receiving works from when the line changed rather than sampling it: each edge's time
+// since the start bit's falling edge says which bit it starts, and every bit since the
+// last edge had the level from before it. A frame that ends in 1s has no edge after its
+// last data bit, so Poll() finishes it once its stop bit's over (and the next start bit
+// does too, if that comes first). Transmitting is a bit at a time from a timer: TxBit()
+// gives the level for each bit period in turn, start, data, stop, then the next byte.
+class SoftUART
+{
+public:
+	static const uint8_t c_RxBufferSize = 32;    // powers of two
+	static const uint8_t c_TxBufferSize = 64;
+
+public:
+	SoftUART();
+
+	// bitTime is in 1/256 of whatever unit the edge times are in
+	void begin(uint32_t bitTime);
+	void clear();
+
+	// from the edge interrupt, with the line's level after the edge
+	void OnEdge(uint32_t time, uint8_t level);
+	// with interrupts off, to finish a frame whose stop bit has gone by without an edge
+	void Poll(uint32_t time);
+
+	uint8_t available() const;
+	int peek() const;
+	int read();
+
+	// false if the transmit buffer's full
+	bool Write(uint8_t byte);
+	uint8_t GetTxSpace() const;             // bytes that can be written before it is
+	// from the transmit timer, once a bit period: the level for the next bit, or false when there's nothing to send
+	bool TxBit(uint8_t* pLevel);
+
+	uint16_t GetOverflowCount() const;      // bytes dropped with the receive buffer full
+	uint16_t GetFramingErrorCount() const;  // frames whose stop bit wasn't a 1
+	uint32_t GetLastRxTime() const;         // the end of the stop bit of the latest byte into the receive buffer
+
+private:
+	void endFrame(uint8_t stopLevel);
+
+private:
+	uint32_t m_BitTime;
+	uint32_t m_FrameTime;             // to the end of the stop bit, in the edge times' units
+
+	// receiving
+	uint32_t m_RxStart;               // the start bit's falling edge
+	uint8_t m_RxLevel;                // since the last edge
+	uint8_t m_RxBit;                  // the next bit to fill in, 0 when between frames
+	uint8_t m_RxByte;
+	uint8_t m_RxBuffer[c_RxBufferSize];
+	volatile uint8_t m_RxHead;        // written by the interrupt
+	volatile uint8_t m_RxTail;        // read by the app
+	uint16_t m_OverflowCount;
+	uint16_t m_FramingErrorCount;
+	uint32_t m_RxEnd;                 // of the latest byte into the buffer
+
+	// transmitting
+	uint8_t m_TxBit;                  // the next bit to send, 0 when between bytes
+	uint8_t m_TxByte;
+	uint8_t m_TxBuffer[c_TxBufferSize];
+	volatile uint8_t m_TxHead;        // written by the app
+	volatile uint8_t m_TxTail;        // read by the interrupt
+};
+
+#endif
@@ -0,0 +1,154 @@
+#include "ClockSync.h"
+
+ClockSync::ClockSync() :
+	m_LastRemote(0),
+	m_SampleCount(0),
+	m_RejectedCount(0),
+	m_ResetCount(0)
+{
+	m_Config.maxDelay = 500;
+	m_Config.historySpacing = 30000;
+	reset();
+}
+
+void ClockSync::setup(const Config& config)
+{
+	m_Config = config;
+}
+
+bool ClockSync::AddSample(uint32_t t1, uint32_t t2, uint32_t t3, uint32_t t4)
+{
+	const int32_t delay = (int32_t)(t4 - t1) - (int32_t)(t3 - t2);
+	if (delay < 0 || delay > m_Config.maxDelay)
+	{
+		++m_RejectedCount;
+		return false;
+	}
+
+	// their clock's gone back, so it's not the one we've been following
+	if (m_SampleCount && (int32_t)(t2 - m_LastRemote) < 0)
+	{
+		reset();
+		++m_ResetCount;
+	}
+	m_LastRemote = t3;
+	++m_SampleCount;
+
+	Sample sample;
+	sample.local = t1 + (t4 - t1) / 2;
+	sample.offset = ((int32_t)(t2 - t1) + (int32_t)(t3 - t4)) / 2;
+	sample.delay = (uint16_t)delay;
+	if (!m_HasBest || sample.delay < m_Best.delay)
+	{
+		m_Best = sample;
+		m_HasBest = true;
+	}
+
+	// the best of each historySpacing goes into the history
+	if (m_HistoryCount && sample.local - m_History[(m_HistoryHead + m_HistoryCount - 1) % c_HistorySize].local < m_Config.historySpacing)
+		return true;
+
+	if (m_HistoryCount == c_HistorySize)
+		m_HistoryHead = (m_HistoryHead + 1) % c_HistorySize;
+	else
+		++m_HistoryCount;
+	m_History[(m_HistoryHead + m_HistoryCount - 1) % c_HistorySize] = m_Best;
+	m_HasBest = false;
+
+	fit();
+	return true;
+}
+
+bool ClockSync::IsSynced() const
+{
+	return m_HistoryCount > 0;
+}
+
+int32_t ClockSync::GetOffset(uint32_t local) const
+{
+	const float x = (float)(int32_t)(local - m_RefLocal);
+	return m_RefOffset + (int32_t)floor(m_FitOffset + m_Drift * x + 0.5f);
+}
+
+uint32_t ClockSync::ToLocal(uint32_t remote) const
+{
+	// the drift's tiny, so once round gets it to the ms
+	const uint32_t local = remote - m_RefOffset;
+	return remote - GetOffset(local);
+}
+
+float ClockSync::GetDrift() const
+{
+	return m_Drift * 1.0e6f;
+}
+
+uint16_t ClockSync::GetDelay() const
+{
+	return m_HistoryCount ? m_History[(m_HistoryHead + m_HistoryCount - 1) % c_HistorySize].delay : 0;
+}
+
+uint16_t ClockSync::GetSampleCount() const
+{
+	return m_SampleCount;
+}
+
+uint16_t ClockSync::GetRejectedCount() const
+{
+	return m_RejectedCount;
+}
+
+uint16_t ClockSync::GetResetCount() const
+{
+	return m_ResetCount;
+}
+
+void ClockSync::reset()
+{
+	m_HistoryHead = 0;
+	m_HistoryCount = 0;
+	m_HasBest = false;
+	m_RefLocal = 0;
+	m_RefOffset = 0;
+	m_FitOffset = 0.0f;
+	m_Drift = 0.0f;
+}
+
+void ClockSync::fit()
+{
+	// relative to the latest sample, so the floats keep their precision; each is weighted by
+	// how far out it could be, half its round trip, so one that was held up doesn't count for much
+	const Sample& latest = m_History[(m_HistoryHead + m_HistoryCount - 1) % c_HistorySize];
+	m_RefLocal = latest.local;
+	m_RefOffset = latest.offset;
+
+	float sw = 0.0f, meanX = 0.0f, meanY = 0.0f;
+	for (uint8_t i=0; i<m_HistoryCount; ++i)
+	{
+		const Sample& sample = m_History[(m_HistoryHead + i) % c_HistorySize];
+		const float w = getWeight(sample);
+		sw += w;
+		meanX += w * (int32_t)(sample.local - m_RefLocal);
+		meanY += w * (sample.offset - m_RefOffset);
+	}
+	meanX /= sw;
+	meanY /= sw;
+
+	float sxx = 0.0f, sxy = 0.0f;
+	for (uint8_t i=0; i<m_HistoryCount; ++i)
+	{
+		const Sample& sample = m_History[(m_HistoryHead + i) % c_HistorySize];
+		const float w = getWeight(sample);
+		const float dx = (int32_t)(sample.local - m_RefLocal) - meanX;
+		sxx += w * dx * dx;
+		sxy += w * dx * (sample.offset - m_RefOffset - meanY);
+	}
+
+	m_Drift = sxx > 0.0f ? sxy / sxx : 0.0f;
+	m_FitOffset = meanY - m_Drift * meanX;
+}
+
+float ClockSync::getWeight(const Sample& sample)
+{
+	const float delay = max(sample.delay, (uint16_t)1);
+	return 1.0f / (delay * delay);
+}
@@ -0,0 +1,82 @@
+#ifndef _CLOCK_SYNC_H
+#define _CLOCK_SYNC_H
+
+#include <Core.h>
+
+// Works out where another board's millis() is against ours, from NTP style exchanges over
+// the radio: a ping's stamped t1 by our clock as it goes, t2 by theirs when it arrives,
+// t3 by theirs when the answer goes back, and t4 by ours when that arrives. The round
+// trip took (t4 - t1) - (t3 - t2) on the air, and their clock's ahead of ours by
+// ((t2 - t1) + (t3 - t4)) / 2, give or take half the difference between the two ways,
+// which can't be more than half the round trip.
+//
+// The round trip varies a lot, with the serial buffers, the poll loops at each end and
+// whatever else is on the air, and the shortest are the most even both ways, so of the
+// samples in each historySpacing only the one with the shortest round trip is kept, like
+// NTP's clock filter, and those longer than maxDelay aren't considered at all. A straight
+// line through the last c_HistorySize kept samples, by least squares weighted by how far
+// out each could be, gives the offset now and the drift, which matters: a ceramic
+// resonator can be out by 0.5%, 18 s an hour.
+// If their clock's gone backwards they've been reset, and it starts again.
+class ClockSync
+{
+public:
+	static const uint8_t c_HistorySize = 16;
+
+	struct Config
+	{
+		uint16_t maxDelay;          // ms, round trips longer than this are thrown away
+		uint16_t historySpacing;    // ms, between the samples that are kept
+	};
+
+public:
+	ClockSync();
+	void setup(const Config& config);
+
+	// false if it was thrown away
+	bool AddSample(uint32_t t1, uint32_t t2, uint32_t t3, uint32_t t4);
+
+	bool IsSynced() const;
+	int32_t GetOffset(uint32_t local) const;        // ms their clock's ahead of ours, at that time by ours
+	uint32_t ToLocal(uint32_t remote) const;        // their time, by our clock
+	float GetDrift() const;                         // ppm their clock runs fast by
+	uint16_t GetDelay() const;                      // ms, of the latest sample that was kept
+
+	uint16_t GetSampleCount() const;
+	uint16_t GetRejectedCount() const;
+	uint16_t GetResetCount() const;
+
+private:
+	struct Sample
+	{
+		uint32_t local;             // ms, by our clock, halfway through the round trip
+		int32_t offset;             // ms
+		uint16_t delay;             // ms
+	};
+
+	void reset();
+	void fit();
+	static float getWeight(const Sample& sample);
+
+private:
+	Config m_Config;
+
+	Sample m_History[c_HistorySize];
+	uint8_t m_HistoryHead;          // the oldest
+	uint8_t m_HistoryCount;
+	Sample m_Best;                  // of the samples since the latest in the history
+	bool m_HasBest;
+	uint32_t m_LastRemote;          // their t3 in the last sample, to notice them being reset
+
+	// the line through the history, as an offset from the latest sample's
+	uint32_t m_RefLocal;
+	int32_t m_RefOffset;
+	float m_FitOffset;              // ms, at m_RefLocal
+	float m_Drift;                  // ms/ms
+
+	uint16_t m_SampleCount;
+	uint16_t m_RejectedCount;
+	uint16_t m_ResetCount;
+};
+
+#endif
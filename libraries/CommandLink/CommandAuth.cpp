@@ -0,0 +1,49 @@
+#include "CommandAuth.h"
+
+CommandAuth::CommandAuth(const uint8_t* pKey)
+{
+	memcpy_P(m_Key, pKey, sizeof(m_Key));
+}
+
+uint32_t CommandAuth::Sign(const void* pData, uint8_t size) const
+{
+	const uint8_t* pBytes = (const uint8_t*)pData;
+
+	uint32_t v[2] = {size, 0};
+	encipher(v);
+
+	for (uint8_t i=0; i<size; i+=8)
+	{
+		uint8_t block[8];
+		memset(block, 0, sizeof(block));
+		memcpy(block, pBytes + i, min(size - i, 8));
+
+		uint32_t words[2];
+		memcpy(words, block, sizeof(words));
+		v[0] ^= words[0];
+		v[1] ^= words[1];
+		encipher(v);
+	}
+
+	return v[0];
+}
+
+bool CommandAuth::Verify(const void* pData, uint8_t size, uint32_t mac) const
+{
+	return Sign(pData, size) == mac;
+}
+
+void CommandAuth::encipher(uint32_t* v) const
+{
+	// XTEA, 32 cycles
+	const uint32_t delta = 0x9E3779B9;
+	uint32_t v0 = v[0], v1 = v[1], sum = 0;
+	for (uint8_t i=0; i<32; ++i)
+	{
+		v0 += (((v1 << 4) ^ (v1 >> 5)) + v1) ^ (sum + m_Key[sum & 3]);
+		sum += delta;
+		v1 += (((v0 << 4) ^ (v0 >> 5)) + v0) ^ (sum + m_Key[(sum >> 11) & 3]);
+	}
+	v[0] = v0;
+	v[1] = v1;
+}
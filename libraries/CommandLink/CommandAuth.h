@@ -0,0 +1,33 @@
+#ifndef _COMMAND_AUTH_H
+#define _COMMAND_AUTH_H
+
+#include <Core.h>
+
+// Signs the uplink's commands and the balloon's answers with a key both ends share, so
+// nobody else on the frequency can tell the balloon what to do.
+//
+// The MAC is a CBC-MAC with XTEA: the packet's length goes into the first block, then
+// each 8 bytes of it are XORed in and enciphered in turn, and the first half of the
+// last block is the MAC. XTEA's a few hundred bytes of code and no tables, and a packet's
+// signed in well under a millisecond. 32 bits is short for a MAC, but at the link's rate
+// guessing one would take years of airtime, and each packet's sequence number keeps one
+// that's been heard from being used again.
+class CommandAuth
+{
+public:
+	static const uint8_t c_KeySize = 16;
+
+public:
+	CommandAuth(const uint8_t* pKey);   // c_KeySize bytes, in PROGMEM
+
+	uint32_t Sign(const void* pData, uint8_t size) const;
+	bool Verify(const void* pData, uint8_t size, uint32_t mac) const;
+
+private:
+	void encipher(uint32_t* v) const;
+
+private:
+	uint32_t m_Key[4];
+};
+
+#endif
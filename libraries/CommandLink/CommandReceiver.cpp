@@ -0,0 +1,70 @@
+#include "CommandReceiver.h"
+
+CommandReceiver::CommandReceiver() :
+	m_Last(0),
+	m_HasResult(false),
+	m_Result(c_StaleResult),
+	m_NewCount(0),
+	m_RepeatCount(0),
+	m_StaleCount(0)
+{
+}
+
+void CommandReceiver::setup(uint16_t last)
+{
+	m_Last = last;
+	m_HasResult = false;
+	m_Result = c_StaleResult;
+}
+
+CommandReceiver::EVerdict::Enum CommandReceiver::OnCommand(uint16_t sequence)
+{
+	const uint16_t ahead = sequence - m_Last;
+	if (ahead >= 1 && ahead <= c_MaxSkip)
+	{
+		m_Last = sequence;
+		m_HasResult = false;
+		++m_NewCount;
+		return EVerdict::New;
+	}
+
+	if (ahead == 0 && m_HasResult)
+	{
+		++m_RepeatCount;
+		return EVerdict::Repeat;
+	}
+
+	++m_StaleCount;
+	return EVerdict::Stale;
+}
+
+void CommandReceiver::SetResult(uint8_t result)
+{
+	m_Result = result;
+	m_HasResult = true;
+}
+
+uint16_t CommandReceiver::GetLastSequence() const
+{
+	return m_Last;
+}
+
+uint8_t CommandReceiver::GetLastResult() const
+{
+	return m_Result;
+}
+
+uint16_t CommandReceiver::GetNewCount() const
+{
+	return m_NewCount;
+}
+
+uint16_t CommandReceiver::GetRepeatCount() const
+{
+	return m_RepeatCount;
+}
+
+uint16_t CommandReceiver::GetStaleCount() const
+{
+	return m_StaleCount;
+}
@@ -0,0 +1,58 @@
+#ifndef _COMMAND_RECEIVER_H
+#define _COMMAND_RECEIVER_H
+
+#include <Core.h>
+
+// The balloon's half of the uplink's commands: says whether a command that's checked out
+// with CommandAuth is new, so it's run, or one it's run already, so only its result's
+// sent back again. CommandSender is the ground's half.
+//
+// Every command has a sequence number, one more than the last the ground sent, and is
+// sent again until it's answered, so it mustn't be run twice when an answer's lost: the
+// last command's sequence number and result are kept to answer it again with. One a
+// little ahead of the last is new, since the ground may have given up on some in between.
+// Anything else is stale, and is answered with the last sequence number, so a ground
+// that's been restarted can carry on from it. That's also how a command that was heard
+// earlier and sent again by someone else is turned away. The balloon starts from a random
+// sequence number, so one heard on an earlier flight almost certainly isn't ahead of it.
+class CommandReceiver
+{
+public:
+	static const uint8_t c_MaxSkip = 16;            // how far ahead of the last a new command can be
+	static const uint8_t c_StaleResult = 0xFF;      // the result in the answer to a stale command
+
+	struct EVerdict
+	{
+		enum Enum
+		{
+			New,            // run it, then SetResult()
+			Repeat,         // answer with GetLastResult()
+			Stale,          // answer with c_StaleResult and GetLastSequence()
+		};
+	};
+
+public:
+	CommandReceiver();
+	void setup(uint16_t last);          // random, ideally
+
+	EVerdict::Enum OnCommand(uint16_t sequence);
+	void SetResult(uint8_t result);
+
+	uint16_t GetLastSequence() const;
+	uint8_t GetLastResult() const;
+
+	uint16_t GetNewCount() const;
+	uint16_t GetRepeatCount() const;
+	uint16_t GetStaleCount() const;
+
+private:
+	uint16_t m_Last;
+	bool m_HasResult;                   // nothing's been run since setup()
+	uint8_t m_Result;
+
+	uint16_t m_NewCount;
+	uint16_t m_RepeatCount;
+	uint16_t m_StaleCount;
+};
+
+#endif
@@ -0,0 +1,120 @@
+#include "CommandSender.h"
+
+CommandSender::CommandSender() :
+	m_Sequence(0),
+	m_Waiting(false),
+	m_SendNow(false),
+	m_Command(0),
+	m_Arg(0),
+	m_Tries(0),
+	m_LastSent(0),
+	m_SentCount(0),
+	m_ResyncCount(0)
+{
+	m_Config.retryInterval = 1500;
+	m_Config.maxTries = 5;
+}
+
+void CommandSender::setup(const Config& config)
+{
+	m_Config = config;
+}
+
+bool CommandSender::Queue(uint8_t command, uint32_t arg)
+{
+	if (m_Waiting)
+		return false;
+
+	++m_Sequence;
+	m_Waiting = true;
+	m_SendNow = true;
+	m_Command = command;
+	m_Arg = arg;
+	m_Tries = 0;
+	return true;
+}
+
+bool CommandSender::IsWaiting() const
+{
+	return m_Waiting;
+}
+
+bool CommandSender::GetNext(uint32_t now, uint16_t* pSequence, uint8_t* pCommand, uint32_t* pArg)
+{
+	if (!m_Waiting || m_Tries >= m_Config.maxTries ||
+	    (!m_SendNow && now - m_LastSent < m_Config.retryInterval))
+		return false;
+
+	*pSequence = m_Sequence;
+	*pCommand = m_Command;
+	*pArg = m_Arg;
+	return true;
+}
+
+void CommandSender::OnSent(uint32_t now)
+{
+	++m_Tries;
+	m_SendNow = false;
+	m_LastSent = now;
+	++m_SentCount;
+}
+
+bool CommandSender::OnAnswer(uint16_t sequence, uint8_t result)
+{
+	if (!m_Waiting)
+		return false;
+
+	if (result == CommandReceiver::c_StaleResult)
+	{
+		// carry on from the balloon's numbering, and go again if there are tries left
+		m_Sequence = sequence + 1;
+		m_SendNow = (m_Tries < m_Config.maxTries);
+		++m_ResyncCount;
+		return false;
+	}
+
+	if (sequence != m_Sequence)
+		return false;
+
+	m_Waiting = false;
+	return true;
+}
+
+bool CommandSender::HasFailed(uint32_t now)
+{
+	if (!m_Waiting || m_Tries < m_Config.maxTries || now - m_LastSent < m_Config.retryInterval)
+		return false;
+
+	m_Waiting = false;
+	return true;
+}
+
+uint16_t CommandSender::GetSequence() const
+{
+	return m_Sequence;
+}
+
+uint8_t CommandSender::GetCommand() const
+{
+	return m_Command;
+}
+
+uint32_t CommandSender::GetArg() const
+{
+	return m_Arg;
+}
+
+uint8_t CommandSender::GetTries() const
+{
+	return m_Tries;
+}
+
+uint16_t CommandSender::GetSentCount() const
+{
+	return m_SentCount;
+}
+
+uint16_t CommandSender::GetResyncCount() const
+{
+	return m_ResyncCount;
+}
@@ -0,0 +1,66 @@
+#ifndef _COMMAND_SENDER_H
+#define _COMMAND_SENDER_H
+
+#include <Core.h>
+#include "CommandReceiver.h"
+
+// The ground's half of the uplink's commands: numbers them, and sends each one again
+// every retryInterval until it's answered or it's been tried maxTries times. One command
+// is in flight at a time, since they're typed in by hand.
+//
+// An answer saying the command was stale carries the balloon's last sequence number, so
+// the numbering carries on from there and the command goes again straight away: the
+// tracker may have been restarted, or the balloon, which starts from a random sequence
+// number. Going again counts as a try like any other, so a stale answer replayed over
+// and over can't keep the command going past maxTries. The app decides when there's room
+// on the link: GetNext() only says what to send, and OnSent() is called once it's gone.
+class CommandSender
+{
+public:
+	struct Config
+	{
+		uint16_t retryInterval;     // ms, without an answer before it's sent again
+		uint8_t maxTries;
+	};
+
+public:
+	CommandSender();
+	void setup(const Config& config);
+
+	bool Queue(uint8_t command, uint32_t arg);      // false while there's still one in flight
+	bool IsWaiting() const;
+
+	// the command to send, if it's due
+	bool GetNext(uint32_t now, uint16_t* pSequence, uint8_t* pCommand, uint32_t* pArg);
+	void OnSent(uint32_t now);
+
+	// true if it's the answer to the command in flight, which is then done
+	bool OnAnswer(uint16_t sequence, uint8_t result);
+	// true once, when the last try's gone unanswered and it's been given up on
+	bool HasFailed(uint32_t now);
+
+	// the command in flight, or the last one
+	uint16_t GetSequence() const;
+	uint8_t GetCommand() const;
+	uint32_t GetArg() const;
+	uint8_t GetTries() const;
+
+	uint16_t GetSentCount() const;
+	uint16_t GetResyncCount() const;
+
+private:
+	Config m_Config;
+
+	uint16_t m_Sequence;
+	bool m_Waiting;
+	bool m_SendNow;
+	uint8_t m_Command;
+	uint32_t m_Arg;
+	uint8_t m_Tries;
+	uint32_t m_LastSent;                // ms
+
+	uint16_t m_SentCount;
+	uint16_t m_ResyncCount;
+};
+
+#endif
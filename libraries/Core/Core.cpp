@@ -48,6 +48,31 @@ extern unsigned int __bss_end;
 extern unsigned int __heap_start;
 extern void *__brkval;
 
+namespace
+{
+	const uint8_t c_StackPaint = 0xC5;
+}
+
+// Fills everything from the end of the static data up to the top of RAM with
+// c_StackPaint, before the C runtime's set anything up. There's no stack yet, and no
+// zero register, so it's done in assembly.
+void PaintStack() __attribute__((naked, used, section(".init1")));
+void PaintStack()
+{
+	__asm volatile (
+		"    ldi r30, lo8(__heap_start)\n"
+		"    ldi r31, hi8(__heap_start)\n"
+		"    ldi r24, %0\n"
+		"    ldi r25, hi8(__stack)\n"
+		"    rjmp 2f\n"
+		"1:  st Z+, r24\n"
+		"2:  cpi r30, lo8(__stack)\n"
+		"    cpc r31, r25\n"
+		"    brlo 1b\n"
+		"    breq 1b\n"
+		:: "M" (c_StackPaint));
+}
+
 size_t GetFreeMemory()
 {
 	size_t free_memory;
@@ -60,3 +85,17 @@ size_t GetFreeMemory()
 	return free_memory;
 }
 
+size_t GetMinFreeMemory()
+{
+	// the paint left between the top of the heap and the deepest the stack's been
+	const uint8_t* p = (__brkval == 0 ? (const uint8_t*)&__heap_start : (const uint8_t*)__brkval);
+	const uint8_t* end = (const uint8_t*)&p;
+	size_t free_memory = 0;
+	while (p < end && *p == c_StackPaint)
+	{
+		++p;
+		++free_memory;
+	}
+
+	return free_memory;
+}
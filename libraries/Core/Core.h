@@ -14,7 +14,11 @@ float sign(float x);
 float LerpClamp(float in, float in0, float in1, float out0, float out1);
 float LerpClamp(float in, float in0, float in1, float in2, float out0, float out1, float out2);
 float ModInto(float in, float min, float max);
-size_t GetFreeMemory();
+
+// RAM between the heap and the stack. The stack's painted before main() runs, so the
+// least there's ever been, ISRs and all, is however much of the paint is still there.
+size_t GetFreeMemory();     // right now
+size_t GetMinFreeMemory();  // since reset
 
 template <typename T>
 T ToRadians(const T& degrees)
@@ -138,6 +142,11 @@ public:
 		return m_Size;
 	}
 	
+	uint32_t capacity() const
+	{
+		return BUFFER_SIZE * 8;
+	}
+	
 	void push_back(uint8_t bit)
 	{
 		uint8_t& byte = m_Buffer[m_Size / 8];
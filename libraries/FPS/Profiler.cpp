@@ -0,0 +1,90 @@
+#include "Profiler.h"
+
+namespace
+{
+	const uint8_t c_FirstBucketBits = 3;      // bucket 0 is everything under 2^3 us
+	const uint8_t c_MaxBucket = 0xFF;
+	const uint32_t c_MaxTotal = 0x7FFFFFFFul;
+}
+
+Profiler::Profiler() :
+	m_SectionCount(0),
+	m_LastLoop(0)
+{
+	memset(&m_Loop, 0, sizeof(m_Loop));
+	memset(m_Sections, 0, sizeof(m_Sections));
+	for (uint8_t i=0; i<c_MaxSections; ++i)
+		m_Names[i] = NULL;
+}
+
+void Profiler::SetName(uint8_t section, const char* name)
+{
+	if (section >= c_MaxSections)
+		return;
+
+	m_Names[section] = name;
+	m_SectionCount = max(m_SectionCount, (uint8_t)(section + 1));
+}
+
+void Profiler::Add(uint8_t section, uint32_t duration)
+{
+	if (section >= c_MaxSections)
+		return;
+
+	add(m_Sections[section], duration);
+	m_SectionCount = max(m_SectionCount, (uint8_t)(section + 1));
+}
+
+void Profiler::loop()
+{
+	const uint32_t now = micros();
+	if (m_LastLoop)
+		add(m_Loop, now - m_LastLoop);
+	m_LastLoop = now;
+}
+
+uint32_t Profiler::GetMaxLoopTime() const
+{
+	return m_Loop.max;
+}
+
+void Profiler::add(Section& section, uint32_t duration)
+{
+	if (!section.count || duration < section.min)
+		section.min = duration;
+	section.max = max(section.max, duration);
+
+	// halve rather than overflow
+	duration = min(duration, c_MaxTotal);
+	if (section.total > c_MaxTotal - duration)
+	{
+		section.count >>= 1;
+		section.total >>= 1;
+	}
+	++section.count;
+	section.total += duration;
+
+	const uint8_t index = bucket(duration);
+	if (section.buckets[index] == c_MaxBucket)
+	{
+		for (uint8_t i=0; i<c_BucketCount; ++i)
+			section.buckets[i] >>= 1;
+	}
+	++section.buckets[index];
+}
+
+uint8_t Profiler::bucket(uint32_t duration)
+{
+	uint8_t bits = 0;
+	while (duration)
+	{
+		duration >>= 1;
+		++bits;
+	}
+	return (bits <= c_FirstBucketBits ? 0 : min((uint8_t)(bits - c_FirstBucketBits), (uint8_t)(c_BucketCount - 1)));
+}
+
+uint8_t Profiler::nameLength(const char* name)
+{
+	return (name ? (uint8_t)min(strlen_P(name), (size_t)0xFF) : 0);
+}
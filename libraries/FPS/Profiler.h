@@ -0,0 +1,156 @@
+#ifndef _PROFILER_H
+#define _PROFILER_H
+
+#include <Core.h>
+#include <CRC.h>
+
+// Where the loop's time goes, in fixed RAM.
+//
+// Each section (a Scheduler task, or a ProfileScope around any bit of code) keeps its
+// count, min, max and total time in us, and a histogram with a bucket per power of two:
+// bucket 0 is under 8 us, bucket n is 2^(n+2) to 2^(n+3) us, and the last one takes
+// everything longer. Call loop() once a pass and it keeps the same for the passes
+// themselves, so the worst case latency of anything polled once a pass is the max there.
+// Rather than overflow, the count and total are halved together, and so are the
+// histogram's buckets, so the means and the shape of the histogram stay right however
+// long it's been running.
+//
+// Dump() writes everything out as one binary frame, for tools/ProfileDump to decode out
+// of the log:
+//   0xA5 0x5A 'P', uint16 payload length, payload, uint32 CRC32 of the payload
+// where the payload is, all little endian:
+//   uint8 version, uint32 now (ms), uint8 section count, uint8 bucket count,
+//   the loop's section, then each section's uint8 name length, name and section,
+// and a section is uint32 min, max, total (us), count, uint8 buckets[bucket count].
+class Profiler
+{
+public:
+	static const uint8_t c_MaxSections = 8;
+	static const uint8_t c_BucketCount = 16;
+	static const uint8_t c_Version = 1;
+
+public:
+	Profiler();
+
+	void SetName(uint8_t section, const char* name);   // name in PROGMEM
+	void Add(uint8_t section, uint32_t duration);      // us
+	void loop();
+
+	uint32_t GetMaxLoopTime() const;                   // us
+
+	template <typename TSerial>
+	void Dump(TSerial& serial, uint32_t now) const;
+
+private:
+	struct Section
+	{
+		uint32_t min;
+		uint32_t max;
+		uint32_t total;
+		uint32_t count;
+		uint8_t buckets[c_BucketCount];
+	};
+
+	static void add(Section& section, uint32_t duration);
+	static uint8_t bucket(uint32_t duration);
+	static uint8_t nameLength(const char* name);
+
+	template <typename TSerial>
+	static void write(TSerial& serial, uint32_t* pCRC, const void* data, uint8_t size);
+	template <typename TSerial>
+	static void writeSection(TSerial& serial, uint32_t* pCRC, const Section& section);
+
+private:
+	Section m_Loop;
+	Section m_Sections[c_MaxSections];
+	const char* m_Names[c_MaxSections];
+	uint8_t m_SectionCount;         // one past the highest section used
+	uint32_t m_LastLoop;            // micros() at the last loop()
+};
+
+// Times from its construction to the end of its scope.
+class ProfileScope
+{
+public:
+	ProfileScope(Profiler* pProfiler, uint8_t section) :
+		m_pProfiler(pProfiler),
+		m_Section(section),
+		m_Start(micros())
+	{
+	}
+
+	~ProfileScope()
+	{
+		if (m_pProfiler)
+			m_pProfiler->Add(m_Section, micros() - m_Start);
+	}
+
+private:
+	Profiler* m_pProfiler;
+	uint8_t m_Section;
+	uint32_t m_Start;
+};
+
+template <typename TSerial>
+void Profiler::Dump(TSerial& serial, uint32_t now) const
+{
+	// version, now, section count, bucket count, then the sections
+	const uint16_t sectionSize = 16 + c_BucketCount;
+	uint16_t length = 7 + sectionSize;
+	for (uint8_t i=0; i<m_SectionCount; ++i)
+		length += 1 + nameLength(m_Names[i]) + sectionSize;
+
+	const uint8_t header[] = {0xA5, 0x5A, 'P', (uint8_t)length, (uint8_t)(length >> 8)};
+	for (uint8_t i=0; i<sizeof(header); ++i)
+		serial.write(header[i]);
+
+	uint32_t crc = crc32_init();
+	const uint8_t version = c_Version;
+	const uint8_t sectionCount = m_SectionCount;
+	const uint8_t bucketCount = c_BucketCount;
+	write(serial, &crc, &version, 1);
+	write(serial, &crc, &now, 4);
+	write(serial, &crc, &sectionCount, 1);
+	write(serial, &crc, &bucketCount, 1);
+	writeSection(serial, &crc, m_Loop);
+
+	for (uint8_t i=0; i<m_SectionCount; ++i)
+	{
+		const uint8_t size = nameLength(m_Names[i]);
+		write(serial, &crc, &size, 1);
+		for (uint8_t j=0; j<size; ++j)
+		{
+			const uint8_t c = pgm_read_byte(m_Names[i] + j);
+			write(serial, &crc, &c, 1);
+		}
+		writeSection(serial, &crc, m_Sections[i]);
+	}
+
+	crc = crc32_finish(crc);
+	for (uint8_t i=0; i<4; ++i)
+		serial.write((uint8_t)(crc >> (i * 8)));
+}
+
+template <typename TSerial>
+void Profiler::write(TSerial& serial, uint32_t* pCRC, const void* data, uint8_t size)
+{
+	// AVR's little endian already
+	for (uint8_t i=0; i<size; ++i)
+	{
+		const uint8_t byte = reinterpret_cast<const uint8_t*>(data)[i];
+		serial.write(byte);
+		*pCRC = crc32_update(*pCRC, byte);
+	}
+}
+
+template <typename TSerial>
+void Profiler::writeSection(TSerial& serial, uint32_t* pCRC, const Section& section)
+{
+	write(serial, pCRC, &section.min, 4);
+	write(serial, pCRC, &section.max, 4);
+	write(serial, pCRC, &section.total, 4);
+	write(serial, pCRC, &section.count, 4);
+	write(serial, pCRC, section.buckets, c_BucketCount);
+}
+
+#endif
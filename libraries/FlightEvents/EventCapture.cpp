@@ -0,0 +1,94 @@
+#include "EventCapture.h"
+
+EventCapture::EventCapture() :
+	m_LastSampleTime(0),
+	m_Triggered(false),
+	m_WindowStart(0),
+	m_Next(0),
+	m_Unread(0),
+	m_Fresh(0),
+	m_Dropped(0)
+{
+	m_Config.sampleInterval = 40;
+	m_Config.window = 10000;
+}
+
+void EventCapture::setup(const Config& config)
+{
+	m_Config = config;
+}
+
+bool EventCapture::IsSampleDue(uint32_t now) const
+{
+	return now - m_LastSampleTime >= m_Config.sampleInterval;
+}
+
+void EventCapture::AddSample(uint32_t now, const Sample& sample)
+{
+	m_LastSampleTime = now;
+
+	const bool windowOpen = isWindowOpen(now);
+	if (!windowOpen && m_Unread > 0)
+		return;
+
+	m_Samples[m_Next] = sample;
+	if (++m_Next == c_SampleCount)
+		m_Next = 0;
+
+	if (!windowOpen)
+	{
+		if (m_Fresh < c_SampleCount)
+			++m_Fresh;
+		return;
+	}
+
+	// that was the oldest unread sample we just overwrote
+	if (m_Unread == c_SampleCount)
+		++m_Dropped;
+	else
+		++m_Unread;
+}
+
+void EventCapture::Trigger(uint32_t now)
+{
+	// everything since the last capture is part of this one too
+	if (!isWindowOpen(now) && m_Unread == 0)
+		m_Unread = m_Fresh;
+	m_Fresh = 0;
+
+	m_Triggered = true;
+	m_WindowStart = now;
+}
+
+bool EventCapture::IsCapturing(uint32_t now) const
+{
+	return m_Unread > 0 || isWindowOpen(now);
+}
+
+bool EventCapture::Read(Sample* pSample)
+{
+	if (m_Unread == 0)
+		return false;
+
+	int16_t index = (int16_t)m_Next - m_Unread;
+	if (index < 0)
+		index += c_SampleCount;
+	*pSample = m_Samples[index];
+	--m_Unread;
+	return true;
+}
+
+uint16_t EventCapture::GetDroppedCount() const
+{
+	return m_Dropped;
+}
+
+uint32_t EventCapture::GetSampleTime(uint32_t now, const Sample& sample)
+{
+	return now - (uint16_t)((uint16_t)now - sample.time);
+}
+
+bool EventCapture::isWindowOpen(uint32_t now) const
+{
+	return m_Triggered && now - m_WindowStart < m_Config.window;
+}
@@ -0,0 +1,66 @@
+#ifndef _EVENT_CAPTURE_H
+#define _EVENT_CAPTURE_H
+
+#include <Core.h>
+
+// Keeps the latest high rate IMU samples, so there's something from before an event when
+// it's detected.
+//
+// Samples go into a ring buffer all the time, overwriting the oldest. A Trigger() opens a
+// capture window: everything in the buffer, and every sample until the window closes, is
+// then handed back by Read(), oldest first, for the logger to write out at its own pace.
+// Another trigger while capturing just stretches the window. If the logger falls a whole
+// buffer behind, the oldest unread samples are lost, and counted. Sampling stops while
+// the last of a capture is read out after its window closes, so nothing's read twice.
+class EventCapture
+{
+public:
+	static const uint8_t c_SampleCount = 24;
+
+	struct Config
+	{
+		uint16_t sampleInterval;  // ms
+		uint16_t window;          // ms, how long to capture for after the latest trigger
+	};
+
+	struct Sample
+	{
+		uint16_t time;            // ms, the bottom 16 bits of millis()
+		int16_t accel[3];         // raw
+		int16_t gyro[3];          // raw
+		int16_t ascentRate;       // cm/s
+	};
+
+public:
+	EventCapture();
+	void setup(const Config& config);
+
+	bool IsSampleDue(uint32_t now) const;
+	void AddSample(uint32_t now, const Sample& sample);
+
+	void Trigger(uint32_t now);
+	bool IsCapturing(uint32_t now) const;     // the window's open, or there are samples still to read
+	bool Read(Sample* pSample);
+
+	uint16_t GetDroppedCount() const;
+
+	// the full millis() of a sample from the last minute or so
+	static uint32_t GetSampleTime(uint32_t now, const Sample& sample);
+
+private:
+	bool isWindowOpen(uint32_t now) const;
+
+private:
+	Config m_Config;
+	uint32_t m_LastSampleTime;
+	bool m_Triggered;
+	uint32_t m_WindowStart;   // ms, of the latest trigger
+
+	Sample m_Samples[c_SampleCount];
+	uint8_t m_Next;           // where the next sample will go
+	uint8_t m_Unread;         // the newest samples that are still to be read
+	uint8_t m_Fresh;          // the newest ones since the last capture, for the next one to start with
+	uint16_t m_Dropped;
+};
+
+#endif
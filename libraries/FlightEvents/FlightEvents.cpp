@@ -0,0 +1,188 @@
+#include "FlightEvents.h"
+
+namespace
+{
+	const int32_t c_LaunchSpeed     = 1000;     // mm/s up, for c_LaunchHold, and it's been launched
+	const uint16_t c_LaunchHold     = 5000;     // ms
+
+	const int32_t c_BurstTrend      = 1500;     // ppm/s, ~10 m/s down
+	const int32_t c_BurstSpeed      = 5000;     // mm/s down, so a gust doesn't look like a burst on its own
+	const uint16_t c_BurstHold      = 500;      // ms
+	const int32_t c_ApogeeDrop      = 100000;   // mm below the highest point, for flights that come down without bursting
+
+	const int32_t c_LandedSpeed     = 1000;     // mm/s either way, and the pressure steady, for c_LandedHold
+	const int32_t c_LandedTrend     = 150;      // ppm/s
+	const uint16_t c_LandedHold     = 5000;     // ms
+
+	const uint8_t c_FreeFallTenths  = 3;        // g, below this it's falling freely
+	const uint8_t c_RearmTenths     = 6;        // g, and above this it's stopped
+	const uint16_t c_FreeFallHold   = 100;      // ms
+
+	const uint16_t c_TrendInterval  = 500;      // ms, between the readings the pressure trend is measured across
+	const uint16_t c_MaxTrendAge    = 3000;     // ms, older than this and it's stale
+
+	// whether condition has held for hold ms
+	bool Held(bool condition, uint32_t now, uint32_t* pSince, uint16_t hold)
+	{
+		if (!condition)
+		{
+			*pSince = now;
+			return false;
+		}
+		return now - *pSince >= hold;
+	}
+
+	uint32_t SquaredTenthsOfG(uint8_t tenths, uint16_t accelPerG)
+	{
+		const uint32_t accel = (uint32_t)tenths * accelPerG / 10;
+		return accel * accel;
+	}
+}
+
+FlightEvents::FlightEvents() :
+	m_FreeFallSquared(0),
+	m_RearmSquared(0),
+	m_Phase(EPhase::Ground),
+	m_HoldSince(0),
+	m_MaxAltitude(0),
+	m_HasPressure(false),
+	m_TrendTime(0),
+	m_TrendPressure(0),
+	m_PressureTrend(0),
+	m_FreeFall(false),
+	m_FreeFallSince(0)
+{
+}
+
+void FlightEvents::setup(const Config& config)
+{
+	m_FreeFallSquared = SquaredTenthsOfG(c_FreeFallTenths, config.accelPerG);
+	m_RearmSquared = SquaredTenthsOfG(c_RearmTenths, config.accelPerG);
+}
+
+void FlightEvents::UpdatePressure(uint32_t time, int32_t pressure)
+{
+	if (pressure <= 0)
+		return;
+
+	if (!m_HasPressure || time - m_TrendTime > c_MaxTrendAge)
+	{
+		m_HasPressure = true;
+		m_TrendTime = time;
+		m_TrendPressure = pressure;
+		m_PressureTrend = 0;
+		return;
+	}
+
+	const uint32_t dt = time - m_TrendTime;
+	if (dt < c_TrendInterval)
+		return;
+
+	// a couple of times a second, so float's fine here
+	m_PressureTrend = (int32_t)((float)(pressure - m_TrendPressure) * 1.0e9f / ((float)m_TrendPressure * dt));
+	m_TrendTime = time;
+	m_TrendPressure = pressure;
+}
+
+FlightEvents::EEvent::Enum FlightEvents::Update(uint32_t now, int32_t altitude, int32_t velocity, int16_t accelX, int16_t accelY, int16_t accelZ)
+{
+	if (m_HasPressure && now - m_TrendTime > c_MaxTrendAge)
+	{
+		m_HasPressure = false;
+		m_PressureTrend = 0;
+	}
+
+	const EEvent::Enum event = updatePhase(now, altitude, velocity);
+	if (event != EEvent::None)
+		return event;
+
+	const uint32_t accelSquared = (uint32_t)((int32_t)accelX * accelX) + (uint32_t)((int32_t)accelY * accelY) + (uint32_t)((int32_t)accelZ * accelZ);
+	return updateFreeFall(now, accelSquared);
+}
+
+FlightEvents::EEvent::Enum FlightEvents::updatePhase(uint32_t now, int32_t altitude, int32_t velocity)
+{
+	switch (m_Phase)
+	{
+	case EPhase::Ground:
+		m_MaxAltitude = altitude;
+		if (Held(velocity > c_LaunchSpeed, now, &m_HoldSince, c_LaunchHold))
+		{
+			m_Phase = EPhase::Ascent;
+			m_HoldSince = now;
+		}
+		break;
+
+	case EPhase::Ascent:
+		m_MaxAltitude = max(m_MaxAltitude, altitude);
+		if (Held(m_PressureTrend > c_BurstTrend && velocity < -c_BurstSpeed, now, &m_HoldSince, c_BurstHold))
+		{
+			m_Phase = EPhase::Descent;
+			m_HoldSince = now;
+			return EEvent::Burst;
+		}
+		if (m_MaxAltitude - altitude > c_ApogeeDrop)
+		{
+			m_Phase = EPhase::Descent;
+			m_HoldSince = now;
+			return EEvent::Apogee;
+		}
+		break;
+
+	case EPhase::Descent:
+		if (Held(abs(velocity) < c_LandedSpeed && abs(m_PressureTrend) < c_LandedTrend, now, &m_HoldSince, c_LandedHold))
+		{
+			m_Phase = EPhase::Landed;
+			return EEvent::Landing;
+		}
+		break;
+
+	default:
+		break;
+	}
+	return EEvent::None;
+}
+
+FlightEvents::EEvent::Enum FlightEvents::updateFreeFall(uint32_t now, uint32_t accelSquared)
+{
+	if (accelSquared >= m_FreeFallSquared)
+	{
+		m_FreeFallSince = now;
+		if (accelSquared > m_RearmSquared)
+			m_FreeFall = false;
+		return EEvent::None;
+	}
+
+	if (m_FreeFall || now - m_FreeFallSince < c_FreeFallHold)
+		return EEvent::None;
+
+	m_FreeFall = true;
+	return EEvent::FreeFall;
+}
+
+FlightEvents::EPhase::Enum FlightEvents::GetPhase() const
+{
+	return m_Phase;
+}
+
+int32_t FlightEvents::GetPressureTrend() const
+{
+	return m_PressureTrend;
+}
+
+int32_t FlightEvents::GetMaxAltitude() const
+{
+	return m_MaxAltitude;
+}
+
+const char* FlightEvents::GetName(EEvent::Enum event)
+{
+	switch (event)
+	{
+	case EEvent::Burst:    return "burst";
+	case EEvent::Apogee:   return "apogee";
+	case EEvent::FreeFall: return "freeFall";
+	case EEvent::Landing:  return "landing";
+	default:               return "none";
+	}
+}
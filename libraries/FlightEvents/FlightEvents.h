@@ -0,0 +1,64 @@
+#ifndef _FLIGHT_EVENTS_H
+#define _FLIGHT_EVENTS_H
+
+#include <Core.h>
+
+// Spots the moments of a flight worth recording in detail: burst, apogee, free fall and landing.
+//
+// Follows the flight through its phases (on the ground, ascending, descending, landed)
+// from the altitude filter's vertical velocity and the trend of the raw pressure, which
+// reacts to a burst without waiting on the filter. The pressure trend is in ppm/s, so
+// the same thresholds work at any altitude: ~1000 ppm/s is ~7 m/s vertically. A flight
+// that comes down without bursting (a slow leak, or a cut down from float) reports
+// apogee instead, once it's clearly below its highest point. Free fall is watched for in
+// every phase, from the accelerometer alone, and is reported each time it starts; the
+// others are reported once each, from the Update() where they're detected.
+class FlightEvents
+{
+public:
+	struct EPhase { enum Enum { Ground, Ascent, Descent, Landed, EnumCount }; };
+	struct EEvent { enum Enum { None, Burst, Apogee, FreeFall, Landing, EnumCount }; };
+
+	struct Config
+	{
+		uint16_t accelPerG;    // accelerometer LSBs per g
+	};
+
+public:
+	FlightEvents();
+	void setup(const Config& config);
+
+	// time in ms, pressure in Pa, each time there's a new reading
+	void UpdatePressure(uint32_t time, int32_t pressure);
+
+	// every loop; altitude in mm, vertical velocity in mm/s, raw acceleration
+	EEvent::Enum Update(uint32_t now, int32_t altitude, int32_t velocity, int16_t accelX, int16_t accelY, int16_t accelZ);
+
+	EPhase::Enum GetPhase() const;
+	int32_t GetPressureTrend() const;     // ppm/s, positive when falling
+	int32_t GetMaxAltitude() const;       // mm
+
+	static const char* GetName(EEvent::Enum event);
+
+private:
+	EEvent::Enum updatePhase(uint32_t now, int32_t altitude, int32_t velocity);
+	EEvent::Enum updateFreeFall(uint32_t now, uint32_t accelSquared);
+
+private:
+	uint32_t m_FreeFallSquared;   // LSB^2, below this much acceleration it's falling freely
+	uint32_t m_RearmSquared;      // LSB^2, and above this it's stopped
+
+	EPhase::Enum m_Phase;
+	uint32_t m_HoldSince;         // ms, when the condition for leaving this phase became true
+	int32_t m_MaxAltitude;
+
+	bool m_HasPressure;
+	uint32_t m_TrendTime;         // ms, of the older reading the trend is measured from
+	int32_t m_TrendPressure;
+	int32_t m_PressureTrend;
+
+	bool m_FreeFall;
+	uint32_t m_FreeFallSince;
+};
+
+#endif
@@ -0,0 +1,34 @@
+#ifndef _FLASH_DEVICE_H
+#define _FLASH_DEVICE_H
+
+#include <Core.h>
+
+// NOR flash as FlightRecorder sees it, so the same log code runs on the SPI chip and on a
+// file on a PC (tools/Common/FileFlash).
+//
+// Programming can only clear bits, and only erasing a whole sector sets them back to 1s.
+// Program() and EraseSector() just start the operation and return; nothing else can be
+// done to the device until IsBusy() says it's finished, except that an erase can be
+// suspended: then it's not busy, and anywhere outside the sector being erased can be read
+// or programmed until ResumeErase() carries on with it. Another erase can't be started
+// meanwhile, and suspending or resuming when there's no erase to do it to does nothing.
+class FlashDevice
+{
+public:
+	static const uint16_t c_PageSize = 256;       // the most one Program() can write, and it can't cross a page
+	static const uint16_t c_SectorSize = 4096;    // the least that can be erased
+
+public:
+	virtual ~FlashDevice() {}
+
+	virtual uint32_t GetSize() = 0;               // in bytes, a whole number of sectors
+	virtual bool IsBusy() = 0;
+
+	virtual void Read(uint32_t address, uint8_t* pData, uint16_t size) = 0;
+	virtual void Program(uint32_t address, const uint8_t* pData, uint16_t size) = 0;
+	virtual void EraseSector(uint32_t address) = 0;
+	virtual void SuspendErase() = 0;              // returns once the device has stopped
+	virtual void ResumeErase() = 0;
+};
+
+#endif
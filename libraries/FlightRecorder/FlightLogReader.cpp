@@ -0,0 +1,138 @@
+#include "FlightLogReader.h"
+#include <CRC.h>
+
+FlightLogReader::FlightLogReader(FlashDevice* pDevice) :
+	m_pDevice(pDevice),
+	m_DeviceSectors((uint16_t)min(pDevice->GetSize() / FlashDevice::c_SectorSize, (uint32_t)0xFFFF)),
+	m_FirstSector(0),
+	m_FirstSequence(0),
+	m_LogSectors(0),
+	m_SectorIndex(0),
+	m_Page(0),
+	m_PageLoaded(false),
+	m_PageState(EPageState::Open),
+	m_Offset(0),
+	m_End(0)
+{
+}
+
+bool FlightLogReader::Rewind()
+{
+	m_LogSectors = 0;
+	m_SectorIndex = 0;
+	m_Page = 0;
+	m_PageLoaded = false;
+
+	// the oldest sector's the one with the lowest sequence number
+	bool found = false;
+	FlightRecorder::SectorHeader header;
+	for (uint16_t i=0; i<m_DeviceSectors; ++i)
+	{
+		if (readSector(i, &header) && (!found || header.sequence < m_FirstSequence))
+		{
+			found = true;
+			m_FirstSector = i;
+			m_FirstSequence = header.sequence;
+		}
+	}
+	if (!found)
+		return false;
+
+	// and the log carries on for as long as they count up
+	for (m_LogSectors=1; m_LogSectors<m_DeviceSectors; ++m_LogSectors)
+	{
+		const uint16_t sector = (m_FirstSector + m_LogSectors) % m_DeviceSectors;
+		if (!readSector(sector, &header) || header.sequence != m_FirstSequence + m_LogSectors)
+			break;
+	}
+	return true;
+}
+
+bool FlightLogReader::Next(Record* pRecord)
+{
+	while (m_SectorIndex < m_LogSectors)
+	{
+		if (!m_PageLoaded)
+			loadPage();
+
+		if (m_Offset + 2 <= m_End)
+		{
+			const uint8_t size = m_Data[m_Offset];
+			if (size != 0xFF && size <= sizeof(pRecord->data) && m_Offset + 2 + size <= m_End)
+			{
+				pRecord->sequence = m_FirstSequence + m_SectorIndex;
+				pRecord->page = m_Page;
+				pRecord->pageState = m_PageState;
+				pRecord->type = m_Data[m_Offset + 1];
+				pRecord->size = size;
+				memcpy(pRecord->data, m_Data + m_Offset + 2, size);
+				m_Offset += 2 + size;
+				return true;
+			}
+		}
+
+		// on to the next page, and sector
+		m_PageLoaded = false;
+		if (++m_Page == FlightRecorder::c_PagesPerSector)
+		{
+			m_Page = 0;
+			++m_SectorIndex;
+		}
+	}
+	return false;
+}
+
+uint16_t FlightLogReader::GetSectorCount() const
+{
+	return m_LogSectors;
+}
+
+uint32_t FlightLogReader::GetFirstSequence() const
+{
+	return m_FirstSequence;
+}
+
+const char* FlightLogReader::GetPageStateName(EPageState::Enum state)
+{
+	switch (state)
+	{
+	case EPageState::Verified:  return "verified";
+	case EPageState::Recovered: return "recovered";
+	case EPageState::Corrupt:   return "corrupt";
+	case EPageState::Open:      return "open";
+	}
+	return "";
+}
+
+bool FlightLogReader::readSector(uint16_t sector, FlightRecorder::SectorHeader* pHeader)
+{
+	m_pDevice->Read((uint32_t)sector * FlashDevice::c_SectorSize, (uint8_t*)pHeader, sizeof(*pHeader));
+	return FlightRecorder::IsHeaderValid(*pHeader);
+}
+
+void FlightLogReader::loadPage()
+{
+	const uint16_t sector = (m_FirstSector + m_SectorIndex) % m_DeviceSectors;
+	m_pDevice->Read((uint32_t)sector * FlashDevice::c_SectorSize + (uint32_t)m_Page * FlashDevice::c_PageSize, m_Data, sizeof(m_Data));
+	m_PageLoaded = true;
+	m_Offset = FlightRecorder::GetPageDataStart(m_Page);
+
+	FlightRecorder::PageTrailer trailer;
+	memcpy(&trailer, m_Data + FlightRecorder::c_PageDataEnd, sizeof(trailer));
+	if (trailer.end == 0xFFFF)
+	{
+		// its records run up to the first size byte that's still erased
+		m_PageState = EPageState::Open;
+		m_End = FlightRecorder::c_PageDataEnd;
+		return;
+	}
+
+	m_End = min(trailer.end, FlightRecorder::c_PageDataEnd);
+	const uint32_t crc = (m_End >= m_Offset ? crc32(m_Data + m_Offset, m_End - m_Offset) : 0);
+	if (crc != trailer.crc)
+		m_PageState = EPageState::Corrupt;
+	else if (trailer.flags & FlightRecorder::EPageFlags::Recovered)
+		m_PageState = EPageState::Recovered;
+	else
+		m_PageState = EPageState::Verified;
+}
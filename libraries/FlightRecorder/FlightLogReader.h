@@ -0,0 +1,71 @@
+#ifndef _FLIGHT_LOG_READER_H
+#define _FLIGHT_LOG_READER_H
+
+#include <Core.h>
+#include "FlashDevice.h"
+#include "FlightRecorder.h"
+
+// Reads a FlightRecorder's log back, oldest record first.
+//
+// The log runs from the sector with the lowest sequence number round through the
+// following ones for as long as their sequence numbers count up by one. Each record says
+// how far it can be trusted by its page's state: a sealed page's records have been checked
+// against its CRC, and the page the recorder was writing when it stopped hasn't been
+// sealed, so its records can't be. Reads a page at a time, so it's meant for a PC.
+class FlightLogReader
+{
+public:
+	struct EPageState
+	{
+		enum Enum
+		{
+			Verified,       // sealed, and the CRC matches
+			Recovered,      // sealed after the power went, and the CRC matches
+			Corrupt,        // sealed, but the CRC doesn't match
+			Open,           // still being written
+		};
+	};
+
+	struct Record
+	{
+		uint32_t sequence;              // the sector's
+		uint8_t page;
+		EPageState::Enum pageState;
+		uint8_t type;
+		uint8_t size;
+		uint8_t data[FlightRecorder::c_MaxRecordSize - 2];
+	};
+
+public:
+	FlightLogReader(FlashDevice* pDevice);
+
+	bool Rewind();                      // back to the oldest record, false if there's no log
+	bool Next(Record* pRecord);         // false at the end of the log
+
+	uint16_t GetSectorCount() const;    // in the log, found by Rewind()
+	uint32_t GetFirstSequence() const;
+
+	static const char* GetPageStateName(EPageState::Enum state);
+
+private:
+	bool readSector(uint16_t sector, FlightRecorder::SectorHeader* pHeader);
+	void loadPage();
+
+private:
+	FlashDevice* m_pDevice;
+	uint16_t m_DeviceSectors;
+
+	uint16_t m_FirstSector;
+	uint32_t m_FirstSequence;
+	uint16_t m_LogSectors;
+
+	uint16_t m_SectorIndex;             // from the first
+	uint8_t m_Page;
+	bool m_PageLoaded;
+	EPageState::Enum m_PageState;
+	uint16_t m_Offset;
+	uint16_t m_End;
+	uint8_t m_Data[FlashDevice::c_PageSize];
+};
+
+#endif
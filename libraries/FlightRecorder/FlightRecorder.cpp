@@ -0,0 +1,399 @@
+#include "FlightRecorder.h"
+#include <CRC.h>
+
+namespace
+{
+	const uint8_t c_ReadChunk = 16;     // bytes, when setup() checks over a page
+}
+
+FlightRecorder::FlightRecorder() :
+	m_pDevice(NULL),
+	m_State(EState::Off),
+	m_SectorCount(0),
+	m_Sector(0),
+	m_Page(0),
+	m_Offset(0),
+	m_PageCRC(0),
+	m_Sequence(0),
+	m_EraseCount(0),
+	m_EraseAhead(EEraseAhead::Idle),
+	m_NextEraseCount(0),
+	m_QueueHead(0),
+	m_QueueTail(0),
+	m_QueuePeak(0),
+	m_RecordCount(0),
+	m_DroppedCount(0),
+	m_RecoveredCount(0)
+{
+}
+
+bool FlightRecorder::setup(FlashDevice* pDevice)
+{
+	m_pDevice = pDevice;
+	m_State = EState::Off;
+	m_EraseAhead = EEraseAhead::Idle;
+	m_QueueHead = m_QueueTail = 0;
+
+	m_SectorCount = (uint16_t)min(pDevice->GetSize() / FlashDevice::c_SectorSize, (uint32_t)0xFFFF);
+	if (m_SectorCount < 2)
+		return false;
+
+	// the chip stays suspended through the app resetting, and won't start another erase till it's resumed
+	m_pDevice->ResumeErase();
+	waitWhileBusy();
+
+	// the end of the log's in the sector with the highest sequence number
+	bool found = false;
+	for (uint16_t i=0; i<m_SectorCount; ++i)
+	{
+		SectorHeader header;
+		m_pDevice->Read(getSectorAddress(i), (uint8_t*)&header, sizeof(header));
+		if (IsHeaderValid(header) && (!found || header.sequence > m_Sequence))
+		{
+			found = true;
+			m_Sector = i;
+			m_Sequence = header.sequence;
+			m_EraseCount = header.eraseCount;
+		}
+	}
+
+	if (!found)
+	{
+		m_Sequence = 0;
+		m_EraseCount = 1;
+		startSector(0);
+		waitWhileBusy();
+		return true;
+	}
+
+	// then in its first page that hasn't been sealed
+	for (m_Page=0; m_Page<c_PagesPerSector; ++m_Page)
+	{
+		PageTrailer trailer;
+		m_pDevice->Read(getPageAddress() + c_PageDataEnd, (uint8_t*)&trailer, sizeof(trailer));
+		if (isErased((const uint8_t*)&trailer, sizeof(trailer)) && recoverPage(GetPageDataStart(m_Page)))
+		{
+			m_State = EState::Writing;
+			return true;
+		}
+	}
+
+	// there's nothing erased ahead yet, so get that out of the way before the records start
+	startSector((m_Sector + 1) % m_SectorCount);
+	waitWhileBusy();
+	return true;
+}
+
+void FlightRecorder::loop()
+{
+	if (m_State == EState::Off)
+		return;
+
+	// put the erase ahead aside while there's a record to write
+	if (m_EraseAhead == EEraseAhead::Erasing)
+	{
+		if (!m_pDevice->IsBusy())
+		{
+			m_EraseAhead = EEraseAhead::Erased;
+		}
+		else if (m_QueueHead != m_QueueTail && m_Page < c_PagesPerSector)
+		{
+			m_pDevice->SuspendErase();
+			m_EraseAhead = EEraseAhead::Suspended;
+		}
+		else
+		{
+			return;
+		}
+	}
+
+	if (m_pDevice->IsBusy())
+		return;
+
+	if (m_State == EState::Erasing)
+	{
+		SectorHeader header;
+		header.magic = c_Magic;
+		header.version = c_Version;
+		header.reserved = 0xFF;
+		header.sequence = ++m_Sequence;
+		header.eraseCount = m_EraseCount;
+		header.crc = crc32((const uint8_t*)&header, sizeof(header) - sizeof(header.crc));
+		m_pDevice->Program(getSectorAddress(m_Sector), (const uint8_t*)&header, sizeof(header));
+
+		m_State = EState::Writing;
+		m_Page = 0;
+		m_Offset = sizeof(SectorHeader);
+		m_PageCRC = crc32_init();
+		return;
+	}
+
+	// nothing can go in this sector till the next one's ready, or on with the erase ahead while there's nothing to write
+	if (m_Page == c_PagesPerSector || m_QueueHead == m_QueueTail)
+	{
+		if (m_EraseAhead == EEraseAhead::Suspended)
+		{
+			m_pDevice->ResumeErase();
+			m_EraseAhead = EEraseAhead::Erasing;
+		}
+		else if (m_Page == c_PagesPerSector)
+		{
+			startSector((m_Sector + 1) % m_SectorCount);
+		}
+		else if (m_EraseAhead == EEraseAhead::Idle)
+		{
+			eraseAhead();
+		}
+		return;
+	}
+
+	// seal the page once the next record won't fit in it
+	const uint8_t size = m_Queue[m_QueueTail] + 2;
+	if (m_Offset + size > c_PageDataEnd)
+	{
+		sealPage(m_Offset, 0, crc32_finish(m_PageCRC));
+		++m_Page;
+		m_Offset = 0;
+		m_PageCRC = crc32_init();
+		return;
+	}
+
+	uint8_t record[c_MaxRecordSize];
+	for (uint8_t i=0; i<size; ++i)
+	{
+		record[i] = m_Queue[m_QueueTail++];
+		m_PageCRC = crc32_update(m_PageCRC, record[i]);
+	}
+	m_pDevice->Program(getPageAddress() + m_Offset, record, size);
+	m_Offset += size;
+	++m_RecordCount;
+}
+
+bool FlightRecorder::IsWriting() const
+{
+	return m_State != EState::Off;
+}
+
+bool FlightRecorder::Append(uint8_t type, const void* pData, uint8_t size)
+{
+	if (m_State == EState::Off)
+		return false;
+
+	const uint8_t used = m_QueueHead - m_QueueTail;
+	if (size > c_MaxRecordSize - 2 || used + size + 2 >= c_QueueSize)
+	{
+		++m_DroppedCount;
+		return false;
+	}
+
+	m_Queue[m_QueueHead++] = size;
+	m_Queue[m_QueueHead++] = type;
+	const uint8_t* pBytes = (const uint8_t*)pData;
+	for (uint8_t i=0; i<size; ++i)
+		m_Queue[m_QueueHead++] = pBytes[i];
+
+	m_QueuePeak = max(m_QueuePeak, (uint8_t)(m_QueueHead - m_QueueTail));
+	return true;
+}
+
+uint32_t FlightRecorder::GetSequence() const
+{
+	return m_Sequence;
+}
+
+uint32_t FlightRecorder::GetEraseCount() const
+{
+	return m_EraseCount;
+}
+
+uint32_t FlightRecorder::GetRecordCount() const
+{
+	return m_RecordCount;
+}
+
+uint16_t FlightRecorder::GetDroppedCount() const
+{
+	return m_DroppedCount;
+}
+
+uint8_t FlightRecorder::GetQueuePeak() const
+{
+	return m_QueuePeak;
+}
+
+uint8_t FlightRecorder::GetRecoveredCount() const
+{
+	return m_RecoveredCount;
+}
+
+uint32_t FlightRecorder::GetOldestPosition() const
+{
+	// the sector after the head gets erased next
+	const uint32_t head = getHeadSequence();
+	const uint32_t oldest = (head > (uint32_t)m_SectorCount - 2 ? head - (m_SectorCount - 2) : 1);
+	return oldest * FlashDevice::c_SectorSize;
+}
+
+uint32_t FlightRecorder::GetSealedPosition() const
+{
+	if (m_State == EState::Off)
+		return 0;
+	if (m_State == EState::Erasing)
+		return getHeadSequence() * FlashDevice::c_SectorSize;
+	return m_Sequence * FlashDevice::c_SectorSize + (uint32_t)m_Page * FlashDevice::c_PageSize;
+}
+
+bool FlightRecorder::ReadLog(uint32_t position, uint8_t* pData, uint16_t size)
+{
+	const uint16_t offset = position % FlashDevice::c_SectorSize;
+	if (m_State == EState::Off || position < GetOldestPosition() || position + size > GetSealedPosition() ||
+		offset + size > FlashDevice::c_SectorSize || m_pDevice->IsBusy())
+		return false;
+
+	const uint32_t back = getHeadSequence() - position / FlashDevice::c_SectorSize;
+	const uint16_t sector = (uint16_t)((m_Sector + m_SectorCount - back) % m_SectorCount);
+	m_pDevice->Read(getSectorAddress(sector) + offset, pData, size);
+	return true;
+}
+
+bool FlightRecorder::IsHeaderValid(const SectorHeader& header)
+{
+	return header.magic == c_Magic && header.version == c_Version &&
+		header.crc == crc32((const uint8_t*)&header, sizeof(header) - sizeof(header.crc));
+}
+
+uint16_t FlightRecorder::GetPageDataStart(uint8_t page)
+{
+	return page == 0 ? sizeof(SectorHeader) : 0;
+}
+
+uint32_t FlightRecorder::getSectorAddress(uint16_t sector) const
+{
+	return (uint32_t)sector * FlashDevice::c_SectorSize;
+}
+
+// the sequence number of m_Sector, which it won't have in its header yet while it's being erased
+uint32_t FlightRecorder::getHeadSequence() const
+{
+	return m_State == EState::Erasing ? m_Sequence + 1 : m_Sequence;
+}
+
+uint32_t FlightRecorder::getPageAddress() const
+{
+	return getSectorAddress(m_Sector) + (uint32_t)m_Page * FlashDevice::c_PageSize;
+}
+
+void FlightRecorder::startSector(uint16_t sector)
+{
+	m_Sector = sector;
+	m_Page = 0;
+
+	m_State = EState::Erasing;
+
+	// it's usually been erased ahead, and the header can go straight on
+	if (m_EraseAhead == EEraseAhead::Erased)
+	{
+		m_EraseCount = m_NextEraseCount;
+		m_EraseAhead = EEraseAhead::Idle;
+		return;
+	}
+
+	m_EraseCount = getNextEraseCount(sector);
+	m_EraseAhead = EEraseAhead::Idle;
+	m_pDevice->EraseSector(getSectorAddress(sector));
+}
+
+void FlightRecorder::eraseAhead()
+{
+	const uint16_t next = (m_Sector + 1) % m_SectorCount;
+	m_NextEraseCount = getNextEraseCount(next);
+	m_pDevice->EraseSector(getSectorAddress(next));
+	m_EraseAhead = EEraseAhead::Erasing;
+}
+
+// a sector that's never been used, or lost its header to the power going, counts as the last one's
+uint32_t FlightRecorder::getNextEraseCount(uint16_t sector) const
+{
+	SectorHeader old;
+	m_pDevice->Read(getSectorAddress(sector), (uint8_t*)&old, sizeof(old));
+	return IsHeaderValid(old) ? old.eraseCount + 1 : m_EraseCount;
+}
+
+void FlightRecorder::sealPage(uint16_t end, uint8_t flags, uint32_t crc)
+{
+	PageTrailer trailer;
+	trailer.end = end;
+	trailer.flags = flags;
+	trailer.reserved = 0xFF;
+	trailer.crc = crc;
+	m_pDevice->Program(getPageAddress() + c_PageDataEnd, (const uint8_t*)&trailer, sizeof(trailer));
+}
+
+bool FlightRecorder::recoverPage(uint16_t start)
+{
+	const uint32_t address = getPageAddress();
+
+	// follow the records to the first size that's still erased
+	uint16_t offset = start;
+	uint16_t last = start;
+	while (offset < c_PageDataEnd)
+	{
+		uint8_t size;
+		m_pDevice->Read(address + offset, &size, 1);
+		if (size == 0xFF || offset + 2 + size > c_PageDataEnd)
+			break;
+
+		last = offset;
+		offset += 2 + size;
+	}
+
+	// it can only be carried on with if there's nothing in it, not even a record that didn't get its size written
+	bool erased = true;
+	uint8_t chunk[c_ReadChunk];
+	for (uint16_t i=start; i<c_PageDataEnd && erased; i+=c_ReadChunk)
+	{
+		const uint8_t size = (uint8_t)min((uint16_t)c_ReadChunk, (uint16_t)(c_PageDataEnd - i));
+		m_pDevice->Read(address + i, chunk, size);
+		erased = isErased(chunk, size);
+	}
+
+	if (erased)
+	{
+		m_Offset = start;
+		m_PageCRC = crc32_init();
+		return true;
+	}
+
+	// the power went while it was open, so its last record may only be half there
+	const uint16_t end = (offset > start ? last : start);
+	uint32_t crc = crc32_init();
+	for (uint16_t i=start; i<end; i+=c_ReadChunk)
+	{
+		const uint8_t size = (uint8_t)min((uint16_t)c_ReadChunk, (uint16_t)(end - i));
+		m_pDevice->Read(address + i, chunk, size);
+		for (uint8_t j=0; j<size; ++j)
+			crc = crc32_update(crc, chunk[j]);
+	}
+
+	sealPage(end, EPageFlags::Recovered, crc32_finish(crc));
+	waitWhileBusy();
+	++m_RecoveredCount;
+	return false;
+}
+
+bool FlightRecorder::isErased(const uint8_t* pData, uint8_t size)
+{
+	for (uint8_t i=0; i<size; ++i)
+	{
+		if (pData[i] != 0xFF)
+			return false;
+	}
+	return true;
+}
+
+void FlightRecorder::waitWhileBusy()
+{
+	while (m_pDevice->IsBusy())
+	{
+	}
+}
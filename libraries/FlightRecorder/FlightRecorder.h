@@ -0,0 +1,161 @@
+#ifndef _FLIGHT_RECORDER_H
+#define _FLIGHT_RECORDER_H
+
+#include <Core.h>
+#include "FlashDevice.h"
+
+// An append-only log of binary records in NOR flash, so the flight's data survives the
+// logger or the radio link going.
+//
+// The flash is used as one big ring of 4 KB sectors, written in order and erased just
+// before they're reused, so every sector is erased the same number of times: the wear
+// levels itself. Each sector starts with a header holding its place in the log (a
+// sequence number that only goes up) and how many times it's been erased, with a CRC32,
+// so one that was cut off by the power going is just ignored. Records are packed into
+// its 256 byte pages, none crossing a page, and a page is sealed with a trailer giving
+// where its records end and the CRC32 of them once the next record won't fit.
+//
+// Append() only copies the record into a RAM queue, so it takes the same short time
+// whatever the flash is doing. loop() starts at most one flash operation each call, and
+// only when the last one's finished, so it never waits on the flash either. A sector erase
+// takes 45 ms, or up to 400 ms on a bad day, which is more records than the queue holds,
+// so the sector after the one being written is erased ahead, in the background: loop()
+// suspends the erase whenever there's a record to write and resumes it when the queue's
+// empty, and the erase is spread over the gaps between records. Then the queue only has to
+// cover a page program (~1 ms) and whatever holds up loop(). Records that don't fit in the
+// queue are dropped, and counted.
+//
+// setup() finds where the log got to from the sector headers. If the power went while a
+// page was open, that page is sealed, as recovered, without its last record, which may
+// have been cut off halfway through being programmed, and writing carries on after it. A
+// page whose trailer was cut off is left as it is.
+//
+// FlightLogReader reads the log back, on the balloon or from an image on a PC.
+class FlightRecorder
+{
+public:
+	static const uint16_t c_Magic = 0x5246;          // "FR"
+	static const uint8_t c_Version = 1;
+	static const uint8_t c_MaxRecordSize = 64;       // its size and type bytes and all
+	static const uint16_t c_QueueSize = 256;         // the queue's indices are bytes, that wrap around it
+	static const uint8_t c_PagesPerSector = FlashDevice::c_SectorSize / FlashDevice::c_PageSize;
+
+	struct SectorHeader
+	{
+		uint16_t magic;
+		uint8_t version;
+		uint8_t reserved;
+		uint32_t sequence;          // counts up through the sectors, from 1
+		uint32_t eraseCount;
+		uint32_t crc;               // of everything before it
+	};
+
+	struct PageTrailer
+	{
+		uint16_t end;               // the offset in the page after the last record, 0xFFFF while the page is open
+		uint8_t flags;              // EPageFlags
+		uint8_t reserved;
+		uint32_t crc;               // of the records
+	};
+
+	struct EPageFlags
+	{
+		enum Enum
+		{
+			Recovered = 0x01,       // sealed by setup() after the power went
+		};
+	};
+
+	// records are a size byte (0xFF where there's no record yet), a type byte, then the data
+	static const uint16_t c_PageDataEnd = FlashDevice::c_PageSize - sizeof(PageTrailer);
+
+public:
+	FlightRecorder();
+
+	// finds the end of the log, waiting on the flash while it does; false if there isn't one to use
+	bool setup(FlashDevice* pDevice);
+	void loop();
+
+	bool IsWriting() const;
+
+	// false if it was dropped, with the queue full or the record too big
+	bool Append(uint8_t type, const void* pData, uint8_t size);
+
+	uint32_t GetSequence() const;           // of the sector being written
+	uint32_t GetEraseCount() const;         // of the sector being written
+	uint32_t GetRecordCount() const;        // written since setup()
+	uint16_t GetDroppedCount() const;       // records that didn't fit in the queue
+	uint8_t GetQueuePeak() const;           // bytes
+	uint8_t GetRecoveredCount() const;      // pages setup() had to seal
+
+	// for reading the log back while it's being written, positions in it are a sector's
+	// sequence number * c_SectorSize + the offset in the sector; only sealed pages can be
+	// read, from the oldest sector that isn't about to be erased
+	uint32_t GetOldestPosition() const;
+	uint32_t GetSealedPosition() const;     // the end of the sealed pages
+	// false if that's not in the log, or the flash is busy, which it will be for a while after Append()
+	bool ReadLog(uint32_t position, uint8_t* pData, uint16_t size);
+
+	// whether a sector's header is a good one, for reading back
+	static bool IsHeaderValid(const SectorHeader& header);
+	// the offset in a page where its records start, after the header in a sector's first page
+	static uint16_t GetPageDataStart(uint8_t page);
+
+private:
+	struct EState
+	{
+		enum Enum
+		{
+			Off,
+			Erasing,                // then the header's programmed
+			Writing,
+		};
+	};
+
+	struct EEraseAhead
+	{
+		enum Enum
+		{
+			Idle,
+			Erasing,
+			Suspended,
+			Erased,
+		};
+	};
+
+	uint32_t getSectorAddress(uint16_t sector) const;
+	uint32_t getHeadSequence() const;
+	uint32_t getPageAddress() const;
+	void startSector(uint16_t sector);
+	void eraseAhead();
+	uint32_t getNextEraseCount(uint16_t sector) const;
+	void sealPage(uint16_t end, uint8_t flags, uint32_t crc);
+	bool recoverPage(uint16_t start);
+	void waitWhileBusy();
+	static bool isErased(const uint8_t* pData, uint8_t size);
+
+private:
+	FlashDevice* m_pDevice;
+	EState::Enum m_State;
+	uint16_t m_SectorCount;
+
+	uint16_t m_Sector;
+	uint8_t m_Page;
+	uint16_t m_Offset;                      // in the page, where the next record goes
+	uint32_t m_PageCRC;                     // of the page's records so far, not finished
+	uint32_t m_Sequence;
+	uint32_t m_EraseCount;
+	EEraseAhead::Enum m_EraseAhead;         // of the sector after m_Sector
+	uint32_t m_NextEraseCount;              // its, once erased
+
+	uint8_t m_Queue[c_QueueSize];
+	uint8_t m_QueueHead;
+	uint8_t m_QueueTail;
+	uint8_t m_QueuePeak;
+
+	uint32_t m_RecordCount;
+	uint16_t m_DroppedCount;
+	uint8_t m_RecoveredCount;
+};
+
+#endif
@@ -0,0 +1,164 @@
+#include "SPIFlash.h"
+#include <SPI.h>
+
+namespace
+{
+	const uint8_t c_WriteEnable      = 0x06;
+	const uint8_t c_ReadStatus       = 0x05;
+	const uint8_t c_ReadData         = 0x03;
+	const uint8_t c_PageProgram      = 0x02;
+	const uint8_t c_SectorErase      = 0x20;
+	const uint8_t c_EraseSuspend     = 0x75;
+	const uint8_t c_EraseResume      = 0x7A;
+	const uint8_t c_JEDECID          = 0x9F;
+	const uint8_t c_ReleasePowerDown = 0xAB;
+
+	const uint8_t c_StatusBusy       = 0x01;
+
+	const uint8_t c_SuspendTime      = 20;     // us, the most a suspend takes, and the least after an erase starts or resumes before it can be
+}
+
+SPIFlash::SPIFlash(uint8_t csPin) :
+	m_CSPin(csPin),
+	m_Manufacturer(0),
+	m_DeviceID(0),
+	m_Size(0),
+	m_EraseTime(0)
+{
+}
+
+bool SPIFlash::setup()
+{
+	pinMode(m_CSPin, OUTPUT);
+	deselect();
+
+	SPI.begin();
+	SPI.setBitOrder(MSBFIRST);
+	SPI.setDataMode(SPI_MODE0);
+	SPI.setClockDivider(SPI_CLOCK_DIV2);
+
+	// in case it was left powered down, it takes 3 us to come back
+	select();
+	SPI.transfer(c_ReleasePowerDown);
+	deselect();
+	delayMicroseconds(5);
+
+	select();
+	SPI.transfer(c_JEDECID);
+	m_Manufacturer = SPI.transfer(0);
+	m_DeviceID = (uint16_t)SPI.transfer(0) << 8;
+	m_DeviceID |= SPI.transfer(0);
+	deselect();
+
+	// nothing on the bus reads as all 0s or all 1s; the ID's bottom byte is log2 of the size
+	const uint8_t capacity = (uint8_t)m_DeviceID;
+	if (m_Manufacturer == 0x00 || m_Manufacturer == 0xFF || capacity < 16 || capacity > 24)
+	{
+		m_Size = 0;
+		return false;
+	}
+
+	m_Size = 1ul << capacity;
+	return true;
+}
+
+uint8_t SPIFlash::GetManufacturer() const
+{
+	return m_Manufacturer;
+}
+
+uint16_t SPIFlash::GetDeviceID() const
+{
+	return m_DeviceID;
+}
+
+uint32_t SPIFlash::GetSize()
+{
+	return m_Size;
+}
+
+bool SPIFlash::IsBusy()
+{
+	select();
+	SPI.transfer(c_ReadStatus);
+	const uint8_t status = SPI.transfer(0);
+	deselect();
+	return (status & c_StatusBusy) != 0;
+}
+
+void SPIFlash::Read(uint32_t address, uint8_t* pData, uint16_t size)
+{
+	select();
+	command(c_ReadData, address);
+	for (uint16_t i=0; i<size; ++i)
+		pData[i] = SPI.transfer(0);
+	deselect();
+}
+
+void SPIFlash::Program(uint32_t address, const uint8_t* pData, uint16_t size)
+{
+	writeEnable();
+	select();
+	command(c_PageProgram, address);
+	for (uint16_t i=0; i<size; ++i)
+		SPI.transfer(pData[i]);
+	deselect();
+}
+
+void SPIFlash::EraseSector(uint32_t address)
+{
+	writeEnable();
+	select();
+	command(c_SectorErase, address);
+	deselect();
+	m_EraseTime = micros();
+}
+
+void SPIFlash::SuspendErase()
+{
+	// any sooner and the chip ignores it
+	while (micros() - m_EraseTime < c_SuspendTime)
+	{
+	}
+
+	select();
+	SPI.transfer(c_EraseSuspend);
+	deselect();
+
+	while (IsBusy())
+	{
+	}
+}
+
+void SPIFlash::ResumeErase()
+{
+	select();
+	SPI.transfer(c_EraseResume);
+	deselect();
+	m_EraseTime = micros();
+}
+
+void SPIFlash::select()
+{
+	digitalWrite(m_CSPin, LOW);
+}
+
+void SPIFlash::deselect()
+{
+	digitalWrite(m_CSPin, HIGH);
+}
+
+void SPIFlash::command(uint8_t command, uint32_t address)
+{
+	SPI.transfer(command);
+	SPI.transfer((uint8_t)(address >> 16));
+	SPI.transfer((uint8_t)(address >> 8));
+	SPI.transfer((uint8_t)address);
+}
+
+void SPIFlash::writeEnable()
+{
+	select();
+	SPI.transfer(c_WriteEnable);
+	deselect();
+}
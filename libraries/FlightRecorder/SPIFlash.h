@@ -0,0 +1,43 @@
+#ifndef _SPI_FLASH_H
+#define _SPI_FLASH_H
+
+#include <Core.h>
+#include "FlashDevice.h"
+
+// A JEDEC SPI NOR flash chip with 4 KB sectors and 24-bit addresses, like the Winbond
+// W25Q16 to W25Q128, on the hardware SPI pins (11, 12 and 13 on the 328), at half the
+// CPU clock. The sketch has to include SPI.h.
+class SPIFlash : public FlashDevice
+{
+public:
+	SPIFlash(uint8_t csPin);
+
+	bool setup();                   // false if there's no chip answering
+
+	uint8_t GetManufacturer() const;
+	uint16_t GetDeviceID() const;
+
+	virtual uint32_t GetSize();
+	virtual bool IsBusy();
+
+	virtual void Read(uint32_t address, uint8_t* pData, uint16_t size);
+	virtual void Program(uint32_t address, const uint8_t* pData, uint16_t size);
+	virtual void EraseSector(uint32_t address);
+	virtual void SuspendErase();
+	virtual void ResumeErase();
+
+private:
+	void select();
+	void deselect();
+	void command(uint8_t command, uint32_t address);
+	void writeEnable();
+
+private:
+	uint8_t m_CSPin;
+	uint8_t m_Manufacturer;
+	uint16_t m_DeviceID;
+	uint32_t m_Size;
+	uint32_t m_EraseTime;           // micros() when an erase was last started or resumed
+};
+
+#endif
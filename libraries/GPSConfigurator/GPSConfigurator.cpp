@@ -0,0 +1,488 @@
+#include "GPSConfigurator.h"
+
+const uint32_t c_Bauds[]         = {4800, 9600, 19200, 38400, 57600, 115200};
+
+const char c_MTKACK[]            = "PMTK001,";
+const uint8_t c_VenusACK         = 0x83;
+const uint8_t c_VenusNACK        = 0x84;
+const uint8_t c_VenusSerialPort  = 0x05;
+
+uint8_t FromHex(char c)
+{
+	if (c >= 'A' && c <= 'F')
+		return c - 'A' + 10;
+	if (c >= 'a' && c <= 'f')
+		return c - 'a' + 10;
+	return c - '0';
+}
+
+// where to listen next when autobauding: ours first, then everything else, fastest first
+uint32_t ProbeBaud(int8_t index, uint32_t ours)
+{
+	return (index < 0 ? ours : c_Bauds[_countof(c_Bauds) - 1 - index]);
+}
+
+GPSConfigurator::GPSConfigurator(BufferedSerial* pSerial, EProtocol::Enum protocol, uint32_t baud, const char* script, const char* resetBanner, bool sharedPort) :
+	m_pSerial(pSerial),
+	m_Protocol(protocol),
+	m_Baud(baud),
+	m_Script(script),
+	m_ResetBanner(resetBanner),
+	m_SharedPort(sharedPort),
+	m_Configured(false),
+	m_DetectedBaud(0),
+	m_ConfigureCount(0),
+	m_FailedCommands(0),
+	m_BannerOffset(0),
+	m_ResetDetected(false),
+	m_LastReceived(0),
+	m_LastAttempt(0),
+	m_RetryBackoff(0),
+	m_State(EState::Idle),
+	m_StateStart(0),
+	m_BaudIndex(-1),
+	m_pLine(NULL),
+	m_CommandID(0),
+	m_Tries(0),
+	m_Heard(false),
+	m_Response(EResponse::None),
+	m_NextSection(ENextSection::Idle),
+	m_Checksum(0),
+	m_ReceivedChecksum(0),
+	m_Length(0),
+	m_Offset(0),
+	m_ResponseID(0)
+{
+}
+
+bool GPSConfigurator::setup()
+{
+	const bool configured = Configure();
+	m_LastAttempt = millis();
+	return configured;
+}
+
+bool GPSConfigurator::loop(bool received)
+{
+	const uint32_t now = millis();
+	if (received)
+	{
+		m_LastReceived = now;
+		m_Heard = true;
+	}
+
+	if (m_State != EState::Idle)
+	{
+		Step(now);
+		if (m_State != EState::Idle)
+			return false;
+
+		m_LastAttempt = now;
+
+		// if there was nothing there, back off so that a dead receiver isn't probed for ever
+		if (m_DetectedBaud)
+			m_RetryBackoff = 0;
+		else
+			m_RetryBackoff = min(max(2 * m_RetryBackoff, (uint32_t)c_SilenceTimeout), c_MaxRetryBackoff);
+
+		return true;
+	}
+
+	// whatever was already buffered when we finished configuring doesn't count
+	if (m_ResetDetected && now - m_LastAttempt < c_ListenTime)
+		m_ResetDetected = false;
+
+	if (!m_ResetDetected && now - m_LastReceived < c_SilenceTimeout)
+		return false;
+	if (now - m_LastAttempt < m_RetryBackoff)
+		return false;
+
+	Start(now);
+	return false;
+}
+
+void GPSConfigurator::Monitor(char c)
+{
+	if (m_State != EState::Idle)
+	{
+		const EResponse::Enum response = ProcessByte(c);
+		if (response != EResponse::None)
+			m_Heard = true;
+		if ((response == EResponse::ACK || response == EResponse::NACK) && m_ResponseID == m_CommandID)
+			m_Response = response;
+	}
+
+	if (!m_ResetBanner)
+		return;
+
+	if (c == (char)pgm_read_byte(m_ResetBanner + m_BannerOffset))
+	{
+		if (!pgm_read_byte(m_ResetBanner + ++m_BannerOffset))
+		{
+			m_ResetDetected = true;
+			m_BannerOffset = 0;
+		}
+	}
+	else
+	{
+		m_BannerOffset = (c == (char)pgm_read_byte(m_ResetBanner) ? 1 : 0);
+	}
+}
+
+bool GPSConfigurator::Configure()
+{
+	Start(millis());
+	while (m_State != EState::Idle)
+	{
+		while (m_pSerial->available())
+			Monitor(m_pSerial->read());
+		Step(millis());
+	}
+
+	return m_Configured;
+}
+
+bool GPSConfigurator::IsConfiguring() const
+{
+	return m_State != EState::Idle;
+}
+
+bool GPSConfigurator::IsConfigured() const
+{
+	return m_Configured;
+}
+
+uint32_t GPSConfigurator::GetDetectedBaud() const
+{
+	return m_DetectedBaud;
+}
+
+uint8_t GPSConfigurator::GetConfigureCount() const
+{
+	return m_ConfigureCount;
+}
+
+uint8_t GPSConfigurator::GetFailedCommands() const
+{
+	return m_FailedCommands;
+}
+
+void GPSConfigurator::Start(uint32_t now)
+{
+	++m_ConfigureCount;
+	m_Configured = false;
+	m_FailedCommands = 0;
+	m_DetectedBaud = 0;
+	m_BaudIndex = -1;
+	Probe(now);
+}
+
+void GPSConfigurator::Step(uint32_t now)
+{
+	const uint32_t elapsed = now - m_StateStart;
+	switch (m_State)
+	{
+	case EState::Idle:
+		break;
+
+	case EState::Autobauding:
+		if (m_Heard)
+		{
+			m_DetectedBaud = ProbeBaud(m_BaudIndex, m_Baud);
+			if (m_DetectedBaud == m_Baud)
+			{
+				m_pLine = m_Script;
+				NextCommand(now);
+			}
+			else
+			{
+				// only the baud command's in the buffer, so this doesn't wait long
+				SendBaud(m_Baud);
+				m_pSerial->flush();
+				Enter(EState::ChangingBaud, now);
+			}
+		}
+		else if (elapsed >= c_ListenTime)
+		{
+			do
+				++m_BaudIndex;
+			while (m_BaudIndex < (int8_t)_countof(c_Bauds) && ProbeBaud(m_BaudIndex, m_Baud) == m_Baud);
+
+			if (!m_SharedPort && m_BaudIndex < (int8_t)_countof(c_Bauds))
+			{
+				Probe(now);
+			}
+			else
+			{
+				if (!m_SharedPort)
+					m_pSerial->begin(m_Baud);
+				Finish(now);
+			}
+		}
+		break;
+
+	case EState::ChangingBaud:
+		if (elapsed >= c_BaudChangeTime)
+		{
+			m_pSerial->begin(m_Baud);
+			Enter(EState::Confirming, now);
+		}
+		break;
+
+	case EState::Confirming:
+		if (m_Heard)
+		{
+			m_pLine = m_Script;
+			NextCommand(now);
+		}
+		else if (elapsed >= c_ListenTime)
+		{
+			Finish(now);
+		}
+		break;
+
+	case EState::Commanding:
+		if (m_Response == EResponse::None && elapsed >= c_ACKTimeout && ++m_Tries < c_Retries)
+		{
+			SendCommand();
+			Enter(EState::Commanding, now);
+		}
+		else if (m_Response != EResponse::None || elapsed >= c_ACKTimeout)
+		{
+			if (m_Response != EResponse::ACK)
+				++m_FailedCommands;
+
+			char c;
+			while ((c = pgm_read_byte(m_pLine)) && c != '\n')
+				++m_pLine;
+			NextCommand(now);
+		}
+		break;
+	}
+}
+
+void GPSConfigurator::Enter(EState::Enum state, uint32_t now)
+{
+	m_State = state;
+	m_StateStart = now;
+	m_Heard = false;
+	m_Response = EResponse::None;
+	m_NextSection = ENextSection::Idle;
+}
+
+void GPSConfigurator::Finish(uint32_t now)
+{
+	m_State = EState::Idle;
+	m_ResetDetected = false;
+	m_LastReceived = now;
+}
+
+void GPSConfigurator::Probe(uint32_t now)
+{
+	if (!m_SharedPort)
+		m_pSerial->begin(ProbeBaud(m_BaudIndex, m_Baud));
+	Enter(EState::Autobauding, now);
+}
+
+void GPSConfigurator::NextCommand(uint32_t now)
+{
+	while (pgm_read_byte(m_pLine) == '\n')
+		++m_pLine;
+
+	if (!pgm_read_byte(m_pLine))
+	{
+		m_Configured = (m_FailedCommands == 0);
+		Finish(now);
+		return;
+	}
+
+	m_Tries = 0;
+	SendCommand();
+	Enter(EState::Commanding, now);
+}
+
+void GPSConfigurator::SendCommand()
+{
+	char line[64];
+	uint8_t length = 0;
+	char c;
+	for (const char* p = m_pLine; (c = pgm_read_byte(p)) && c != '\n'; ++p)
+		if (length < sizeof(line) - 1)
+			line[length++] = c;
+	line[length] = 0;
+
+	if (line[0] == '#')
+	{
+		uint8_t payload[24];
+		uint8_t size = 0;
+		for (const char* p = line + 1; p[0] && p[1] && size < sizeof(payload); p += 2)
+			payload[size++] = (FromHex(p[0]) << 4) | FromHex(p[1]);
+
+		// an empty payload can't be ACKed, so it just times out
+		m_CommandID = (size > 0 ? payload[0] : 0xFFFF);
+		if (size > 0)
+			SendBinary(payload, size);
+	}
+	else
+	{
+		m_CommandID = (strncmp(line, "PMTK", 4) == 0 ? atoi(line + 4) : 0);
+		SendSentence(line);
+	}
+}
+
+void GPSConfigurator::SendBaud(uint32_t baud)
+{
+	if (m_Protocol == EProtocol::MTK)
+	{
+		char body[20];
+		sprintf(body, "PMTK251,%lu", baud);
+		SendSentence(body);
+	}
+	else
+	{
+		uint8_t index = 0;
+		while (index + 1 < _countof(c_Bauds) && c_Bauds[index] < baud)
+			++index;
+
+		const uint8_t payload[] = {c_VenusSerialPort, 0x00, index, 0x00};
+		SendBinary(payload, sizeof(payload));
+	}
+}
+
+void GPSConfigurator::SendSentence(const char* body)
+{
+	uint8_t checksum = 0;
+	for (const char* p = body; *p; ++p)
+		checksum ^= *p;
+
+	char tail[6];
+	sprintf(tail, "*%.2X\r\n", checksum);
+
+	m_pSerial->write('$');
+	m_pSerial->print(body);
+	m_pSerial->print(tail);
+}
+
+void GPSConfigurator::SendBinary(const uint8_t* payload, uint8_t size)
+{
+	m_pSerial->write(0xA0);
+	m_pSerial->write(0xA1);
+	m_pSerial->write((uint8_t)0x00);
+	m_pSerial->write(size);
+
+	uint8_t checksum = 0;
+	for (uint8_t i=0; i<size; ++i)
+	{
+		m_pSerial->write(payload[i]);
+		checksum ^= payload[i];
+	}
+
+	m_pSerial->write(checksum);
+	m_pSerial->write(0x0D);
+	m_pSerial->write(0x0A);
+}
+
+GPSConfigurator::EResponse::Enum GPSConfigurator::ProcessByte(uint8_t c)
+{
+	switch (m_NextSection)
+	{
+	case ENextSection::Idle:
+		m_Checksum = 0;
+		m_Offset = 0;
+		if (c == '$')
+			m_NextSection = ENextSection::Sentence;
+		else if (c == 0xA0)
+			m_NextSection = ENextSection::BinaryStart2;
+		break;
+
+	case ENextSection::Sentence:
+		if (c == '*')
+		{
+			m_Buffer[min(m_Offset, (uint16_t)(sizeof(m_Buffer) - 1))] = 0;
+			m_NextSection = ENextSection::SentenceChecksum;
+		}
+		else if (c == '$')
+		{
+			m_Checksum = 0;
+			m_Offset = 0;
+		}
+		else if (c < ' ' || c > '~')
+		{
+			m_NextSection = ENextSection::Idle;
+		}
+		else
+		{
+			m_Checksum ^= c;
+			if (m_Offset < sizeof(m_Buffer))
+				m_Buffer[m_Offset] = c;
+			++m_Offset;
+		}
+		break;
+
+	case ENextSection::SentenceChecksum:
+		m_ReceivedChecksum = FromHex(c) << 4;
+		m_NextSection = ENextSection::SentenceChecksum2;
+		break;
+
+	case ENextSection::SentenceChecksum2:
+		m_ReceivedChecksum |= FromHex(c);
+		m_NextSection = ENextSection::Idle;
+		if (m_ReceivedChecksum != m_Checksum)
+			break;
+
+		// $PMTK001,<command>,<flag>, where 3 means it worked
+		if (strncmp(m_Buffer, c_MTKACK, sizeof(c_MTKACK) - 1) == 0)
+		{
+			const char* p = m_Buffer + sizeof(c_MTKACK) - 1;
+			m_ResponseID = atoi(p);
+			while (*p && *p != ',')
+				++p;
+			return (*p == ',' && p[1] == '3' ? EResponse::ACK : EResponse::NACK);
+		}
+		return EResponse::Frame;
+
+	case ENextSection::BinaryStart2:
+		m_NextSection = (c == 0xA1 ? ENextSection::BinaryLength : ENextSection::Idle);
+		break;
+
+	case ENextSection::BinaryLength:
+		m_Length = (uint16_t)c << 8;
+		m_NextSection = ENextSection::BinaryLength2;
+		break;
+
+	case ENextSection::BinaryLength2:
+		m_Length |= c;
+		m_NextSection = (m_Length > 0 ? ENextSection::BinaryPayload : ENextSection::Idle);
+		break;
+
+	case ENextSection::BinaryPayload:
+		m_Checksum ^= c;
+		if (m_Offset < sizeof(m_Buffer))
+			m_Buffer[m_Offset] = c;
+		if (++m_Offset == m_Length)
+			m_NextSection = ENextSection::BinaryChecksum;
+		break;
+
+	case ENextSection::BinaryChecksum:
+		m_NextSection = (c == m_Checksum ? ENextSection::BinaryEnd : ENextSection::Idle);
+		break;
+
+	case ENextSection::BinaryEnd:
+		m_NextSection = (c == 0x0D ? ENextSection::BinaryEnd2 : ENextSection::Idle);
+		break;
+
+	case ENextSection::BinaryEnd2:
+		m_NextSection = ENextSection::Idle;
+		if (c != 0x0A)
+			break;
+
+		if ((uint8_t)m_Buffer[0] == c_VenusACK || (uint8_t)m_Buffer[0] == c_VenusNACK)
+		{
+			m_ResponseID = (m_Length >= 2 ? (uint8_t)m_Buffer[1] : 0);
+			return ((uint8_t)m_Buffer[0] == c_VenusACK ? EResponse::ACK : EResponse::NACK);
+		}
+		return EResponse::Frame;
+	}
+
+	return EResponse::None;
+}
@@ -0,0 +1,150 @@
+#ifndef _GPSCONFIGURATOR_H
+#define _GPSCONFIGURATOR_H
+
+#include <Core.h>
+#include <BufferedSerial.h>
+
+// Brings a GPS receiver up from whatever state it's in: finds its baud rate, moves it to ours,
+// then runs a script of configuration commands, checking each one gets ACKed. While running,
+// it watches for the receiver resetting (its boot banner, or the data stopping) and runs the
+// whole thing again.
+//
+// setup() blocks until it's done, but from loop() it's a state machine that sends at most one
+// probe or command per call and reads the replies from Monitor(), so the app's loop never waits
+// on it for more than the time taken to queue a command. A port that's shared with the log is
+// never re-bauded: the receiver has to be at our baud rate already, and only the script is run.
+//
+// Scripts are PROGMEM strings with one command per line:
+//   PMTK220,1000        an MTK command, sent as $PMTK220,1000*1F and ACKed by $PMTK001,220,3
+//   #0E0A00             a SkyTraq Venus binary message payload in hex, ACKed by message 0x83
+class GPSConfigurator
+{
+public:
+	struct EProtocol
+	{
+		enum Enum
+		{
+			MTK,
+			Venus,
+		};
+	};
+
+	static const uint16_t c_ListenTime      = 1200;   // ms, per baud rate when autobauding
+	static const uint16_t c_BaudChangeTime  = 100;    // ms for the receiver to switch after the command's gone
+	static const uint16_t c_ACKTimeout      = 1000;   // ms
+	static const uint8_t  c_Retries         = 3;
+	static const uint16_t c_SilenceTimeout  = 5000;   // ms without a valid sentence or message before we assume a reset
+	static const uint32_t c_MaxRetryBackoff = 300000; // ms, between attempts while the receiver's not answering
+
+public:
+	// resetBanner is what the receiver sends (only) after coming up with its defaults, or NULL
+	// sharedPort = something else (the log) is on this port too, so it's left at baud
+	GPSConfigurator(BufferedSerial* pSerial, EProtocol::Enum protocol, uint32_t baud, const char* script, const char* resetBanner, bool sharedPort = false);
+
+	bool setup();                        // blocks while configuring, returns true if every command was ACKed
+	bool loop(bool received);            // received = a checksum-valid sentence or message since the last loop, fix or not; returns true when it's finished reconfiguring
+	void Monitor(char c);                // feed every byte from the receiver through here as well
+
+	bool Configure();                    // blocks, reading the port itself
+	bool IsConfiguring() const;
+	bool IsConfigured() const;
+	uint32_t GetDetectedBaud() const;    // what the receiver was at when we found it
+	uint8_t GetConfigureCount() const;
+	uint8_t GetFailedCommands() const;   // in the last Configure()
+
+protected:
+	struct EResponse
+	{
+		enum Enum
+		{
+			None,
+			Frame,  // any valid sentence or message
+			ACK,
+			NACK,
+		};
+	};
+
+	struct EState
+	{
+		enum Enum
+		{
+			Idle,
+			Autobauding,    // listening for anything at m_BaudIndex
+			ChangingBaud,   // waiting for the receiver to switch
+			Confirming,     // listening for it at our baud
+			Commanding,     // waiting for m_pLine's ACK
+		};
+	};
+
+	struct ENextSection
+	{
+		enum Enum
+		{
+			Idle,
+			Sentence,
+			SentenceChecksum,
+			SentenceChecksum2,
+			BinaryStart2,
+			BinaryLength,
+			BinaryLength2,
+			BinaryPayload,
+			BinaryChecksum,
+			BinaryEnd,
+			BinaryEnd2,
+		};
+	};
+
+protected:
+	void Start(uint32_t now);
+	void Step(uint32_t now);
+	void Enter(EState::Enum state, uint32_t now);
+	void Finish(uint32_t now);
+	void Probe(uint32_t now);
+	void NextCommand(uint32_t now);
+	void SendCommand();
+	void SendBaud(uint32_t baud);
+	void SendSentence(const char* body);
+	void SendBinary(const uint8_t* payload, uint8_t size);
+	EResponse::Enum ProcessByte(uint8_t c);
+
+protected:
+	BufferedSerial* m_pSerial;
+	EProtocol::Enum m_Protocol;
+	uint32_t m_Baud;
+	const char* m_Script;
+	const char* m_ResetBanner;
+	bool m_SharedPort;
+
+	bool m_Configured;
+	uint32_t m_DetectedBaud;
+	uint8_t m_ConfigureCount;
+	uint8_t m_FailedCommands;
+
+	// monitoring
+	uint8_t m_BannerOffset;
+	bool m_ResetDetected;
+	uint32_t m_LastReceived;
+	uint32_t m_LastAttempt;
+	uint32_t m_RetryBackoff;
+
+	// configuring
+	EState::Enum m_State;
+	uint32_t m_StateStart;
+	int8_t m_BaudIndex;      // into c_Bauds, fastest first, or -1 for ours
+	const char* m_pLine;     // the script line being run, in PROGMEM
+	uint16_t m_CommandID;
+	uint8_t m_Tries;
+	bool m_Heard;            // a valid frame since entering the state
+	EResponse::Enum m_Response;   // to m_CommandID
+
+	// response parsing
+	ENextSection::Enum m_NextSection;
+	uint8_t m_Checksum;
+	uint8_t m_ReceivedChecksum;
+	uint16_t m_Length;
+	uint16_t m_Offset;
+	char m_Buffer[16];       // start of the sentence or message
+	uint16_t m_ResponseID;   // command the last ACK/NACK was for
+};
+
+#endif
@@ -0,0 +1,272 @@
+#include "Geodesy.h"
+#include <avr/pgmspace.h>
+
+namespace
+{
+	const int32_t c_EarthRadius           = 6372795;      // m, same as TinyGPS
+	const int64_t c_DegE5ToAngle          = 7818749;      // 2^32 / 36000000 in 16.16 fixed point
+	const uint64_t c_MPerDegE5            = 72893;        // m per 1e-5 degree of latitude in 16.16 fixed point
+	const uint64_t c_MPerHalfAngle        = 80082904;     // m per binary angle of half the central angle in 0.32 fixed point
+	const uint64_t c_CordicGain           = 2608131496u;  // 1 / the CORDIC's gain in 0.32 fixed point
+	const int32_t c_HalfPi                = 1686629713;   // pi / 2 in 2.30 fixed point
+
+	// sin(i * 90 / 256 degrees) in 2.30 fixed point
+	const uint32_t c_SinTable[257] PROGMEM = {
+	0, 6588356, 13176464, 19764076, 26350943, 32936819, 39521455, 46104602,
+	52686014, 59265442, 65842639, 72417357, 78989349, 85558366, 92124163, 98686491,
+	105245103, 111799753, 118350194, 124896179, 131437462, 137973796, 144504935, 151030634,
+	157550647, 164064728, 170572633, 177074115, 183568930, 190056834, 196537583, 203010932,
+	209476638, 215934457, 222384147, 228825464, 235258165, 241682010, 248096755, 254502159,
+	260897982, 267283981, 273659918, 280025552, 286380643, 292724951, 299058239, 305380268,
+	311690799, 317989595, 324276419, 330551034, 336813204, 343062693, 349299266, 355522689,
+	361732726, 367929144, 374111709, 380280190, 386434353, 392573967, 398698801, 404808624,
+	410903207, 416982319, 423045732, 429093217, 435124548, 441139496, 447137835, 453119340,
+	459083786, 465030947, 470960600, 476872522, 482766489, 488642281, 494499676, 500338453,
+	506158392, 511959275, 517740883, 523502998, 529245404, 534967884, 540670223, 546352205,
+	552013618, 557654248, 563273883, 568872310, 574449320, 580004702, 585538248, 591049748,
+	596538995, 602005783, 607449906, 612871159, 618269338, 623644239, 628995660, 634323400,
+	639627258, 644907034, 650162530, 655393548, 660599890, 665781362, 670937767, 676068911,
+	681174602, 686254647, 691308855, 696337036, 701339000, 706314559, 711263525, 716185713,
+	721080937, 725949013, 730789757, 735602987, 740388522, 745146182, 749875788, 754577161,
+	759250125, 763894504, 768510122, 773096806, 777654384, 782182683, 786681534, 791150767,
+	795590213, 799999706, 804379079, 808728167, 813046808, 817334838, 821592095, 825818421,
+	830013654, 834177638, 838310216, 842411232, 846480531, 850517961, 854523370, 858496606,
+	862437520, 866345964, 870221790, 874064853, 877875009, 881652112, 885396022, 889106597,
+	892783698, 896427186, 900036924, 903612776, 907154608, 910662286, 914135678, 917574653,
+	920979082, 924348837, 927683790, 930983817, 934248793, 937478595, 940673101, 943832191,
+	946955747, 950043650, 953095785, 956112036, 959092290, 962036435, 964944360, 967815955,
+	970651112, 973449725, 976211688, 978936898, 981625251, 984276646, 986890984, 989468165,
+	992008094, 994510675, 996975812, 999403415, 1001793390, 1004145648, 1006460100, 1008736660,
+	1010975242, 1013175761, 1015338134, 1017462281, 1019548121, 1021595575, 1023604567, 1025575020,
+	1027506862, 1029400018, 1031254418, 1033069992, 1034846671, 1036584389, 1038283080, 1039942680,
+	1041563127, 1043144360, 1044686319, 1046188946, 1047652185, 1049075980, 1050460278, 1051805027,
+	1053110176, 1054375676, 1055601479, 1056787540, 1057933813, 1059040255, 1060106826, 1061133483,
+	1062120190, 1063066909, 1063973603, 1064840240, 1065666786, 1066453210, 1067199483, 1067905576,
+	1068571464, 1069197120, 1069782521, 1070327646, 1070832474, 1071296985, 1071721163, 1072104991,
+	1072448455, 1072751542, 1073014240, 1073236540, 1073418433, 1073559913, 1073660973, 1073721611,
+	1073741824
+	};
+
+	// atan(2^-i) as binary angles
+	const uint32_t c_AtanTable[30] = {
+		536870912, 316933406, 167458907, 85004756, 42667331, 21354465, 10679838, 5340245,
+		2670163, 1335087, 667544, 333772, 166886, 83443, 41722, 20861,
+		10430, 5215, 2608, 1304, 652, 326, 163, 81,
+		41, 20, 10, 5, 3, 1
+	};
+
+	struct Sphere
+	{
+		int32_t cosLat1, sinLat1;
+		int32_t cosLat2, sinLat2;
+		int32_t x2, y2;             // the second point's equatorial components, with the first on the prime meridian
+	};
+
+	int32_t Mul30(int32_t a, int32_t b)
+	{
+		return (int32_t)(((int64_t)a * b) >> 30);
+	}
+
+	void GetSphere(int32_t lat1, int32_t lon1, int32_t lat2, int32_t lon2, Sphere* pSphere)
+	{
+		const uint32_t phi1 = Geodesy::DegE5ToAngle(lat1);
+		const uint32_t phi2 = Geodesy::DegE5ToAngle(lat2);
+		const uint32_t dLambda = Geodesy::DegE5ToAngle(lon2 - lon1);
+
+		pSphere->cosLat1 = Geodesy::Cos(phi1);
+		pSphere->sinLat1 = Geodesy::Sin(phi1);
+		pSphere->cosLat2 = Geodesy::Cos(phi2);
+		pSphere->sinLat2 = Geodesy::Sin(phi2);
+		pSphere->x2 = Mul30(pSphere->cosLat2, Geodesy::Cos(dLambda));
+		pSphere->y2 = Mul30(pSphere->cosLat2, Geodesy::Sin(dLambda));
+	}
+
+	// half the angle between the two points, as seen from the center of the earth, along with its sine and cosine;
+	// these are half the lengths of the difference and sum of the two points as unit vectors, which, unlike
+	// the haversine's square root, the CORDIC gives us for free and without losing anything at short range
+	uint32_t GetHalfCentralAngle(const Sphere& sphere, uint32_t* pSinHalf, uint32_t* pCosHalf)
+	{
+		uint32_t xy;
+		Geodesy::Atan2(-(sphere.y2 >> 1), (sphere.cosLat1 >> 1) - (sphere.x2 >> 1), &xy);
+		Geodesy::Atan2((sphere.sinLat1 >> 1) - (sphere.sinLat2 >> 1), xy, pSinHalf);
+		Geodesy::Atan2(sphere.y2 >> 1, (sphere.cosLat1 >> 1) + (sphere.x2 >> 1), &xy);
+		Geodesy::Atan2((sphere.sinLat1 >> 1) + (sphere.sinLat2 >> 1), xy, pCosHalf);
+		return Geodesy::Atan2(*pSinHalf, *pCosHalf);
+	}
+
+	uint16_t GetBearing(const Sphere& sphere)
+	{
+		const int32_t north = (int32_t)(((int64_t)sphere.cosLat1 * sphere.sinLat2 - (int64_t)sphere.sinLat1 * sphere.x2) >> 31);
+		return Geodesy::AngleToCentiDeg(Geodesy::Atan2(sphere.y2 >> 1, north));
+	}
+}
+
+uint32_t Geodesy::EquirectangularRangeInM(int32_t lat1, int32_t lon1, int32_t lat2, int32_t lon2, uint16_t* pBearing)
+{
+	const int32_t dLat = lat2 - lat1;
+	int32_t dLon = lon2 - lon1;
+	if (dLon > 18000000l)
+		dLon -= 36000000l;
+	else if (dLon < -18000000l)
+		dLon += 36000000l;
+
+	// in 1/16ths of 1e-5 degree, so that short ranges don't lose their fractions
+	const int32_t east = (int32_t)(((int64_t)dLon * Cos(DegE5ToAngle(lat1 / 2 + lat2 / 2))) >> 26);
+	const int32_t north = dLat * 16;
+
+	uint32_t length;
+	const uint32_t bearing = Atan2(east, north, &length);
+	if (pBearing)
+		*pBearing = AngleToCentiDeg(bearing);
+
+	return (uint32_t)((length * c_MPerDegE5 + (1ul << 19)) >> 20);
+}
+
+uint32_t Geodesy::HaversineRangeInM(int32_t lat1, int32_t lon1, int32_t lat2, int32_t lon2)
+{
+	Sphere sphere;
+	GetSphere(lat1, lon1, lat2, lon2, &sphere);
+
+	uint32_t sinHalf, cosHalf;
+	return (uint32_t)((GetHalfCentralAngle(sphere, &sinHalf, &cosHalf) * c_MPerHalfAngle + 0x80000000ul) >> 32);
+}
+
+uint16_t Geodesy::BearingInCentiDeg(int32_t lat1, int32_t lon1, int32_t lat2, int32_t lon2)
+{
+	Sphere sphere;
+	GetSphere(lat1, lon1, lat2, lon2, &sphere);
+	return GetBearing(sphere);
+}
+
+void Geodesy::GetLookAngle(int32_t lat1, int32_t lon1, int32_t alt1, int32_t lat2, int32_t lon2, int32_t alt2, LookAngle* pLook)
+{
+	Sphere sphere;
+	GetSphere(lat1, lon1, lat2, lon2, &sphere);
+
+	uint32_t sinHalf, cosHalf;
+	const uint32_t halfAngle = GetHalfCentralAngle(sphere, &sinHalf, &cosHalf);
+	pLook->groundRange = (uint32_t)((halfAngle * c_MPerHalfAngle + 0x80000000ul) >> 32);
+	pLook->azimuth = GetBearing(sphere);
+
+	// in cm, in the vertical plane through both points, the target is (R + alt2) sin(c) out and (R + alt2) cos(c) - (R + alt1) up;
+	// sin(c) = 2 sin(c/2) cos(c/2) and 1 - cos(c) = 2 sin^2(c/2) keep the big numbers from cancelling
+	const int64_t r2 = (int64_t)(c_EarthRadius + alt2) * 100;
+	const int32_t out = (int32_t)((r2 * Mul30(sinHalf, cosHalf)) >> 29);
+	const int32_t up = (alt2 - alt1) * 100 - (int32_t)((r2 * Mul30(sinHalf, sinHalf)) >> 29);
+
+	uint32_t slantRange;
+	pLook->elevation = SignedAngleToCentiDeg(Atan2(up, out, &slantRange));
+	pLook->slantRange = (slantRange + 50) / 100;
+}
+
+int32_t Geodesy::Sin(uint32_t angle)
+{
+	const uint8_t quadrant = angle >> 30;
+	uint32_t a = angle & 0x3FFFFFFFul;
+	if (quadrant & 1)
+		a = 0x40000000ul - a;
+
+	// sin(table + b) = sin(table) cos(b) + cos(table) sin(b), and b is small enough for the first couple of terms
+	// of the series, which is much better than interpolating when we're taking the difference of two nearby points
+	const uint16_t i = (a + (1ul << 21)) >> 22;
+	const int32_t b = Mul30((int32_t)(a - ((uint32_t)i << 22)), c_HalfPi);
+	const int32_t b2 = Mul30(b, b);
+	const int32_t sinB = b - Mul30(b2, b) / 6;
+	const int32_t cosB = (1l << 30) - b2 / 2;
+	const int32_t value = Mul30((int32_t)pgm_read_dword(&c_SinTable[i]), cosB) + Mul30((int32_t)pgm_read_dword(&c_SinTable[256 - i]), sinB);
+
+	return (quadrant & 2) ? -value : value;
+}
+
+int32_t Geodesy::Cos(uint32_t angle)
+{
+	return Sin(angle + 0x40000000ul);
+}
+
+#define CORDIC_STEP(i) \
+	if (y > 0) \
+	{ \
+		const int32_t t = x + (y >> i); \
+		y -= x >> i; \
+		x = t; \
+		angle += c_AtanTable[i]; \
+	} \
+	else \
+	{ \
+		const int32_t t = x - (y >> i); \
+		y += x >> i; \
+		x = t; \
+		angle -= c_AtanTable[i]; \
+	}
+
+uint32_t Geodesy::Atan2(int32_t y, int32_t x, uint32_t* pLength)
+{
+	// scale up (or down) so that the larger component is in [2^28..2^29), which leaves room for the CORDIC's gain
+	uint32_t m = (x < 0 ? -(uint32_t)x : (uint32_t)x) | (y < 0 ? -(uint32_t)y : (uint32_t)y);
+	if (m == 0)
+	{
+		if (pLength)
+			*pLength = 0;
+		return 0;
+	}
+
+	int8_t shift = 0;
+	for (; m >= (1ul << 29); m >>= 1)
+		--shift;
+	for (; m < (1ul << 28); m <<= 1)
+		++shift;
+
+	if (shift >= 0)
+	{
+		x <<= shift;
+		y <<= shift;
+	}
+	else
+	{
+		x >>= -shift;
+		y >>= -shift;
+	}
+
+	// the CORDIC only converges within +-99 degrees, so start from the right half plane
+	uint32_t angle = 0;
+	if (x < 0)
+	{
+		x = -x;
+		y = -y;
+		angle = 0x80000000ul;
+	}
+
+	// rotate onto the x axis, unrolled so that all the shifts are by constants
+	CORDIC_STEP(0)  CORDIC_STEP(1)  CORDIC_STEP(2)  CORDIC_STEP(3)  CORDIC_STEP(4)
+	CORDIC_STEP(5)  CORDIC_STEP(6)  CORDIC_STEP(7)  CORDIC_STEP(8)  CORDIC_STEP(9)
+	CORDIC_STEP(10) CORDIC_STEP(11) CORDIC_STEP(12) CORDIC_STEP(13) CORDIC_STEP(14)
+	CORDIC_STEP(15) CORDIC_STEP(16) CORDIC_STEP(17) CORDIC_STEP(18) CORDIC_STEP(19)
+	CORDIC_STEP(20) CORDIC_STEP(21) CORDIC_STEP(22) CORDIC_STEP(23) CORDIC_STEP(24)
+	CORDIC_STEP(25) CORDIC_STEP(26) CORDIC_STEP(27) CORDIC_STEP(28) CORDIC_STEP(29)
+
+	if (pLength)
+	{
+		const uint32_t length = (uint32_t)(((uint64_t)x * c_CordicGain) >> 32);
+		*pLength = shift >= 0 ? (length + ((1ul << shift) >> 1)) >> shift : length << -shift;
+	}
+
+	return angle;
+}
+
+#undef CORDIC_STEP
+
+uint32_t Geodesy::DegE5ToAngle(int32_t degE5)
+{
+	return (uint32_t)((degE5 * c_DegE5ToAngle + 0x8000) >> 16);
+}
+
+uint16_t Geodesy::AngleToCentiDeg(uint32_t angle)
+{
+	const uint16_t centiDeg = (uint16_t)(((uint64_t)angle * 36000 + 0x80000000ul) >> 32);
+	return centiDeg < 36000 ? centiDeg : 0;
+}
+
+int16_t Geodesy::SignedAngleToCentiDeg(uint32_t angle)
+{
+	return (int16_t)(((int64_t)(int32_t)angle * 36000 + 0x80000000l) >> 32);
+}
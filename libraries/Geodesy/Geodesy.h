@@ -0,0 +1,48 @@
+#ifndef _GEODESY_H
+#define _GEODESY_H
+
+#include <Core.h>
+
+// Integer geodesy on the 1e-5 degree coordinates that TinyGPS::get_position() returns.
+//
+// Angles are carried as binary angles, where 2^32 is a full turn, so wrapping is free.
+// Sin/Cos come from a quarter-wave table and Atan2 is a CORDIC, which also gives the
+// length of the vector it was handed. Everything works on a sphere of radius 6372795m,
+// the same one TinyGPS uses, so the results can be compared directly. The error bounds
+// below are the worst tools/GeodesyCheck finds against double precision, rounded up.
+class Geodesy
+{
+public:
+	struct LookAngle
+	{
+		uint32_t groundRange;   // m, along the surface
+		uint32_t slantRange;    // m, straight line
+		uint16_t azimuth;       // centidegrees, [0..36000) clockwise from north
+		int16_t elevation;      // centidegrees, [-9000..9000] above the local horizontal
+	};
+
+public:
+	// distance and bearing on a flat earth at the mean latitude; the cheapest, and good to 0.1% in
+	// range and a degree in bearing out to a few hundred km
+	static uint32_t EquirectangularRangeInM(int32_t lat1, int32_t lon1, int32_t lat2, int32_t lon2, uint16_t* pBearing = NULL);
+
+	// great circle distance and initial bearing; range is good to 2.5 m at any range, bearing to 0.02 degrees
+	// past 10 km, 0.1 past 1 km and 0.5 past 100 m
+	static uint32_t HaversineRangeInM(int32_t lat1, int32_t lon1, int32_t lat2, int32_t lon2);
+	static uint16_t BearingInCentiDeg(int32_t lat1, int32_t lon1, int32_t lat2, int32_t lon2);
+
+	// where to point from the first position (alt in m) to see the second, allowing for the curve of the earth;
+	// elevation is good to 0.05 degrees, or 0.1 under 100 m
+	static void GetLookAngle(int32_t lat1, int32_t lon1, int32_t alt1, int32_t lat2, int32_t lon2, int32_t alt2, LookAngle* pLook);
+
+	// fixed point trig on binary angles, results in 2.30 fixed point
+	static int32_t Sin(uint32_t angle);
+	static int32_t Cos(uint32_t angle);
+	static uint32_t Atan2(int32_t y, int32_t x, uint32_t* pLength = NULL);
+
+	static uint32_t DegE5ToAngle(int32_t degE5);
+	static uint16_t AngleToCentiDeg(uint32_t angle);
+	static int16_t SignedAngleToCentiDeg(uint32_t angle);
+};
+
+#endif
@@ -0,0 +1,145 @@
+#include <Core.h>
+#include <TinyGPS.h>
+#include <Geodesy.h>
+
+// Compares the fixed point geodesy against TinyGPS's float versions, both for accuracy
+// (against ranges and bearings worked out in double precision on a PC) and for speed.
+
+struct TestCase
+{
+	int32_t lat1, lon1;
+	int32_t lat2, lon2;
+	uint32_t range;     // cm
+	uint16_t bearing;   // centidegrees
+};
+
+const TestCase c_TestCases[] = {
+	{4760000, -12233000, 4760007, -12232992, 983, 3762},
+	{4760000, -12233000, 4759916, -12233046, 9960, 20027},
+	{4760000, -12233000, 4759922, -12231672, 99978, 9497},
+	{4760000, -12233000, 4765775, -12243225, 1000020, 31000},
+	{4760000, -12233000, 4717735, -12210381, 5000025, 16000},
+	{4760000, -12233000, 4823181, -12137560, 9999991, 4500},
+	{4760000, -12233000, 4661751, -12602120, 29999953, 25000},
+	{4760000, -12233000, 4258588, -11173789, 99999993, 12000},
+};
+
+const uint16_t c_Iterations = 100;
+
+volatile uint32_t sink;
+
+void printErrors(const char* name, float rangeError, float bearingError)
+{
+	Serial.print(name);
+	Serial.print(rangeError, 2);
+	Serial.print("m ");
+	Serial.print(bearingError, 3);
+	Serial.println("deg");
+}
+
+float bearingError(float bearing, uint16_t reference)
+{
+	float error = bearing - reference * 0.01f;
+	if (error > 180.0f)
+		error -= 360.0f;
+	if (error < -180.0f)
+		error += 360.0f;
+	return error;
+}
+
+void printCycles(const char* name, uint32_t start)
+{
+	const uint32_t cycles = (micros() - start) * clockCyclesPerMicrosecond() / (c_Iterations * _countof(c_TestCases));
+	Serial.print(name);
+	Serial.print(cycles);
+	Serial.println(" cycles");
+}
+
+void setup()
+{
+	Serial.begin(115200);
+
+	for (uint8_t i=0; i<_countof(c_TestCases); ++i)
+	{
+		const TestCase& t = c_TestCases[i];
+		const float lat1 = t.lat1 * 1.0e-5f;
+		const float lon1 = t.lon1 * 1.0e-5f;
+		const float lat2 = t.lat2 * 1.0e-5f;
+		const float lon2 = t.lon2 * 1.0e-5f;
+		const float range = t.range * 0.01f;
+
+		Serial.print("range ");
+		Serial.print(range, 2);
+		Serial.println('m');
+
+		printErrors("  float:           ", TinyGPS::distance_between(lat1, lon1, lat2, lon2) - range, bearingError(TinyGPS::course_to(lat1, lon1, lat2, lon2), t.bearing));
+		printErrors("  haversine:       ", (float)Geodesy::HaversineRangeInM(t.lat1, t.lon1, t.lat2, t.lon2) - range, bearingError(Geodesy::BearingInCentiDeg(t.lat1, t.lon1, t.lat2, t.lon2) * 0.01f, t.bearing));
+
+		uint16_t bearing;
+		const uint32_t equirectangular = Geodesy::EquirectangularRangeInM(t.lat1, t.lon1, t.lat2, t.lon2, &bearing);
+		printErrors("  equirectangular: ", (float)equirectangular - range, bearingError(bearing * 0.01f, t.bearing));
+	}
+
+	uint32_t start = micros();
+	for (uint16_t n=0; n<c_Iterations; ++n)
+	{
+		for (uint8_t i=0; i<_countof(c_TestCases); ++i)
+		{
+			const TestCase& t = c_TestCases[i];
+			const float lat1 = t.lat1 * 1.0e-5f;
+			const float lon1 = t.lon1 * 1.0e-5f;
+			const float lat2 = t.lat2 * 1.0e-5f;
+			const float lon2 = t.lon2 * 1.0e-5f;
+			sink = TinyGPS::distance_between(lat1, lon1, lat2, lon2) + TinyGPS::course_to(lat1, lon1, lat2, lon2);
+		}
+	}
+	printCycles("float range+bearing:           ", start);
+
+	start = micros();
+	for (uint16_t n=0; n<c_Iterations; ++n)
+	{
+		for (uint8_t i=0; i<_countof(c_TestCases); ++i)
+		{
+			const TestCase& t = c_TestCases[i];
+			sink = Geodesy::HaversineRangeInM(t.lat1, t.lon1, t.lat2, t.lon2) + Geodesy::BearingInCentiDeg(t.lat1, t.lon1, t.lat2, t.lon2);
+		}
+	}
+	printCycles("haversine range+bearing:       ", start);
+
+	start = micros();
+	for (uint16_t n=0; n<c_Iterations; ++n)
+	{
+		for (uint8_t i=0; i<_countof(c_TestCases); ++i)
+		{
+			const TestCase& t = c_TestCases[i];
+			uint16_t bearing;
+			sink = Geodesy::EquirectangularRangeInM(t.lat1, t.lon1, t.lat2, t.lon2, &bearing) + bearing;
+		}
+	}
+	printCycles("equirectangular range+bearing: ", start);
+
+	start = micros();
+	for (uint16_t n=0; n<c_Iterations; ++n)
+	{
+		for (uint8_t i=0; i<_countof(c_TestCases); ++i)
+		{
+			const TestCase& t = c_TestCases[i];
+			Geodesy::LookAngle look;
+			Geodesy::GetLookAngle(t.lat1, t.lon1, 100, t.lat2, t.lon2, 20000, &look);
+			sink = look.slantRange + look.azimuth + look.elevation;
+		}
+	}
+	printCycles("look angle:                    ", start);
+
+	start = micros();
+	for (uint16_t n=0; n<c_Iterations; ++n)
+	{
+		for (uint8_t i=0; i<_countof(c_TestCases); ++i)
+			sink = Geodesy::Sin((uint32_t)n * 0x01234567ul + i) + Geodesy::Atan2(c_TestCases[i].lat2, c_TestCases[i].lon2);
+	}
+	printCycles("sin+atan2:                     ", start);
+}
+
+void loop()
+{
+}
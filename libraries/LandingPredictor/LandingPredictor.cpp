@@ -0,0 +1,242 @@
+#include "LandingPredictor.h"
+#include <Geodesy.h>
+
+namespace
+{
+	const int32_t c_CmPerLat          = 28474;      // cm per 1e-5 degrees of latitude in 24.8 fixed point, on the same sphere as Geodesy
+	const uint32_t c_LatPerCm         = 150839;     // and the other way round, in 8.24 fixed point
+	const int32_t c_MinCosLat         = 1l << 24;   // 2.30 fixed point, treat anything closer to the poles than 89 degrees as 89 degrees
+
+	const uint32_t c_MinWindInterval  = 2000;       // ms, shorter than this and GPS noise swamps the drift
+	const uint32_t c_MaxWindInterval  = 30000;      // ms, longer than this and we don't know which bin it drifted in
+	const uint8_t c_MaxWeight         = 120;        // s, so that a bin follows the latest pass through it
+	const int32_t c_MaxWind           = 10000;      // cm/s
+	const int16_t c_MinVerticalSpeed  = 100;        // cm/s, slower than this and it's sitting on the ground (or floating), not sampling layers
+
+	const int32_t c_BurstDrop         = 300;        // m below the highest point, and falling, before we believe it's burst
+	const int32_t c_ChuteOpenDrop     = 3000;       // m below the highest point before the parachute's settled enough to calibrate against
+	const uint8_t c_DescentScaleShift = 4;          // the descent scale follows the measured rate with a 1/16 IIR
+	const uint16_t c_MinDescentScale  = 1024;       // 4.12 fixed point, 0.25 to 4 times the model
+	const uint16_t c_MaxDescentScale  = 16384;
+
+	const int32_t c_MaxStep           = 1000;       // m, keeps the fixed point step times inside 32 bits
+	const uint8_t c_DensityShift      = 10;         // the table below has an entry every 1024 m
+
+	// sqrt(density / sea level density) in the 1976 standard atmosphere, every 1024 m from 0 to 40960 m, in 4.12
+	// fixed point; the time it takes to fall through a m goes down by this much with altitude
+	const uint16_t c_DensityTable[] PROGMEM = {
+		4096, 3897, 3704, 3516, 3332, 3155, 2982, 2814, 2652, 2495,
+		2342, 2187, 2017, 1860, 1716, 1583, 1460, 1347, 1243, 1146,
+		1056, 972, 895, 825, 760, 701, 647, 597, 551, 509,
+		470, 434, 400, 369, 340, 314, 290, 269, 249, 231,
+		214,
+	};
+
+	uint16_t DensityFactor(int32_t alt)
+	{
+		const int32_t maxAlt = (int32_t)(_countof(c_DensityTable) - 1) << c_DensityShift;
+		if (alt <= 0)
+			return pgm_read_word(&c_DensityTable[0]);
+		if (alt >= maxAlt)
+			return pgm_read_word(&c_DensityTable[_countof(c_DensityTable) - 1]);
+
+		const uint8_t i = (uint8_t)(alt >> c_DensityShift);
+		const int32_t frac = alt & ((1 << c_DensityShift) - 1);
+		const int32_t a = pgm_read_word(&c_DensityTable[i]);
+		const int32_t b = pgm_read_word(&c_DensityTable[i + 1]);
+		return (uint16_t)(a + (((b - a) * frac) >> c_DensityShift));
+	}
+
+	// s per m at a vertical speed in cm/s, in 14.18 fixed point
+	uint32_t SecondsPerM(uint32_t speed)
+	{
+		return (100ul << 18) / max(speed, (uint32_t)c_MinVerticalSpeed);
+	}
+}
+
+LandingPredictor::LandingPredictor() :
+	m_SeaLevelDescentRate(500),
+	m_HasFix(false),
+	m_Descending(false),
+	m_Time(0),
+	m_Lat(0),
+	m_Lon(0),
+	m_Alt(0),
+	m_AscentRate(0),
+	m_MaxAlt(0),
+	m_DescentScale(4096),
+	m_HasWindFix(false),
+	m_WindTime(0),
+	m_WindLat(0),
+	m_WindLon(0),
+	m_WindAlt(0)
+{
+	for (uint8_t i=0; i<c_BinCount; ++i)
+	{
+		m_Bins[i].windNorth = 0;
+		m_Bins[i].windEast = 0;
+		m_Bins[i].weight = 0;
+	}
+}
+
+void LandingPredictor::setup(const Config& config)
+{
+	m_Config = config;
+
+	// terminal velocity, where drag balances weight: v = sqrt(2 m g / (rho Cd A))
+	const float mass = config.mass * 0.001f;
+	const float dragArea = config.dragArea * 1.0e-4f;
+	const float rate = sqrt(2.0f * mass * 9.80665f / (1.225f * dragArea)) * 100.0f;
+	m_SeaLevelDescentRate = (uint16_t)Clamp(rate + 0.5f, 1.0f, 10000.0f);
+}
+
+void LandingPredictor::AddFix(uint32_t time, int32_t lat, int32_t lon, int32_t alt, int16_t ascentRate)
+{
+	if (!m_HasFix)
+		m_MaxAlt = alt;
+
+	m_HasFix = true;
+	m_Time = time;
+	m_Lat = lat;
+	m_Lon = lon;
+	m_Alt = alt;
+	m_AscentRate = ascentRate;
+	m_MaxAlt = max(m_MaxAlt, alt);
+
+	if (!m_Descending && ascentRate < 0 && alt + c_BurstDrop < m_MaxAlt)
+		m_Descending = true;
+
+	// once it's well down under the parachute, scale the model to match how fast it's really falling
+	if (m_Descending && ascentRate < 0 && alt + c_ChuteOpenDrop < m_MaxAlt)
+	{
+		const uint32_t model = max(((uint32_t)m_SeaLevelDescentRate << 12) / DensityFactor(alt), (uint32_t)1);
+		const int32_t scale = (int32_t)Clamp(((uint32_t)-ascentRate << 12) / model, (uint32_t)c_MinDescentScale, (uint32_t)c_MaxDescentScale);
+		m_DescentScale = (uint16_t)(m_DescentScale + ((scale - (int32_t)m_DescentScale) >> c_DescentScaleShift));
+	}
+
+	// the wind is the drift since a fix a few seconds ago
+	if (!m_HasWindFix || time - m_WindTime > c_MaxWindInterval || abs(ascentRate) < c_MinVerticalSpeed)
+	{
+		m_HasWindFix = true;
+		m_WindTime = time;
+		m_WindLat = lat;
+		m_WindLon = lon;
+		m_WindAlt = alt;
+		return;
+	}
+
+	const uint32_t dt = time - m_WindTime;
+	if (dt < c_MinWindInterval)
+		return;
+
+	const int32_t cosLat = max(Geodesy::Cos(Geodesy::DegE5ToAngle(lat)), c_MinCosLat);
+	const int32_t north = ((lat - m_WindLat) * c_CmPerLat) >> 8;
+	const int32_t east = (int32_t)(((int64_t)((lon - m_WindLon) * c_CmPerLat) * cosLat) >> 38);
+	const int32_t windNorth = Clamp(north * 1000 / (int32_t)dt, -c_MaxWind, c_MaxWind);
+	const int32_t windEast = Clamp(east * 1000 / (int32_t)dt, -c_MaxWind, c_MaxWind);
+
+	// fold it into the running mean for the layer it drifted through
+	Bin& bin = m_Bins[binIndex((alt + m_WindAlt) / 2)];
+	const int32_t weight = (int32_t)((dt + 500) / 1000);
+	const int32_t total = bin.weight + weight;
+	bin.windNorth = (int16_t)(bin.windNorth + (windNorth - bin.windNorth) * weight / total);
+	bin.windEast = (int16_t)(bin.windEast + (windEast - bin.windEast) * weight / total);
+	bin.weight = (uint8_t)min(total, (int32_t)c_MaxWeight);
+
+	m_WindTime = time;
+	m_WindLat = lat;
+	m_WindLon = lon;
+	m_WindAlt = alt;
+}
+
+bool LandingPredictor::IsDescending() const
+{
+	return m_Descending;
+}
+
+bool LandingPredictor::Predict(Prediction* pPrediction) const
+{
+	if (!m_HasFix || !findWind(0))
+		return false;
+
+	int32_t north = 0;
+	int32_t east = 0;
+	uint32_t time = 0;
+
+	// up to the burst altitude if it's still climbing, then down under the parachute
+	int32_t top = m_Alt;
+	if (!m_Descending && m_Alt < m_Config.burstAlt)
+	{
+		top = m_Config.burstAlt;
+		fly(m_Alt, top, SecondsPerM(max(m_AscentRate, c_MinVerticalSpeed)), false, &north, &east, &time);
+	}
+	if (top > m_Config.groundAlt)
+		fly(top, m_Config.groundAlt, SecondsPerM((uint32_t)m_SeaLevelDescentRate * m_DescentScale >> 12), true, &north, &east, &time);
+
+	const int32_t cosLat = max(Geodesy::Cos(Geodesy::DegE5ToAngle(m_Lat)), c_MinCosLat);
+	const uint32_t lonPerCm = (uint32_t)(((uint64_t)c_LatPerCm << 30) / (uint32_t)cosLat);
+
+	pPrediction->lat = m_Lat + (int32_t)(((int64_t)north * c_LatPerCm) >> 24);
+	pPrediction->lon = m_Lon + (int32_t)(((int64_t)east * lonPerCm) >> 24);
+	pPrediction->time = (time + 512) >> 10;
+	pPrediction->landingSpeed = descentRate(m_Config.groundAlt);
+	return true;
+}
+
+uint8_t LandingPredictor::binIndex(int32_t alt) const
+{
+	return (uint8_t)Clamp<int32_t>(alt / (int32_t)m_Config.binHeight, 0, c_BinCount - 1);
+}
+
+const LandingPredictor::Bin* LandingPredictor::findWind(uint8_t index) const
+{
+	// layers it hasn't flown through yet get the nearest one that it has
+	for (uint8_t d=0; d<c_BinCount; ++d)
+	{
+		if (index >= d && m_Bins[index - d].weight)
+			return &m_Bins[index - d];
+		if (index + d < c_BinCount && m_Bins[index + d].weight)
+			return &m_Bins[index + d];
+	}
+	return NULL;
+}
+
+uint16_t LandingPredictor::descentRate(int32_t alt) const
+{
+	const uint32_t model = ((uint32_t)m_SeaLevelDescentRate << 12) / DensityFactor(alt);
+	return (uint16_t)Clamp(model * m_DescentScale >> 12, (uint32_t)1, (uint32_t)0xFFFF);
+}
+
+void LandingPredictor::fly(int32_t from, int32_t to, uint32_t secondsPerM, bool descending, int32_t* pNorth, int32_t* pEast, uint32_t* pTime) const
+{
+	// one step per bin, so each step sees a single wind, and no divides in the loop; time is in s, 22.10 fixed point
+	const bool up = to > from;
+	const int32_t height = m_Config.binHeight;
+	uint8_t index = binIndex(from);
+	int32_t alt = from;
+	while (alt != to)
+	{
+		// the top and bottom bins carry on forever
+		int32_t next = up ? alt + c_MaxStep : alt - c_MaxStep;
+		if (up && index < c_BinCount - 1)
+			next = min(next, (index + 1) * height);
+		if (!up && index > 0)
+			next = max(next, index * height);
+		next = up ? min(next, to) : max(next, to);
+
+		const int32_t dh = abs(next - alt);
+		const uint32_t rate = descending ? secondsPerM * DensityFactor((alt + next) / 2) >> 12 : secondsPerM;
+		const int32_t dt = (int32_t)(dh * rate >> 8);
+		const Bin* pBin = findWind(index);
+
+		*pNorth += (pBin->windNorth * (dt >> 4)) >> 6;
+		*pEast += (pBin->windEast * (dt >> 4)) >> 6;
+		*pTime += dt;
+
+		if (up && index < c_BinCount - 1 && next == (index + 1) * height)
+			++index;
+		if (!up && index > 0 && next == index * height)
+			--index;
+		alt = next;
+	}
+}
@@ -0,0 +1,83 @@
+#ifndef _LANDING_PREDICTOR_H
+#define _LANDING_PREDICTOR_H
+
+#include <Core.h>
+
+// Predicts where the balloon will come down, using the winds it has actually flown through.
+//
+// Every fix is compared with one a few seconds older, and the horizontal drift between
+// them is averaged into the altitude bin it happened in, so by burst there's a wind
+// profile from the ground up. A prediction flies the balloon up to the expected burst
+// altitude (if it's still climbing) and then down under the parachute, bin by bin, drifting
+// with each bin's wind. The parachute falls at its terminal velocity in the standard
+// atmosphere, scaled by how fast it's really been falling once it's on the way down.
+// The bins are a fixed 200 bytes and the prediction is all integer math.
+class LandingPredictor
+{
+public:
+	static const uint8_t c_BinCount = 40;
+
+	struct Config
+	{
+		uint16_t binHeight;    // m, c_BinCount of these should reach past the burst altitude
+		uint16_t burstAlt;     // m, where we expect it to burst, for predictions made on the way up
+		int16_t groundAlt;     // m, where we expect it to come down
+		uint16_t mass;         // g, everything hanging under the parachute
+		uint16_t dragArea;     // cm^2, the parachute's drag coefficient times its area
+	};
+
+	struct Prediction
+	{
+		int32_t lat;           // 1e-5 degrees
+		int32_t lon;           // 1e-5 degrees
+		uint32_t time;         // s, from the latest fix to landing
+		uint16_t landingSpeed; // cm/s, vertical, at the ground
+	};
+
+public:
+	LandingPredictor();
+	void setup(const Config& config);
+
+	// time in ms, lat/lon in 1e-5 degrees, alt in m, ascent rate in cm/s
+	void AddFix(uint32_t time, int32_t lat, int32_t lon, int32_t alt, int16_t ascentRate);
+
+	bool IsDescending() const;
+	bool Predict(Prediction* pPrediction) const;
+
+private:
+	struct Bin
+	{
+		int16_t windNorth;     // cm/s
+		int16_t windEast;      // cm/s
+		uint8_t weight;        // s of flight averaged in, 0 until the bin's been flown through
+	};
+
+	uint8_t binIndex(int32_t alt) const;
+	const Bin* findWind(uint8_t index) const;
+	uint16_t descentRate(int32_t alt) const;
+	void fly(int32_t from, int32_t to, uint32_t secondsPerM, bool descending, int32_t* pNorth, int32_t* pEast, uint32_t* pTime) const;
+
+private:
+	Config m_Config;
+	uint16_t m_SeaLevelDescentRate;   // cm/s, terminal velocity in sea level air
+
+	bool m_HasFix;
+	bool m_Descending;
+	uint32_t m_Time;                  // ms, of the latest fix
+	int32_t m_Lat;
+	int32_t m_Lon;
+	int32_t m_Alt;
+	int16_t m_AscentRate;
+	int32_t m_MaxAlt;
+	uint16_t m_DescentScale;          // 4.12 fixed point, measured descent rate over the model's
+
+	bool m_HasWindFix;
+	uint32_t m_WindTime;              // ms, of the older fix the drift is measured from
+	int32_t m_WindLat;
+	int32_t m_WindLon;
+	int32_t m_WindAlt;
+
+	Bin m_Bins[c_BinCount];
+};
+
+#endif
@@ -9,12 +9,46 @@ float Matrix<2,2>::Determinant() const
 template<>
 Matrix<2,2> Matrix<2,2>::Inverse() const
 {
+	const float invDet = 1.0f / Determinant();
+
 	Matrix<2,2> ret;
-	ret.m[0][0] = m[0][0];
-	ret.m[0][1] = -m[1][0];
-	ret.m[1][0] = -m[0][1];
-	ret.m[1][1] = m[1][1];
-	return ret * (1 / Determinant());
+	ret.m[0][0] = m[1][1] * invDet;
+	ret.m[0][1] = -m[0][1] * invDet;
+	ret.m[1][0] = -m[1][0] * invDet;
+	ret.m[1][1] = m[0][0] * invDet;
+	return ret;
+}
+
+template<>
+float Matrix<3,3>::Determinant() const
+{
+	return
+		m[0][0] * (m[1][1] * m[2][2] - m[1][2] * m[2][1]) -
+		m[0][1] * (m[1][0] * m[2][2] - m[1][2] * m[2][0]) +
+		m[0][2] * (m[1][0] * m[2][1] - m[1][1] * m[2][0]);
+}
+
+template<>
+Matrix<3,3> Matrix<3,3>::Inverse() const
+{
+	Matrix<3,3> ret;
+	ret.m[0][0] = m[1][1] * m[2][2] - m[1][2] * m[2][1];
+	ret.m[1][0] = m[1][2] * m[2][0] - m[1][0] * m[2][2];
+	ret.m[2][0] = m[1][0] * m[2][1] - m[1][1] * m[2][0];
+
+	// the determinant falls out of the first column of cofactors
+	const float invDet = 1.0f / (m[0][0] * ret.m[0][0] + m[0][1] * ret.m[1][0] + m[0][2] * ret.m[2][0]);
+
+	ret.m[0][0] *= invDet;
+	ret.m[1][0] *= invDet;
+	ret.m[2][0] *= invDet;
+	ret.m[0][1] = (m[0][2] * m[2][1] - m[0][1] * m[2][2]) * invDet;
+	ret.m[1][1] = (m[0][0] * m[2][2] - m[0][2] * m[2][0]) * invDet;
+	ret.m[2][1] = (m[0][1] * m[2][0] - m[0][0] * m[2][1]) * invDet;
+	ret.m[0][2] = (m[0][1] * m[1][2] - m[0][2] * m[1][1]) * invDet;
+	ret.m[1][2] = (m[0][2] * m[1][0] - m[0][0] * m[1][2]) * invDet;
+	ret.m[2][2] = (m[0][0] * m[1][1] - m[0][1] * m[1][0]) * invDet;
+	return ret;
 }
 
 template<>
@@ -52,5 +86,11 @@ Matrix<4,4> Matrix<4,4>::Inverse() const
 	ret.m[3][1] = m[0][1]*m[2][2]*m[3][0] - m[0][2]*m[2][1]*m[3][0] + m[0][2]*m[2][0]*m[3][1] - m[0][0]*m[2][2]*m[3][1] - m[0][1]*m[2][0]*m[3][2] + m[0][0]*m[2][1]*m[3][2];
 	ret.m[3][2] = m[0][2]*m[1][1]*m[3][0] - m[0][1]*m[1][2]*m[3][0] - m[0][2]*m[1][0]*m[3][1] + m[0][0]*m[1][2]*m[3][1] + m[0][1]*m[1][0]*m[3][2] - m[0][0]*m[1][1]*m[3][2];
 	ret.m[3][3] = m[0][1]*m[1][2]*m[2][0] - m[0][2]*m[1][1]*m[2][0] + m[0][2]*m[1][0]*m[2][1] - m[0][0]*m[1][2]*m[2][1] - m[0][1]*m[1][0]*m[2][2] + m[0][0]*m[1][1]*m[2][2];
-	return ret * (1 / Determinant());
+
+	// reuse the cofactors rather than expanding the determinant from scratch
+	const float invDet = 1.0f / (m[0][0] * ret.m[0][0] + m[0][1] * ret.m[1][0] + m[0][2] * ret.m[2][0] + m[0][3] * ret.m[3][0]);
+	for (uint8_t r=0; r<4; ++r)
+		for (uint8_t c=0; c<4; ++c)
+			ret.m[r][c] *= invDet;
+	return ret;
 }
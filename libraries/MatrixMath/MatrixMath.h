@@ -26,12 +26,35 @@ public:
 	float m[rows][cols];
 };
 
+// Compile-time unrolled dot product of n floats, where lhs is contiguous and rhs is
+// strided by 'stride' floats. Used by the multiply kernels so that the inner loop
+// is flattened out and every product goes straight into a register accumulator.
+template <uint32_t n>
+struct MatrixDot
+{
+	template <uint32_t stride>
+	static float Dot(const float* lhs, const float* rhs)
+	{
+		return MatrixDot<n-1>::template Dot<stride>(lhs, rhs) + lhs[n-1] * rhs[(n-1) * stride];
+	}
+};
+
+template <>
+struct MatrixDot<1>
+{
+	template <uint32_t stride>
+	static float Dot(const float* lhs, const float* rhs)
+	{
+		return lhs[0] * rhs[0];
+	}
+};
+
 template <uint32_t rows, uint32_t cols>
 Matrix<rows, cols> Matrix<rows, cols>::Zero()
 {
 	Matrix<rows, cols> ret;
-	for (uint32_t r=0; r<rows; ++r)
-		for (uint32_t c=0; c<cols; ++c)
+	for (uint8_t r=0; r<rows; ++r)
+		for (uint8_t c=0; c<cols; ++c)
 			ret.m[r][c] = 0.0f;
 	return ret;
 }
@@ -40,8 +63,8 @@ template <uint32_t rows, uint32_t cols>
 Matrix<rows, cols> Matrix<rows, cols>::Identity()
 {
 	Matrix<rows, cols> ret;
-	for (uint32_t r=0; r<rows; ++r)
-		for (uint32_t c=0; c<cols; ++c)
+	for (uint8_t r=0; r<rows; ++r)
+		for (uint8_t c=0; c<cols; ++c)
 			ret.m[r][c] = (r == c ? 1.0f : 0.0f);
 	return ret;
 }
@@ -50,8 +73,8 @@ template <uint32_t rows, uint32_t cols>
 float Matrix<rows, cols>::SumSq() const
 {
 	float ret = 0;
-	for (uint32_t r=0; r<rows; ++r)
-		for (uint32_t c=0; c<cols; ++c)
+	for (uint8_t r=0; r<rows; ++r)
+		for (uint8_t c=0; c<cols; ++c)
 			ret += m[r][c] * m[r][c];
 	return ret;
 }
@@ -60,8 +83,8 @@ template <uint32_t rows, uint32_t cols>
 float Matrix<rows, cols>::Sum() const
 {
 	float ret = 0;
-	for (uint32_t r=0; r<rows; ++r)
-		for (uint32_t c=0; c<cols; ++c)
+	for (uint8_t r=0; r<rows; ++r)
+		for (uint8_t c=0; c<cols; ++c)
 			ret += m[r][c];
 	return ret;
 }
@@ -70,8 +93,8 @@ template <uint32_t rows, uint32_t cols>
 Matrix<cols, rows> Matrix<rows, cols>::Transpose() const
 {
 	Matrix<cols, rows> ret;
-	for (uint32_t r=0; r<rows; ++r)
-		for (uint32_t c=0; c<cols; ++c)
+	for (uint8_t r=0; r<rows; ++r)
+		for (uint8_t c=0; c<cols; ++c)
 			ret.m[c][r] = m[r][c];
 	return ret;
 }
@@ -80,8 +103,8 @@ template <uint32_t rows, uint32_t cols>
 Matrix<rows, cols> operator + (const Matrix<rows, cols>& lhs, const Matrix<rows, cols>& rhs)
 {
 	Matrix<rows, cols> ret = lhs;
-	for (uint32_t r=0; r<rows; ++r)
-		for (uint32_t c=0; c<cols; ++c)
+	for (uint8_t r=0; r<rows; ++r)
+		for (uint8_t c=0; c<cols; ++c)
 			ret.m[r][c] += rhs.m[r][c];
 	return ret;
 }
@@ -90,8 +113,8 @@ template <uint32_t rows, uint32_t cols>
 Matrix<rows, cols> operator - (const Matrix<rows, cols>& lhs, const Matrix<rows, cols>& rhs)
 {
 	Matrix<rows, cols> ret = lhs;
-	for (uint32_t r=0; r<rows; ++r)
-		for (uint32_t c=0; c<cols; ++c)
+	for (uint8_t r=0; r<rows; ++r)
+		for (uint8_t c=0; c<cols; ++c)
 			ret.m[r][c] -= rhs.m[r][c];
 	return ret;
 }
@@ -99,11 +122,21 @@ Matrix<rows, cols> operator - (const Matrix<rows, cols>& lhs, const Matrix<rows,
 template <uint32_t rows, uint32_t shared, uint32_t cols>
 Matrix<rows, cols> operator * (const Matrix<rows, shared>& lhs, const Matrix<shared, cols>& rhs)
 {
-	Matrix<rows, cols> ret = Matrix<rows, cols>::Zero();
-	for (uint32_t r=0; r<rows; ++r)
-		for (uint32_t c=0; c<cols; ++c)
-			for (uint32_t i=0; i<shared; ++i)
-				ret.m[r][c] += lhs.m[r][i] * rhs.m[i][c];
+	Matrix<rows, cols> ret;
+	for (uint8_t r=0; r<rows; ++r)
+		for (uint8_t c=0; c<cols; ++c)
+			ret.m[r][c] = MatrixDot<shared>::template Dot<cols>(&lhs.m[r][0], &rhs.m[0][c]);
+	return ret;
+}
+
+// lhs * rhs^T, without building the transpose
+template <uint32_t rows, uint32_t shared, uint32_t cols>
+Matrix<rows, cols> MulTranspose(const Matrix<rows, shared>& lhs, const Matrix<cols, shared>& rhs)
+{
+	Matrix<rows, cols> ret;
+	for (uint8_t r=0; r<rows; ++r)
+		for (uint8_t c=0; c<cols; ++c)
+			ret.m[r][c] = MatrixDot<shared>::template Dot<1>(&lhs.m[r][0], &rhs.m[c][0]);
 	return ret;
 }
 
@@ -111,8 +144,8 @@ template <uint32_t rows, uint32_t cols>
 Matrix<rows, cols> operator * (const Matrix<rows, cols>& lhs, float rhs)
 {
 	Matrix<rows, cols> ret = lhs;
-	for (uint32_t r=0; r<rows; ++r)
-		for (uint32_t c=0; c<cols; ++c)
+	for (uint8_t r=0; r<rows; ++r)
+		for (uint8_t c=0; c<cols; ++c)
 			ret.m[r][c] *= rhs;
 	return ret;
 }
@@ -121,8 +154,8 @@ template <uint32_t rows, uint32_t cols>
 Matrix<rows, cols> operator * (float lhs, const Matrix<rows, cols>& rhs)
 {
 	Matrix<rows, cols> ret = rhs;
-	for (uint32_t r=0; r<rows; ++r)
-		for (uint32_t c=0; c<cols; ++c)
+	for (uint8_t r=0; r<rows; ++r)
+		for (uint8_t c=0; c<cols; ++c)
 			ret.m[r][c] *= lhs;
 	return ret;
 }
@@ -130,22 +163,18 @@ Matrix<rows, cols> operator * (float lhs, const Matrix<rows, cols>& rhs)
 template <uint32_t rows, uint32_t cols>
 Matrix<rows, cols> operator / (const Matrix<rows, cols>& lhs, float rhs)
 {
-	Matrix<rows, cols> ret = lhs;
-	for (uint32_t r=0; r<rows; ++r)
-		for (uint32_t c=0; c<cols; ++c)
-			ret.m[r][c] /= rhs;
-	return ret;
+	return lhs * (1.0f / rhs);
 }
 
 template <uint32_t rows, uint32_t cols, uint32_t cols2>
 Matrix<rows, cols+cols2> CatRight(const Matrix<rows, cols>& lhs, const Matrix<rows, cols2>& rhs)
 {
 	Matrix<rows, cols+cols2> ret;
-	for (int r=0; r<rows; ++r)
-		for (int c=0; c<cols; ++c)
+	for (uint8_t r=0; r<rows; ++r)
+		for (uint8_t c=0; c<cols; ++c)
 			ret.m[r][c] = lhs.m[r][c];
-	for (int r=0; r<rows; ++r)
-		for (int c=0; c<cols2; ++c)
+	for (uint8_t r=0; r<rows; ++r)
+		for (uint8_t c=0; c<cols2; ++c)
 			ret.m[r][c + cols] = rhs.m[r][c];
 	return ret;
 }
@@ -154,11 +183,11 @@ template <uint32_t rows, uint32_t rows2, uint32_t cols>
 Matrix<rows+rows2, cols> CatDown(const Matrix<rows, cols>& lhs, const Matrix<rows2, cols>& rhs)
 {
 	Matrix<rows+rows2, cols> ret;
-	for (int r=0; r<rows; ++r)
-		for (int c=0; c<cols; ++c)
+	for (uint8_t r=0; r<rows; ++r)
+		for (uint8_t c=0; c<cols; ++c)
 			ret.m[r][c] = lhs.m[r][c];
-	for (int r=0; r<rows2; ++r)
-		for (int c=0; c<cols; ++c)
+	for (uint8_t r=0; r<rows2; ++r)
+		for (uint8_t c=0; c<cols; ++c)
 			ret.m[r + rows][c] = rhs.m[r][c];
 	return ret;
 }
@@ -167,13 +196,302 @@ template <uint32_t rows, uint32_t cols, uint32_t rows2, uint32_t cols2>
 Matrix<rows+rows2, cols+cols2> CatDiagonal(const Matrix<rows, cols>& lhs, const Matrix<rows2, cols2>& rhs)
 {
 	Matrix<rows+rows2, cols+cols2> ret = Matrix<rows+rows2, cols+cols2>::Zero();
-	for (int r=0; r<rows; ++r)
-		for (int c=0; c<cols; ++c)
+	for (uint8_t r=0; r<rows; ++r)
+		for (uint8_t c=0; c<cols; ++c)
 			ret.m[r][c] = lhs.m[r][c];
-	for (int r=0; r<rows2; ++r)
-		for (int c=0; c<cols2; ++c)
+	for (uint8_t r=0; r<rows2; ++r)
+		for (uint8_t c=0; c<cols2; ++c)
 			ret.m[r + rows][c + cols] = rhs.m[r][c];
 	return ret;
 }
 
-#endif
+
+
+// Symmetric n x n matrix, storing only the lower triangle (packed row by row), so
+// an EKF covariance takes n(n+1)/2 floats instead of n*n. After CholeskyDecompose()
+// the same storage holds L; after LDLTDecompose() it holds the unit-lower L below
+// the diagonal and D on the diagonal. Up to 4x4, ToMatrix().Inverse() and a multiply
+// is quicker than either decomposition (see tools/MatrixBench); they pay off above that.
+template <uint32_t n>
+struct SymMatrix
+{
+public:
+	static const uint32_t c_Size = n * (n + 1) / 2;
+
+	static SymMatrix<n> Zero();
+	static SymMatrix<n> Identity();
+	static SymMatrix<n> FromMatrix(const Matrix<n, n>& mat); // takes the lower triangle
+
+	static uint8_t Index(uint8_t r, uint8_t c) { return (r >= c ? r * (r + 1) / 2 + c : c * (c + 1) / 2 + r); }
+	float& operator () (uint8_t r, uint8_t c) { return m[Index(r, c)]; }
+	float operator () (uint8_t r, uint8_t c) const { return m[Index(r, c)]; }
+
+	Matrix<n, n> ToMatrix() const;
+
+	bool CholeskyDecompose();   // false if the matrix isn't positive definite
+	bool LDLTDecompose();       // false if the matrix is singular; no sqrt()
+
+	// solve A x = b, given a decomposed A
+	template <uint32_t cols> Matrix<n, cols> CholeskySolve(const Matrix<n, cols>& b) const;
+	template <uint32_t cols> Matrix<n, cols> LDLTSolve(const Matrix<n, cols>& b) const;
+
+	float m[c_Size];
+};
+
+template <uint32_t n>
+SymMatrix<n> SymMatrix<n>::Zero()
+{
+	SymMatrix<n> ret;
+	for (uint8_t i=0; i<c_Size; ++i)
+		ret.m[i] = 0.0f;
+	return ret;
+}
+
+template <uint32_t n>
+SymMatrix<n> SymMatrix<n>::Identity()
+{
+	SymMatrix<n> ret;
+	uint8_t i = 0;
+	for (uint8_t r=0; r<n; ++r)
+		for (uint8_t c=0; c<=r; ++c)
+			ret.m[i++] = (r == c ? 1.0f : 0.0f);
+	return ret;
+}
+
+template <uint32_t n>
+SymMatrix<n> SymMatrix<n>::FromMatrix(const Matrix<n, n>& mat)
+{
+	SymMatrix<n> ret;
+	uint8_t i = 0;
+	for (uint8_t r=0; r<n; ++r)
+		for (uint8_t c=0; c<=r; ++c)
+			ret.m[i++] = mat.m[r][c];
+	return ret;
+}
+
+template <uint32_t n>
+Matrix<n, n> SymMatrix<n>::ToMatrix() const
+{
+	Matrix<n, n> ret;
+	uint8_t i = 0;
+	for (uint8_t r=0; r<n; ++r)
+		for (uint8_t c=0; c<=r; ++c)
+			ret.m[r][c] = ret.m[c][r] = m[i++];
+	return ret;
+}
+
+template <uint32_t n>
+bool SymMatrix<n>::CholeskyDecompose()
+{
+	for (uint8_t j=0; j<n; ++j)
+	{
+		float* rowJ = &m[j * (j + 1) / 2];
+
+		float d = rowJ[j];
+		for (uint8_t k=0; k<j; ++k)
+			d -= rowJ[k] * rowJ[k];
+		if (d <= 0.0f)
+			return false;
+
+		const float ljj = sqrt(d);
+		const float invLjj = 1.0f / ljj;
+		rowJ[j] = ljj;
+
+		for (uint8_t i=j+1; i<n; ++i)
+		{
+			float* rowI = &m[i * (i + 1) / 2];
+			float s = rowI[j];
+			for (uint8_t k=0; k<j; ++k)
+				s -= rowI[k] * rowJ[k];
+			rowI[j] = s * invLjj;
+		}
+	}
+	return true;
+}
+
+template <uint32_t n>
+bool SymMatrix<n>::LDLTDecompose()
+{
+	float v[n] = {0};
+	for (uint8_t j=0; j<n; ++j)
+	{
+		float* rowJ = &m[j * (j + 1) / 2];
+
+		// v[k] = L(j,k) * D(k)
+		float d = rowJ[j];
+		for (uint8_t k=0; k<j; ++k)
+		{
+			v[k] = rowJ[k] * m[k * (k + 1) / 2 + k];
+			d -= rowJ[k] * v[k];
+		}
+		if (d == 0.0f)
+			return false;
+
+		const float invD = 1.0f / d;
+		rowJ[j] = d;
+
+		for (uint8_t i=j+1; i<n; ++i)
+		{
+			float* rowI = &m[i * (i + 1) / 2];
+			float s = rowI[j];
+			for (uint8_t k=0; k<j; ++k)
+				s -= rowI[k] * v[k];
+			rowI[j] = s * invD;
+		}
+	}
+	return true;
+}
+
+template <uint32_t n>
+template <uint32_t cols>
+Matrix<n, cols> SymMatrix<n>::CholeskySolve(const Matrix<n, cols>& b) const
+{
+	Matrix<n, cols> x = b;
+	for (uint8_t c=0; c<cols; ++c)
+	{
+		// forward: L y = b
+		for (uint8_t i=0; i<n; ++i)
+		{
+			const float* rowI = &m[i * (i + 1) / 2];
+			float s = x.m[i][c];
+			for (uint8_t k=0; k<i; ++k)
+				s -= rowI[k] * x.m[k][c];
+			x.m[i][c] = s / rowI[i];
+		}
+
+		// backward: L^T x = y
+		for (uint8_t i=n; i-- > 0;)
+		{
+			float s = x.m[i][c];
+			for (uint8_t k=i+1; k<n; ++k)
+				s -= m[k * (k + 1) / 2 + i] * x.m[k][c];
+			x.m[i][c] = s / m[i * (i + 1) / 2 + i];
+		}
+	}
+	return x;
+}
+
+template <uint32_t n>
+template <uint32_t cols>
+Matrix<n, cols> SymMatrix<n>::LDLTSolve(const Matrix<n, cols>& b) const
+{
+	Matrix<n, cols> x = b;
+	for (uint8_t c=0; c<cols; ++c)
+	{
+		// forward: L z = b
+		for (uint8_t i=0; i<n; ++i)
+		{
+			const float* rowI = &m[i * (i + 1) / 2];
+			float s = x.m[i][c];
+			for (uint8_t k=0; k<i; ++k)
+				s -= rowI[k] * x.m[k][c];
+			x.m[i][c] = s;
+		}
+
+		// diagonal: D y = z
+		for (uint8_t i=0; i<n; ++i)
+			x.m[i][c] /= m[i * (i + 1) / 2 + i];
+
+		// backward: L^T x = y
+		for (uint8_t i=n; i-- > 0;)
+		{
+			float s = x.m[i][c];
+			for (uint8_t k=i+1; k<n; ++k)
+				s -= m[k * (k + 1) / 2 + i] * x.m[k][c];
+			x.m[i][c] = s;
+		}
+	}
+	return x;
+}
+
+template <uint32_t n>
+SymMatrix<n> operator + (const SymMatrix<n>& lhs, const SymMatrix<n>& rhs)
+{
+	SymMatrix<n> ret = lhs;
+	for (uint8_t i=0; i<SymMatrix<n>::c_Size; ++i)
+		ret.m[i] += rhs.m[i];
+	return ret;
+}
+
+template <uint32_t n>
+SymMatrix<n> operator - (const SymMatrix<n>& lhs, const SymMatrix<n>& rhs)
+{
+	SymMatrix<n> ret = lhs;
+	for (uint8_t i=0; i<SymMatrix<n>::c_Size; ++i)
+		ret.m[i] -= rhs.m[i];
+	return ret;
+}
+
+template <uint32_t n>
+SymMatrix<n> operator * (const SymMatrix<n>& lhs, float rhs)
+{
+	SymMatrix<n> ret = lhs;
+	for (uint8_t i=0; i<SymMatrix<n>::c_Size; ++i)
+		ret.m[i] *= rhs;
+	return ret;
+}
+
+template <uint32_t n, uint32_t cols>
+Matrix<n, cols> operator * (const SymMatrix<n>& lhs, const Matrix<n, cols>& rhs)
+{
+	Matrix<n, cols> ret;
+	for (uint8_t r=0; r<n; ++r)
+	{
+		for (uint8_t c=0; c<cols; ++c)
+		{
+			float s = 0.0f;
+			for (uint8_t i=0; i<n; ++i)
+				s += lhs(r, i) * rhs.m[i][c];
+			ret.m[r][c] = s;
+		}
+	}
+	return ret;
+}
+
+// The row vector a times P, walking P's packed storage in order rather than looking up
+// each element: each off-diagonal element goes into two sums.
+template <uint32_t n>
+void MulSymRow(const float* a, const SymMatrix<n>& P, float* ret)
+{
+	for (uint8_t j=0; j<n; ++j)
+		ret[j] = 0.0f;
+	const float* p = P.m;
+	for (uint8_t i=0; i<n; ++i)
+	{
+		for (uint8_t j=0; j<i; ++j, ++p)
+		{
+			ret[j] += a[i] * *p;
+			ret[i] += a[j] * *p;
+		}
+		ret[i] += a[i] * *p++;
+	}
+}
+
+template <uint32_t rows, uint32_t n>
+Matrix<rows, n> operator * (const Matrix<rows, n>& lhs, const SymMatrix<n>& rhs)
+{
+	Matrix<rows, n> ret;
+	for (uint8_t r=0; r<rows; ++r)
+		MulSymRow(&lhs.m[r][0], rhs, &ret.m[r][0]);
+	return ret;
+}
+
+// A * P * A^T, only computing the lower triangle of the (symmetric) result.
+// This is the covariance propagation/update step of a Kalman filter.
+template <uint32_t rows, uint32_t n>
+SymMatrix<rows> Sandwich(const Matrix<rows, n>& A, const SymMatrix<n>& P)
+{
+	SymMatrix<rows> ret;
+	uint8_t index = 0;
+	for (uint8_t r=0; r<rows; ++r)
+	{
+		// one row of A P at a time, rather than all of it
+		float AP[n];
+		MulSymRow(&A.m[r][0], P, AP);
+		for (uint8_t c=0; c<=r; ++c)
+			ret.m[index++] = MatrixDot<n>::template Dot<1>(AP, &A.m[c][0]);
+	}
+	return ret;
+}
+
+#endif
@@ -0,0 +1,52 @@
+#include "IdleManager.h"
+#include <avr/sleep.h>
+
+IdleManager::IdleManager() :
+	m_WakeCount(0),
+	m_LastChange(micros())
+{
+	for (uint8_t i=0; i<EState::EnumCount; ++i)
+	{
+		m_Millis[i] = 0;
+		m_Micros[i] = 0;
+	}
+}
+
+void IdleManager::loop(uint32_t timeUntilNext)
+{
+	if (timeUntilNext > 0)
+		Sleep();
+}
+
+void IdleManager::Sleep()
+{
+	account(EState::Awake);
+
+	// Timer0 will have us awake again within 1.024 ms whatever else happens
+	set_sleep_mode(SLEEP_MODE_IDLE);
+	sleep_mode();
+
+	++m_WakeCount;
+	account(EState::Asleep);
+}
+
+uint32_t IdleManager::GetResidency(EState::Enum state) const
+{
+	return m_Millis[state];
+}
+
+uint32_t IdleManager::GetWakeCount() const
+{
+	return m_WakeCount;
+}
+
+void IdleManager::account(EState::Enum state)
+{
+	// everything since the last change was in this state
+	const uint32_t now = micros();
+	const uint32_t duration = now - m_LastChange + m_Micros[state];
+	m_LastChange = now;
+
+	m_Millis[state] += duration / 1000;
+	m_Micros[state] = duration % 1000;
+}
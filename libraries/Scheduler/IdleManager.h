@@ -0,0 +1,51 @@
+#ifndef _IDLE_MANAGER_H
+#define _IDLE_MANAGER_H
+
+#include <Core.h>
+
+// Sleeps between a Scheduler's tasks, instead of spinning through loop() until the next
+// one's due.
+//
+// Only the AVR's idle mode is used. It stops the CPU's clock and nothing else, so Timer0
+// still wakes it every 1.024 ms for millis(), and the UARTs, the TWI, Timer1 and Timer2's
+// PWM (the AFSK tone while an APRS packet's going out) carry on and wake it with their
+// own interrupts. Power-save would stop Timer0 and the UARTs too, losing millis() and the
+// GPS's bytes, so it's no use while the GPS is streaming. The time spent awake and asleep
+// is kept, so the duty cycle, and from that the current saved, can be logged.
+class IdleManager
+{
+public:
+	struct EState
+	{
+		enum Enum
+		{
+			Awake,
+			Asleep,
+
+			EnumCount
+		};
+	};
+
+public:
+	IdleManager();
+
+	// sleeps until the next interrupt, if there's nothing due yet
+	void loop(uint32_t timeUntilNext);
+
+	// sleeps until the next interrupt, for waiting on something an ISR's doing
+	void Sleep();
+
+	uint32_t GetResidency(EState::Enum state) const;   // ms, since reset
+	uint32_t GetWakeCount() const;
+
+private:
+	void account(EState::Enum state);
+
+private:
+	uint32_t m_Millis[EState::EnumCount];
+	uint16_t m_Micros[EState::EnumCount];   // under a ms, still to go into m_Millis
+	uint32_t m_WakeCount;
+	uint32_t m_LastChange;                  // micros()
+};
+
+#endif
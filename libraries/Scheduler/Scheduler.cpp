@@ -0,0 +1,183 @@
+#include "Scheduler.h"
+#include <Profiler.h>
+
+namespace
+{
+	// whether time a comes before time b, allowing for millis() wrapping
+	bool TimeBefore(uint32_t a, uint32_t b)
+	{
+		return (int32_t)(a - b) < 0;
+	}
+}
+
+Scheduler::Scheduler() :
+	m_TaskCount(0),
+	m_pProfiler(NULL)
+{
+}
+
+uint8_t Scheduler::Add(TaskFunction function, uint16_t period, uint16_t phase, uint16_t deadline)
+{
+	if (m_TaskCount >= c_MaxTasks || !function)
+		return c_InvalidTask;
+
+	const uint8_t index = m_TaskCount++;
+	Task& task = m_Tasks[index];
+	task.function = function;
+	task.period = period;
+	task.deadline = (deadline ? deadline : max(period, (uint16_t)1));
+	task.due = phase;
+	task.lastRun = 0;
+	task.stats.overrunCount = 0;
+	task.stats.skipCount = 0;
+	task.stats.maxLateness = 0;
+
+	m_Heap[index] = index;
+	siftUp(index);
+	return index;
+}
+
+void Scheduler::Start(uint32_t now)
+{
+	// adding the same time to everything leaves the heap in order
+	for (uint8_t i=0; i<m_TaskCount; ++i)
+	{
+		m_Tasks[i].due += now;
+		m_Tasks[i].lastRun = now;
+	}
+}
+
+void Scheduler::SetProfiler(Profiler* pProfiler)
+{
+	m_pProfiler = pProfiler;
+}
+
+bool Scheduler::loop()
+{
+	// only what's due as of now, so that period 0 tasks run once a pass
+	const uint32_t now = millis();
+	bool ran = false;
+	while (m_TaskCount && !TimeBefore(now, m_Tasks[m_Heap[0]].due))
+	{
+		const uint8_t index = m_Heap[0];
+		Task& task = m_Tasks[index];
+		const uint32_t start = millis();
+		const uint32_t lateness = start - task.due;
+		task.stats.maxLateness = (uint16_t)min(max(lateness, (uint32_t)task.stats.maxLateness), (uint32_t)0xFFFF);
+		if (lateness > task.deadline && task.stats.overrunCount < 0xFFFF)
+			++task.stats.overrunCount;
+
+		const uint32_t dt = start - task.lastRun;
+		task.lastRun = start;
+		reschedule(task, now);
+		siftDown(0);
+
+		if (m_pProfiler)
+		{
+			ProfileScope scope(m_pProfiler, index);
+			task.function(start, dt);
+		}
+		else
+		{
+			task.function(start, dt);
+		}
+		ran = true;
+	}
+	return ran;
+}
+
+void Scheduler::SetPeriod(uint8_t task, uint16_t period, uint16_t deadline)
+{
+	if (task >= m_TaskCount)
+		return;
+
+	m_Tasks[task].period = period;
+	m_Tasks[task].deadline = (deadline ? deadline : max(period, (uint16_t)1));
+}
+
+uint32_t Scheduler::GetTimeUntilNext(uint32_t now) const
+{
+	if (!m_TaskCount)
+		return 0xFFFFFFFFul;
+
+	const uint32_t due = m_Tasks[m_Heap[0]].due;
+	return TimeBefore(now, due) ? due - now : 0;
+}
+
+uint32_t Scheduler::GetTimeUntil(uint8_t task, uint32_t now) const
+{
+	if (task >= m_TaskCount)
+		return 0xFFFFFFFFul;
+
+	const uint32_t due = m_Tasks[task].due;
+	return TimeBefore(now, due) ? due - now : 0;
+}
+
+uint8_t Scheduler::GetTaskCount() const
+{
+	return m_TaskCount;
+}
+
+const Scheduler::Stats& Scheduler::GetStats(uint8_t task) const
+{
+	return m_Tasks[min(task, (uint8_t)(m_TaskCount - 1))].stats;
+}
+
+void Scheduler::reschedule(Task& task, uint32_t now)
+{
+	if (!task.period)
+	{
+		task.due = now + 1;
+		return;
+	}
+
+	task.due += task.period;
+	if (!TimeBefore(now, task.due))
+	{
+		// we've fallen a whole period or more behind, so skip to the next one that's still to come
+		const uint32_t behind = (now - task.due) / task.period + 1;
+		task.stats.skipCount = (uint16_t)min(task.stats.skipCount + behind, (uint32_t)0xFFFF);
+		task.due += behind * task.period;
+	}
+}
+
+bool Scheduler::isBefore(uint8_t a, uint8_t b) const
+{
+	return TimeBefore(m_Tasks[m_Heap[a]].due, m_Tasks[m_Heap[b]].due);
+}
+
+void Scheduler::siftDown(uint8_t index)
+{
+	for (;;)
+	{
+		const uint8_t left = index * 2 + 1;
+		const uint8_t right = left + 1;
+		uint8_t soonest = index;
+		if (left < m_TaskCount && isBefore(left, soonest))
+			soonest = left;
+		if (right < m_TaskCount && isBefore(right, soonest))
+			soonest = right;
+		if (soonest == index)
+			return;
+
+		const uint8_t swap = m_Heap[index];
+		m_Heap[index] = m_Heap[soonest];
+		m_Heap[soonest] = swap;
+		index = soonest;
+	}
+}
+
+void Scheduler::siftUp(uint8_t index)
+{
+	while (index > 0)
+	{
+		const uint8_t parent = (index - 1) / 2;
+		if (!isBefore(index, parent))
+			return;
+
+		const uint8_t swap = m_Heap[index];
+		m_Heap[index] = m_Heap[parent];
+		m_Heap[parent] = swap;
+		index = parent;
+	}
+}
@@ -0,0 +1,77 @@
+#ifndef _SCHEDULER_H
+#define _SCHEDULER_H
+
+#include <Core.h>
+
+class Profiler;
+
+// Runs an app's periodic work when it's due, instead of every pass through loop().
+//
+// Each task is a function with a period and a phase: it's due at start + phase, then
+// every period after that, so tasks with the same period can be staggered so they don't
+// bunch up in one pass. A period of 0 means once a pass, at most once a millisecond, for
+// polling a serial port; its deadline is then the longest it can go between runs.
+// Everything's added in setup(), before Start(). The next due task is kept at the top
+// of a min-heap, so loop() can tell straight away whether there's anything to do, and
+// how long until there is. A task that starts more than its deadline late counts as an
+// overrun; one that's a whole period or more behind skips the periods it missed rather
+// than running them back to back. Given a Profiler, each task's run time goes into the
+// section with the task's index.
+class Scheduler
+{
+public:
+	static const uint8_t c_MaxTasks = 8;
+	static const uint8_t c_InvalidTask = 0xFF;
+
+	// now, and ms since the task last ran (or since Start())
+	typedef void (*TaskFunction)(uint32_t now, uint32_t dt);
+
+	struct Stats
+	{
+		uint16_t overrunCount;    // runs that started later than the deadline
+		uint16_t skipCount;       // periods that were missed altogether
+		uint16_t maxLateness;     // ms
+	};
+
+public:
+	Scheduler();
+
+	// all times in ms; a deadline of 0 means the period, returns c_InvalidTask if the table's full
+	uint8_t Add(TaskFunction function, uint16_t period, uint16_t phase = 0, uint16_t deadline = 0);
+	void Start(uint32_t now);
+	void SetProfiler(Profiler* pProfiler);
+
+	// runs everything that's due, in the order it fell due, and returns whether anything ran
+	bool loop();
+
+	void SetPeriod(uint8_t task, uint16_t period, uint16_t deadline = 0);   // from the task's next run
+	uint32_t GetTimeUntilNext(uint32_t now) const;   // ms, 0 if something's due
+	uint32_t GetTimeUntil(uint8_t task, uint32_t now) const;   // ms, 0 if it's due
+	uint8_t GetTaskCount() const;
+	const Stats& GetStats(uint8_t task) const;
+
+private:
+	struct Task
+	{
+		TaskFunction function;
+		uint16_t period;
+		uint16_t deadline;
+		uint32_t due;             // ms, just the phase until Start()
+		uint32_t lastRun;
+		Stats stats;
+	};
+
+	bool isBefore(uint8_t a, uint8_t b) const;
+	void siftDown(uint8_t index);
+	void siftUp(uint8_t index);
+	void reschedule(Task& task, uint32_t now);
+
+private:
+	Task m_Tasks[c_MaxTasks];
+	uint8_t m_TaskCount;
+
+	uint8_t m_Heap[c_MaxTasks];   // task indices, soonest due first
+	Profiler* m_pProfiler;
+};
+
+#endif
@@ -0,0 +1,215 @@
+#include "Timebase.h"
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+#if defined(__AVR_ATmega1280__) || defined(__AVR_ATmega2560__)
+	#define TIMEBASE_TCCRA       TCCR5A
+	#define TIMEBASE_TCCRB       TCCR5B
+	#define TIMEBASE_TIMSK       TIMSK5
+	#define TIMEBASE_TCNT        TCNT5
+	#define TIMEBASE_ICR         ICR5
+	#define TIMEBASE_ICIE        ICIE5
+	#define TIMEBASE_ICNC        ICNC5
+	#define TIMEBASE_ICES        ICES5
+	#define TIMEBASE_CS          CS51
+	#define TIMEBASE_CAPT_vect   TIMER5_CAPT_vect
+	#define TIMEBASE_ICP_PIN     48
+#else
+	#define TIMEBASE_TCCRA       TCCR1A
+	#define TIMEBASE_TCCRB       TCCR1B
+	#define TIMEBASE_TIMSK       TIMSK1
+	#define TIMEBASE_TCNT        TCNT1
+	#define TIMEBASE_ICR         ICR1
+	#define TIMEBASE_ICIE        ICIE1
+	#define TIMEBASE_ICNC        ICNC1
+	#define TIMEBASE_ICES        ICES1
+	#define TIMEBASE_CS          CS11
+	#define TIMEBASE_CAPT_vect   TIMER1_CAPT_vect
+	#define TIMEBASE_ICP_PIN     8
+#endif
+
+Timebase g_Timebase;
+
+namespace
+{
+	const uint32_t c_TimerTicksPerMicro  = F_CPU / 8000000ul;   // the timer runs at clk/8
+	const uint32_t c_SecondsPerDay       = 86400ul;
+	const uint32_t c_MaxGap              = 16;                   // s, PPS can drop out this long and still have its seconds counted
+	const uint32_t c_MaxErrorPerSecond   = 10000ul;              // us, 1% covers a ceramic resonator
+	const uint8_t c_MaxRejects           = 3;                    // edges in a row that don't fit before we start over from the latest
+	const int32_t c_RateFilter           = 8;                    // edges it takes the rate estimate to settle
+	const uint32_t c_LockTimeout         = 2500000ul;            // us without an edge before we're no longer locked
+	const int32_t c_Holdover             = 60000000l;            // us either side of the latest edge that we'll convert stamps for
+}
+
+ISR(TIMEBASE_CAPT_vect)
+{
+	// the capture unit latched the edge, so take off however long this interrupt was held off for
+	const uint16_t capture = TIMEBASE_ICR;
+	const uint16_t count = TIMEBASE_TCNT;
+	const uint32_t now = micros();
+	g_Timebase.OnCapture(now - (uint16_t)(count - capture) / c_TimerTicksPerMicro);
+}
+
+Timebase::Timebase() :
+	m_CaptureMicros(0),
+	m_CapturePending(false),
+	m_HasEdge(false),
+	m_HasRate(false),
+	m_HasLabel(false),
+	m_RejectCount(0),
+	m_PPSCount(0),
+	m_EdgeMicros(0),
+	m_EdgeSeconds(0),
+	m_MicrosPerSecond(1000000ul << 4),
+	m_Scale(1ul << 24)
+{
+}
+
+void Timebase::setup()
+{
+	pinMode(TIMEBASE_ICP_PIN, INPUT);
+
+	// free running at clk/8, capturing rising edges through the noise canceller
+	noInterrupts();
+	TIMEBASE_TCCRA = 0;
+	TIMEBASE_TCCRB = _BV(TIMEBASE_ICNC) | _BV(TIMEBASE_ICES) | _BV(TIMEBASE_CS);
+	TIMEBASE_TIMSK = _BV(TIMEBASE_ICIE);
+	interrupts();
+}
+
+void Timebase::loop()
+{
+	noInterrupts();
+	const bool pending = m_CapturePending;
+	const uint32_t edge = m_CaptureMicros;
+	m_CapturePending = false;
+	interrupts();
+
+	if (pending)
+		processEdge(edge);
+}
+
+void Timebase::SetGPSTime(unsigned long time, unsigned long age)
+{
+	// make sure we're looking at the newest edge
+	loop();
+
+	const uint32_t hours = time / 1000000ul;
+	const uint32_t minutes = time / 10000ul % 100;
+	const uint32_t seconds = time / 100ul % 100;
+	const uint32_t hundredths = time % 100;
+	if (!m_HasEdge || hours >= 24 || minutes >= 60 || seconds >= 60)
+		return;
+
+	// the fix for second S arrives after S's edge and, as long as it wasn't delayed too much, before S+1's
+	const int32_t sinceEdge = (int32_t)(micros() - age * 1000ul - m_EdgeMicros);
+	if (sinceEdge < (int32_t)(hundredths * 10000ul) || sinceEdge >= 1000000l)
+		return;
+
+	m_EdgeSeconds = hours * 3600ul + minutes * 60ul + seconds;
+	m_HasLabel = true;
+}
+
+bool Timebase::IsLocked() const
+{
+	return m_HasLabel && m_HasRate && micros() - m_EdgeMicros < c_LockTimeout;
+}
+
+uint32_t Timebase::GetPPSCount() const
+{
+	return m_PPSCount;
+}
+
+int32_t Timebase::GetClockErrorInPPM() const
+{
+	return ((int32_t)m_MicrosPerSecond - (int32_t)(1000000ul << 4)) / 16;
+}
+
+bool Timebase::GetTime(Timestamp* pTime) const
+{
+	return MicrosToTime(micros(), pTime);
+}
+
+bool Timebase::MicrosToTime(uint32_t micros, Timestamp* pTime) const
+{
+	if (!m_HasLabel)
+		return false;
+
+	const int32_t delta = (int32_t)(micros - m_EdgeMicros);
+	if (delta > c_Holdover || delta < -c_Holdover)
+		return false;
+
+	const int32_t elapsed = (int32_t)(((int64_t)delta * m_Scale) >> 24);
+	int32_t seconds = elapsed / 1000000l;
+	int32_t fraction = elapsed % 1000000l;
+	if (fraction < 0)
+	{
+		fraction += 1000000l;
+		--seconds;
+	}
+
+	pTime->seconds = (m_EdgeSeconds + c_SecondsPerDay + seconds) % c_SecondsPerDay;
+	pTime->micros = fraction;
+	return true;
+}
+
+bool Timebase::MillisToTime(uint32_t millis, Timestamp* pTime) const
+{
+	// millis() and micros() both count Timer0 overflows, so this lines up with micros() to within a ms
+	return MicrosToTime(millis * 1000ul, pTime);
+}
+
+void Timebase::OnCapture(uint32_t micros)
+{
+	m_CaptureMicros = micros;
+	m_CapturePending = true;
+}
+
+void Timebase::processEdge(uint32_t edge)
+{
+	if (m_HasEdge)
+	{
+		const uint32_t interval = edge - m_EdgeMicros;
+		const uint32_t seconds = (interval + 500000ul) / 1000000ul;
+		const uint32_t nominal = seconds * 1000000ul;
+		const uint32_t error = interval > nominal ? interval - nominal : nominal - interval;
+
+		if (seconds > c_MaxGap)
+		{
+			// we've lost count of the seconds
+			m_HasLabel = false;
+		}
+		else if (seconds == 0 || error > seconds * c_MaxErrorPerSecond)
+		{
+			// a glitch on the line, unless it keeps happening
+			if (++m_RejectCount < c_MaxRejects)
+				return;
+
+			m_HasLabel = false;
+			m_HasRate = false;
+		}
+		else
+		{
+			const uint32_t perSecond = (interval << 4) / seconds;
+			if (m_HasRate)
+			{
+				m_MicrosPerSecond += (int32_t)(perSecond - m_MicrosPerSecond) / c_RateFilter;
+			}
+			else
+			{
+				m_MicrosPerSecond = perSecond;
+				m_HasRate = true;
+			}
+			m_Scale = (uint32_t)((1000000ull << 28) / m_MicrosPerSecond);
+
+			if (m_HasLabel)
+				m_EdgeSeconds = (m_EdgeSeconds + seconds) % c_SecondsPerDay;
+		}
+	}
+
+	m_RejectCount = 0;
+	m_HasEdge = true;
+	m_EdgeMicros = edge;
+	++m_PPSCount;
+}
@@ -0,0 +1,68 @@
+#ifndef _TIMEBASE_H
+#define _TIMEBASE_H
+
+#include <Core.h>
+
+// GPS-disciplined time of day.
+//
+// The GPS's PPS output is captured by a 16-bit timer's input capture unit, which
+// latches the exact edge even when the interrupt is held off by serial traffic. The
+// capture is translated back onto the micros() clock, and the spacing of successive
+// edges measures how fast micros() really runs, so any micros()/millis() stamp a
+// driver or the log writer already keeps can be turned into GPS time to within a few
+// microseconds. The PPS edges are labelled with UTC seconds by passing each fix's
+// time to SetGPSTime().
+//
+// The PPS input has to be the timer's ICP pin:
+//   ATmega168/328:     Timer1, ICP1 on digital pin 8
+//   ATmega1280/2560:   Timer5, ICP5 on digital pin 48
+// so this can't share Timer1 with TimerOne on the smaller chips.
+class Timebase
+{
+public:
+	struct Timestamp
+	{
+		uint32_t seconds;   // since UTC midnight
+		uint32_t micros;    // [0..1000000)
+	};
+
+public:
+	Timebase();
+	void setup();
+	void loop();
+
+	// time is TinyGPS hhmmsscc, and age is how long ago (in ms) the fix was received
+	void SetGPSTime(unsigned long time, unsigned long age);
+
+	bool IsLocked() const;
+	uint32_t GetPPSCount() const;
+	int32_t GetClockErrorInPPM() const;        // how fast micros() runs compared to GPS time
+
+	bool GetTime(Timestamp* pTime) const;
+	bool MicrosToTime(uint32_t micros, Timestamp* pTime) const;
+	bool MillisToTime(uint32_t millis, Timestamp* pTime) const;
+
+	void OnCapture(uint32_t micros);           // called from the capture interrupt
+
+private:
+	void processEdge(uint32_t edge);
+
+private:
+	volatile uint32_t m_CaptureMicros;
+	volatile bool m_CapturePending;
+
+	bool m_HasEdge;
+	bool m_HasRate;
+	bool m_HasLabel;
+	uint8_t m_RejectCount;                     // edges in a row that didn't fit
+	uint32_t m_PPSCount;
+
+	uint32_t m_EdgeMicros;                     // micros() at the latest PPS edge
+	uint32_t m_EdgeSeconds;                    // UTC seconds at that edge, once labelled
+	uint32_t m_MicrosPerSecond;                // 28.4 fixed point, filtered
+	uint32_t m_Scale;                          // 8.24 fixed point, GPS us per micros() us
+};
+
+extern Timebase g_Timebase;
+
+#endif
@@ -0,0 +1,298 @@
+#include "VenusGPS.h"
+
+const uint8_t c_StartSequence[2]	= {0xA0, 0xA1};
+const uint8_t c_EndSequence[2]		= {0x0D, 0x0A};
+
+const uint32_t c_GPSEpochDays		= 3657;      // 1980-01-06, in days since 1970-01-01
+const uint32_t c_SecondsPerWeek		= 604800;
+const uint32_t c_SecondsPerDay		= 86400;
+
+template <typename T>
+T ReadBigEndian(const uint8_t* data)
+{
+	T t;
+	for (uint8_t i=0; i<sizeof(T); ++i)
+		reinterpret_cast<uint8_t*>(&t)[sizeof(T) - i - 1] = data[i];
+	return t;
+}
+
+// days since 1970-01-01 to a ddmmyy date, as TinyGPS reports it
+uint32_t DaysToDate(uint32_t days)
+{
+	// shift to a March-based year, so that the leap day is at the end
+	days += 719468;
+	const uint32_t era = days / 146097;
+	const uint32_t dayOfEra = days - era * 146097;
+	const uint32_t yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+	const uint32_t dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+	const uint32_t mp = (5 * dayOfYear + 2) / 153;
+	const uint32_t day = dayOfYear - (153 * mp + 2) / 5 + 1;
+	const uint32_t month = mp < 10 ? mp + 3 : mp - 9;
+	const uint32_t year = yearOfEra + era * 400 + (month <= 2 ? 1 : 0);
+
+	return day * 10000 + month * 100 + year % 100;
+}
+
+VenusGPS::VenusGPS(Stream* pStream) :
+	m_pStream(pStream),
+	m_NextSection(ENextSection::PacketStart),
+	m_Length(0),
+	m_Offset(0),
+	m_Checksum(0),
+	m_LastACK(0),
+	m_LastNACK(0),
+	m_GPSWeek(0),
+	m_TimeOfWeek(0)
+#ifndef _GPS_NO_STATS
+	,
+	m_GoodMessages(0),
+	m_FailedMessages(0)
+#endif
+{
+}
+
+bool VenusGPS::encode(char c)
+{
+	const uint8_t data = (uint8_t)c;
+
+	switch (m_NextSection)
+	{
+	case ENextSection::PacketStart:
+		if (data == c_StartSequence[0])
+			m_NextSection = ENextSection::PacketStart2;
+		else
+			return TinyGPS::encode(c);
+		break;
+
+	case ENextSection::PacketStart2:
+		m_NextSection = (data == c_StartSequence[1] ? ENextSection::PacketLength : ENextSection::PacketStart);
+		break;
+
+	case ENextSection::PacketLength:
+		m_Length = (uint16_t)data << 8;
+		m_NextSection = ENextSection::PacketLength2;
+		break;
+
+	case ENextSection::PacketLength2:
+		m_Length |= data;
+		m_Offset = 0;
+		m_Checksum = 0;
+		if (m_Length == 0 || m_Length > c_MaxPayloadLength)
+		{
+			// nothing we send for is this long, so it's a corrupt length or a false start
+#ifndef _GPS_NO_STATS
+			++m_FailedMessages;
+#endif
+			m_NextSection = ENextSection::PacketStart;
+		}
+		else
+		{
+			m_NextSection = ENextSection::Payload;
+		}
+		break;
+
+	case ENextSection::Payload:
+		m_Payload[m_Offset] = data;
+		m_Checksum ^= data;
+		if (++m_Offset == m_Length)
+			m_NextSection = ENextSection::Checksum;
+		break;
+
+	case ENextSection::Checksum:
+		if (data == m_Checksum)
+		{
+			m_NextSection = ENextSection::PacketEnd;
+		}
+		else
+		{
+#ifndef _GPS_NO_STATS
+			++m_FailedMessages;
+#endif
+			m_NextSection = ENextSection::PacketStart;
+		}
+		break;
+
+	case ENextSection::PacketEnd:
+		m_NextSection = (data == c_EndSequence[0] ? ENextSection::PacketEnd2 : ENextSection::PacketStart);
+		break;
+
+	case ENextSection::PacketEnd2:
+		m_NextSection = ENextSection::PacketStart;
+		if (data == c_EndSequence[1])
+		{
+			++_valid_sentences;
+#ifndef _GPS_NO_STATS
+			++m_GoodMessages;
+#endif
+			return ProcessMessage();
+		}
+		break;
+	}
+
+	return false;
+}
+
+void VenusGPS::ConfigureSerialPort(uint32_t baud, EAttributes::Enum attributes)
+{
+	static const uint32_t c_Bauds[] = {4800, 9600, 19200, 38400, 57600, 115200};
+
+	uint8_t index = 0;
+	while (index + 1 < _countof(c_Bauds) && c_Bauds[index] < baud)
+		++index;
+
+	const uint8_t payload[] = {c_MessageID_ConfigureSerialPort, 0x00, index, (uint8_t)attributes};
+	SendCommand(payload, sizeof(payload));
+}
+
+void VenusGPS::ConfigureMessageType(EMessageType::Enum type, EAttributes::Enum attributes)
+{
+	const uint8_t payload[] = {c_MessageID_ConfigureMessageType, (uint8_t)type, (uint8_t)attributes};
+	SendCommand(payload, sizeof(payload));
+}
+
+void VenusGPS::ConfigurePositionRate(uint8_t hz, EAttributes::Enum attributes)
+{
+	const uint8_t payload[] = {c_MessageID_ConfigurePositionRate, hz, (uint8_t)attributes};
+	SendCommand(payload, sizeof(payload));
+}
+
+void VenusGPS::SendCommand(const uint8_t* payload, uint16_t size)
+{
+	TransmitRaw(c_StartSequence[0]);
+	TransmitRaw(c_StartSequence[1]);
+	TransmitRaw(size >> 8);
+	TransmitRaw(size & 0xFF);
+
+	uint8_t checksum = 0;
+	for (uint16_t i=0; i<size; ++i)
+		checksum ^= TransmitRaw(payload[i]);
+
+	TransmitRaw(checksum);
+	TransmitRaw(c_EndSequence[0]);
+	TransmitRaw(c_EndSequence[1]);
+}
+
+uint8_t VenusGPS::GetLastACK() const
+{
+	return m_LastACK;
+}
+
+uint8_t VenusGPS::GetLastNACK() const
+{
+	return m_LastNACK;
+}
+
+void VenusGPS::ClearACKs()
+{
+	m_LastACK = 0;
+	m_LastNACK = 0;
+}
+
+uint16_t VenusGPS::GetGPSWeek() const
+{
+	return m_GPSWeek;
+}
+
+uint32_t VenusGPS::GetTimeOfWeek() const
+{
+	return m_TimeOfWeek;
+}
+
+#ifndef _GPS_NO_STATS
+uint16_t VenusGPS::GetGoodMessages() const
+{
+	return m_GoodMessages;
+}
+
+uint16_t VenusGPS::GetFailedMessages() const
+{
+	return m_FailedMessages;
+}
+#endif
+
+bool VenusGPS::ProcessMessage()
+{
+	switch (m_Payload[0])
+	{
+	case c_MessageID_ACK:
+		if (m_Length >= 2)
+			m_LastACK = m_Payload[1];
+		return false;
+
+	case c_MessageID_NACK:
+		if (m_Length >= 2)
+			m_LastNACK = m_Payload[1];
+		return false;
+
+	case c_MessageID_NavigationData:
+		if (m_Length < 59)
+			return false;
+		ProcessNavigationData();
+		return _fix_type >= 2;
+	}
+
+	return false;
+}
+
+void VenusGPS::ProcessNavigationData()
+{
+	// 0: ID, 1: fix mode, 2: SVs in fix, 3: week, 5: TOW (10 ms), 9: lat, 13: lon (1e-7 deg), 17: ellipsoid alt,
+	// 21: MSL alt (cm), 25: GDOP, 27: PDOP, 29: HDOP, 31: VDOP, 33: TDOP (0.01), 35: ECEF pos (cm), 47: ECEF vel (cm/s)
+	const uint8_t* p = m_Payload;
+	const uint8_t fixMode = p[1];
+
+	// 0 = no fix, 1 = 2D, 2 = 3D, 3 = 3D + DGPS, reported the way GPGGA/GPGSA would have
+	_fix_type = fixMode == 0 ? 1 : (fixMode == 1 ? 2 : 3);
+	_fix_quality = fixMode == 0 ? 0 : (fixMode == 3 ? 2 : 1);
+	_numsats = p[2];
+
+	m_GPSWeek = ReadBigEndian<uint16_t>(p + 3);
+	m_TimeOfWeek = ReadBigEndian<uint32_t>(p + 5);
+
+	const uint32_t now = millis();
+
+	// GPS time to UTC
+	const uint32_t gpsSeconds = m_GPSWeek * c_SecondsPerWeek + m_TimeOfWeek / 100 - c_LeapSeconds;
+	const uint32_t secondOfDay = gpsSeconds % c_SecondsPerDay;
+	_date = DaysToDate(c_GPSEpochDays + gpsSeconds / c_SecondsPerDay);
+	_time = (secondOfDay / 3600) * 1000000 + ((secondOfDay / 60) % 60) * 10000 + (secondOfDay % 60) * 100 + m_TimeOfWeek % 100;
+	_last_time_fix = now;
+
+	_pdop = ReadBigEndian<uint16_t>(p + 27);
+	_hdop = ReadBigEndian<uint16_t>(p + 29);
+	_vdop = ReadBigEndian<uint16_t>(p + 31);
+
+	if (fixMode == 0)
+		return;
+
+	// 1e-7 degrees to TinyGPS's 1e-5, rounding away from zero at the halfway point like TinyGPS would
+	const int32_t lat = ReadBigEndian<int32_t>(p + 9);
+	const int32_t lon = ReadBigEndian<int32_t>(p + 13);
+	_latitude = (lat + (lat < 0 ? -50 : 50)) / 100;
+	_longitude = (lon + (lon < 0 ? -50 : 50)) / 100;
+	_altitude = ReadBigEndian<int32_t>(p + 21);
+	_last_position_fix = now;
+
+	// rotate the ECEF velocity into north/east to get the ground speed and course
+	const float vx = ReadBigEndian<int32_t>(p + 47);
+	const float vy = ReadBigEndian<int32_t>(p + 51);
+	const float vz = ReadBigEndian<int32_t>(p + 55);
+	const float latRad = ToRadians(lat * 1.0e-7f);
+	const float lonRad = ToRadians(lon * 1.0e-7f);
+	const float sinLat = sin(latRad), cosLat = cos(latRad);
+	const float sinLon = sin(lonRad), cosLon = cos(lonRad);
+	const float east = -sinLon * vx + cosLon * vy;
+	const float north = -sinLat * cosLon * vx - sinLat * sinLon * vy + cosLat * vz;
+
+	_speed = (unsigned long)(METERS_PER_SECOND_TO_KNOTS(sqrt(east * east + north * north)) + 0.5f);
+	float course = ToDegrees(atan2(east, north));
+	if (course < 0.0f)
+		course += 360.0f;
+	_course = (unsigned long)(course * 100.0f + 0.5f) % 36000;
+}
+
+uint8_t VenusGPS::TransmitRaw(uint8_t data)
+{
+	m_pStream->write(data);
+	return data;
+}
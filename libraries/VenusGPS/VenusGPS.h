@@ -0,0 +1,110 @@
+#ifndef _VENUSGPS_H
+#define _VENUSGPS_H
+
+#include <Core.h>
+#include <Stream.h>
+#include <TinyGPS.h>
+
+// SkyTraq Venus binary protocol. Navigation data messages (59 bytes, once per fix) are decoded into
+// the same accessors TinyGPS has, so it can be swapped in for TinyGPS; anything that isn't a binary
+// message is handed on to TinyGPS, so NMEA output still works before the receiver's been switched over.
+class VenusGPS : public TinyGPS
+{
+public:
+	static const uint8_t c_MessageID_ConfigureSerialPort   = 0x05;
+	static const uint8_t c_MessageID_ConfigureMessageType  = 0x09;
+	static const uint8_t c_MessageID_ConfigurePositionRate = 0x0E;
+	static const uint8_t c_MessageID_ACK                   = 0x83;
+	static const uint8_t c_MessageID_NACK                  = 0x84;
+	static const uint8_t c_MessageID_NavigationData        = 0xA8;
+
+	static const uint8_t c_MaxPayloadLength                = 64;
+
+	// GPS - UTC, which needs updating whenever a leap second is announced
+	static const uint8_t c_LeapSeconds                     = 18;
+
+	struct EMessageType
+	{
+		enum Enum
+		{
+			None,
+			NMEA,
+			Binary,
+		};
+	};
+
+	struct EAttributes
+	{
+		enum Enum
+		{
+			SRAM,
+			SRAMAndFlash,
+		};
+	};
+
+public:
+	VenusGPS(Stream* pStream);
+
+	bool encode(char c); // returns true when a navigation data message (or NMEA sentence) has been decoded; good messages count in valid_sentences() too
+
+	// configuration commands, acknowledged by an ACK or NACK message with the same ID
+	void ConfigureSerialPort(uint32_t baud, EAttributes::Enum attributes);
+	void ConfigureMessageType(EMessageType::Enum type, EAttributes::Enum attributes);
+	void ConfigurePositionRate(uint8_t hz, EAttributes::Enum attributes);
+	void SendCommand(const uint8_t* payload, uint16_t size);
+
+	uint8_t GetLastACK() const;   // message ID of the last command ACKed, 0 if none
+	uint8_t GetLastNACK() const;  // message ID of the last command NACKed, 0 if none
+	void ClearACKs();
+
+	uint16_t GetGPSWeek() const;
+	uint32_t GetTimeOfWeek() const; // in 10 ms
+
+#ifndef _GPS_NO_STATS
+	uint16_t GetGoodMessages() const;
+	uint16_t GetFailedMessages() const;
+#endif
+
+protected:
+	struct ENextSection
+	{
+		enum Enum
+		{
+			PacketStart,
+			PacketStart2,
+			PacketLength,
+			PacketLength2,
+			Payload,
+			Checksum,
+			PacketEnd,
+			PacketEnd2,
+		};
+	};
+
+protected:
+	bool ProcessMessage();
+	void ProcessNavigationData();
+
+	uint8_t TransmitRaw(uint8_t data);
+	
+protected:
+	Stream* m_pStream;
+
+	ENextSection::Enum m_NextSection;
+	uint16_t m_Length;
+	uint16_t m_Offset;
+	uint8_t m_Checksum;
+	uint8_t m_Payload[c_MaxPayloadLength];
+
+	uint8_t m_LastACK;
+	uint8_t m_LastNACK;
+	uint16_t m_GPSWeek;
+	uint32_t m_TimeOfWeek;
+
+#ifndef _GPS_NO_STATS
+	uint16_t m_GoodMessages;
+	uint16_t m_FailedMessages;
+#endif
+};
+
+#endif
@@ -11,6 +11,7 @@ public:
 
 	static const uint8_t c_APIIdentifier_Transmit 	= 0x01;
 	static const uint8_t c_APIIdentifier_Receive  	= 0x81;
+	static const uint8_t c_TransmitOverhead		= 9;    // bytes SendTo() writes besides the payload
 
 	struct Frame
 	{
@@ -0,0 +1,152 @@
+// Checks BMP085::PressureToAltitudeInMM() against the US Standard Atmosphere 1976 layer
+// formulas in double precision, the way the bound in BMP085.h was measured.
+//
+// Every pressure the table covers is tried, 1/64 Pa at a time from the top of the table
+// (47 km, 111 Pa) to the bottom (-0.5 km, 107 kPa), and the worst error is printed for
+// each layer of the atmosphere along with the altitude it happened at. That's done twice:
+// with the gas constant the 1976 standard (and so the table) uses, 8.31432 J/(mol K), and
+// with today's 8.314462618, which stretches every altitude by 17 ppm and so is what a
+// reference formula picked up elsewhere will most likely use.
+//
+// Build from this directory with:
+//   g++ -O2 -I../Host -I../../libraries/Core -I../../libraries/BMP085 AltitudeCheck.cpp
+//       ../../libraries/BMP085/BMP085.cpp -o AltitudeCheck
+//
+// Usage: AltitudeCheck
+// and exits with 2 if any error is over the bounds in BMP085.h.
+
+#include <Arduino.h>
+#include <Wire.h>
+#include <BMP085.h>
+
+#include <algorithm>
+
+TwoWire Wire;
+
+namespace
+{
+	const uint32_t c_Lowest         = 7098;       // 1/64 Pa, the table's last entry
+	const uint32_t c_Highest        = 6878561;    // and its first
+	const double c_StandardPressure = 101325;     // Pa
+
+	// base geopotential altitude (m), temperature (K) and lapse rate (K/m) of each layer
+	struct Layer
+	{
+		const char* name;
+		double base;
+		double temp;
+		double lapse;
+	};
+
+	const Layer c_Layers[] = {
+		{"troposphere",  0,     288.15, -0.0065},
+		{"tropopause",   11000, 216.65,  0},
+		{"stratosphere", 20000, 216.65,  0.001},
+		{"stratosphere", 32000, 228.65,  0.0028},
+	};
+	const int c_LayerCount = _countof(c_Layers);
+
+	// the gas constants to check against, and the bounds in BMP085.h for each
+	struct Reference
+	{
+		const char* name;
+		double gasConstant;   // J/(mol K)
+		double bound;         // m
+	};
+
+	const Reference c_References[] = {
+		{"1976", 8.31432,     0.8},
+		{"2019", 8.314462618, 1.2},
+	};
+
+	class Atmosphere
+	{
+	public:
+		explicit Atmosphere(double gasConstant) :
+			m_GM_R(9.80665 * 0.0289644 / gasConstant)
+		{
+			m_BasePressure[0] = c_StandardPressure;
+			for (int i=1; i<c_LayerCount; ++i)
+				m_BasePressure[i] = Pressure(i - 1, c_Layers[i].base);
+		}
+
+		// geopotential altitude in m for a pressure in Pa, and the layer it's in
+		double Altitude(double p, int* layer) const
+		{
+			int i = 0;
+			while (i + 1 < c_LayerCount && p < m_BasePressure[i + 1])
+				++i;
+			*layer = i;
+
+			const Layer& l = c_Layers[i];
+			const double ratio = p / m_BasePressure[i];
+			if (l.lapse == 0)
+				return l.base - l.temp / m_GM_R * log(ratio);
+			return l.base + l.temp / l.lapse * (pow(ratio, -l.lapse / m_GM_R) - 1);
+		}
+
+	private:
+		double Pressure(int layer, double altitude) const
+		{
+			const Layer& l = c_Layers[layer];
+			if (l.lapse == 0)
+				return m_BasePressure[layer] * exp(-m_GM_R * (altitude - l.base) / l.temp);
+			return m_BasePressure[layer] * pow(l.temp / (l.temp + l.lapse * (altitude - l.base)), m_GM_R / l.lapse);
+		}
+
+		double m_GM_R;                      // g0 M / R, K/m
+		double m_BasePressure[c_LayerCount];
+	};
+
+	bool Check(const Reference& reference)
+	{
+		const Atmosphere atmosphere(reference.gasConstant);
+		double worst[c_LayerCount] = {};
+		double worstAt[c_LayerCount] = {};
+		for (uint32_t p=c_Lowest; p<=c_Highest; ++p)
+		{
+			int layer;
+			const double altitude = atmosphere.Altitude(p / 64.0, &layer);
+			const double error = fabs(BMP085::PressureToAltitudeInMM(p) * 0.001 - altitude);
+			if (error > worst[layer])
+			{
+				worst[layer] = error;
+				worstAt[layer] = altitude;
+			}
+		}
+
+		bool ok = true;
+		printf("against R = %.10g (%s):\n", reference.gasConstant, reference.name);
+		for (int i=0; i<c_LayerCount; ++i)
+		{
+			const bool over = worst[i] > reference.bound;
+			printf("  %-12s from %5.0f m: %5.3f m at %7.0f m%s\n", c_Layers[i].name, c_Layers[i].base, worst[i], worstAt[i], over ? ", over" : "");
+			ok &= !over;
+		}
+		return ok;
+	}
+}
+
+unsigned long micros()
+{
+	return 0;
+}
+
+unsigned long millis()
+{
+	return 0;
+}
+
+void delay(unsigned long)
+{
+}
+
+int main()
+{
+	printf("%u pressures, worst errors\n", c_Highest - c_Lowest + 1);
+	bool ok = true;
+	for (size_t i=0; i<_countof(c_References); ++i)
+		ok &= Check(c_References[i]);
+
+	return ok ? 0 : 2;
+}
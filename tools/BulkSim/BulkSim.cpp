@@ -0,0 +1,299 @@
+// Runs the bulk downlink end to end on a simulated XTend link: the balloon's
+// FlightRecorder logging onto a FileFlash, a BulkSender reading its chunks back out from
+// between the telemetry packets, and the tracker's BulkReceiver acking them, then checks
+// that everything the ground got is what was in the log.
+//
+// The link is half duplex at the given baud rate: whatever's sent waits for the air to
+// be clear, takes its bytes' time, and then arrives, or at random doesn't. The balloon
+// sends its telemetry every second, as the app does, and a chunk at most every interval
+// when its serial buffer's empty and the next telemetry packet isn't due within the
+// guard time. The tracker acks when BulkReceiver says to, unless the next telemetry
+// packet's due in a second from the last one less its guard time. Every chunk is checked against
+// what the log held when it was first read, which also checks that a sealed page never
+// changes while it can be read.
+//
+// The log gets a Flight record every RecordingInterval and, spread through the flight, the
+// flight events, each with an Event record and 10.5 s of Capture records at 50 Hz, which
+// the downlink has to catch up with before the end.
+//
+// Build from this directory with:
+//   g++ -O2 -I../Host -I../Common -I../../libraries/Core -I../../libraries/CRC
+//       -I../../libraries/FlightRecorder -I../../libraries/BulkLink BulkSim.cpp
+//       ../Common/FileFlash.cpp ../../libraries/FlightRecorder/FlightRecorder.cpp
+//       ../../libraries/BulkLink/BulkSender.cpp ../../libraries/BulkLink/BulkReceiver.cpp
+//       ../../libraries/CRC/CRC.cpp -o BulkSim
+//
+// Usage: BulkSim [-t hours] [-r rate] [-c events] [-b baud] [-l loss] [-i interval] [-k KB] [-s seed]
+//   -t hours     flight time, default 2
+//   -r rate      Hz, 54 byte Flight records into the log, default 2, every RecordingInterval
+//   -c events    captured, default 4
+//   -b baud      the XTend's, default 9600
+//   -l loss      chance of losing each packet, either way, default 0.1
+//   -i interval  ms, the shortest time between chunks, default 60, BulkInterval
+//   -k KB        flash size, default 8192
+//   -s seed
+// and exits with 2 if a chunk came down wrong, telemetry was held up by a chunk, or the
+// ground ended up more than two pages of the log behind.
+
+#include <Arduino.h>
+#include <FileFlash.h>
+#include <FlightRecorder.h>
+#include <BulkSender.h>
+#include <BulkReceiver.h>
+
+#include <unistd.h>
+#include <algorithm>
+#include <map>
+#include <set>
+#include <vector>
+
+namespace
+{
+	const uint8_t c_ChunkSize         = 32;           // BulkPacket's
+	const uint8_t c_RecordSize        = 52;           // FlightRecord
+	const uint8_t c_EventRecordSize   = 24;           // EventRecord
+	const uint8_t c_CaptureRecordSize = 16;           // CaptureRecord
+	const double c_CaptureRate        = 50;           // Hz, EventCapture's sampleInterval
+	const uint32_t c_CaptureTime      = 10500;        // ms, the window and the half second before the event
+	const uint32_t c_MaxBehind        = 2 * 256 / c_ChunkSize;   // chunks
+	const uint16_t c_TelemetryBytes   = 42 + 9;       // TelemetryPacket and the XTend's frame
+	const uint16_t c_ChunkBytes       = 10 + c_ChunkSize + 9;
+	const uint16_t c_AckBytes         = 10 + 9;
+	const uint32_t c_TelemetryPeriod  = 1000;         // ms
+	const uint32_t c_GuardTime        = 100;          // ms, BulkGuardTime
+	const uint32_t c_AckGuardTime     = 150;          // ms, the tracker's BulkAckGuardTime
+	const uint32_t c_RadioLatency     = 5;            // ms, through the XTends on top of the air time
+	const BulkSender::Config c_SenderConfig = {2000};
+	const BulkReceiver::Config c_ReceiverConfig = {500, 8};
+
+	uint64_t g_Now = 0;                               // us
+
+	struct Options
+	{
+		double hours;
+		double rate;
+		uint32_t events;
+		uint32_t baud;
+		double loss;
+		uint32_t interval;
+		uint32_t flashSize;
+	};
+
+	struct Chunk
+	{
+		uint32_t base;
+		uint32_t number;
+		uint8_t stamp;
+		uint8_t data[c_ChunkSize];
+	};
+
+	struct Ack
+	{
+		uint32_t base;
+		uint32_t received;
+		uint8_t stamp;
+	};
+
+	double Random()
+	{
+		return rand() / (RAND_MAX + 1.0);
+	}
+
+	void Usage()
+	{
+		fprintf(stderr, "Usage: BulkSim [-t hours] [-r rate] [-c events] [-b baud] [-l loss] [-i interval] [-k KB] [-s seed]\n");
+	}
+}
+
+unsigned long micros()
+{
+	g_Now += 10;
+	return (unsigned long)(uint32_t)g_Now;
+}
+
+unsigned long millis()
+{
+	return (unsigned long)(uint32_t)(g_Now / 1000);
+}
+
+int main(int argc, char** argv)
+{
+	Options options;
+	options.hours = 2.0;
+	options.rate = 2.0;
+	options.events = 4;
+	options.baud = 9600;
+	options.loss = 0.1;
+	options.interval = 60;
+	options.flashSize = 8192 * 1024;
+
+	int opt;
+	while ((opt = getopt(argc, argv, "t:r:c:b:l:i:k:s:")) != -1)
+	{
+		switch (opt)
+		{
+		case 't': options.hours = atof(optarg); break;
+		case 'r': options.rate = std::max(atof(optarg), 0.01); break;
+		case 'c': options.events = atoi(optarg); break;
+		case 'b': options.baud = std::max(atoi(optarg), 1200); break;
+		case 'l': options.loss = atof(optarg); break;
+		case 'i': options.interval = std::max(atoi(optarg), 1); break;
+		case 'k': options.flashSize = std::max(atoi(optarg), 8) * 1024; break;
+		case 's': srand(atoi(optarg)); break;
+		default: Usage(); return 1;
+		}
+	}
+
+	FileFlash flash(options.flashSize);
+	FlightRecorder recorder;
+	recorder.setup(&flash);
+
+	const uint32_t first = recorder.GetSealedPosition();
+	BulkSender sender;
+	sender.setup(c_SenderConfig, first / c_ChunkSize);
+	BulkReceiver receiver;
+	receiver.setup(c_ReceiverConfig);
+
+	// the air, and what's on its way across it, by when it arrives
+	uint32_t airFree = 0;
+	uint32_t balloonTxFree = 0;         // when the balloon's serial buffer will have emptied
+	std::multimap<uint32_t, Chunk> downlink;
+	std::multimap<uint32_t, Ack> uplink;
+
+	std::map<uint32_t, std::vector<uint8_t> > truth;
+	std::set<uint32_t> delivered;
+	uint32_t wrong = 0, changed = 0, readFailures = 0;
+	uint32_t telemetryCount = 0, telemetryHeldByChunk = 0, telemetryHeldByAck = 0;
+	uint32_t lastChunk = 0, nextTelemetry = 250;
+	uint32_t telemetryArrival = 0;
+	std::multimap<uint32_t, bool> telemetryLink;
+	double nextRecord = 0.0;
+	uint32_t eventCount = 0, captureEnd = 0;
+	double nextSample = 0.0;
+
+	const uint32_t end = (uint32_t)(options.hours * 3600e3);
+	uint8_t record[c_RecordSize];
+	for (uint32_t now=0; now<end; ++now)
+	{
+		g_Now = std::max(g_Now, (uint64_t)now * 1000);
+
+		// the balloon
+		while (nextRecord <= now)
+		{
+			memset(record, (uint8_t)(nextRecord / 100), sizeof(record));
+			recorder.Append(1, record, sizeof(record));
+			nextRecord += 1000.0 / options.rate;
+		}
+
+		if (eventCount < options.events && now >= end / (options.events + 1) * (eventCount + 1))
+		{
+			memset(record, 0xEE, c_EventRecordSize);
+			recorder.Append(2, record, c_EventRecordSize);
+			captureEnd = now + c_CaptureTime;
+			nextSample = now;
+			++eventCount;
+		}
+		while (now < captureEnd && nextSample <= now)
+		{
+			memset(record, (uint8_t)(nextSample / 20), c_CaptureRecordSize);
+			recorder.Append(3, record, c_CaptureRecordSize);
+			nextSample += 1000.0 / c_CaptureRate;
+		}
+		recorder.loop();
+
+		while (!uplink.empty() && uplink.begin()->first <= now)
+		{
+			const Ack& ack = uplink.begin()->second;
+			sender.OnAck(now, ack.base, ack.received, ack.stamp);
+			uplink.erase(uplink.begin());
+		}
+
+		if (now >= nextTelemetry)
+		{
+			// what's in the serial buffer has to go out first, then it waits for the air
+			const uint32_t start = std::max(std::max(now, balloonTxFree), airFree);
+			if (balloonTxFree > now)
+				++telemetryHeldByChunk;
+			else if (start > now)
+				++telemetryHeldByAck;
+			airFree = start + c_TelemetryBytes * 10000 / options.baud;
+			balloonTxFree = airFree;
+			if (Random() >= options.loss)
+				telemetryLink.insert(std::make_pair(airFree + c_RadioLatency, true));
+			++telemetryCount;
+			nextTelemetry += c_TelemetryPeriod;
+		}
+
+		uint32_t number;
+		if (now - lastChunk >= options.interval && balloonTxFree <= now && nextTelemetry - now >= c_GuardTime &&
+			sender.GetNext(now, (recorder.GetOldestPosition() + c_ChunkSize - 1) / c_ChunkSize, recorder.GetSealedPosition() / c_ChunkSize, &number))
+		{
+			Chunk chunk;
+			if (recorder.ReadLog(number * c_ChunkSize, chunk.data, c_ChunkSize))
+			{
+				std::vector<uint8_t>& expected = truth[number];
+				if (expected.empty())
+					expected.assign(chunk.data, chunk.data + c_ChunkSize);
+				else if (memcmp(&expected[0], chunk.data, c_ChunkSize) != 0)
+					++changed;
+
+				chunk.base = sender.GetBase();
+				chunk.number = number;
+				chunk.stamp = sender.OnSent(now, number);
+				const uint32_t start = std::max(now, airFree);
+				airFree = start + c_ChunkBytes * 10000 / options.baud;
+				balloonTxFree = airFree;
+				if (Random() >= options.loss)
+					downlink.insert(std::make_pair(airFree + c_RadioLatency, chunk));
+				lastChunk = now;
+			}
+			else
+			{
+				++readFailures;
+			}
+		}
+
+		// the tracker
+		while (!downlink.empty() && downlink.begin()->first <= now)
+		{
+			const Chunk& chunk = downlink.begin()->second;
+			if (receiver.OnChunk(now, chunk.base, chunk.number, chunk.stamp))
+			{
+				if (!delivered.insert(chunk.number).second)
+					++wrong;
+				if (memcmp(&truth[chunk.number][0], chunk.data, c_ChunkSize) != 0)
+					++wrong;
+			}
+			downlink.erase(downlink.begin());
+		}
+
+		while (!telemetryLink.empty() && telemetryLink.begin()->first <= now)
+		{
+			telemetryArrival = now;
+			telemetryLink.erase(telemetryLink.begin());
+		}
+
+		if (receiver.IsAckDue(now) && (now - telemetryArrival) % c_TelemetryPeriod + c_AckGuardTime < c_TelemetryPeriod)
+		{
+			Ack ack;
+			receiver.GetAck(&ack.base, &ack.received, &ack.stamp);
+			const uint32_t start = std::max(now, airFree);
+			airFree = start + c_AckBytes * 10000 / options.baud;
+			if (Random() >= options.loss)
+				uplink.insert(std::make_pair(airFree + c_RadioLatency, ack));
+		}
+	}
+
+	const double hours = options.hours;
+	const uint32_t behind = recorder.GetSealedPosition() / c_ChunkSize - receiver.GetBase();
+	printf("%.1f h at %u baud, %.1f Hz and %u events into the log, %.0f%% loss, a chunk every %u ms at most\n",
+		hours, options.baud, options.rate, options.events, options.loss * 100.0, options.interval);
+	printf("chunks sent %u, resent %u, skipped %u, delivered %zu, duplicates %u, lost %u, behind by %u at the end\n",
+		sender.GetSentCount(), sender.GetResentCount(), sender.GetSkippedCount(), delivered.size(),
+		receiver.GetDuplicateCount(), receiver.GetLostCount(), behind);
+	printf("goodput %.0f bytes/s, the log grew %.0f bytes/s, wrong %u, changed %u, flash busy %u times\n",
+		delivered.size() * c_ChunkSize / (hours * 3600.0), (recorder.GetSealedPosition() - first) / (hours * 3600.0), wrong, changed, readFailures);
+	printf("telemetry %u, held up by a chunk %u, by an ack %u\n", telemetryCount, telemetryHeldByChunk, telemetryHeldByAck);
+
+	return (wrong || changed || telemetryHeldByChunk || behind > c_MaxBehind) ? 2 : 0;
+}
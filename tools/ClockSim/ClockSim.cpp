@@ -0,0 +1,177 @@
+// Runs ClockSync against a simulated ping and pong between the tracker and a balloon whose
+// clock drifts, and reports how well it places the balloon's telemetry on the tracker's
+// timeline.
+//
+// The tracker pings every 5 s, stamping t1 as it writes the ping to its XTend at 115200.
+// Each way, the frame goes over the air with the radio's latency, mostly 15 to 45 ms but
+// now and then held up by as much as 300 ms more, and comes out of the far radio at its
+// end's baud rate: 115200 at the tracker, 9600 at the balloon. Each end reads a frame
+// when its loop next polls the serial port, up to its SerialPollDeadline (10 ms on the
+// balloon, 20 on the tracker) after the last byte came in and now and then a lot longer.
+// The balloon stamps t2 as the ping's last byte came in and t3 just before it writes the
+// pong, after it's read the ping, and the tracker stamps t4 as the pong's last byte came
+// in. With -o they stamp when they read the frames instead, t2 and t3 back to back, as
+// they used to.
+//
+// After the first 10 minutes, the balloon's clock at a point between each pair of pings
+// (as a telemetry packet would carry it) is put on the tracker's timeline by ToLocal()
+// and compared to when it really was.
+//
+// Build from this directory with:
+//   g++ -O2 -I../Host -I../../libraries/Core -I../../libraries/ClockSync ClockSim.cpp
+//       ../../libraries/ClockSync/ClockSync.cpp -o ClockSim
+//
+// Usage: ClockSim [-o] [-d ppm] [-t hours] [-s seed]
+//   -o           stamp t2, t3 and t4 when the frames are read
+//   -d ppm       how fast the balloon's clock runs, default -3000, -300, 0, 300 and 3000
+//   -t hours     flight time, default 4
+//   -s seed
+// and exits with 2 if the drift's out by more than 25 ppm or the mean error's over 2.75 ms.
+
+#include <Arduino.h>
+#include <ClockSync.h>
+
+#include <unistd.h>
+#include <algorithm>
+
+namespace
+{
+	const double c_PingInterval      = 5000;     // ms, as the tracker's Config.h
+	const double c_FrameBytes        = 22;       // a ping or pong with XTendAPI's framing
+	const double c_TrackerByteTime   = 10.0 / 115200 * 1000;   // ms
+	const double c_BalloonByteTime   = 10.0 / 9600 * 1000;
+	const double c_BalloonPoll       = 10;       // ms, the balloon's SerialPollDeadline
+	const double c_TrackerPoll       = 20;       // ms, the tracker's
+	const double c_Settle            = 600000;   // ms before the errors count
+	const double c_MaxDriftError     = 25;       // ppm
+	const double c_MaxMeanError      = 2.75;     // ms
+
+	const ClockSync::Config c_Config = {
+		500,    // maxDelay (ms)
+		30000,  // historySpacing (ms)
+	};
+
+	struct Options
+	{
+		bool oldStamps;
+		double hours;
+	};
+
+	struct Result
+	{
+		float drift;            // ppm, estimated
+		double meanError;       // ms
+		double worstError;
+		uint16_t samples;
+		uint16_t rejected;
+	};
+
+	double Random()
+	{
+		return rand() / (RAND_MAX + 1.0);
+	}
+
+	// the radio's latency, from the last byte going in to the first coming out
+	double Air()
+	{
+		return 15 + 20 * Random() + 10 * Random() + (Random() < 0.2 ? 300 * Random() : 0);
+	}
+
+	// from a byte arriving to the loop getting round to reading it
+	double Poll(double deadline)
+	{
+		return deadline * Random() + (Random() < 0.1 ? 5 * deadline * Random() : 0);
+	}
+
+	Result Run(const Options& options, double ppm)
+	{
+		// the balloon was switched on an hour after the tracker
+		const double drift = ppm * 1e-6;
+		const double start = 3600000;
+		struct Balloon
+		{
+			double drift;
+			double start;
+			uint32_t operator()(double t) const { return (uint32_t)floor((t - start) * (1 + drift)); }
+		} balloon = {drift, start};
+
+		ClockSync sync;
+		sync.setup(c_Config);
+
+		double errorSum = 0;
+		double worst = 0;
+		int count = 0;
+		const double end = start + options.hours * 3600000;
+		for (double t=start + 100000; t<end; t+=c_PingInterval)
+		{
+			const uint32_t t1 = (uint32_t)floor(t);
+			const double pingIn = t + c_FrameBytes * c_TrackerByteTime + Air() + c_FrameBytes * c_BalloonByteTime;
+			const double pingRead = pingIn + Poll(c_BalloonPoll);
+			const uint32_t t2 = balloon(options.oldStamps ? pingRead : pingIn);
+			const uint32_t t3 = balloon(pingRead + 0.05);
+			const double pongIn = pingRead + 0.05 + c_FrameBytes * c_BalloonByteTime + Air() + c_FrameBytes * c_TrackerByteTime;
+			const uint32_t t4 = (uint32_t)floor(options.oldStamps ? pongIn + Poll(c_TrackerPoll) : pongIn);
+			sync.AddSample(t1, t2, t3, t4);
+
+			if (sync.IsSynced() && t > start + c_Settle)
+			{
+				const double sent = t + c_PingInterval / 2;
+				const double error = (double)sync.ToLocal(balloon(sent)) - floor(sent);
+				errorSum += fabs(error);
+				worst = std::max(worst, fabs(error));
+				++count;
+			}
+		}
+
+		Result result = {sync.GetDrift(), count ? errorSum / count : 1e9, worst, sync.GetSampleCount(), sync.GetRejectedCount()};
+		return result;
+	}
+
+	void Usage()
+	{
+		fprintf(stderr, "Usage: ClockSim [-o] [-d ppm] [-t hours] [-s seed]\n");
+	}
+}
+
+unsigned long micros()
+{
+	return 0;
+}
+
+unsigned long millis()
+{
+	return 0;
+}
+
+int main(int argc, char** argv)
+{
+	Options options;
+	options.oldStamps = false;
+	options.hours = 4;
+	double drifts[] = {-3000, -300, 0, 300, 3000};
+	size_t driftCount = _countof(drifts);
+
+	int opt;
+	while ((opt = getopt(argc, argv, "od:t:s:")) != -1)
+	{
+		switch (opt)
+		{
+		case 'o': options.oldStamps = true; break;
+		case 'd': drifts[0] = atof(optarg); driftCount = 1; break;
+		case 't': options.hours = std::max(atof(optarg), 0.5); break;
+		case 's': srand(atoi(optarg)); break;
+		default: Usage(); return 1;
+		}
+	}
+
+	printf("%9s %9s %10s %10s %8s %8s\n", "drift", "estimate", "mean (ms)", "worst (ms)", "samples", "rejected");
+	bool ok = true;
+	for (size_t i=0; i<driftCount; ++i)
+	{
+		const Result result = Run(options, drifts[i]);
+		printf("%9.0f %9.1f %10.2f %10.0f %8u %8u\n", drifts[i], result.drift, result.meanError, result.worstError, result.samples, result.rejected);
+		ok &= fabs(result.drift - drifts[i]) <= c_MaxDriftError && result.meanError <= c_MaxMeanError;
+	}
+
+	return ok ? 0 : 2;
+}
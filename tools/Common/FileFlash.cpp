@@ -0,0 +1,243 @@
+#include "FileFlash.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace
+{
+	// W25Q64 datasheet typical and worst case times
+	const FileFlash::Timing c_DefaultTiming = {700, 45000, 400000, 0.0};
+}
+
+FileFlash::FileFlash(uint32_t size) :
+	m_Data((size + c_SectorSize - 1) / c_SectorSize * c_SectorSize, 0xFF),
+	m_Timing(c_DefaultTiming),
+	m_Violations(0),
+	m_Operation(EOperation::None),
+	m_Start(0),
+	m_Duration(0),
+	m_Address(0),
+	m_Suspended(false),
+	m_SuspendedAddress(0),
+	m_SuspendedRemaining(0)
+{
+}
+
+bool FileFlash::Load(const char* path)
+{
+	FILE* pFile = fopen(path, "rb");
+	if (!pFile)
+		return false;
+
+	m_Data.clear();
+	uint8_t buffer[4096];
+	size_t count;
+	while ((count = fread(buffer, 1, sizeof(buffer), pFile)) > 0)
+		m_Data.insert(m_Data.end(), buffer, buffer + count);
+	fclose(pFile);
+
+	m_Data.resize((m_Data.size() + c_SectorSize - 1) / c_SectorSize * c_SectorSize, 0xFF);
+	m_Operation = EOperation::None;
+	m_Suspended = false;
+	return true;
+}
+
+bool FileFlash::Save(const char* path)
+{
+	finish();
+	if (m_Suspended)
+	{
+		memset(&m_Data[m_SuspendedAddress], 0xFF, c_SectorSize);
+		m_Suspended = false;
+	}
+
+	FILE* pFile = fopen(path, "wb");
+	if (!pFile)
+		return false;
+
+	const bool ok = fwrite(&m_Data[0], 1, m_Data.size(), pFile) == m_Data.size();
+	return fclose(pFile) == 0 && ok;
+}
+
+void FileFlash::Write(uint32_t address, const uint8_t* pData, uint32_t size)
+{
+	if (address + size > m_Data.size())
+		m_Data.resize((address + size + c_SectorSize - 1) / c_SectorSize * c_SectorSize, 0xFF);
+	memcpy(&m_Data[address], pData, size);
+}
+
+void FileFlash::SetTiming(const Timing& timing)
+{
+	m_Timing = timing;
+}
+
+void FileFlash::PowerCut()
+{
+	// a suspended erase is as unfinished as one that's going
+	if (m_Suspended)
+	{
+		for (uint32_t i=0; i<c_SectorSize; ++i)
+			m_Data[m_SuspendedAddress + i] |= (uint8_t)(rand() & rand());
+		m_Suspended = false;
+	}
+
+	if (!isBusy())
+	{
+		finish();
+		return;
+	}
+
+	// programming goes a byte at a time, and the byte it stopped on only has some of its 0s
+	if (m_Operation == EOperation::Program)
+	{
+		const size_t done = rand() % (m_Pending.size() + 1);
+		for (size_t i=0; i<done; ++i)
+			m_Data[m_Address + i] &= m_Pending[i];
+		if (done < m_Pending.size())
+			m_Data[m_Address + done] &= m_Pending[done] | (uint8_t)rand();
+	}
+	// and erasing leaves any of the sector's bits set
+	else if (m_Operation == EOperation::Erase)
+	{
+		for (uint32_t i=0; i<c_SectorSize; ++i)
+			m_Data[m_Address + i] |= (uint8_t)(rand() & rand());
+	}
+
+	m_Operation = EOperation::None;
+}
+
+uint32_t FileFlash::GetViolationCount() const
+{
+	return m_Violations;
+}
+
+uint32_t FileFlash::GetSize()
+{
+	return (uint32_t)m_Data.size();
+}
+
+bool FileFlash::IsBusy()
+{
+	if (isBusy())
+		return true;
+
+	finish();
+	return false;
+}
+
+void FileFlash::Read(uint32_t address, uint8_t* pData, uint16_t size)
+{
+	if (!IsBusy() && address + size <= m_Data.size() && !isSuspendedSector(address, size))
+	{
+		memcpy(pData, &m_Data[address], size);
+		return;
+	}
+
+	++m_Violations;
+	memset(pData, 0xFF, size);
+}
+
+void FileFlash::Program(uint32_t address, const uint8_t* pData, uint16_t size)
+{
+	if (IsBusy() || size == 0 || size > c_PageSize || address / c_PageSize != (address + size - 1) / c_PageSize ||
+		address + size > m_Data.size() || isSuspendedSector(address, size))
+	{
+		++m_Violations;
+		return;
+	}
+
+	// only the 1s that are still 1s can be programmed to 0
+	for (uint16_t i=0; i<size; ++i)
+	{
+		if (pData[i] & ~m_Data[address + i])
+		{
+			++m_Violations;
+			break;
+		}
+	}
+
+	m_Operation = EOperation::Program;
+	m_Start = micros();
+	m_Duration = m_Timing.programTime;
+	m_Address = address;
+	m_Pending.assign(pData, pData + size);
+}
+
+void FileFlash::EraseSector(uint32_t address)
+{
+	if (IsBusy() || m_Suspended || address + c_SectorSize > m_Data.size())
+	{
+		++m_Violations;
+		return;
+	}
+
+	const bool slow = rand() < m_Timing.slowEraseChance * RAND_MAX;
+	m_Operation = EOperation::Erase;
+	m_Start = micros();
+	m_Duration = slow ? m_Timing.slowEraseTime : m_Timing.eraseTime;
+	m_Address = address / c_SectorSize * c_SectorSize;
+}
+
+void FileFlash::SuspendErase()
+{
+	const uint32_t elapsed = micros() - m_Start;
+	if (m_Operation == EOperation::None || elapsed >= m_Duration)
+	{
+		finish();
+		return;
+	}
+
+	// the chip would suspend a program too, but nothing here should need it to
+	if (m_Operation != EOperation::Erase)
+	{
+		++m_Violations;
+		return;
+	}
+
+	m_Suspended = true;
+	m_SuspendedAddress = m_Address;
+	m_SuspendedRemaining = m_Duration - elapsed;
+	m_Operation = EOperation::None;
+}
+
+void FileFlash::ResumeErase()
+{
+	if (!m_Suspended)
+		return;
+	if (IsBusy())
+	{
+		++m_Violations;
+		return;
+	}
+
+	m_Suspended = false;
+	m_Operation = EOperation::Erase;
+	m_Start = micros();
+	m_Duration = m_SuspendedRemaining;
+	m_Address = m_SuspendedAddress;
+}
+
+bool FileFlash::isBusy()
+{
+	return m_Operation != EOperation::None && micros() - m_Start < m_Duration;
+}
+
+void FileFlash::finish()
+{
+	if (m_Operation == EOperation::Program)
+	{
+		for (size_t i=0; i<m_Pending.size(); ++i)
+			m_Data[m_Address + i] &= m_Pending[i];
+	}
+	else if (m_Operation == EOperation::Erase)
+	{
+		memset(&m_Data[m_Address], 0xFF, c_SectorSize);
+	}
+	m_Operation = EOperation::None;
+}
+
+bool FileFlash::isSuspendedSector(uint32_t address, uint32_t size) const
+{
+	return m_Suspended && address < m_SuspendedAddress + c_SectorSize && address + size > m_SuspendedAddress;
+}
@@ -0,0 +1,81 @@
+#ifndef _FILE_FLASH_H
+#define _FILE_FLASH_H
+
+#include <FlashDevice.h>
+
+#include <stdint.h>
+#include <vector>
+
+// A NOR flash chip in memory, loaded from and saved to an image file, for running
+// FlightRecorder and FlightLogReader on a PC.
+//
+// It behaves the way the chip does: programming can only clear bits, erasing sets a
+// whole sector back to 0xFF, and Program() and EraseSector() take time, by micros(),
+// during which the only thing allowed is IsBusy(). An operation's effect lands when it
+// finishes, unless PowerCut() comes first, in which case only some of it does. Anything
+// the chip wouldn't allow, like programming a 0 back to a 1, reading while it's busy or
+// touching a sector whose erase is suspended, is counted as a violation, so the
+// simulations can check the recorder never does it.
+class FileFlash : public FlashDevice
+{
+public:
+	struct Timing
+	{
+		uint32_t programTime;           // us, for a page program
+		uint32_t eraseTime;             // us, typical for a sector erase
+		uint32_t slowEraseTime;         // us, the worst case
+		double slowEraseChance;         // of an erase taking the worst case time
+	};
+
+public:
+	FileFlash(uint32_t size);           // all erased
+
+	bool Load(const char* path);        // an image, its size rounded up to whole sectors
+	bool Save(const char* path);
+	void Write(uint32_t address, const uint8_t* pData, uint32_t size);   // straight in, for rebuilding an image
+
+	void SetTiming(const Timing& timing);
+	void PowerCut();                    // whatever's under way only partly happens
+	uint32_t GetViolationCount() const;
+
+	virtual uint32_t GetSize();
+	virtual bool IsBusy();
+
+	virtual void Read(uint32_t address, uint8_t* pData, uint16_t size);
+	virtual void Program(uint32_t address, const uint8_t* pData, uint16_t size);
+	virtual void EraseSector(uint32_t address);
+	virtual void SuspendErase();
+	virtual void ResumeErase();
+
+private:
+	struct EOperation
+	{
+		enum Enum
+		{
+			None,
+			Program,
+			Erase,
+		};
+	};
+
+	bool isBusy();
+	void finish();
+	bool isSuspendedSector(uint32_t address, uint32_t size) const;
+
+private:
+	std::vector<uint8_t> m_Data;
+	Timing m_Timing;
+	uint32_t m_Violations;
+
+	EOperation::Enum m_Operation;
+	uint32_t m_Start;                   // micros() when the operation started
+	uint32_t m_Duration;
+	uint32_t m_Address;
+	std::vector<uint8_t> m_Pending;     // what's being programmed
+
+	bool m_Suspended;                   // an erase
+	uint32_t m_SuspendedAddress;
+	uint32_t m_SuspendedRemaining;      // us
+};
+
+#endif
@@ -0,0 +1,270 @@
+#include "TelemetryReader.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+namespace
+{
+	// the rows BalloonTracker writes, and their layouts today, for when we start reading after the heading rows
+	const char* const c_RowPrefixes[] = {"Telemetry,", "Logging,"};
+	const int c_DefaultColumns[][5] = {
+		// now, pps, lat, lon, alt
+		{1, 2, 6, 7, 8},
+		{1, 2, 4, 5, 6},
+	};
+
+	const char* const c_APRSTimeSuffix = " UTC: ";
+
+	void Split(const std::string& line, std::vector<std::string>* pFields)
+	{
+		pFields->clear();
+		size_t start = 0;
+		for (;;)
+		{
+			const size_t end = line.find(',', start);
+			pFields->push_back(line.substr(start, end == std::string::npos ? std::string::npos : end - start));
+			if (end == std::string::npos)
+				break;
+			start = end + 1;
+		}
+	}
+
+	bool GetNumber(const std::vector<std::string>& fields, int column, double* pValue)
+	{
+		if (column < 0 || column >= (int)fields.size() || fields[column].empty())
+			return false;
+
+		char* pEnd;
+		*pValue = strtod(fields[column].c_str(), &pEnd);
+		return *pEnd == '\0';
+	}
+
+	// one character of a Mic-E destination address, as a digit, or -1 if it isn't one
+	int MicEDigit(char c)
+	{
+		if (c >= '0' && c <= '9')
+			return c - '0';
+		if (c >= 'A' && c <= 'J')
+			return c - 'A';
+		if (c >= 'P' && c <= 'Y')
+			return c - 'P';
+		if (c == 'K' || c == 'L' || c == 'Z')
+			return 0;     // position ambiguity
+		return -1;
+	}
+
+	bool MicEFlag(char c)
+	{
+		return c >= 'P' && c <= 'Z';
+	}
+}
+
+TelemetryReader::TelemetryReader(const char* path, bool follow) :
+	m_Path(path),
+	m_pFile(fopen(path, "r")),
+	m_Follow(follow)
+{
+	for (int i=0; i<ESource::APRS; ++i)
+	{
+		m_Columns[i].now = c_DefaultColumns[i][0];
+		m_Columns[i].pps = c_DefaultColumns[i][1];
+		m_Columns[i].lat = c_DefaultColumns[i][2];
+		m_Columns[i].lon = c_DefaultColumns[i][3];
+		m_Columns[i].alt = c_DefaultColumns[i][4];
+	}
+}
+
+TelemetryReader::~TelemetryReader()
+{
+	if (m_pFile)
+		fclose(m_pFile);
+}
+
+bool TelemetryReader::IsOpen() const
+{
+	return m_pFile != NULL;
+}
+
+const char* TelemetryReader::GetPath() const
+{
+	return m_Path.c_str();
+}
+
+bool TelemetryReader::Read(Fix* pFix)
+{
+	std::string line;
+	while (readLine(&line))
+	{
+		bool tracker = false;
+		for (int i=0; i<ESource::APRS; ++i)
+		{
+			if (line.compare(0, strlen(c_RowPrefixes[i]), c_RowPrefixes[i]) == 0)
+			{
+				tracker = true;
+				if (parseTracker((ESource::Enum)i, line, pFix))
+					return true;
+			}
+		}
+
+		if (!tracker && line.find(c_APRSTimeSuffix) != std::string::npos && parseAPRS(line, pFix))
+			return true;
+	}
+	return false;
+}
+
+bool TelemetryReader::readLine(std::string* pLine)
+{
+	if (!m_pFile)
+		return false;
+
+	char buffer[512];
+	while (fgets(buffer, sizeof(buffer), m_pFile))
+	{
+		m_Partial += buffer;
+		const size_t length = m_Partial.size();
+		if (m_Partial[length - 1] != '\n')
+			continue;
+
+		pLine->assign(m_Partial, 0, length - (length >= 2 && m_Partial[length - 2] == '\r' ? 2 : 1));
+		m_Partial.clear();
+		return true;
+	}
+
+	// hold on to a partial line while the logger's still writing it, and pick up again from here next time
+	clearerr(m_pFile);
+	if (!m_Follow && !m_Partial.empty())
+	{
+		pLine->swap(m_Partial);
+		m_Partial.clear();
+		return true;
+	}
+	return false;
+}
+
+bool TelemetryReader::parseTracker(ESource::Enum source, const std::string& line, Fix* pFix)
+{
+	std::vector<std::string> fields;
+	Split(line, &fields);
+
+	// a heading row tells us where everything is
+	Columns& columns = m_Columns[source];
+	if (fields.size() > 1 && fields[1] == "now (ms)")
+	{
+		columns.now = columns.pps = columns.lat = columns.lon = columns.alt = -1;
+		for (int i=0; i<(int)fields.size(); ++i)
+		{
+			if (fields[i] == "now (ms)")
+				columns.now = i;
+			else if (fields[i] == "ppsTime (s)")
+				columns.pps = i;
+			else if (fields[i] == "gpsLat (deg)")
+				columns.lat = i;
+			else if (fields[i] == "gpsLon (deg)")
+				columns.lon = i;
+			else if (fields[i] == "gpsAlt (m)")
+				columns.alt = i;
+		}
+		return false;
+	}
+
+	double now;
+	if (!GetNumber(fields, columns.lat, &pFix->lat) ||
+	    !GetNumber(fields, columns.lon, &pFix->lon) ||
+	    !GetNumber(fields, columns.alt, &pFix->alt) ||
+	    !GetNumber(fields, columns.now, &now))
+		return false;
+
+	// the balloon sends zeros until it has a fix
+	if (pFix->lat == 0.0 && pFix->lon == 0.0)
+		return false;
+
+	pFix->source = source;
+	pFix->timeBase = ETimeBase::TimeOfDay;
+	if (!GetNumber(fields, columns.pps, &pFix->time))
+	{
+		pFix->timeBase = ETimeBase::Uptime;
+		pFix->time = now * 0.001;
+	}
+	return true;
+}
+
+bool TelemetryReader::parseAPRS(const std::string& line, Fix* pFix)
+{
+	int year, month, day, hours, minutes, seconds;
+	if (sscanf(line.c_str(), "%d-%d-%d %d:%d:%d", &year, &month, &day, &hours, &minutes, &seconds) != 6)
+		return false;
+
+	// SRC>DEST,PATH:INFO
+	const size_t header = line.find(c_APRSTimeSuffix) + strlen(c_APRSTimeSuffix);
+	const size_t dest = line.find('>', header);
+	const size_t info = line.find(':', header);
+	if (dest == std::string::npos || info == std::string::npos || dest > info)
+		return false;
+
+	const std::string destination = line.substr(dest + 1, line.find_first_of(",-:", dest + 1) - dest - 1);
+	if (!DecodeMicE(destination.c_str(), line.c_str() + info + 1, pFix))
+		return false;
+
+	tm time;
+	memset(&time, 0, sizeof(time));
+	time.tm_year = year - 1900;
+	time.tm_mon = month - 1;
+	time.tm_mday = day;
+	time.tm_hour = hours;
+	time.tm_min = minutes;
+	time.tm_sec = seconds;
+
+	pFix->source = ESource::APRS;
+	pFix->timeBase = ETimeBase::UTC;
+	pFix->time = (double)timegm(&time);
+	return true;
+}
+
+bool TelemetryReader::DecodeMicE(const char* dest, const char* info, Fix* pFix)
+{
+	if (strlen(dest) != 6 || strlen(info) < 9 || (info[0] != '`' && info[0] != '\''))
+		return false;
+
+	int digits[6];
+	for (int i=0; i<6; ++i)
+	{
+		digits[i] = MicEDigit(dest[i]);
+		if (digits[i] < 0)
+			return false;
+	}
+
+	const bool north = MicEFlag(dest[3]);
+	const bool lonOffset = MicEFlag(dest[4]);
+	const bool west = MicEFlag(dest[5]);
+
+	const double latMinutes = digits[2] * 10 + digits[3] + (digits[4] * 10 + digits[5]) * 0.01;
+	pFix->lat = (digits[0] * 10 + digits[1]) + latMinutes / 60.0;
+	if (!north)
+		pFix->lat = -pFix->lat;
+
+	int lonDeg = (unsigned char)info[1] - 28;
+	if (lonOffset)
+		lonDeg += 100;
+	if (lonDeg >= 180 && lonDeg <= 189)
+		lonDeg -= 80;
+	else if (lonDeg >= 190 && lonDeg <= 199)
+		lonDeg -= 190;
+
+	int lonMin = (unsigned char)info[2] - 28;
+	if (lonMin >= 60)
+		lonMin -= 60;
+	const int lonCentiMin = (unsigned char)info[3] - 28;
+
+	pFix->lon = lonDeg + (lonMin + lonCentiMin * 0.01) / 60.0;
+	if (west)
+		pFix->lon = -pFix->lon;
+
+	// altitude is optional, three base 91 digits before a '}' in the status text
+	pFix->alt = 0.0;
+	const char* pAlt = strchr(info + 9, '}');
+	if (pAlt && pAlt - info >= 12)
+		pFix->alt = (pAlt[-3] - 33) * 91 * 91 + (pAlt[-2] - 33) * 91 + (pAlt[-1] - 33) - 10000.0;
+
+	return true;
+}
@@ -0,0 +1,91 @@
+#ifndef _TELEMETRY_READER_H
+#define _TELEMETRY_READER_H
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+// Reads positions out of the ground station's logs, as they're written.
+//
+// Three kinds of line are understood:
+//   BalloonTracker's Telemetry rows, the balloon's position as received over the XTend
+//   BalloonTracker's Logging rows, the tracker's own position
+//   APRS-IS style log lines, "YYYY-MM-DD HH:MM:SS UTC: SRC>DEST,PATH:INFO", carrying
+//   Mic-E positions like the ones APRS.ino sends
+// BalloonTracker's columns are found from its heading rows (or the current layout if the
+// headings have been missed), and its rows are timed by the PPS time when there is one.
+// Anything else is skipped. When following, a half written line at the end of the file
+// is held back until the rest of it turns up.
+class TelemetryReader
+{
+public:
+	struct ESource
+	{
+		enum Enum
+		{
+			Telemetry,
+			Logging,
+			APRS,
+
+			EnumCount
+		};
+	};
+
+	struct ETimeBase
+	{
+		enum Enum
+		{
+			Uptime,         // s since the tracker started
+			TimeOfDay,      // s since UTC midnight
+			UTC,            // s since 1970
+		};
+	};
+
+	struct Fix
+	{
+		ESource::Enum source;
+		ETimeBase::Enum timeBase;
+		double time;        // s
+		double lat;         // degrees
+		double lon;         // degrees
+		double alt;         // m
+	};
+
+public:
+	TelemetryReader(const char* path, bool follow);
+	~TelemetryReader();
+
+	bool IsOpen() const;
+	const char* GetPath() const;
+
+	// false when there's nothing more to read for now
+	bool Read(Fix* pFix);
+
+	// Mic-E destination address and information field, as sent by AX25::MicECompress()
+	static bool DecodeMicE(const char* dest, const char* info, Fix* pFix);
+
+private:
+	bool readLine(std::string* pLine);
+	bool parseTracker(ESource::Enum source, const std::string& line, Fix* pFix);
+	bool parseAPRS(const std::string& line, Fix* pFix);
+
+private:
+	std::string m_Path;
+	FILE* m_pFile;
+	bool m_Follow;
+	std::string m_Partial;
+
+	struct Columns
+	{
+		int now;
+		int pps;
+		int lat;
+		int lon;
+		int alt;
+	};
+
+	// for Telemetry and Logging rows
+	Columns m_Columns[ESource::APRS];
+};
+
+#endif
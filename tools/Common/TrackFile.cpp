@@ -0,0 +1,188 @@
+#include "TrackFile.h"
+
+#include <fcntl.h>
+#include <stdarg.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace
+{
+	const size_t c_MaxPending = 65536;     // bytes of points to buffer before writing them out anyway
+
+	void Append(std::string* pText, const char* format, ...) __attribute__((format(printf, 2, 3)));
+	void Append(std::string* pText, const char* format, ...)
+	{
+		char buffer[512];
+		va_list args;
+		va_start(args, format);
+		vsnprintf(buffer, sizeof(buffer), format, args);
+		va_end(args);
+		*pText += buffer;
+	}
+
+	void AppendTime(std::string* pText, double time)
+	{
+		const time_t seconds = (time_t)time;
+		tm utc;
+		gmtime_r(&seconds, &utc);
+		Append(pText, "%04d-%02d-%02dT%02d:%02d:%06.3fZ",
+			utc.tm_year + 1900, utc.tm_mon + 1, utc.tm_mday, utc.tm_hour, utc.tm_min, utc.tm_sec + (time - seconds));
+	}
+}
+
+TrackFile::TrackFile() :
+	m_File(-1),
+	m_Format(EFormat::KML),
+	m_TailOffset(0),
+	m_PointCount(0),
+	m_HasPoint(false),
+	m_Lat(0.0),
+	m_Lon(0.0),
+	m_Alt(0.0),
+	m_Time(-1.0)
+{
+}
+
+TrackFile::~TrackFile()
+{
+	if (m_File >= 0)
+	{
+		Flush();
+		close(m_File);
+	}
+}
+
+bool TrackFile::Open(const char* path, EFormat::Enum format, const char* name, const char* color)
+{
+	m_File = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (m_File < 0)
+		return false;
+
+	m_Format = format;
+	m_Name = name;
+	m_Color = color;
+
+	std::string header;
+	writeHeader(&header);
+	m_TailOffset = (long)header.size();
+
+	std::string tail;
+	writeTail(&tail);
+	header += tail;
+	return pwrite(m_File, header.data(), header.size(), 0) == (ssize_t)header.size();
+}
+
+bool TrackFile::IsOpen() const
+{
+	return m_File >= 0;
+}
+
+void TrackFile::AddPoint(double lat, double lon, double alt, double time)
+{
+	writePoint(&m_Pending, lat, lon, alt, time);
+	++m_PointCount;
+
+	m_HasPoint = true;
+	m_Lat = lat;
+	m_Lon = lon;
+	m_Alt = alt;
+	m_Time = time;
+
+	if (m_Pending.size() >= c_MaxPending)
+		Flush();
+}
+
+bool TrackFile::Flush()
+{
+	if (m_File < 0 || m_Pending.empty())
+		return true;
+
+	// the new points and a new tail go over the old tail, all in one write
+	std::string text;
+	text.swap(m_Pending);
+	const long offset = m_TailOffset + (long)text.size();
+	writeTail(&text);
+
+	if (pwrite(m_File, text.data(), text.size(), m_TailOffset) != (ssize_t)text.size())
+		return false;
+
+	// the tail can be shorter than the one it replaced
+	const long end = m_TailOffset + (long)text.size();
+	m_TailOffset = offset;
+	return ftruncate(m_File, end) == 0;
+}
+
+unsigned long TrackFile::GetPointCount() const
+{
+	return m_PointCount;
+}
+
+void TrackFile::writeHeader(std::string* pText) const
+{
+	switch (m_Format)
+	{
+	case EFormat::KML:
+		// laid out like the post-processed logs/*/Flight.kml, but one point to a line
+		Append(pText, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n");
+		Append(pText, "<kml xmlns=\"http://www.opengis.net/kml/2.2\">\n");
+		Append(pText, "<Document>\n<name>%s</name>\n<description>Live track for %s</description>\n", m_Name.c_str(), m_Name.c_str());
+		Append(pText, "<Style id=\"path\">\n<LineStyle>\n<color>%s</color>\n<width>4</width>\n</LineStyle>\n<PolyStyle>\n<color>00%s</color>\n</PolyStyle>\n</Style>\n",
+			m_Color.c_str(), m_Color.c_str() + 2);
+		Append(pText, "<Placemark>\n<name>%s</name>\n<description></description>\n<styleUrl>#path</styleUrl>\n", m_Name.c_str());
+		Append(pText, "<LineString>\n<extrude>1</extrude>\n<tesselate>1</tesselate>\n<altitudeMode>absolute</altitudeMode>\n<coordinates>\n");
+		break;
+
+	case EFormat::GPX:
+		Append(pText, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n");
+		Append(pText, "<gpx version=\"1.1\" creator=\"OpenSpace TrackWriter\" xmlns=\"http://www.topografix.com/GPX/1/1\">\n");
+		Append(pText, "<trk>\n<name>%s</name>\n<trkseg>\n", m_Name.c_str());
+		break;
+	}
+}
+
+void TrackFile::writePoint(std::string* pText, double lat, double lon, double alt, double time) const
+{
+	switch (m_Format)
+	{
+	case EFormat::KML:
+		Append(pText, "%.6f,%.6f,%.1f\n", lon, lat, alt);
+		break;
+
+	case EFormat::GPX:
+		Append(pText, "<trkpt lat=\"%.6f\" lon=\"%.6f\"><ele>%.1f</ele>", lat, lon, alt);
+		if (time >= 0.0)
+		{
+			*pText += "<time>";
+			AppendTime(pText, time);
+			*pText += "</time>";
+		}
+		*pText += "</trkpt>\n";
+		break;
+	}
+}
+
+void TrackFile::writeTail(std::string* pText) const
+{
+	switch (m_Format)
+	{
+	case EFormat::KML:
+		Append(pText, "</coordinates>\n</LineString></Placemark>\n");
+		if (m_HasPoint)
+		{
+			Append(pText, "<Placemark>\n<name>%s Position</name>\n", m_Name.c_str());
+			Append(pText, "<description>%s at %.5f, %.5f with altitude %.0fm", m_Name.c_str(), m_Lat, m_Lon, m_Alt);
+			if (m_Time >= 0.0)
+			{
+				*pText += " at ";
+				AppendTime(pText, m_Time);
+			}
+			Append(pText, ".</description>\n<Point><altitudeMode>absolute</altitudeMode><coordinates>%.6f,%.6f,%.1f</coordinates></Point>\n</Placemark>\n", m_Lon, m_Lat, m_Alt);
+		}
+		Append(pText, "</Document></kml>\n");
+		break;
+
+	case EFormat::GPX:
+		Append(pText, "</trkseg>\n</trk>\n</gpx>\n");
+		break;
+	}
+}
@@ -0,0 +1,62 @@
+#ifndef _TRACK_FILE_H
+#define _TRACK_FILE_H
+
+#include <stdio.h>
+#include <string>
+
+// A KML or GPX track that grows as points arrive, without ever rewriting what's already there.
+//
+// The file is a header, the points so far, and a tail that closes everything off (and for
+// KML, marks the latest position). New points are written over the old tail, followed by
+// a new one, in a single write, so the file is valid whenever something reads it and the
+// cost of a point doesn't grow with the length of the flight. Points are buffered until
+// Flush(), and only the latest one is kept, so memory use is constant too.
+class TrackFile
+{
+public:
+	struct EFormat
+	{
+		enum Enum
+		{
+			KML,
+			GPX,
+		};
+	};
+
+public:
+	TrackFile();
+	~TrackFile();
+
+	// color is KML's aabbggrr
+	bool Open(const char* path, EFormat::Enum format, const char* name, const char* color);
+	bool IsOpen() const;
+
+	// time is s since 1970 UTC, or negative if it isn't known
+	void AddPoint(double lat, double lon, double alt, double time);
+	bool Flush();
+
+	unsigned long GetPointCount() const;
+
+private:
+	void writeHeader(std::string* pText) const;
+	void writePoint(std::string* pText, double lat, double lon, double alt, double time) const;
+	void writeTail(std::string* pText) const;
+
+private:
+	int m_File;
+	EFormat::Enum m_Format;
+	std::string m_Name;
+	std::string m_Color;
+
+	long m_TailOffset;          // where the tail starts, and the next points will go
+	std::string m_Pending;      // points that haven't been written yet
+	unsigned long m_PointCount;
+
+	bool m_HasPoint;            // the latest point, for the tail
+	double m_Lat;
+	double m_Lon;
+	double m_Alt;
+	double m_Time;
+};
+
+#endif
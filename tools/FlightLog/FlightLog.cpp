@@ -0,0 +1,302 @@
+// Turns the balloon's flight recorder log back into CSV rows like the ones it logs over
+// serial, from what FlightDump sent, from a raw image of the chip with -r (read off it
+// with a programmer, or saved by RecorderSim), or with -b from the tracker's log of what
+// came down the bulk downlink during the flight.
+//
+// FlightDump's frames are 0xA5 0x5A 'F', a sector's index, its 4096 bytes and a CRC32 of
+// the index and the bytes. Anything that doesn't check out is skipped, so a dump that was
+// cut off still gives what it got. The sectors are put back where they were on the chip
+// and FlightLogReader walks the log from its oldest record. Each row says which sector
+// (by sequence number) and page it came from and the page's state, so the last records of
+// a page that was still open when the power went can be told apart, since nothing's
+// checked them.
+//
+// The tracker's Bulk rows each hold a 32 byte chunk of the log, numbered from the start of
+// the log's first sector, so they're put back where they belong in sectors laid out by
+// sequence number. A sector whose header never came down gets one made up for it, and the
+// chunks that are missing are left erased, so their pages read as corrupt or open.
+//
+// Build from this directory with:
+//   g++ -O2 -I../Host -I../Common -I../../libraries/Core -I../../libraries/CRC
+//       -I../../libraries/FlightRecorder -I../../apps/Balloon FlightLog.cpp
+//       ../Common/FileFlash.cpp ../../libraries/FlightRecorder/FlightRecorder.cpp
+//       ../../libraries/FlightRecorder/FlightLogReader.cpp ../../libraries/CRC/CRC.cpp
+//       -o FlightLog
+//
+// Usage: FlightLog [-r | -b] file
+
+#include <Arduino.h>
+#include <CRC.h>
+#include <FileFlash.h>
+#include <FlightRecorder.h>
+#include <FlightLogReader.h>
+#include <Records.h>
+
+#include <unistd.h>
+#include <map>
+#include <vector>
+
+namespace
+{
+	const uint8_t c_Sync[] = {0xA5, 0x5A, 'F'};
+	const uint8_t c_ChunkSize = 32;     // BulkPacket's
+	const char* const c_EventNames[] = {"none", "burst", "apogee", "freeFall", "landing"};
+
+	void Usage()
+	{
+		fprintf(stderr, "Usage: FlightLog [-r | -b] file\n");
+	}
+
+	// puts the sectors in every frame that checks out back in their places
+	uint32_t ReadDump(FILE* pFile, FileFlash* pFlash)
+	{
+		std::vector<uint8_t> data;
+		uint8_t buffer[4096];
+		size_t count;
+		while ((count = fread(buffer, 1, sizeof(buffer), pFile)) > 0)
+			data.insert(data.end(), buffer, buffer + count);
+
+		const size_t header = sizeof(c_Sync) + 2;
+		const size_t frameSize = header + FlashDevice::c_SectorSize + 4;
+		uint32_t sectors = 0;
+		for (size_t i=0; i + frameSize <= data.size(); ++i)
+		{
+			if (memcmp(&data[i], c_Sync, sizeof(c_Sync)) != 0)
+				continue;
+
+			const uint8_t* pCRC = &data[i + header + FlashDevice::c_SectorSize];
+			const uint32_t crc = pCRC[0] | (pCRC[1] << 8) | (pCRC[2] << 16) | ((uint32_t)pCRC[3] << 24);
+			if (crc32(&data[i + sizeof(c_Sync)], 2 + FlashDevice::c_SectorSize) != crc)
+				continue;
+
+			const uint16_t sector = data[i + 3] | (data[i + 4] << 8);
+			pFlash->Write((uint32_t)sector * FlashDevice::c_SectorSize, &data[i + header], FlashDevice::c_SectorSize);
+			++sectors;
+			i += frameSize - 1;
+		}
+		return sectors;
+	}
+
+	// puts the chunks in the tracker's Bulk rows back in sectors of their own, by sequence number
+	uint32_t ReadBulk(FILE* pFile, FileFlash* pFlash)
+	{
+		std::map<uint32_t, std::vector<uint8_t> > chunks;
+		char line[256];
+		while (fgets(line, sizeof(line), pFile))
+		{
+			unsigned now, chunk;
+			char hex[2 * c_ChunkSize + 1];
+			if (sscanf(line, "Bulk,%u,%u,%64[0-9a-f]", &now, &chunk, hex) != 3 || strlen(hex) != 2 * c_ChunkSize)
+				continue;
+
+			std::vector<uint8_t>& data = chunks[chunk];
+			data.resize(c_ChunkSize);
+			for (uint8_t i=0; i<c_ChunkSize; ++i)
+			{
+				unsigned byte;
+				sscanf(hex + 2 * i, "%2x", &byte);
+				data[i] = (uint8_t)byte;
+			}
+		}
+		if (chunks.empty())
+			return 0;
+
+		const uint32_t chunksPerSector = FlashDevice::c_SectorSize / c_ChunkSize;
+		const uint32_t first = chunks.begin()->first / chunksPerSector;
+		const uint32_t last = chunks.rbegin()->first / chunksPerSector;
+		for (uint32_t sequence=first; sequence<=last; ++sequence)
+		{
+			if (chunks.count(sequence * chunksPerSector))
+				continue;
+
+			FlightRecorder::SectorHeader header;
+			header.magic = FlightRecorder::c_Magic;
+			header.version = FlightRecorder::c_Version;
+			header.reserved = 0xFF;
+			header.sequence = sequence;
+			header.eraseCount = 0;
+			header.crc = crc32((const uint8_t*)&header, sizeof(header) - sizeof(header.crc));
+			pFlash->Write((sequence - first) * FlashDevice::c_SectorSize, (const uint8_t*)&header, sizeof(header));
+		}
+
+		for (std::map<uint32_t, std::vector<uint8_t> >::const_iterator it=chunks.begin(); it!=chunks.end(); ++it)
+			pFlash->Write((it->first - first * chunksPerSector) * c_ChunkSize, &it->second[0], c_ChunkSize);
+		return chunks.size();
+	}
+
+	// the full millis() of a capture sample, from the bottom 16 bits and the time of a record near it
+	uint32_t UnwrapTime(uint16_t time, uint32_t near)
+	{
+		return near + (int16_t)(time - (uint16_t)near);
+	}
+
+	void PrintHeadings()
+	{
+		const char* const where = "sequence,page,pageState,";
+		printf("Flight,%snow (ms),gpsLat (deg),gpsLon (deg),gpsAlt (m),bmpPressure (Pa),altitude (m),ascentRate (m/s),", where);
+		printf("accelX (raw),accelY (raw),accelZ (raw),angVelX (raw),angVelY (raw),angVelZ (raw),magX (raw),magY (raw),magZ (raw),");
+		printf("thermistor0 (deg C),thermistor1 (deg C),thermistor2 (deg C),battery (V),\n");
+		printf("Event,%snow (ms),event,altitude (m),maxAltitude (m),ascentRate (m/s),pressureTrend (ppm/s),captureDropped,recorderDropped,\n", where);
+		printf("Capture,%snow (ms),accelX (raw),accelY (raw),accelZ (raw),angVelX (raw),angVelY (raw),angVelZ (raw),ascentRate (m/s),\n", where);
+	}
+
+	void PrintFlight(const FlightRecord& record)
+	{
+		printf("%u,", record.now);
+		if (record.gpsLat != 0 || record.gpsLon != 0)
+			printf("%.5f,%.5f,%.2f,", record.gpsLat * 1e-5, record.gpsLon * 1e-5, record.gpsAlt * 0.01);
+		else
+			printf(",,,");
+		printf("%u,%.3f,%.2f,", record.bmpPressure, record.altitude * 0.001, record.ascentRate * 0.01);
+		for (uint8_t i=0; i<3; ++i)
+			printf("%d,", record.accel[i]);
+		for (uint8_t i=0; i<3; ++i)
+			printf("%d,", record.gyro[i]);
+		for (uint8_t i=0; i<3; ++i)
+			printf("%d,", record.mag[i]);
+		for (uint8_t i=0; i<3; ++i)
+			printf("%.2f,", record.thermTemps[i] * 0.01);
+		printf("%.3f,\n", record.batteryVoltage * 0.001);
+	}
+
+	void PrintEvent(const EventRecord& record)
+	{
+		printf("%u,%s,%.3f,%.3f,%.2f,%d,%u,%u,\n", record.now,
+			record.event < sizeof(c_EventNames) / sizeof(c_EventNames[0]) ? c_EventNames[record.event] : "unknown",
+			record.altitude * 0.001, record.maxAltitude * 0.001, record.ascentRate * 0.01,
+			record.pressureTrend, record.captureDropped, record.recorderDropped);
+	}
+
+	void PrintCapture(const CaptureRecord& record, uint32_t near)
+	{
+		printf("%u,", UnwrapTime(record.time, near));
+		for (uint8_t i=0; i<3; ++i)
+			printf("%d,", record.accel[i]);
+		for (uint8_t i=0; i<3; ++i)
+			printf("%d,", record.gyro[i]);
+		printf("%.2f,\n", record.ascentRate * 0.01);
+	}
+}
+
+// FileFlash only looks at the clock while it's programming or erasing, which it never is here
+unsigned long micros()
+{
+	return 0;
+}
+
+int main(int argc, char** argv)
+{
+	bool raw = false;
+	bool bulk = false;
+
+	int opt;
+	while ((opt = getopt(argc, argv, "rb")) != -1)
+	{
+		switch (opt)
+		{
+		case 'r': raw = true; break;
+		case 'b': bulk = true; break;
+		default: Usage(); return 1;
+		}
+	}
+	if (optind + 1 != argc || (raw && bulk))
+	{
+		Usage();
+		return 1;
+	}
+
+	const char* path = argv[optind];
+	FileFlash flash(0);
+	if (raw)
+	{
+		if (!flash.Load(path))
+		{
+			fprintf(stderr, "Couldn't read %s\n", path);
+			return 1;
+		}
+	}
+	else
+	{
+		FILE* pFile = fopen(path, "rb");
+		if (!pFile)
+		{
+			fprintf(stderr, "Couldn't read %s\n", path);
+			return 1;
+		}
+		if (bulk)
+		{
+			const uint32_t chunks = ReadBulk(pFile, &flash);
+			fprintf(stderr, "%u chunks in the tracker's log\n", chunks);
+		}
+		else
+		{
+			const uint32_t sectors = ReadDump(pFile, &flash);
+			fprintf(stderr, "%u sectors in the dump\n", sectors);
+		}
+		fclose(pFile);
+	}
+
+	FlightLogReader reader(&flash);
+	if (!reader.Rewind())
+	{
+		fprintf(stderr, "No log in %s\n", path);
+		return 1;
+	}
+
+	PrintHeadings();
+
+	uint32_t counts[FlightLogReader::EPageState::Open + 1] = {0};
+	uint32_t unknown = 0;
+	uint32_t lastNow = 0;           // of the last Flight or Event record, for putting the captures' times back together
+	FlightLogReader::Record record;
+	while (reader.Next(&record))
+	{
+		++counts[record.pageState];
+
+		const char* const state = FlightLogReader::GetPageStateName(record.pageState);
+		switch (record.type)
+		{
+		case ERecordType::Flight:
+			if (record.size == sizeof(FlightRecord))
+			{
+				FlightRecord flight;
+				memcpy(&flight, record.data, sizeof(flight));
+				printf("Flight,%u,%u,%s,", record.sequence, record.page, state);
+				PrintFlight(flight);
+				lastNow = flight.now;
+				continue;
+			}
+			break;
+
+		case ERecordType::Event:
+			if (record.size == sizeof(EventRecord))
+			{
+				EventRecord event;
+				memcpy(&event, record.data, sizeof(event));
+				printf("Event,%u,%u,%s,", record.sequence, record.page, state);
+				PrintEvent(event);
+				lastNow = event.now;
+				continue;
+			}
+			break;
+
+		case ERecordType::Capture:
+			if (record.size == sizeof(CaptureRecord))
+			{
+				CaptureRecord capture;
+				memcpy(&capture, record.data, sizeof(capture));
+				printf("Capture,%u,%u,%s,", record.sequence, record.page, state);
+				PrintCapture(capture, lastNow);
+				continue;
+			}
+			break;
+		}
+		++unknown;
+	}
+
+	fprintf(stderr, "%u sectors from #%u: %u records verified, %u recovered, %u corrupt, %u open, %u of unknown types\n",
+		reader.GetSectorCount(), reader.GetFirstSequence(),
+		counts[FlightLogReader::EPageState::Verified], counts[FlightLogReader::EPageState::Recovered],
+		counts[FlightLogReader::EPageState::Corrupt], counts[FlightLogReader::EPageState::Open], unknown);
+	return 0;
+}
@@ -0,0 +1,260 @@
+// Times TinyGPS's encode() against the GGA and RMC only parser it grew out of (OldTinyGPS,
+// here), and checks that the two agree on everything the old one decoded. The new one
+// still buffers each term the same way, but also decodes GSA, GSV, VTG and ZDA from any
+// talker, so on the full stream it's doing more of the work.
+//
+// The input is a simulated receiver's output, one burst a second of a balloon climbing
+// and drifting: GGA, GSA, three GSVs, RMC and VTG, as a typical receiver sends them, or
+// with -r just the GGA and RMC that the old parser understood. Both parsers are fed
+// the whole flight, taking turns, 20 times over and the best time per byte is kept. After every GGA
+// and RMC, what it carries (position and time, and altitude, satellites and HDOP from a
+// GGA or date, speed and course from an RMC) has to match between the two.
+//
+// Build from this directory with:
+//   g++ -O2 -DARDUINO=100 -I../Host -I../../external/TinyGPS GPSBench.cpp OldTinyGPS.cpp
+//       ../../external/TinyGPS/TinyGPS.cpp -o GPSBench
+//
+// Usage: GPSBench [-r] [-t hours] [-s seed]
+//   -r           GGA and RMC only
+//   -t hours     flight time, default 1
+//   -s seed
+// and exits with 2 if the parsers disagree.
+
+#include <Arduino.h>
+#include <TinyGPS.h>
+#include "OldTinyGPS.h"
+
+#include <unistd.h>
+#include <time.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+namespace
+{
+	const int c_Passes = 20;
+
+	unsigned long g_Millis = 0;
+
+	struct ESentence
+	{
+		enum Enum
+		{
+			GGA,
+			RMC,
+			Other,                // which only the new parser decodes
+		};
+	};
+
+	struct Sentence
+	{
+		std::string text;         // with the checksum and CR LF
+		ESentence::Enum type;
+	};
+
+	double Random()
+	{
+		return rand() / (RAND_MAX + 1.0);
+	}
+
+	double Now()
+	{
+		timespec ts;
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		return ts.tv_sec + ts.tv_nsec * 1e-9;
+	}
+
+	void Add(std::vector<Sentence>& out, const char* body, ESentence::Enum type)
+	{
+		byte parity = 0;
+		for (const char* p=body; *p; ++p)
+			parity ^= *p;
+
+		char text[128];
+		snprintf(text, sizeof(text), "$%s*%02X\r\n", body, parity);
+		Sentence sentence = {text, type};
+		out.push_back(sentence);
+	}
+
+	// ddmm.mmmm and the hemisphere
+	void FormatAngle(char* out, size_t size, double degrees, int degreeDigits, char positive, char negative)
+	{
+		const char hemisphere = degrees < 0 ? negative : positive;
+		degrees = fabs(degrees);
+		const int whole = (int)degrees;
+		snprintf(out, size, "%0*d%07.4f,%c", degreeDigits, whole, (degrees - whole) * 60, hemisphere);
+	}
+
+	std::vector<Sentence> Simulate(double hours, bool reduced)
+	{
+		std::vector<Sentence> ret;
+		double lat = 30.2425;
+		double lon = -97.8263;
+		double alt = 225.6;
+		const int seconds = (int)(hours * 3600);
+		for (int t=0; t<seconds; ++t)
+		{
+			const int tod = (20 * 3600 + 15 * 60 + t) % 86400;
+			char time[16];
+			snprintf(time, sizeof(time), "%02d%02d%02d.000", tod / 3600, tod / 60 % 60, tod % 60);
+
+			const double north = Random() * 10 - 5;
+			const double east = Random() * 20;
+			lat += north / 111000;
+			lon += east / (111000 * cos(radians(lat)));
+			alt += 5 + Random() - 0.5;
+			const double knots = sqrt(north * north + east * east) / 0.51444444;
+			const double course = fmod(degrees(atan2(east, north)) + 360, 360);
+			const int sats = 6 + rand() % 6;
+			const double hdop = 0.8 + Random();
+
+			char latText[20];
+			char lonText[20];
+			FormatAngle(latText, sizeof(latText), lat, 2, 'N', 'S');
+			FormatAngle(lonText, sizeof(lonText), lon, 3, 'E', 'W');
+
+			char body[120];
+			snprintf(body, sizeof(body), "GPGGA,%s,%s,%s,1,%02d,%.1f,%.1f,M,-22.5,M,,", time, latText, lonText, sats, hdop, alt);
+			Add(ret, body, ESentence::GGA);
+
+			if (!reduced)
+			{
+				snprintf(body, sizeof(body), "GPGSA,A,3,04,05,,09,12,,,24,,,,,%.1f,%.1f,%.1f", hdop * 1.6, hdop, hdop * 1.3);
+				Add(ret, body, ESentence::Other);
+				for (int i=1; i<=3; ++i)
+				{
+					snprintf(body, sizeof(body), "GPGSV,3,%d,12,%02d,%02d,%03d,%02d,%02d,%02d,%03d,%02d,%02d,%02d,%03d,,%02d,%02d,%03d,%02d",
+						i, i * 4, rand() % 90, rand() % 360, 20 + rand() % 30, i * 4 + 1, rand() % 90, rand() % 360, 20 + rand() % 30,
+						i * 4 + 2, rand() % 90, rand() % 360, i * 4 + 3, rand() % 90, rand() % 360, 20 + rand() % 30);
+					Add(ret, body, ESentence::Other);
+				}
+			}
+
+			snprintf(body, sizeof(body), "GPRMC,%s,A,%s,%s,%.2f,%.2f,040109,,", time, latText, lonText, knots, course);
+			Add(ret, body, ESentence::RMC);
+
+			if (!reduced)
+			{
+				snprintf(body, sizeof(body), "GPVTG,%.1f,T,,M,%.2f,N,%.2f,K", course, knots, knots * 1.852);
+				Add(ret, body, ESentence::Other);
+			}
+		}
+		return ret;
+	}
+
+	// one pass over the stream, in seconds per byte
+	template <typename GPS>
+	double Time(const std::string& stream)
+	{
+		GPS gps;
+		const double start = Now();
+		for (size_t i=0; i<stream.size(); ++i)
+			gps.encode(stream[i]);
+		const double ret = (Now() - start) / stream.size();
+
+		unsigned long chars;
+		unsigned short good;
+		unsigned short failed;
+		gps.stats(&chars, &good, &failed);
+		if (failed != 0)
+			fprintf(stderr, "%u sentences failed their checksum\n", failed);
+		return ret;
+	}
+
+	// what the sentence that's just been decoded carries
+	bool Same(ESentence::Enum type, TinyGPS& a, OldTinyGPS& b)
+	{
+		long latA, lonA, latB, lonB;
+		unsigned long dateA, timeA, dateB, timeB;
+		a.get_position(&latA, &lonA);
+		b.get_position(&latB, &lonB);
+		a.get_datetime(&dateA, &timeA);
+		b.get_datetime(&dateB, &timeB);
+		if (latA != latB || lonA != lonB || timeA != timeB)
+			return false;
+
+		if (type == ESentence::GGA)
+			return a.altitude() == b.altitude() && a.satellites() == b.satellites() && a.hdop() == b.hdop();
+		return dateA == dateB && a.speed() == b.speed() && a.course() == b.course();
+	}
+
+	void Usage()
+	{
+		fprintf(stderr, "Usage: GPSBench [-r] [-t hours] [-s seed]\n");
+	}
+}
+
+unsigned long micros()
+{
+	return g_Millis * 1000;
+}
+
+unsigned long millis()
+{
+	return g_Millis;
+}
+
+int main(int argc, char** argv)
+{
+	bool reduced = false;
+	double hours = 1.0;
+
+	int opt;
+	while ((opt = getopt(argc, argv, "rt:s:")) != -1)
+	{
+		switch (opt)
+		{
+		case 'r': reduced = true; break;
+		case 't': hours = std::max(atof(optarg), 0.01); break;
+		case 's': srand(atoi(optarg)); break;
+		default: Usage(); return 1;
+		}
+	}
+
+	const std::vector<Sentence> sentences = Simulate(hours, reduced);
+	std::string stream;
+	for (size_t i=0; i<sentences.size(); ++i)
+		stream += sentences[i].text;
+
+	// check first, a sentence at a time
+	TinyGPS gps;
+	OldTinyGPS oldGps;
+	uint32_t compared = 0;
+	uint32_t mismatched = 0;
+	for (size_t i=0; i<sentences.size(); ++i)
+	{
+		const std::string& text = sentences[i].text;
+		bool valid = false;
+		bool oldValid = false;
+		for (size_t j=0; j<text.size(); ++j)
+		{
+			valid |= gps.encode(text[j]);
+			oldValid |= oldGps.encode(text[j]);
+		}
+
+		if (sentences[i].type == ESentence::Other)
+			continue;
+		++compared;
+		if (valid != oldValid || !Same(sentences[i].type, gps, oldGps))
+		{
+			if (mismatched++ < 10)
+				fprintf(stderr, "mismatch after %s", text.c_str());
+		}
+	}
+
+	// taking turns, so that both see the same load on the machine, and keeping the best
+	double time = 1e9;
+	double oldTime = 1e9;
+	for (int pass=0; pass<c_Passes; ++pass)
+	{
+		time = std::min(time, Time<TinyGPS>(stream));
+		oldTime = std::min(oldTime, Time<OldTinyGPS>(stream));
+	}
+
+	printf("%u sentences, %u bytes, %u compared, %u mismatched\n", (unsigned)sentences.size(), (unsigned)stream.size(), compared, mismatched);
+	printf("TinyGPS     %6.2f ns/byte\n", time * 1e9);
+	printf("OldTinyGPS  %6.2f ns/byte\n", oldTime * 1e9);
+	printf("ratio       %6.2f\n", time / oldTime);
+
+	return mismatched ? 2 : 0;
+}
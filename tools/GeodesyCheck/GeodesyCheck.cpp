@@ -0,0 +1,159 @@
+// Checks Geodesy's fixed point range, bearing and look angle against the same spherical
+// maths in double precision, the way the bounds in Geodesy.h were measured.
+//
+// Each trial starts from a random point between 80 S and 80 N, goes a random distance
+// (spread evenly in log, from 10 m to 3000 km) on a random bearing, and rounds both ends
+// to the 1e-5 degree integers that TinyGPS gives us. The references are then worked out
+// from the rounded coordinates, on the same 6372795 m sphere:
+//
+//   range         HaversineRangeInM() against the haversine
+//   bearing       BearingInCentiDeg() against the initial great circle bearing, past 100 m
+//                 (closer in, the 1e-5 degree rounding alone moves it by more)
+//   elevation     GetLookAngle() from 100 m up to a random altitude under 40 km
+//
+// and the worst error of each is printed for each decade of range, along with the range
+// it happened at.
+//
+// Build from this directory with:
+//   g++ -O2 -I../Host -I../../libraries/Core -I../../libraries/Geodesy GeodesyCheck.cpp
+//       ../../libraries/Geodesy/Geodesy.cpp -o GeodesyCheck
+//
+// Usage: GeodesyCheck [-n trials] [-s seed]
+//   -n trials    default 200000
+//   -s seed
+// and exits with 2 if any error is over the bounds Geodesy.h gives for its decade.
+
+#include <Arduino.h>
+#include <Geodesy.h>
+
+#include <unistd.h>
+#include <algorithm>
+
+namespace
+{
+	const double c_EarthRadius      = 6372795;  // m, as in Geodesy.cpp
+	const int c_Decades             = 6;        // 10 m to 3000 km
+
+	// the bounds in Geodesy.h, for each decade of range from 10 m
+	const double c_RangeBound[c_Decades]     = { 2.5,  2.5,  2.5,  2.5,  2.5,  2.5};  // m
+	const double c_BearingBound[c_Decades]   = {   0,  0.5,  0.1, 0.02, 0.02, 0.02};  // degrees, not checked under 100 m
+	const double c_ElevationBound[c_Decades] = { 0.1, 0.05, 0.05, 0.05, 0.05, 0.05};  // degrees
+
+	struct Worst
+	{
+		double error;
+		double range;     // m, where it was
+	};
+
+	typedef Worst Decades[c_Decades];
+
+	double Random()
+	{
+		return rand() / (RAND_MAX + 1.0);
+	}
+
+	void Update(Decades worst, double error, double range)
+	{
+		const int decade = std::min(std::max((int)floor(log10(range)) - 1, 0), c_Decades - 1);
+		error = fabs(error);
+		if (error > worst[decade].error)
+		{
+			worst[decade].error = error;
+			worst[decade].range = range;
+		}
+	}
+
+	bool Report(const char* name, const Decades worst, const char* units, const double* bounds)
+	{
+		bool ok = true;
+		printf("%s\n", name);
+		for (int i=0; i<c_Decades; ++i)
+		{
+			if (worst[i].range == 0)
+				continue;
+			const bool over = worst[i].error > bounds[i];
+			printf("  from %7.0f m: %6.3f %s at %7.0f m%s\n", pow(10, i + 1), worst[i].error, units, worst[i].range, over ? ", over" : "");
+			ok &= !over;
+		}
+		return ok;
+	}
+
+	void Usage()
+	{
+		fprintf(stderr, "Usage: GeodesyCheck [-n trials] [-s seed]\n");
+	}
+}
+
+unsigned long micros()
+{
+	return 0;
+}
+
+unsigned long millis()
+{
+	return 0;
+}
+
+int main(int argc, char** argv)
+{
+	long trials = 200000;
+
+	int opt;
+	while ((opt = getopt(argc, argv, "n:s:")) != -1)
+	{
+		switch (opt)
+		{
+		case 'n': trials = atol(optarg); break;
+		case 's': srand(atoi(optarg)); break;
+		default: Usage(); return 1;
+		}
+	}
+
+	Decades range = {};
+	Decades bearing = {};
+	Decades elevation = {};
+	for (long n=0; n<trials; ++n)
+	{
+		// a point, and another some way off it
+		const double startLat = radians((Random() - 0.5) * 160);
+		const double startLon = radians((Random() - 0.5) * 360);
+		const double distance = pow(10, 1 + Random() * 5.5) / c_EarthRadius;
+		const double course = Random() * 2 * M_PI;
+		const double endLat = asin(sin(startLat) * cos(distance) + cos(startLat) * sin(distance) * cos(course));
+		const double endLon = startLon + atan2(sin(course) * sin(distance) * cos(startLat), cos(distance) - sin(startLat) * sin(endLat));
+
+		const int32_t lat1 = lround(degrees(startLat) * 1e5);
+		const int32_t lon1 = lround(degrees(startLon) * 1e5);
+		const int32_t lat2 = lround(degrees(endLat) * 1e5);
+		const int32_t lon2 = lround(remainder(degrees(endLon), 360.0) * 1e5);
+
+		// the references, from what Geodesy was actually given
+		const double phi1 = radians(lat1 * 1e-5);
+		const double phi2 = radians(lat2 * 1e-5);
+		const double dLambda = radians(lon2 * 1e-5 - lon1 * 1e-5);
+		const double sinHalfLat = sin((phi2 - phi1) / 2);
+		const double sinHalfLon = sin(dLambda / 2);
+		const double angle = 2 * asin(sqrt(sinHalfLat * sinHalfLat + cos(phi1) * cos(phi2) * sinHalfLon * sinHalfLon));
+		const double referenceRange = angle * c_EarthRadius;
+		const double referenceBearing = degrees(atan2(sin(dLambda) * cos(phi2), cos(phi1) * sin(phi2) - sin(phi1) * cos(phi2) * cos(dLambda)));
+
+		Update(range, Geodesy::HaversineRangeInM(lat1, lon1, lat2, lon2) - referenceRange, referenceRange);
+		if (referenceRange > 100)
+			Update(bearing, remainder(Geodesy::BearingInCentiDeg(lat1, lon1, lat2, lon2) * 0.01 - referenceBearing, 360.0), referenceRange);
+
+		const int32_t alt1 = 100;
+		const int32_t alt2 = rand() % 40000;
+		Geodesy::LookAngle look;
+		Geodesy::GetLookAngle(lat1, lon1, alt1, lat2, lon2, alt2, &look);
+		const double out = (c_EarthRadius + alt2) * sin(angle);
+		const double up = (c_EarthRadius + alt2) * cos(angle) - (c_EarthRadius + alt1);
+		Update(elevation, look.elevation * 0.01 - degrees(atan2(up, out)), referenceRange);
+	}
+
+	printf("%ld trials, worst errors:\n", trials);
+	bool ok = Report("range", range, "m", c_RangeBound);
+	ok &= Report("bearing", bearing, "deg", c_BearingBound);
+	ok &= Report("elevation", elevation, "deg", c_ElevationBound);
+
+	return ok ? 0 : 2;
+}
@@ -0,0 +1,52 @@
+#ifndef _HOST_ARDUINO_H
+#define _HOST_ARDUINO_H
+
+// Just enough of the Arduino core to build the hardware independent libraries into
+// programs that run on a PC. The program has to provide millis() and micros(),
+// analogRead() if it uses a library that reads a pin, and delay() if it uses one that
+// waits.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <math.h>
+#include <avr/pgmspace.h>
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+
+#define PI 3.1415926535897932384626433832795
+#define TWO_PI 6.283185307179586476925286766559
+#define radians(deg) ((deg) * 0.017453292519943295769236907684886)
+#define degrees(rad) ((rad) * 57.295779513082320876798154814105)
+#define sq(x) ((x) * (x))
+
+template <typename T> T min(T a, T b) { return a < b ? a : b; }
+template <typename T> T max(T a, T b) { return a > b ? a : b; }
+
+unsigned long millis();
+unsigned long micros();
+int analogRead(uint8_t pin);
+void delay(unsigned long ms);
+
+// Serial goes to stdout
+class HostSerial
+{
+public:
+	size_t print(const char* s) { return fputs(s, stdout) >= 0 ? strlen(s) : 0; }
+	size_t print(char c) { return putchar(c) != EOF; }
+	size_t write(uint8_t b) { return putchar(b) != EOF; }
+	size_t println() { return print('\n'); }
+};
+
+extern HostSerial Serial;
+
+#endif
@@ -0,0 +1,18 @@
+#ifndef _HOST_WIRE_H
+#define _HOST_WIRE_H
+
+// There's no I2C on a PC; this is only here so that Core.h and the sensor libraries compile.
+class TwoWire
+{
+public:
+	void beginTransmission(uint8_t) {}
+	uint8_t endTransmission() { return 0; }
+	uint8_t requestFrom(uint8_t, uint8_t) { return 0; }
+	int available() { return 0; }
+	int read() { return 0; }
+	size_t write(uint8_t) { return 1; }
+};
+
+extern TwoWire Wire;
+
+#endif
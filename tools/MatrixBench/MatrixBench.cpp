@@ -0,0 +1,536 @@
+// Checks MatrixMath's kernels against plain reference versions of the same maths and
+// times them against the kernels they replaced, on random well conditioned inputs:
+//
+//   multiply      operator* against the old zero-then-accumulate triple loop
+//   transpose     MulTranspose() against multiplying by Transpose()
+//   sandwich      Sandwich(A, P) against A * P * A^T on full matrices
+//   inverse       2x2, 3x3 and 4x4 Inverse() against Gauss-Jordan in double; the 4x4
+//                 is timed against the old one, which expanded Determinant() separately
+//   cholesky      decompose and solve against multiplying by the inverse: Inverse() up
+//                 to 4x4, where it's quicker, and Gauss-Jordan in float above that
+//   ldlt          the same, without the sqrt()
+//   ekf step      a 7 state predict and a 4 value measurement update, on SymMatrix with
+//                 the kernels above against full matrices with the old ones, along with
+//                 how many float multiplies each takes
+//
+// Errors are the largest absolute difference from the double precision reference, or
+// for the solves the largest residual |A x - b|, over every trial. The times are per
+// call on this machine, so only the ratios between the columns mean much; on the AVR
+// every float operation's a library call and the savings go with the operation counts.
+//
+// Build from this directory with:
+//   g++ -O2 -I../Host -I../../libraries/Core -I../../libraries/MatrixMath MatrixBench.cpp
+//       ../../libraries/MatrixMath/MatrixMath.cpp -o MatrixBench
+//
+// Usage: MatrixBench [-n trials] [-s seed]
+//   -n trials    random inputs per check, default 100000
+//   -s seed
+// and exits with 2 if any error is over its tolerance.
+
+#include <Arduino.h>
+#include <MatrixMath.h>
+
+#include <unistd.h>
+#include <time.h>
+#include <algorithm>
+#include <vector>
+
+namespace
+{
+	const double c_Tolerance = 1e-4;       // relative to the inputs, which are all about 1
+
+	volatile float g_Sink;
+	bool g_Failed = false;
+
+	double Random()
+	{
+		return rand() / (RAND_MAX + 1.0) * 2.0 - 1.0;
+	}
+
+	double Now()
+	{
+		timespec ts;
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		return ts.tv_sec + ts.tv_nsec * 1e-9;
+	}
+
+	template <uint32_t rows, uint32_t cols>
+	Matrix<rows, cols> RandomMatrix()
+	{
+		Matrix<rows, cols> ret;
+		for (uint8_t r=0; r<rows; ++r)
+			for (uint8_t c=0; c<cols; ++c)
+				ret.m[r][c] = (float)Random();
+		return ret;
+	}
+
+	// M M^T + n I, so that it's symmetric positive definite and nowhere near singular
+	template <uint32_t n>
+	Matrix<n, n> RandomSPD()
+	{
+		const Matrix<n, n> M = RandomMatrix<n, n>();
+		Matrix<n, n> ret = MulTranspose(M, M);
+		for (uint8_t i=0; i<n; ++i)
+			ret.m[i][i] += n;
+		return ret;
+	}
+
+	// well conditioned but not symmetric
+	template <uint32_t n>
+	Matrix<n, n> RandomInvertible()
+	{
+		Matrix<n, n> ret = RandomMatrix<n, n>();
+		for (uint8_t i=0; i<n; ++i)
+			ret.m[i][i] += (ret.m[i][i] < 0 ? -n : n);
+		return ret;
+	}
+
+	// the multiply as it was before the kernels were unrolled
+	template <uint32_t rows, uint32_t shared, uint32_t cols>
+	Matrix<rows, cols> OldMultiply(const Matrix<rows, shared>& lhs, const Matrix<shared, cols>& rhs)
+	{
+		Matrix<rows, cols> ret = Matrix<rows, cols>::Zero();
+		for (uint32_t r=0; r<rows; ++r)
+			for (uint32_t c=0; c<cols; ++c)
+				for (uint32_t i=0; i<shared; ++i)
+					ret.m[r][c] += lhs.m[r][i] * rhs.m[i][c];
+		return ret;
+	}
+
+	// and the 4x4 inverse, with its own determinant expansion and a divide for every element
+	Matrix<4,4> OldInverse(const Matrix<4,4>& mat)
+	{
+		const float (&m)[4][4] = mat.m;
+		Matrix<4,4> ret;
+		ret.m[0][0] = m[1][2]*m[2][3]*m[3][1] - m[1][3]*m[2][2]*m[3][1] + m[1][3]*m[2][1]*m[3][2] - m[1][1]*m[2][3]*m[3][2] - m[1][2]*m[2][1]*m[3][3] + m[1][1]*m[2][2]*m[3][3];
+		ret.m[0][1] = m[0][3]*m[2][2]*m[3][1] - m[0][2]*m[2][3]*m[3][1] - m[0][3]*m[2][1]*m[3][2] + m[0][1]*m[2][3]*m[3][2] + m[0][2]*m[2][1]*m[3][3] - m[0][1]*m[2][2]*m[3][3];
+		ret.m[0][2] = m[0][2]*m[1][3]*m[3][1] - m[0][3]*m[1][2]*m[3][1] + m[0][3]*m[1][1]*m[3][2] - m[0][1]*m[1][3]*m[3][2] - m[0][2]*m[1][1]*m[3][3] + m[0][1]*m[1][2]*m[3][3];
+		ret.m[0][3] = m[0][3]*m[1][2]*m[2][1] - m[0][2]*m[1][3]*m[2][1] - m[0][3]*m[1][1]*m[2][2] + m[0][1]*m[1][3]*m[2][2] + m[0][2]*m[1][1]*m[2][3] - m[0][1]*m[1][2]*m[2][3];
+		ret.m[1][0] = m[1][3]*m[2][2]*m[3][0] - m[1][2]*m[2][3]*m[3][0] - m[1][3]*m[2][0]*m[3][2] + m[1][0]*m[2][3]*m[3][2] + m[1][2]*m[2][0]*m[3][3] - m[1][0]*m[2][2]*m[3][3];
+		ret.m[1][1] = m[0][2]*m[2][3]*m[3][0] - m[0][3]*m[2][2]*m[3][0] + m[0][3]*m[2][0]*m[3][2] - m[0][0]*m[2][3]*m[3][2] - m[0][2]*m[2][0]*m[3][3] + m[0][0]*m[2][2]*m[3][3];
+		ret.m[1][2] = m[0][3]*m[1][2]*m[3][0] - m[0][2]*m[1][3]*m[3][0] - m[0][3]*m[1][0]*m[3][2] + m[0][0]*m[1][3]*m[3][2] + m[0][2]*m[1][0]*m[3][3] - m[0][0]*m[1][2]*m[3][3];
+		ret.m[1][3] = m[0][2]*m[1][3]*m[2][0] - m[0][3]*m[1][2]*m[2][0] + m[0][3]*m[1][0]*m[2][2] - m[0][0]*m[1][3]*m[2][2] - m[0][2]*m[1][0]*m[2][3] + m[0][0]*m[1][2]*m[2][3];
+		ret.m[2][0] = m[1][1]*m[2][3]*m[3][0] - m[1][3]*m[2][1]*m[3][0] + m[1][3]*m[2][0]*m[3][1] - m[1][0]*m[2][3]*m[3][1] - m[1][1]*m[2][0]*m[3][3] + m[1][0]*m[2][1]*m[3][3];
+		ret.m[2][1] = m[0][3]*m[2][1]*m[3][0] - m[0][1]*m[2][3]*m[3][0] - m[0][3]*m[2][0]*m[3][1] + m[0][0]*m[2][3]*m[3][1] + m[0][1]*m[2][0]*m[3][3] - m[0][0]*m[2][1]*m[3][3];
+		ret.m[2][2] = m[0][1]*m[1][3]*m[3][0] - m[0][3]*m[1][1]*m[3][0] + m[0][3]*m[1][0]*m[3][1] - m[0][0]*m[1][3]*m[3][1] - m[0][1]*m[1][0]*m[3][3] + m[0][0]*m[1][1]*m[3][3];
+		ret.m[2][3] = m[0][3]*m[1][1]*m[2][0] - m[0][1]*m[1][3]*m[2][0] - m[0][3]*m[1][0]*m[2][1] + m[0][0]*m[1][3]*m[2][1] + m[0][1]*m[1][0]*m[2][3] - m[0][0]*m[1][1]*m[2][3];
+		ret.m[3][0] = m[1][2]*m[2][1]*m[3][0] - m[1][1]*m[2][2]*m[3][0] - m[1][2]*m[2][0]*m[3][1] + m[1][0]*m[2][2]*m[3][1] + m[1][1]*m[2][0]*m[3][2] - m[1][0]*m[2][1]*m[3][2];
+		ret.m[3][1] = m[0][1]*m[2][2]*m[3][0] - m[0][2]*m[2][1]*m[3][0] + m[0][2]*m[2][0]*m[3][1] - m[0][0]*m[2][2]*m[3][1] - m[0][1]*m[2][0]*m[3][2] + m[0][0]*m[2][1]*m[3][2];
+		ret.m[3][2] = m[0][2]*m[1][1]*m[3][0] - m[0][1]*m[1][2]*m[3][0] - m[0][2]*m[1][0]*m[3][1] + m[0][0]*m[1][2]*m[3][1] + m[0][1]*m[1][0]*m[3][2] - m[0][0]*m[1][1]*m[3][2];
+		ret.m[3][3] = m[0][1]*m[1][2]*m[2][0] - m[0][2]*m[1][1]*m[2][0] + m[0][2]*m[1][0]*m[2][1] - m[0][0]*m[1][2]*m[2][1] - m[0][1]*m[1][0]*m[2][2] + m[0][0]*m[1][1]*m[2][2];
+		return ret / mat.Determinant();
+	}
+
+	// Gauss-Jordan with partial pivoting, in double: the reference for everything, and
+	// in float, what the solves are timed against
+	template <typename T, uint32_t n>
+	bool GaussJordan(const Matrix<n, n>& mat, T (&inv)[n][n])
+	{
+		T a[n][n];
+		for (uint8_t r=0; r<n; ++r)
+			for (uint8_t c=0; c<n; ++c)
+			{
+				a[r][c] = mat.m[r][c];
+				inv[r][c] = (r == c ? 1 : 0);
+			}
+
+		for (uint8_t j=0; j<n; ++j)
+		{
+			uint8_t pivot = j;
+			for (uint8_t r=j+1; r<n; ++r)
+				if (fabs(a[r][j]) > fabs(a[pivot][j]))
+					pivot = r;
+			if (a[pivot][j] == 0)
+				return false;
+			for (uint8_t c=0; c<n; ++c)
+			{
+				std::swap(a[j][c], a[pivot][c]);
+				std::swap(inv[j][c], inv[pivot][c]);
+			}
+
+			const T scale = 1 / a[j][j];
+			for (uint8_t c=0; c<n; ++c)
+			{
+				a[j][c] *= scale;
+				inv[j][c] *= scale;
+			}
+			for (uint8_t r=0; r<n; ++r)
+			{
+				if (r == j)
+					continue;
+				const T f = a[r][j];
+				for (uint8_t c=0; c<n; ++c)
+				{
+					a[r][c] -= f * a[j][c];
+					inv[r][c] -= f * inv[j][c];
+				}
+			}
+		}
+		return true;
+	}
+
+	template <uint32_t rows, uint32_t cols>
+	double MaxError(const Matrix<rows, cols>& mat, const double (&ref)[rows][cols])
+	{
+		double ret = 0;
+		for (uint8_t r=0; r<rows; ++r)
+			for (uint8_t c=0; c<cols; ++c)
+				ret = std::max(ret, fabs(mat.m[r][c] - ref[r][c]));
+		return ret;
+	}
+
+	template <uint32_t rows, uint32_t shared, uint32_t cols>
+	void Multiply(const Matrix<rows, shared>& lhs, const Matrix<shared, cols>& rhs, double (&ret)[rows][cols])
+	{
+		for (uint8_t r=0; r<rows; ++r)
+			for (uint8_t c=0; c<cols; ++c)
+			{
+				ret[r][c] = 0;
+				for (uint8_t i=0; i<shared; ++i)
+					ret[r][c] += (double)lhs.m[r][i] * rhs.m[i][c];
+			}
+	}
+
+	template <uint32_t n>
+	Matrix<n, n> ClosedInverse(const Matrix<n, n>& A)
+	{
+		return A.Inverse();
+	}
+
+	template <uint32_t n>
+	Matrix<n, n> GaussJordanInverse(const Matrix<n, n>& A)
+	{
+		Matrix<n, n> inv;
+		GaussJordan(A, inv.m);
+		return inv;
+	}
+
+	// largest |A x - b|
+	template <uint32_t n, uint32_t cols>
+	double Residual(const Matrix<n, n>& A, const Matrix<n, cols>& x, const Matrix<n, cols>& b)
+	{
+		double Ax[n][cols];
+		Multiply(A, x, Ax);
+		double ret = 0;
+		for (uint8_t r=0; r<n; ++r)
+			for (uint8_t c=0; c<cols; ++c)
+				ret = std::max(ret, fabs(Ax[r][c] - b.m[r][c]));
+		return ret;
+	}
+
+	void Report(const char* name, double error, double tolerance, double time, double oldTime)
+	{
+		const bool failed = !(error <= tolerance);
+		g_Failed |= failed;
+		printf("%-24s %10.2e%s %9.1f ns", name, error, failed ? " FAIL" : "     ", time * 1e9);
+		if (oldTime > 0)
+			printf(" %9.1f ns  %5.2fx", oldTime * 1e9, oldTime / time);
+		printf("\n");
+	}
+
+	// Times f() over every input, a few times round, and returns the best per call time.
+	// The result goes into g_Sink so that none of it can be optimized away.
+	template <typename In, typename F>
+	double Time(const std::vector<In>& inputs, F f)
+	{
+		double best = 1e9;
+		for (int pass=0; pass<3; ++pass)
+		{
+			float sink = 0;
+			const double start = Now();
+			for (size_t i=0; i<inputs.size(); ++i)
+				sink += f(inputs[i]);
+			best = std::min(best, (Now() - start) / inputs.size());
+			g_Sink = sink;
+		}
+		return best;
+	}
+
+	template <uint32_t rows, uint32_t shared, uint32_t cols>
+	void CheckMultiply(int trials)
+	{
+		typedef std::pair<Matrix<rows, shared>, Matrix<shared, cols> > Pair;
+		std::vector<Pair> inputs;
+		double error = 0;
+		double transposeError = 0;
+		for (int t=0; t<trials; ++t)
+		{
+			const Pair p(RandomMatrix<rows, shared>(), RandomMatrix<shared, cols>());
+			inputs.push_back(p);
+
+			double ref[rows][cols];
+			Multiply(p.first, p.second, ref);
+			error = std::max(error, MaxError(p.first * p.second, ref));
+			transposeError = std::max(transposeError, MaxError(MulTranspose(p.first, p.second.Transpose()), ref));
+		}
+
+		const double time = Time(inputs, [](const Pair& p) { return (p.first * p.second).m[rows-1][cols-1]; });
+		const double oldTime = Time(inputs, [](const Pair& p) { return OldMultiply(p.first, p.second).m[rows-1][cols-1]; });
+		char name[32];
+		snprintf(name, sizeof(name), "multiply %ux%u * %ux%u", rows, shared, shared, cols);
+		Report(name, error, c_Tolerance * shared, time, oldTime);
+
+		std::vector<std::pair<Matrix<rows, shared>, Matrix<cols, shared> > > transposed;
+		for (size_t i=0; i<inputs.size(); ++i)
+			transposed.push_back(std::make_pair(inputs[i].first, inputs[i].second.Transpose()));
+		typedef std::pair<Matrix<rows, shared>, Matrix<cols, shared> > TPair;
+		const double tTime = Time(transposed, [](const TPair& p) { return MulTranspose(p.first, p.second).m[rows-1][cols-1]; });
+		const double tOldTime = Time(transposed, [](const TPair& p) { return OldMultiply(p.first, p.second.Transpose()).m[rows-1][cols-1]; });
+		snprintf(name, sizeof(name), "transpose %ux%u * %ux%u", rows, shared, shared, cols);
+		Report(name, transposeError, c_Tolerance * shared, tTime, tOldTime);
+	}
+
+	template <uint32_t rows, uint32_t n>
+	void CheckSandwich(int trials)
+	{
+		typedef std::pair<Matrix<rows, n>, SymMatrix<n> > Pair;
+		std::vector<Pair> inputs;
+		double error = 0;
+		for (int t=0; t<trials; ++t)
+		{
+			const Pair p(RandomMatrix<rows, n>(), SymMatrix<n>::FromMatrix(RandomSPD<n>()));
+			inputs.push_back(p);
+
+			double AP[rows][n];
+			Multiply(p.first, p.second.ToMatrix(), AP);
+			double ref[rows][rows];
+			for (uint8_t r=0; r<rows; ++r)
+				for (uint8_t c=0; c<rows; ++c)
+				{
+					ref[r][c] = 0;
+					for (uint8_t i=0; i<n; ++i)
+						ref[r][c] += AP[r][i] * p.first.m[c][i];
+				}
+			error = std::max(error, MaxError(Sandwich(p.first, p.second).ToMatrix(), ref) / n);
+		}
+
+		const double time = Time(inputs, [](const Pair& p) { return Sandwich(p.first, p.second).m[0]; });
+		const double oldTime = Time(inputs, [](const Pair& p) { return OldMultiply(OldMultiply(p.first, p.second.ToMatrix()), p.first.Transpose()).m[0][0]; });
+		char name[32];
+		snprintf(name, sizeof(name), "sandwich %ux%u", rows, n);
+		Report(name, error, c_Tolerance * n, time, oldTime);
+	}
+
+	template <uint32_t n>
+	void CheckInverse(int trials, Matrix<n, n> (*oldInverse)(const Matrix<n, n>&))
+	{
+		std::vector<Matrix<n, n> > inputs;
+		double error = 0;
+		for (int t=0; t<trials; ++t)
+		{
+			const Matrix<n, n> A = RandomInvertible<n>();
+			inputs.push_back(A);
+
+			double ref[n][n];
+			GaussJordan(A, ref);
+			error = std::max(error, MaxError(A.Inverse(), ref));
+		}
+
+		const double time = Time(inputs, [](const Matrix<n, n>& A) { return A.Inverse().m[n-1][n-1]; });
+		double oldTime = 0;
+		if (oldInverse)
+			oldTime = Time(inputs, [oldInverse](const Matrix<n, n>& A) { return oldInverse(A).m[n-1][n-1]; });
+		char name[32];
+		snprintf(name, sizeof(name), "inverse %ux%u", n, n);
+		Report(name, error, c_Tolerance, time, oldTime);
+	}
+
+	// solving A x = b by decomposing A, against multiplying b by A's inverse
+	template <uint32_t n, uint32_t cols>
+	void CheckSolves(int trials, Matrix<n, n> (*inverse)(const Matrix<n, n>&))
+	{
+		typedef std::pair<Matrix<n, n>, Matrix<n, cols> > Pair;
+		std::vector<Pair> inputs;
+		double choleskyError = 0;
+		double ldltError = 0;
+		for (int t=0; t<trials; ++t)
+		{
+			const Pair p(RandomSPD<n>(), RandomMatrix<n, cols>());
+			inputs.push_back(p);
+
+			SymMatrix<n> L = SymMatrix<n>::FromMatrix(p.first);
+			if (!L.CholeskyDecompose())
+				choleskyError = INFINITY;
+			else
+				choleskyError = std::max(choleskyError, Residual(p.first, L.CholeskySolve(p.second), p.second));
+
+			SymMatrix<n> LD = SymMatrix<n>::FromMatrix(p.first);
+			if (!LD.LDLTDecompose())
+				ldltError = INFINITY;
+			else
+				ldltError = std::max(ldltError, Residual(p.first, LD.LDLTSolve(p.second), p.second));
+		}
+
+		const double oldTime = Time(inputs, [inverse](const Pair& p) { return (inverse(p.first) * p.second).m[n-1][cols-1]; });
+		const double choleskyTime = Time(inputs, [](const Pair& p)
+		{
+			SymMatrix<n> L = SymMatrix<n>::FromMatrix(p.first);
+			L.CholeskyDecompose();
+			return L.CholeskySolve(p.second).m[n-1][cols-1];
+		});
+		const double ldltTime = Time(inputs, [](const Pair& p)
+		{
+			SymMatrix<n> LD = SymMatrix<n>::FromMatrix(p.first);
+			LD.LDLTDecompose();
+			return LD.LDLTSolve(p.second).m[n-1][cols-1];
+		});
+
+		char name[32];
+		snprintf(name, sizeof(name), "cholesky %ux%u, %u", n, n, cols);
+		Report(name, choleskyError, c_Tolerance * n, choleskyTime, oldTime);
+		snprintf(name, sizeof(name), "ldlt %ux%u, %u", n, n, cols);
+		Report(name, ldltError, c_Tolerance * n, ldltTime, oldTime);
+	}
+
+	// What a 7 state EKF does each step, with a 4 value measurement (a GPS fix, say):
+	//   P = F P F^T + Q
+	//   S = H P H^T + R,  K = P H^T S^-1,  P = P - K H P
+	// The new way keeps P packed and works from H P, which it needs for both S and K:
+	// K^T = S^-1 H P, and P - (H P)^T K^T on the lower triangle only.
+	struct EKFInput
+	{
+		Matrix<7,7> F;
+		SymMatrix<7> P;
+		SymMatrix<7> Q;
+		Matrix<4,7> H;
+		SymMatrix<4> R;
+	};
+
+	// multiplies, counted from the loops: 539 + 196 + 112 + 212 + 112 + 112
+	const int c_NewEKFMultiplies = 1283;
+	SymMatrix<7> NewEKFStep(const EKFInput& in)
+	{
+		SymMatrix<7> P = Sandwich(in.F, in.P) + in.Q;
+
+		const Matrix<4,7> HP = in.H * P;
+		const Matrix<4,4> S = MulTranspose(HP, in.H) + in.R.ToMatrix();
+		const Matrix<4,7> KT = S.Inverse() * HP;
+
+		uint8_t i = 0;
+		for (uint8_t r=0; r<7; ++r)
+			for (uint8_t c=0; c<=r; ++c)
+				P.m[i++] -= HP.m[0][r] * KT.m[0][c] + HP.m[1][r] * KT.m[1][c] + HP.m[2][r] * KT.m[2][c] + HP.m[3][r] * KT.m[3][c];
+		return P;
+	}
+
+	// 343 + 343 + 196 + 112 + 264 + 112 + 196 + 343, and 16 divides
+	const int c_OldEKFMultiplies = 1909;
+	Matrix<7,7> OldEKFStep(const EKFInput& in)
+	{
+		const Matrix<7,7> P = OldMultiply(OldMultiply(in.F, in.P.ToMatrix()), in.F.Transpose()) + in.Q.ToMatrix();
+
+		const Matrix<7,4> PHT = OldMultiply(P, in.H.Transpose());
+		const Matrix<4,4> S = OldMultiply(in.H, PHT) + in.R.ToMatrix();
+		const Matrix<7,4> K = OldMultiply(PHT, OldInverse(S));
+		return P - OldMultiply(OldMultiply(K, in.H), P);
+	}
+
+	void CheckEKFStep(int trials)
+	{
+		std::vector<EKFInput> inputs;
+		double error = 0;
+		for (int t=0; t<trials; ++t)
+		{
+			EKFInput in;
+			in.F = RandomMatrix<7,7>() * 0.1f;
+			for (uint8_t i=0; i<7; ++i)
+				in.F.m[i][i] += 1;
+			in.P = SymMatrix<7>::FromMatrix(RandomSPD<7>());
+			in.Q = SymMatrix<7>::FromMatrix(RandomSPD<7>()) * 0.01f;
+			in.H = RandomMatrix<4,7>();
+			in.R = SymMatrix<4>::FromMatrix(RandomSPD<4>());
+			inputs.push_back(in);
+
+			// the old way, in double
+			double FP[7][7], P[7][7];
+			Multiply(in.F, in.P.ToMatrix(), FP);
+			for (uint8_t r=0; r<7; ++r)
+				for (uint8_t c=0; c<7; ++c)
+				{
+					P[r][c] = in.Q(r, c);
+					for (uint8_t i=0; i<7; ++i)
+						P[r][c] += FP[r][i] * in.F.m[c][i];
+				}
+			Matrix<7,7> Pf;
+			for (uint8_t r=0; r<7; ++r)
+				for (uint8_t c=0; c<7; ++c)
+					Pf.m[r][c] = (float)P[r][c];
+			double HP[4][7], S[4][4], Sinv[4][4];
+			Multiply(in.H, Pf, HP);
+			Matrix<4,4> Sf;
+			for (uint8_t r=0; r<4; ++r)
+				for (uint8_t c=0; c<4; ++c)
+				{
+					S[r][c] = in.R(r, c);
+					for (uint8_t i=0; i<7; ++i)
+						S[r][c] += HP[r][i] * in.H.m[c][i];
+					Sf.m[r][c] = (float)S[r][c];
+				}
+			GaussJordan(Sf, Sinv);
+			double ref[7][7];
+			for (uint8_t r=0; r<7; ++r)
+				for (uint8_t c=0; c<7; ++c)
+				{
+					ref[r][c] = P[r][c];
+					for (uint8_t i=0; i<4; ++i)
+						for (uint8_t j=0; j<4; ++j)
+							ref[r][c] -= HP[i][r] * Sinv[i][j] * HP[j][c];
+				}
+			error = std::max(error, MaxError(NewEKFStep(in).ToMatrix(), ref) / 7);
+		}
+
+		const double time = Time(inputs, [](const EKFInput& in) { return NewEKFStep(in).m[SymMatrix<7>::c_Size - 1]; });
+		const double oldTime = Time(inputs, [](const EKFInput& in) { return OldEKFStep(in).m[6][6]; });
+		Report("ekf step 7, 4", error, c_Tolerance * 7, time, oldTime);
+		printf("%-24s %15s %9d    %9d\n", "  float multiplies", "", c_NewEKFMultiplies, c_OldEKFMultiplies);
+	}
+
+	void Usage()
+	{
+		fprintf(stderr, "Usage: MatrixBench [-n trials] [-s seed]\n");
+	}
+}
+
+unsigned long micros()
+{
+	return (unsigned long)(Now() * 1e6);
+}
+
+unsigned long millis()
+{
+	return (unsigned long)(Now() * 1e3);
+}
+
+int main(int argc, char** argv)
+{
+	int trials = 100000;
+
+	int opt;
+	while ((opt = getopt(argc, argv, "n:s:")) != -1)
+	{
+		switch (opt)
+		{
+		case 'n': trials = std::max(atoi(optarg), 1); break;
+		case 's': srand(atoi(optarg)); break;
+		default: Usage(); return 1;
+		}
+	}
+
+	printf("%-24s %15s %12s %12s %6s\n", "", "error", "new", "old", "");
+	CheckMultiply<3, 3, 3>(trials);
+	CheckMultiply<3, 3, 1>(trials);
+	CheckMultiply<4, 4, 4>(trials);
+	CheckMultiply<7, 7, 7>(trials);
+	CheckSandwich<3, 3>(trials);
+	CheckSandwich<7, 7>(trials);
+	CheckInverse<2>(trials, NULL);
+	CheckInverse<3>(trials, NULL);
+	CheckInverse<4>(trials, OldInverse);
+	CheckSolves<3, 1>(trials, ClosedInverse<3>);
+	CheckSolves<4, 4>(trials, ClosedInverse<4>);
+	CheckSolves<7, 1>(trials, GaussJordanInverse<7>);
+	CheckSolves<7, 7>(trials, GaussJordanInverse<7>);
+	CheckEKFStep(trials);
+
+	return g_Failed ? 2 : 0;
+}
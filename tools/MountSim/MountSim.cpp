@@ -0,0 +1,311 @@
+// Flies a simulated balloon past the tracker and runs the real AntennaMount controller
+// against a model of the pan/tilt servos, reporting how far the antenna's boresight was
+// from the balloon with and without the prediction between telemetry packets.
+//
+// Build from this directory with:
+//   g++ -O2 -I../Host -I../../libraries/Core -I../../libraries/Geodesy -I../../libraries/AntennaMount
+//       MountSim.cpp ../../libraries/Geodesy/Geodesy.cpp ../../libraries/AntennaMount/AntennaMount.cpp -o MountSim
+//
+// Usage: MountSim [samples.csv]
+
+#include <Arduino.h>
+#include <Core.h>
+#include <Geodesy.h>
+#include <AntennaMount.h>
+
+#include <vector>
+#include <algorithm>
+
+namespace
+{
+	const double c_EarthRadius      = 6372795.0;    // m, same as Geodesy
+	const double c_MPerDeg          = c_EarthRadius * PI / 180.0;
+
+	const double c_TrackerLat       = 47.60000;
+	const double c_TrackerLon       = -122.33000;
+	const double c_TrackerAlt       = 50.0;         // m
+	const double c_LaunchEast       = -400.0;       // m, launched just to the west so that the wind carries it overhead
+	const double c_LaunchNorth      = 150.0;        // m
+
+	const double c_AscentRate       = 5.0;          // m/s
+	const double c_BurstAlt         = 30000.0;      // m
+	const double c_DescentRateSL    = 5.0;          // m/s under the parachute at sea level
+	const double c_ScaleHeight      = 7000.0;       // m
+
+	const uint32_t c_TelemetryPeriod = 1000;        // ms
+	const uint32_t c_TelemetryDelay = 150;          // ms, from the fix to the packet arriving
+	const double c_PacketLoss       = 0.15;
+
+	const double c_ServoSpeed       = 300.0;        // deg/s, hobby servo flat out
+	const double c_ServoLag         = 0.05;         // s, time constant once it's nearly there
+	const double c_BeamWidth        = 10.0;         // deg, half power half width of the Yagi
+	const double c_CloseRange       = 5000.0;       // m, where it moves fastest across the sky
+
+	const uint32_t c_Step           = 5;            // ms, simulation step
+	const uint32_t c_Settle         = 10000;        // ms, for the mount to swing round to the launch before we start counting
+	const uint32_t c_FlightTime     = 3 * 3600 * 1000;
+
+	const AntennaMount::Config c_MountConfig = {
+		{
+			{-9000, 9000, 600, 2400, 18000},       // azimuth: 180 degree servo
+			{0, 18000, 600, 2400, 18000},          // elevation: 180 degree servo, so it can flip over the top
+		},
+		9000,   // heading, mount's zero faces east, roughly where the prediction says it'll go
+		true,   // canFlip
+		20,     // controlPeriod (ms)
+		5000,   // maxPrediction (ms)
+	};
+
+	struct Vec3
+	{
+		double east, north, up;
+	};
+
+	struct Balloon
+	{
+		Vec3 pos;       // m, from the tracker
+		Vec3 vel;       // m/s
+		bool burst;
+	};
+
+	struct Stats
+	{
+		std::vector<double> errors;
+		std::vector<double> closeErrors;
+		uint32_t flips;
+	};
+
+	unsigned long s_Now = 0;
+
+	double Random()
+	{
+		return rand() / (double)RAND_MAX;
+	}
+
+	void Wind(double alt, double t, double* pEast, double* pNorth)
+	{
+		// a jet stream around 11 km, veering with height, plus some gusting
+		const double speed = 5.0 + 35.0 * exp(-sq((alt - 11000.0) / 4000.0)) + 2.0 * sin(t * 0.05);
+		const double towards = radians(70.0 + alt * 0.002);
+		*pEast = speed * sin(towards);
+		*pNorth = speed * cos(towards);
+	}
+
+	void Fly(Balloon* pBalloon, double t, double dt)
+	{
+		double windEast, windNorth;
+		Wind(pBalloon->pos.up, t, &windEast, &windNorth);
+
+		if (!pBalloon->burst && pBalloon->pos.up >= c_BurstAlt)
+			pBalloon->burst = true;
+
+		pBalloon->vel.east = windEast;
+		pBalloon->vel.north = windNorth;
+		pBalloon->vel.up = pBalloon->burst ? -c_DescentRateSL / sqrt(exp(-pBalloon->pos.up / c_ScaleHeight)) : c_AscentRate;
+
+		pBalloon->pos.east += pBalloon->vel.east * dt;
+		pBalloon->pos.north += pBalloon->vel.north * dt;
+		pBalloon->pos.up += pBalloon->vel.up * dt;
+	}
+
+	void ToGeodetic(const Vec3& pos, double* pLat, double* pLon, double* pAlt)
+	{
+		*pLat = c_TrackerLat + pos.north / c_MPerDeg;
+		*pLon = c_TrackerLon + pos.east / (c_MPerDeg * cos(radians(c_TrackerLat)));
+		*pAlt = c_TrackerAlt + pos.up;
+	}
+
+	// the line of sight on a round earth, as a unit vector in the tracker's east/north/up frame
+	Vec3 LineOfSight(const Vec3& pos)
+	{
+		double lat, lon, alt;
+		ToGeodetic(pos, &lat, &lon, &alt);
+
+		const double r1 = c_EarthRadius + c_TrackerAlt;
+		const double r2 = c_EarthRadius + alt;
+		const double p1 = radians(c_TrackerLat), p2 = radians(lat), dl = radians(lon - c_TrackerLon);
+
+		// the balloon in earth-centered coordinates, turned so that the tracker is on the prime meridian
+		const double x = r2 * cos(p2) * cos(dl) - r1 * cos(p1);
+		const double y = r2 * cos(p2) * sin(dl);
+		const double z = r2 * sin(p2) - r1 * sin(p1);
+
+		Vec3 los;
+		los.east = y;
+		los.north = -sin(p1) * x + cos(p1) * z;
+		los.up = cos(p1) * x + sin(p1) * z;
+
+		const double length = sqrt(sq(los.east) + sq(los.north) + sq(los.up));
+		los.east /= length;
+		los.north /= length;
+		los.up /= length;
+		return los;
+	}
+
+	Vec3 Boresight(double azimuth, double elevation, double heading)
+	{
+		// the mount's angles are already in its own frame, flipped or not, so this works either way
+		const double az = radians(azimuth + heading);
+		const double el = radians(elevation);
+
+		Vec3 dir;
+		dir.east = cos(el) * sin(az);
+		dir.north = cos(el) * cos(az);
+		dir.up = sin(el);
+		return dir;
+	}
+
+	double PulseToAngle(const AntennaMount::AxisConfig& axis, uint16_t pulse)
+	{
+		return (axis.minAngle + (pulse - axis.minPulse) * (double)(axis.maxAngle - axis.minAngle) / (axis.maxPulse - axis.minPulse)) * 0.01;
+	}
+
+	void Servo(double* pAngle, double command, double dt)
+	{
+		const double rate = Clamp((command - *pAngle) / c_ServoLag, -c_ServoSpeed, c_ServoSpeed);
+		*pAngle += rate * dt;
+	}
+
+	Stats Run(uint16_t maxPrediction, FILE* pCSV)
+	{
+		srand(1);
+
+		AntennaMount::Config config = c_MountConfig;
+		config.maxPrediction = maxPrediction;
+		AntennaMount mount(config);
+		mount.SetOrigin((int32_t)floor(c_TrackerLat * 1.0e5 + 0.5), (int32_t)floor(c_TrackerLon * 1.0e5 + 0.5), (int32_t)c_TrackerAlt);
+
+		Balloon balloon;
+		balloon.pos.east = c_LaunchEast;
+		balloon.pos.north = c_LaunchNorth;
+		balloon.pos.up = 0.0;
+		balloon.burst = false;
+
+		// packets in flight, as (arrival time, the fix they carry)
+		std::vector<std::pair<uint32_t, Balloon> > packets;
+
+		double angles[AntennaMount::EAxis::EnumCount] = {0.0, 0.0};
+		double commands[AntennaMount::EAxis::EnumCount] = {0.0, 0.0};
+		bool wasFlipped = false;
+
+		Stats stats;
+		stats.flips = 0;
+
+		for (s_Now = 0; s_Now < c_FlightTime && balloon.pos.up >= 0.0; s_Now += c_Step)
+		{
+			const double t = s_Now * 0.001;
+			Fly(&balloon, t, c_Step * 0.001);
+
+			if (s_Now % c_TelemetryPeriod == 0 && Random() >= c_PacketLoss)
+				packets.push_back(std::make_pair((uint32_t)(s_Now + c_TelemetryDelay), balloon));
+
+			while (!packets.empty() && packets.front().first <= s_Now)
+			{
+				// quantized the same way as the TelemetryPacket
+				const Balloon& fix = packets.front().second;
+				double lat, lon, alt;
+				ToGeodetic(fix.pos, &lat, &lon, &alt);
+
+				const float packetLat = (float)lat;
+				const float packetLon = (float)lon;
+				const double speed = sqrt(sq(fix.vel.east) + sq(fix.vel.north));
+				const double course = fmod(degrees(atan2(fix.vel.east, fix.vel.north)) + 360.0, 360.0);
+
+				mount.SetTarget(s_Now - c_TelemetryDelay,
+					(int32_t)floor(packetLat * 1.0e5f + 0.5f), (int32_t)floor(packetLon * 1.0e5f + 0.5f), (int32_t)alt,
+					(uint16_t)min(speed, 255.0), (int16_t)course, (int16_t)(fix.vel.up * 100.0));
+
+				packets.erase(packets.begin());
+			}
+
+			if (mount.loop(s_Now))
+			{
+				for (uint8_t i=0; i<AntennaMount::EAxis::EnumCount; ++i)
+					commands[i] = PulseToAngle(config.axes[i], mount.GetPulseInUS((AntennaMount::EAxis::Enum)i));
+
+				const bool flipped = mount.GetAngle(AntennaMount::EAxis::Elevation) > 9000;
+				stats.flips += flipped != wasFlipped;
+				wasFlipped = flipped;
+			}
+
+			for (uint8_t i=0; i<AntennaMount::EAxis::EnumCount; ++i)
+				Servo(&angles[i], commands[i], c_Step * 0.001);
+
+			if (!mount.HasTarget() || s_Now < c_Settle)
+				continue;
+
+			const Vec3 los = LineOfSight(balloon.pos);
+			const Vec3 boresight = Boresight(angles[AntennaMount::EAxis::Azimuth], angles[AntennaMount::EAxis::Elevation], config.heading * 0.01);
+			const double dot = los.east * boresight.east + los.north * boresight.north + los.up * boresight.up;
+			const double error = degrees(acos(Clamp(dot, -1.0, 1.0)));
+			stats.errors.push_back(error);
+			if (sqrt(sq(balloon.pos.east) + sq(balloon.pos.north)) < c_CloseRange)
+				stats.closeErrors.push_back(error);
+
+			if (pCSV && s_Now % 100 == 0)
+			{
+				fprintf(pCSV, "%lu,%.1f,%.1f,%.1f,%.2f,%.2f,%.3f\n",
+					s_Now, balloon.pos.east, balloon.pos.north, balloon.pos.up,
+					angles[AntennaMount::EAxis::Azimuth], angles[AntennaMount::EAxis::Elevation], error);
+			}
+		}
+
+		return stats;
+	}
+
+	void Report(const char* name, std::vector<double> errors)
+	{
+		std::sort(errors.begin(), errors.end());
+
+		double sumSq = 0.0;
+		uint32_t inBeam = 0;
+		for (size_t i=0; i<errors.size(); ++i)
+		{
+			sumSq += sq(errors[i]);
+			inBeam += errors[i] <= c_BeamWidth;
+		}
+
+		const size_t n = errors.size();
+		printf("  %s: rms %.2f deg, median %.2f deg, 99%% %.2f deg, max %.2f deg, in beam %.2f%%\n",
+			name, sqrt(sumSq / n), errors[n / 2], errors[n * 99 / 100], errors[n - 1], 100.0 * inBeam / n);
+	}
+
+	void Report(const char* name, const Stats& stats)
+	{
+		printf("%s, %u flips over the top\n", name, stats.flips);
+		Report("whole flight", stats.errors);
+		Report("within 5 km ", stats.closeErrors);
+	}
+}
+
+unsigned long millis()
+{
+	return s_Now;
+}
+
+unsigned long micros()
+{
+	return s_Now * 1000;
+}
+
+int main(int argc, char** argv)
+{
+	FILE* pCSV = NULL;
+	if (argc > 1)
+	{
+		pCSV = fopen(argv[1], "w");
+		if (!pCSV)
+		{
+			fprintf(stderr, "Couldn't open %s\n", argv[1]);
+			return 1;
+		}
+		fprintf(pCSV, "time (ms),east (m),north (m),up (m),azimuth (deg),elevation (deg),error (deg)\n");
+	}
+
+	Report("last fix only", Run(0, NULL));
+	Report("predicted    ", Run(c_MountConfig.maxPrediction, pCSV));
+
+	if (pCSV)
+		fclose(pCSV);
+	return 0;
+}
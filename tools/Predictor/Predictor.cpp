@@ -0,0 +1,757 @@
+// Monte Carlo landing prediction for the chase car.
+//
+// Follows the ground station's logs (BalloonTracker's CSV output and/or an APRS log),
+// learns the wind profile from the balloon's drift as it climbs, and after every new
+// position flies thousands of perturbed trajectories down to the ground, spread over all
+// of the cores. Each trajectory gets its own burst altitude, parachute drag and a wind
+// profile with correlated noise on top of the measured one, sized by how well that layer
+// has been measured. The result is written out as KML in the same style as the
+// pre-flight predictions: the nominal path, where it'll burst and land, and the 50% and
+// 95% landing areas.
+//
+// Build from this directory with:
+//   g++ -O2 -pthread -I../Common Predictor.cpp ../Common/TelemetryReader.cpp -o Predictor
+//
+// Usage: Predictor [options] log...
+//   -o file     KML to write, default Prediction.kml
+//   -f          keep following the logs as they're written
+//   -e          when not following, predict after every position instead of just the last
+//   -n count    trajectories per prediction, default 10000
+//   -t threads  default one per core
+//   -b m        expected burst altitude, default 30000
+//   -s m        burst altitude sigma, default 3000
+//   -r m/s      ascent rate to assume until it's measured, default 5
+//   -m kg       everything under the parachute, default 1.5
+//   -a m^2      parachute drag coefficient times area, default 1.0
+//   -g m        ground altitude at the landing site, default 0
+//   -N name     flight name for the KML
+
+#include <TelemetryReader.h>
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+namespace
+{
+	const double c_EarthRadius        = 6372795.0;    // m, same as TinyGPS and Geodesy
+	const double c_MPerDeg            = c_EarthRadius * M_PI / 180.0;
+	const double c_Gravity            = 9.80665;      // m/s^2
+	const double c_SeaLevelDensity    = 1.225;        // kg/m^3
+
+	const double c_BinHeight          = 250.0;        // m
+	const int c_BinCount              = 180;          // up to 45 km
+	const double c_Step               = 50.0;         // m, integration step
+	const double c_MinWindInterval    = 2.0;          // s, shorter than this and GPS noise swamps the drift
+	const double c_MaxWindInterval    = 300.0;        // s, APRS positions are a minute or more apart
+	const double c_MinVerticalSpeed   = 1.0;          // m/s, slower than this and it isn't sampling layers
+	const double c_MaxWind            = 150.0;        // m/s, any faster and one of the positions is bad
+
+	const double c_WindSigma          = 1.5;          // m/s, on even a well measured layer, it's changed since
+	const double c_WindSigmaPerKm     = 0.5;          // m/s, more for every km from the nearest measured layer
+	const double c_WindCorrelation    = 2000.0;       // m, the wind noise decorrelates over this much height
+	const double c_AscentRateSigma    = 0.5;          // m/s
+	const double c_DragSigma          = 0.15;         // log of the drag area, before we've seen it fall
+	const double c_CalibratedDragSigma = 0.05;        // and after
+
+	const double c_BurstDrop          = 300.0;        // m below the highest point, and falling, before we believe it's burst
+	const double c_ChuteOpenDrop      = 3000.0;       // m below the highest point before the parachute's settled
+	const double c_CalibrationGain    = 0.2;
+
+	const int c_EllipsePoints         = 72;
+	const double c_Ellipse50          = 1.1774;       // sqrt(-2 ln(1 - 0.50)), for a 2D Gaussian
+	const double c_Ellipse95          = 2.4477;       // sqrt(-2 ln(1 - 0.95))
+
+	struct Options
+	{
+		const char* output;
+		bool follow;
+		bool everyFix;
+		int samples;
+		int threads;
+		double burstAlt;
+		double burstSigma;
+		double ascentRate;
+		double mass;
+		double dragArea;
+		double groundAlt;
+		const char* name;
+	};
+
+	double Now()
+	{
+		timeval tv;
+		gettimeofday(&tv, NULL);
+		return tv.tv_sec + tv.tv_usec * 1.0e-6;
+	}
+
+	// 1976 standard atmosphere, up to 51 km
+	double Density(double alt)
+	{
+		static const double c_Layers[][4] = {
+			// base (m), temperature (K), lapse rate (K/m), pressure (Pa)
+			{0.0,     288.15, -0.0065, 101325.0},
+			{11000.0, 216.65, 0.0,     22632.06},
+			{20000.0, 216.65, 0.001,   5474.889},
+			{32000.0, 228.65, 0.0028,  868.0187},
+			{47000.0, 270.65, 0.0,     110.9063},
+		};
+		const double M = 0.0289644;     // kg/mol
+		const double R = 8.3144598;     // J/(mol K)
+
+		alt = std::max(alt, 0.0);
+		int i = 0;
+		while (i + 1 < (int)(sizeof(c_Layers) / sizeof(c_Layers[0])) && alt >= c_Layers[i + 1][0])
+			++i;
+
+		const double* layer = c_Layers[i];
+		double temperature, pressure;
+		if (layer[2] == 0.0)
+		{
+			temperature = layer[1];
+			pressure = layer[3] * exp(-c_Gravity * M * (alt - layer[0]) / (R * temperature));
+		}
+		else
+		{
+			temperature = layer[1] + layer[2] * (alt - layer[0]);
+			pressure = layer[3] * pow(layer[1] / temperature, c_Gravity * M / (R * layer[2]));
+		}
+		return pressure * M / (R * temperature);
+	}
+
+	// xorshift64*, one per thread
+	class Random
+	{
+	public:
+		Random(uint64_t seed) : m_State(seed ? seed : 1), m_HasSpare(false), m_Spare(0.0) {}
+
+		double Uniform()
+		{
+			m_State ^= m_State >> 12;
+			m_State ^= m_State << 25;
+			m_State ^= m_State >> 27;
+			return ((m_State * 2685821657736338717ull) >> 11) * (1.0 / 9007199254740992.0);
+		}
+
+		double Gaussian()
+		{
+			if (m_HasSpare)
+			{
+				m_HasSpare = false;
+				return m_Spare;
+			}
+
+			const double r = sqrt(-2.0 * log(1.0 - Uniform()));
+			const double theta = 2.0 * M_PI * Uniform();
+			m_Spare = r * sin(theta);
+			m_HasSpare = true;
+			return r * cos(theta);
+		}
+
+	private:
+		uint64_t m_State;
+		bool m_HasSpare;
+		double m_Spare;
+	};
+
+	// the winds the balloon has drifted through, binned by altitude
+	class WindProfile
+	{
+	public:
+		struct Layer
+		{
+			double east, north;     // m/s
+			double sigma;           // m/s, per component
+		};
+
+	public:
+		WindProfile()
+		{
+			for (int i=0; i<c_BinCount; ++i)
+				m_Bins[i].weight = m_Bins[i].east = m_Bins[i].north = m_Bins[i].sumSq = 0.0;
+		}
+
+		// the drift from one position to the next, spread over the layers between them
+		void AddDrift(double alt0, double alt1, double east, double north, double dt)
+		{
+			const double low = std::min(alt0, alt1);
+			const double high = std::max(alt0, alt1);
+			const double span = std::max(high - low, 1.0);
+
+			for (int i=BinIndex(low); i<=BinIndex(high); ++i)
+			{
+				const double overlap = std::min(high, (i + 1) * c_BinHeight) - std::max(low, i * c_BinHeight);
+				const double weight = dt * std::max(overlap, 1.0) / span;
+				add(&m_Bins[i], east / dt, north / dt, weight);
+			}
+		}
+
+		bool IsEmpty() const
+		{
+			for (int i=0; i<c_BinCount; ++i)
+			{
+				if (m_Bins[i].weight > 0.0)
+					return false;
+			}
+			return true;
+		}
+
+		// layers it hasn't flown through get the nearest one it has, with more uncertainty the further that is
+		void GetLayers(Layer* pLayers) const
+		{
+			for (int i=0; i<c_BinCount; ++i)
+			{
+				int nearest = -1;
+				for (int d=0; d<c_BinCount && nearest < 0; ++d)
+				{
+					if (i - d >= 0 && m_Bins[i - d].weight > 0.0)
+						nearest = i - d;
+					else if (i + d < c_BinCount && m_Bins[i + d].weight > 0.0)
+						nearest = i + d;
+				}
+
+				const Bin& bin = m_Bins[nearest];
+				const double variance = bin.sumSq / bin.weight;
+				pLayers[i].east = bin.east;
+				pLayers[i].north = bin.north;
+				pLayers[i].sigma = sqrt(variance + c_WindSigma * c_WindSigma) + c_WindSigmaPerKm * abs(i - nearest) * c_BinHeight * 0.001;
+			}
+		}
+
+		static int BinIndex(double alt)
+		{
+			return std::min(std::max((int)floor(alt / c_BinHeight), 0), c_BinCount - 1);
+		}
+
+	private:
+		struct Bin
+		{
+			double weight;          // s
+			double east, north;     // m/s, weighted mean
+			double sumSq;           // weighted sum of squared deviations, both components together, per component
+		};
+
+		// West's weighted incremental mean and variance
+		static void add(Bin* pBin, double east, double north, double weight)
+		{
+			const double total = pBin->weight + weight;
+			const double dEast = east - pBin->east;
+			const double dNorth = north - pBin->north;
+			pBin->east += dEast * weight / total;
+			pBin->north += dNorth * weight / total;
+			pBin->sumSq += 0.5 * weight * (dEast * (east - pBin->east) + dNorth * (north - pBin->north));
+			pBin->weight = total;
+		}
+
+		Bin m_Bins[c_BinCount];
+	};
+
+	// everything a prediction starts from
+	struct Scenario
+	{
+		double lat, lon, alt;       // where it is now
+		double maxAlt;              // the highest it's been
+		bool descending;
+		double ascentRate;          // m/s
+		double descentRate;         // m/s at sea level, calibrated if it's been falling for a while
+		bool calibrated;
+		double groundAlt;
+		double burstAlt;
+		double burstSigma;
+		WindProfile::Layer layers[c_BinCount];
+		std::vector<double> densityFactors;     // sqrt(sea level density / density) every c_Step
+	};
+
+	struct Trajectory
+	{
+		double east, north;         // m, from where it is now
+		double time;                // s
+		double burstAlt;            // m
+	};
+
+	// flies one trajectory from the scenario's position to the ground, with the winds perturbed by pNoise
+	// (sigmas per layer, in each component), recording the path if pPath is given
+	void Fly(const Scenario& scenario, double ascentRate, double burstAlt, double descentRate, const double* pNoise,
+		Trajectory* pTrajectory, std::vector<double>* pPath)
+	{
+		double east = 0.0, north = 0.0, time = 0.0;
+		double alt = scenario.alt;
+
+		if (pPath)
+		{
+			pPath->push_back(east);
+			pPath->push_back(north);
+			pPath->push_back(alt);
+		}
+
+		for (int leg=0; leg<2; ++leg)
+		{
+			const bool up = leg == 0;
+			if (up && (scenario.descending || alt >= burstAlt))
+				continue;
+			const double target = up ? burstAlt : scenario.groundAlt;
+
+			while (up ? alt < target : alt > target)
+			{
+				const double next = up ? std::min(alt + c_Step, target) : std::max(alt - c_Step, target);
+				const double mid = 0.5 * (alt + next);
+				const int bin = WindProfile::BinIndex(mid);
+				const WindProfile::Layer& layer = scenario.layers[bin];
+
+				double speed = ascentRate;
+				if (!up)
+				{
+					const size_t step = std::min((size_t)std::max(mid / c_Step, 0.0), scenario.densityFactors.size() - 1);
+					speed = descentRate * scenario.densityFactors[step];
+				}
+
+				const double dt = fabs(next - alt) / speed;
+				east += (layer.east + pNoise[2 * bin] * layer.sigma) * dt;
+				north += (layer.north + pNoise[2 * bin + 1] * layer.sigma) * dt;
+				time += dt;
+				alt = next;
+
+				if (pPath)
+				{
+					pPath->push_back(east);
+					pPath->push_back(north);
+					pPath->push_back(alt);
+				}
+			}
+		}
+
+		pTrajectory->east = east;
+		pTrajectory->north = north;
+		pTrajectory->time = time;
+		pTrajectory->burstAlt = scenario.descending ? scenario.maxAlt : std::max(burstAlt, scenario.alt);
+	}
+
+	struct Job
+	{
+		const Scenario* pScenario;
+		uint64_t seed;
+		Trajectory* pTrajectories;
+		int count;
+	};
+
+	void* RunJob(void* pArg)
+	{
+		const Job& job = *(const Job*)pArg;
+		const Scenario& scenario = *job.pScenario;
+		Random random(job.seed);
+
+		const double correlation = exp(-c_BinHeight / c_WindCorrelation);
+		const double innovation = sqrt(1.0 - correlation * correlation);
+		double noise[2 * c_BinCount];
+
+		for (int i=0; i<job.count; ++i)
+		{
+			// a random walk up through the layers, so neighbouring layers are off in the same direction
+			for (int c=0; c<2; ++c)
+			{
+				double e = random.Gaussian();
+				for (int b=0; b<c_BinCount; ++b)
+				{
+					noise[2 * b + c] = e;
+					e = correlation * e + innovation * random.Gaussian();
+				}
+			}
+
+			const double ascentRate = std::max(scenario.ascentRate + c_AscentRateSigma * random.Gaussian(), c_MinVerticalSpeed);
+			const double burstAlt = scenario.burstAlt + scenario.burstSigma * random.Gaussian();
+
+			// descent rate goes as 1/sqrt(drag area)
+			const double dragSigma = scenario.calibrated ? c_CalibratedDragSigma : c_DragSigma;
+			const double descentRate = scenario.descentRate * exp(-0.5 * dragSigma * random.Gaussian());
+
+			Fly(scenario, ascentRate, burstAlt, descentRate, noise, &job.pTrajectories[i], NULL);
+		}
+
+		return NULL;
+	}
+
+	// what we know about the flight so far
+	class Flight
+	{
+	public:
+		Flight(const Options& options) :
+			m_Options(options),
+			m_HasFix(false),
+			m_MaxAlt(0.0),
+			m_AscentRate(options.ascentRate),
+			m_Descending(false),
+			m_DescentRate(sqrt(2.0 * options.mass * c_Gravity / (c_SeaLevelDensity * options.dragArea))),
+			m_Calibrated(false)
+		{
+			for (int i=0; i<TelemetryReader::ESource::EnumCount; ++i)
+				m_HasSourceFix[i] = false;
+		}
+
+		void AddFix(const TelemetryReader::Fix& fix)
+		{
+			// the tracker's own position
+			if (fix.source == TelemetryReader::ESource::Logging)
+				return;
+
+			if (!m_HasFix)
+				m_MaxAlt = fix.alt;
+			m_HasFix = true;
+			m_Latest = fix;
+			m_MaxAlt = std::max(m_MaxAlt, fix.alt);
+
+			// drift and climb are measured against the last position from the same source, so that the
+			// clocks match
+			TelemetryReader::Fix& previous = m_SourceFix[fix.source];
+			if (!m_HasSourceFix[fix.source] || fix.timeBase != previous.timeBase)
+			{
+				m_HasSourceFix[fix.source] = true;
+				previous = fix;
+				return;
+			}
+
+			double dt = fix.time - previous.time;
+			if (dt < -43200.0)
+				dt += 86400.0;      // past UTC midnight
+			if (dt < c_MinWindInterval)
+				return;
+			if (dt > c_MaxWindInterval)
+			{
+				previous = fix;
+				return;
+			}
+
+			const double east = (fix.lon - previous.lon) * c_MPerDeg * cos(fix.lat * M_PI / 180.0);
+			const double north = (fix.lat - previous.lat) * c_MPerDeg;
+			const double verticalSpeed = (fix.alt - previous.alt) / dt;
+
+			if (fabs(verticalSpeed) >= c_MinVerticalSpeed && sqrt(east * east + north * north) <= c_MaxWind * dt)
+				m_Wind.AddDrift(previous.alt, fix.alt, east, north, dt);
+
+			if (!m_Descending && verticalSpeed >= c_MinVerticalSpeed)
+				m_AscentRate = verticalSpeed;
+			if (!m_Descending && verticalSpeed < 0.0 && fix.alt + c_BurstDrop < m_MaxAlt)
+				m_Descending = true;
+
+			// once it's settled under the parachute, scale the drag model to match how fast it's falling
+			if (m_Descending && verticalSpeed < 0.0 && fix.alt + c_ChuteOpenDrop < m_MaxAlt)
+			{
+				const double model = sqrt(c_SeaLevelDensity / Density(0.5 * (fix.alt + previous.alt)));
+				const double measured = -verticalSpeed / model;
+				m_DescentRate = m_Calibrated ? m_DescentRate + c_CalibrationGain * (measured - m_DescentRate) : measured;
+				m_Calibrated = true;
+			}
+
+			previous = fix;
+		}
+
+		bool GetScenario(Scenario* pScenario) const
+		{
+			if (!m_HasFix || m_Wind.IsEmpty())
+				return false;
+
+			pScenario->lat = m_Latest.lat;
+			pScenario->lon = m_Latest.lon;
+			pScenario->alt = m_Latest.alt;
+			pScenario->maxAlt = m_MaxAlt;
+			pScenario->descending = m_Descending;
+			pScenario->ascentRate = m_AscentRate;
+			pScenario->descentRate = m_DescentRate;
+			pScenario->calibrated = m_Calibrated;
+			pScenario->groundAlt = m_Options.groundAlt;
+			pScenario->burstAlt = std::max(m_Options.burstAlt, m_Latest.alt);
+			pScenario->burstSigma = m_Latest.alt < m_Options.burstAlt ? m_Options.burstSigma : 0.0;
+			m_Wind.GetLayers(pScenario->layers);
+
+			if (pScenario->densityFactors.empty())
+			{
+				for (double alt=0.5 * c_Step; alt<c_BinCount * c_BinHeight; alt+=c_Step)
+					pScenario->densityFactors.push_back(sqrt(c_SeaLevelDensity / Density(alt)));
+			}
+			return true;
+		}
+
+	private:
+		const Options& m_Options;
+
+		bool m_HasFix;
+		TelemetryReader::Fix m_Latest;
+		double m_MaxAlt;
+		double m_AscentRate;
+		bool m_Descending;
+		double m_DescentRate;
+		bool m_Calibrated;
+
+		bool m_HasSourceFix[TelemetryReader::ESource::EnumCount];
+		TelemetryReader::Fix m_SourceFix[TelemetryReader::ESource::EnumCount];
+
+		WindProfile m_Wind;
+	};
+
+	void ToLatLon(const Scenario& scenario, double east, double north, double* pLat, double* pLon)
+	{
+		*pLat = scenario.lat + north / c_MPerDeg;
+		*pLon = scenario.lon + east / (c_MPerDeg * cos(scenario.lat * M_PI / 180.0));
+	}
+
+	void WriteEllipse(FILE* pFile, const Scenario& scenario, const char* name, double k,
+		double meanEast, double meanNorth, double varEast, double varNorth, double covar)
+	{
+		// principal axes of the covariance
+		const double mid = 0.5 * (varEast + varNorth);
+		const double spread = sqrt(0.25 * (varEast - varNorth) * (varEast - varNorth) + covar * covar);
+		const double major = sqrt(std::max(mid + spread, 0.0));
+		const double minor = sqrt(std::max(mid - spread, 0.0));
+		const double theta = 0.5 * atan2(2.0 * covar, varEast - varNorth);
+
+		fprintf(pFile, "<Placemark>\n<name>%s</name>\n", name);
+		fprintf(pFile, "<description>%.0fm by %.0fm.</description>\n", 2.0 * k * major, 2.0 * k * minor);
+		fprintf(pFile, "<styleUrl>#area</styleUrl>\n<Polygon>\n<tesselate>1</tesselate>\n<altitudeMode>clampToGround</altitudeMode>\n");
+		fprintf(pFile, "<outerBoundaryIs><LinearRing>\n<coordinates>\n");
+		for (int i=0; i<=c_EllipsePoints; ++i)
+		{
+			const double phi = 2.0 * M_PI * i / c_EllipsePoints;
+			const double x = k * major * cos(phi);
+			const double y = k * minor * sin(phi);
+			double lat, lon;
+			ToLatLon(scenario, meanEast + x * cos(theta) - y * sin(theta), meanNorth + x * sin(theta) + y * cos(theta), &lat, &lon);
+			fprintf(pFile, "%.6f,%.6f,0\n", lon, lat);
+		}
+		fprintf(pFile, "</coordinates>\n</LinearRing></outerBoundaryIs>\n</Polygon></Placemark>\n");
+	}
+
+	// runs the Monte Carlo and writes the KML, returning the radius of the 95% area in m, or -1 if it couldn't
+	double Predict(const Options& options, const Flight& flight, Scenario* pScenario, uint64_t seed)
+	{
+		if (!flight.GetScenario(pScenario))
+			return -1.0;
+		const Scenario& scenario = *pScenario;
+
+		// the nominal path, with no noise
+		std::vector<double> path;
+		std::vector<double> noNoise(2 * c_BinCount, 0.0);
+		Trajectory nominal;
+		Fly(scenario, scenario.ascentRate, scenario.burstAlt, scenario.descentRate, &noNoise[0], &nominal, &path);
+
+		// and the perturbed ones, split between the threads
+		std::vector<Trajectory> trajectories(options.samples);
+		std::vector<Job> jobs(options.threads);
+		std::vector<pthread_t> threads(options.threads);
+		for (int i=0; i<options.threads; ++i)
+		{
+			const int first = (int)((int64_t)options.samples * i / options.threads);
+			const int last = (int)((int64_t)options.samples * (i + 1) / options.threads);
+			jobs[i].pScenario = &scenario;
+			jobs[i].seed = seed * 0x9E3779B97F4A7C15ull + i + 1;
+			jobs[i].pTrajectories = &trajectories[first];
+			jobs[i].count = last - first;
+			pthread_create(&threads[i], NULL, RunJob, &jobs[i]);
+		}
+		for (int i=0; i<options.threads; ++i)
+			pthread_join(threads[i], NULL);
+
+		double meanEast = 0.0, meanNorth = 0.0, meanTime = 0.0;
+		for (int i=0; i<options.samples; ++i)
+		{
+			meanEast += trajectories[i].east;
+			meanNorth += trajectories[i].north;
+			meanTime += trajectories[i].time;
+		}
+		meanEast /= options.samples;
+		meanNorth /= options.samples;
+		meanTime /= options.samples;
+
+		double varEast = 0.0, varNorth = 0.0, covar = 0.0;
+		for (int i=0; i<options.samples; ++i)
+		{
+			const double dEast = trajectories[i].east - meanEast;
+			const double dNorth = trajectories[i].north - meanNorth;
+			varEast += dEast * dEast;
+			varNorth += dNorth * dNorth;
+			covar += dEast * dNorth;
+		}
+		varEast /= options.samples;
+		varNorth /= options.samples;
+		covar /= options.samples;
+
+		// written to the side and moved into place, so that Google Earth never loads half of it
+		const std::string temp = std::string(options.output) + ".tmp";
+		FILE* pFile = fopen(temp.c_str(), "w");
+		if (!pFile)
+		{
+			fprintf(stderr, "Couldn't write %s\n", temp.c_str());
+			return -1.0;
+		}
+
+		fprintf(pFile, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n");
+		fprintf(pFile, "<kml xmlns=\"http://www.opengis.net/kml/2.2\">\n");
+		fprintf(pFile, "<Document>\n<name>Predicted Path</name>\n<description>Predicted path for %s</description>\n", options.name);
+		fprintf(pFile, "<Style id=\"path\">\n<LineStyle>\n<color>7f00ffff</color>\n<width>4</width>\n</LineStyle>\n<PolyStyle>\n<color>7f00ff00</color>\n</PolyStyle>\n</Style>\n");
+		fprintf(pFile, "<Style id=\"area\">\n<LineStyle>\n<color>7f0000ff</color>\n<width>2</width>\n</LineStyle>\n<PolyStyle>\n<color>3f0000ff</color>\n</PolyStyle>\n</Style>\n");
+
+		fprintf(pFile, "<Placemark>\n<name>Predicted Path</name>\n");
+		fprintf(pFile, "<description>Ascent rate: %.1fm/s, descent rate: %.1fm/s with burst at %.0fm.</description>\n",
+			scenario.ascentRate, scenario.descentRate * sqrt(c_SeaLevelDensity / Density(scenario.groundAlt)), nominal.burstAlt);
+		fprintf(pFile, "<styleUrl>#path</styleUrl>\n<LineString>\n<extrude>1</extrude>\n<tesselate>1</tesselate>\n<altitudeMode>absolute</altitudeMode>\n<coordinates>\n");
+		double burstLat = scenario.lat, burstLon = scenario.lon;
+		for (size_t i=0; i<path.size(); i+=3)
+		{
+			double lat, lon;
+			ToLatLon(scenario, path[i], path[i + 1], &lat, &lon);
+			fprintf(pFile, "%.6f,%.6f,%.0f\n", lon, lat, path[i + 2]);
+			if (!scenario.descending && path[i + 2] == nominal.burstAlt)
+			{
+				burstLat = lat;
+				burstLon = lon;
+			}
+		}
+		fprintf(pFile, "</coordinates>\n</LineString></Placemark>\n");
+
+		fprintf(pFile, "<Placemark>\n<name>Balloon Position</name>\n");
+		fprintf(pFile, "<description>Balloon at %.5f, %.5f with altitude %.0fm.</description>\n", scenario.lat, scenario.lon, scenario.alt);
+		fprintf(pFile, "<Point><coordinates>%.6f,%.6f,%.0f</coordinates></Point>\n</Placemark>\n", scenario.lon, scenario.lat, scenario.alt);
+
+		if (!scenario.descending)
+		{
+			fprintf(pFile, "<Placemark>\n<name>Balloon Burst</name>\n");
+			fprintf(pFile, "<description>Balloon burst at %.5f, %.5f in %.0f minutes with altitude %.0fm.</description>\n",
+				burstLat, burstLon, (nominal.burstAlt - scenario.alt) / scenario.ascentRate / 60.0, nominal.burstAlt);
+			fprintf(pFile, "<Point><coordinates>%.6f,%.6f,%.0f</coordinates></Point>\n</Placemark>\n", burstLon, burstLat, nominal.burstAlt);
+		}
+
+		double landingLat, landingLon;
+		ToLatLon(scenario, meanEast, meanNorth, &landingLat, &landingLon);
+		fprintf(pFile, "<Placemark>\n<name>Predicted Balloon Landing</name>\n");
+		fprintf(pFile, "<description>Balloon landing at %.5f, %.5f in %.0f minutes, from %d trajectories.</description>\n",
+			landingLat, landingLon, meanTime / 60.0, options.samples);
+		fprintf(pFile, "<Point><coordinates>%.6f,%.6f,0</coordinates></Point>\n</Placemark>\n", landingLon, landingLat);
+
+		WriteEllipse(pFile, scenario, "50% Landing Area", c_Ellipse50, meanEast, meanNorth, varEast, varNorth, covar);
+		WriteEllipse(pFile, scenario, "95% Landing Area", c_Ellipse95, meanEast, meanNorth, varEast, varNorth, covar);
+
+		fprintf(pFile, "</Document></kml>");
+		fclose(pFile);
+
+		if (rename(temp.c_str(), options.output) != 0)
+		{
+			fprintf(stderr, "Couldn't replace %s\n", options.output);
+			return -1.0;
+		}
+
+		return c_Ellipse95 * sqrt(std::max(0.5 * (varEast + varNorth) + sqrt(0.25 * (varEast - varNorth) * (varEast - varNorth) + covar * covar), 0.0));
+	}
+
+	void Usage()
+	{
+		fprintf(stderr, "Usage: Predictor [-o out.kml] [-f] [-e] [-n count] [-t threads] [-b burstAlt] [-s burstSigma]\n");
+		fprintf(stderr, "                 [-r ascentRate] [-m mass] [-a dragArea] [-g groundAlt] [-N name] log...\n");
+	}
+}
+
+int main(int argc, char** argv)
+{
+	Options options;
+	options.output = "Prediction.kml";
+	options.follow = false;
+	options.everyFix = false;
+	options.samples = 10000;
+	options.threads = std::max((int)sysconf(_SC_NPROCESSORS_ONLN), 1);
+	options.burstAlt = 30000.0;
+	options.burstSigma = 3000.0;
+	options.ascentRate = 5.0;
+	options.mass = 1.5;
+	options.dragArea = 1.0;
+	options.groundAlt = 0.0;
+	options.name = "the balloon";
+
+	int opt;
+	while ((opt = getopt(argc, argv, "o:fen:t:b:s:r:m:a:g:N:")) != -1)
+	{
+		switch (opt)
+		{
+		case 'o': options.output = optarg; break;
+		case 'f': options.follow = true; break;
+		case 'e': options.everyFix = true; break;
+		case 'n': options.samples = std::max(atoi(optarg), 1); break;
+		case 't': options.threads = std::max(atoi(optarg), 1); break;
+		case 'b': options.burstAlt = atof(optarg); break;
+		case 's': options.burstSigma = atof(optarg); break;
+		case 'r': options.ascentRate = atof(optarg); break;
+		case 'm': options.mass = atof(optarg); break;
+		case 'a': options.dragArea = atof(optarg); break;
+		case 'g': options.groundAlt = atof(optarg); break;
+		case 'N': options.name = optarg; break;
+		default: Usage(); return 1;
+		}
+	}
+	if (optind >= argc)
+	{
+		Usage();
+		return 1;
+	}
+	options.threads = std::min(options.threads, options.samples);
+
+	std::vector<TelemetryReader*> readers;
+	for (int i=optind; i<argc; ++i)
+	{
+		readers.push_back(new TelemetryReader(argv[i], options.follow));
+		if (!readers.back()->IsOpen())
+		{
+			fprintf(stderr, "Couldn't open %s\n", argv[i]);
+			return 1;
+		}
+	}
+
+	Flight flight(options);
+	Scenario scenario;
+	uint64_t predictions = 0;
+	uint32_t fixes = 0;
+
+	for (;;)
+	{
+		bool updated = false;
+		for (size_t i=0; i<readers.size(); ++i)
+		{
+			TelemetryReader::Fix fix;
+			while (readers[i]->Read(&fix))
+			{
+				flight.AddFix(fix);
+				updated = true;
+				++fixes;
+
+				if (!options.follow && options.everyFix)
+				{
+					const double start = Now();
+					const double radius = Predict(options, flight, &scenario, ++predictions);
+					if (radius >= 0.0)
+						fprintf(stderr, "%.0fm: 95%% within %.0fm, %d trajectories in %.0fms\n", fix.alt, radius, options.samples, (Now() - start) * 1000.0);
+				}
+			}
+		}
+
+		if (updated && (options.follow || !options.everyFix))
+		{
+			const double start = Now();
+			const double radius = Predict(options, flight, &scenario, ++predictions);
+			if (radius >= 0.0)
+				fprintf(stderr, "%u positions: 95%% within %.0fm, %d trajectories in %.0fms\n", fixes, radius, options.samples, (Now() - start) * 1000.0);
+			else
+				fprintf(stderr, "%u positions: not enough to predict from yet\n", fixes);
+		}
+
+		if (!options.follow)
+			break;
+		usleep(250000);
+	}
+
+	for (size_t i=0; i<readers.size(); ++i)
+		delete readers[i];
+	return 0;
+}
@@ -0,0 +1,260 @@
+// Decodes the Profiler frames out of a log written by one of the apps.
+//
+// The frames are binary, in among the CSV rows: 0xA5 0x5A 'P', a length, the payload and
+// a CRC32 (see libraries/FPS/Profiler.h). Anything that doesn't check out is skipped, so
+// it's fine to run this over a log that was cut off or had bytes dropped. Prints the
+// latest frame in each log, or all of them with -a, as a table of each section's times
+// and its histogram.
+//
+// Build from this directory with:
+//   g++ -O2 -I../Host -I../../libraries/CRC ProfileDump.cpp ../../libraries/CRC/CRC.cpp -o ProfileDump
+//
+// Usage: ProfileDump [-a] log...
+
+#include <CRC.h>
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+
+namespace
+{
+	const uint8_t c_Sync[] = {0xA5, 0x5A, 'P'};
+	const uint8_t c_Version = 1;
+	const uint8_t c_FirstBucketBits = 3;    // bucket 0 is everything under 2^3 us
+	const size_t c_MaxPayload = 4096;
+
+	struct Section
+	{
+		std::string name;
+		uint32_t min;
+		uint32_t max;
+		uint32_t total;
+		uint32_t count;
+		std::vector<uint8_t> buckets;
+	};
+
+	struct Frame
+	{
+		uint32_t now;           // ms
+		Section loop;
+		std::vector<Section> sections;
+	};
+
+	class Reader
+	{
+	public:
+		Reader(const uint8_t* data, size_t size) : m_Data(data), m_Size(size), m_Offset(0), m_OK(true) {}
+
+		bool IsOK() const { return m_OK && m_Offset == m_Size; }
+
+		uint32_t Read(uint8_t bytes)
+		{
+			if (m_Offset + bytes > m_Size)
+			{
+				m_OK = false;
+				return 0;
+			}
+
+			uint32_t value = 0;
+			for (uint8_t i=0; i<bytes; ++i)
+				value |= (uint32_t)m_Data[m_Offset++] << (i * 8);
+			return value;
+		}
+
+		std::string ReadString(uint8_t length)
+		{
+			if (m_Offset + length > m_Size)
+			{
+				m_OK = false;
+				return std::string();
+			}
+
+			const std::string text((const char*)m_Data + m_Offset, length);
+			m_Offset += length;
+			return text;
+		}
+
+	private:
+		const uint8_t* m_Data;
+		size_t m_Size;
+		size_t m_Offset;
+		bool m_OK;
+	};
+
+	void ReadSection(Reader& reader, uint8_t bucketCount, Section* pSection)
+	{
+		pSection->min = reader.Read(4);
+		pSection->max = reader.Read(4);
+		pSection->total = reader.Read(4);
+		pSection->count = reader.Read(4);
+		pSection->buckets.resize(bucketCount);
+		for (uint8_t i=0; i<bucketCount; ++i)
+			pSection->buckets[i] = (uint8_t)reader.Read(1);
+	}
+
+	bool ParsePayload(const uint8_t* data, size_t size, Frame* pFrame)
+	{
+		Reader reader(data, size);
+		if (reader.Read(1) != c_Version)
+			return false;
+
+		pFrame->now = reader.Read(4);
+		const uint8_t sectionCount = (uint8_t)reader.Read(1);
+		const uint8_t bucketCount = (uint8_t)reader.Read(1);
+
+		pFrame->loop.name = "(loop)";
+		ReadSection(reader, bucketCount, &pFrame->loop);
+
+		pFrame->sections.resize(sectionCount);
+		for (uint8_t i=0; i<sectionCount; ++i)
+		{
+			Section& section = pFrame->sections[i];
+			section.name = reader.ReadString((uint8_t)reader.Read(1));
+			if (section.name.empty())
+			{
+				char name[16];
+				snprintf(name, sizeof(name), "#%u", i);
+				section.name = name;
+			}
+			ReadSection(reader, bucketCount, &section);
+		}
+		return reader.IsOK();
+	}
+
+	// every frame in the file that checks out
+	void ReadFrames(FILE* pFile, std::vector<Frame>* pFrames)
+	{
+		std::vector<uint8_t> data;
+		uint8_t buffer[4096];
+		size_t count;
+		while ((count = fread(buffer, 1, sizeof(buffer), pFile)) > 0)
+			data.insert(data.end(), buffer, buffer + count);
+
+		const size_t header = sizeof(c_Sync) + 2;
+		for (size_t i=0; i + header <= data.size(); ++i)
+		{
+			if (memcmp(&data[i], c_Sync, sizeof(c_Sync)) != 0)
+				continue;
+
+			const size_t length = data[i + 3] | (data[i + 4] << 8);
+			if (length > c_MaxPayload || i + header + length + 4 > data.size())
+				continue;
+
+			const uint8_t* pPayload = &data[i + header];
+			const uint8_t* pCRC = pPayload + length;
+			const uint32_t crc = pCRC[0] | (pCRC[1] << 8) | (pCRC[2] << 16) | ((uint32_t)pCRC[3] << 24);
+			if (crc32(pPayload, length) != crc)
+				continue;
+
+			Frame frame;
+			if (!ParsePayload(pPayload, length, &frame))
+				continue;
+
+			pFrames->push_back(frame);
+			i += header + length + 4 - 1;
+		}
+	}
+
+	// a bucket's lower bound in us, as a short label
+	std::string BucketLabel(uint8_t bucket)
+	{
+		if (bucket == 0)
+			return "0";
+
+		const uint32_t us = 1ul << (bucket + c_FirstBucketBits - 1);
+		char label[16];
+		if (us >= 1000000)
+			snprintf(label, sizeof(label), "%us", us / 1000000);
+		else if (us >= 1000)
+			snprintf(label, sizeof(label), "%ums", us / 1000);
+		else
+			snprintf(label, sizeof(label), "%uus", us);
+		return label;
+	}
+
+	void PrintSection(const Section& section)
+	{
+		const double mean = section.count ? (double)section.total / section.count : 0.0;
+		printf("%-16s %8u %10.0f %10u %10u  ", section.name.c_str(), section.count, mean, section.min, section.max);
+		for (size_t i=0; i<section.buckets.size(); ++i)
+		{
+			if (section.buckets[i])
+				printf(" %5u", section.buckets[i]);
+			else
+				printf("     .");
+		}
+		printf("\n");
+	}
+
+	void PrintFrame(const char* path, const Frame& frame)
+	{
+		printf("%s at %.3f s\n", path, frame.now * 0.001);
+		printf("%-16s %8s %10s %10s %10s  ", "section", "count", "mean (us)", "min (us)", "max (us)");
+		for (size_t i=0; i<frame.loop.buckets.size(); ++i)
+			printf(" %5s", BucketLabel((uint8_t)i).c_str());
+		printf("\n");
+
+		PrintSection(frame.loop);
+		for (size_t i=0; i<frame.sections.size(); ++i)
+		{
+			if (frame.sections[i].count)
+				PrintSection(frame.sections[i]);
+		}
+		printf("\n");
+	}
+
+	void Usage()
+	{
+		fprintf(stderr, "Usage: ProfileDump [-a] log...\n");
+	}
+}
+
+int main(int argc, char** argv)
+{
+	bool all = false;
+	int opt;
+	while ((opt = getopt(argc, argv, "a")) != -1)
+	{
+		switch (opt)
+		{
+		case 'a': all = true; break;
+		default: Usage(); return 1;
+		}
+	}
+	if (optind >= argc)
+	{
+		Usage();
+		return 1;
+	}
+
+	int result = 0;
+	for (int i=optind; i<argc; ++i)
+	{
+		FILE* pFile = fopen(argv[i], "rb");
+		if (!pFile)
+		{
+			fprintf(stderr, "Couldn't open %s\n", argv[i]);
+			result = 1;
+			continue;
+		}
+
+		std::vector<Frame> frames;
+		ReadFrames(pFile, &frames);
+		fclose(pFile);
+
+		if (frames.empty())
+		{
+			fprintf(stderr, "No profiles in %s\n", argv[i]);
+			result = 1;
+			continue;
+		}
+
+		for (size_t j=(all ? 0 : frames.size() - 1); j<frames.size(); ++j)
+			PrintFrame(argv[i], frames[j]);
+	}
+	return result;
+}
@@ -0,0 +1,267 @@
+// Runs FlightRecorder on a simulated flash chip through a long flight, cutting the power
+// now and then, and checks what FlightLogReader gets back.
+//
+// The app appends a record at a steady rate and calls loop() every millisecond, except
+// when some other task holds it up. The chip takes datasheet times to program and erase,
+// and sometimes an erase takes the worst case time, which the recorder has to hide by
+// suspending the erase whenever it has records to write. Every time FileFlash looks at the
+// clock takes 10 us, about what an SPI transaction costs, which is also what lets the
+// recorder's waits in setup() get anywhere. At random the power's cut, leaving whatever
+// the chip was doing half done, and the recorder's set up again from what's on the chip.
+//
+// Each record holds its own number and a pattern made from it, so at the end every record
+// read back can be checked, and any that are missing accounted for: dropped with the
+// queue full, or still in the queue or the last of an open page when the power went.
+//
+// Build from this directory with:
+//   g++ -O2 -I../Host -I../Common -I../../libraries/Core -I../../libraries/CRC
+//       -I../../libraries/FlightRecorder RecorderSim.cpp ../Common/FileFlash.cpp
+//       ../../libraries/FlightRecorder/FlightRecorder.cpp
+//       ../../libraries/FlightRecorder/FlightLogReader.cpp ../../libraries/CRC/CRC.cpp
+//       -o RecorderSim
+//
+// Usage: RecorderSim [-t hours] [-r rate] [-z size] [-k KB] [-c minutes] [-w ms] [-e chance] [-o image] [-s seed]
+//   -t hours     flight time, default 3
+//   -r rate      Hz, records per second, default 10
+//   -z size      bytes of data in each record, default 52, the balloon's Flight record
+//   -k KB        flash size, default 2048, so a long flight goes round it a few times
+//   -c minutes   mean time between power cuts, default 20, 0 for none
+//   -w ms        the longest another task holds up loop(), default 20
+//   -e chance    of an erase taking the worst case 400 ms, default 0.05
+//   -o image     save the flash image at the end, for FlightLog
+//   -s seed
+// and exits with 2 if a record was dropped, came back wrong or out of order, went missing
+// without a reason, or the recorder did anything to the chip that a real one wouldn't allow.
+
+#include <Arduino.h>
+#include <FileFlash.h>
+#include <FlightRecorder.h>
+#include <FlightLogReader.h>
+
+#include <math.h>
+#include <unistd.h>
+#include <algorithm>
+#include <set>
+#include <vector>
+
+namespace
+{
+	const uint64_t c_ClockReadTime  = 10;         // us, each time FileFlash looks at the clock
+	const uint64_t c_PollInterval   = 1000;       // us, between loop()s when nothing's holding them up
+	const double c_HoldUpChance     = 0.02;       // of another task holding up a loop()
+	const uint64_t c_BootTime       = 3000000;    // us, from the power coming back to the first record
+	const uint8_t c_RecordType      = 1;
+
+	uint64_t g_Now = 0;                           // us
+
+	struct Options
+	{
+		double hours;
+		double rate;
+		int size;
+		uint32_t flashSize;
+		double cutMinutes;
+		double holdUp;
+		double slowEraseChance;
+		const char* pImagePath;
+	};
+
+	double Random()
+	{
+		return rand() / (RAND_MAX + 1.0);
+	}
+
+	void MakeRecord(uint32_t number, uint8_t size, uint8_t* pData)
+	{
+		memcpy(pData, &number, 4);
+		for (uint8_t i=4; i<size; ++i)
+			pData[i] = (uint8_t)(number * 31 + i);
+	}
+
+	bool CheckRecord(const FlightLogReader::Record& record, uint8_t size, uint32_t* pNumber)
+	{
+		if (record.type != c_RecordType || record.size != size)
+			return false;
+
+		uint8_t expected[FlightRecorder::c_MaxRecordSize];
+		memcpy(pNumber, record.data, 4);
+		MakeRecord(*pNumber, size, expected);
+		return memcmp(expected, record.data, size) == 0;
+	}
+
+	void Usage()
+	{
+		fprintf(stderr, "Usage: RecorderSim [-t hours] [-r rate] [-z size] [-k KB] [-c minutes] [-w ms] [-e chance] [-o image] [-s seed]\n");
+	}
+}
+
+unsigned long micros()
+{
+	g_Now += c_ClockReadTime;
+	return (unsigned long)(uint32_t)g_Now;
+}
+
+unsigned long millis()
+{
+	return (unsigned long)(uint32_t)(g_Now / 1000);
+}
+
+int main(int argc, char** argv)
+{
+	Options options;
+	options.hours = 3.0;
+	options.rate = 10.0;
+	options.size = 52;
+	options.flashSize = 2048 * 1024;
+	options.cutMinutes = 20.0;
+	options.holdUp = 20.0;
+	options.slowEraseChance = 0.05;
+	options.pImagePath = NULL;
+
+	int opt;
+	while ((opt = getopt(argc, argv, "t:r:z:k:c:w:e:o:s:")) != -1)
+	{
+		switch (opt)
+		{
+		case 't': options.hours = atof(optarg); break;
+		case 'r': options.rate = std::max(atof(optarg), 0.01); break;
+		case 'z': options.size = std::min(std::max(atoi(optarg), 4), FlightRecorder::c_MaxRecordSize - 2); break;
+		case 'k': options.flashSize = std::max(atoi(optarg), 8) * 1024; break;
+		case 'c': options.cutMinutes = atof(optarg); break;
+		case 'w': options.holdUp = atof(optarg); break;
+		case 'e': options.slowEraseChance = atof(optarg); break;
+		case 'o': options.pImagePath = optarg; break;
+		case 's': srand(atoi(optarg)); break;
+		default: Usage(); return 1;
+		}
+	}
+
+	FileFlash flash(options.flashSize);
+	FileFlash::Timing timing = {700, 45000, 400000, options.slowEraseChance};
+	flash.SetTiming(timing);
+
+	FlightRecorder recorder;
+	recorder.setup(&flash);
+
+	const uint64_t end = (uint64_t)(options.hours * 3600e6);
+	const double recordInterval = 1e6 / options.rate;
+	const double cutInterval = options.cutMinutes * 60e6;
+	double nextRecord = (double)g_Now;         // after setup(), which waits on the flash
+	uint64_t nextPoll = 0;
+	double nextCut = cutInterval > 0.0 ? -log(1.0 - Random()) * cutInterval : 1e300;
+
+	uint32_t appended = 0;
+	std::set<uint32_t> dropped;
+	std::vector<uint32_t> cuts;           // the number of the next record to be appended at each cut
+	uint32_t recovered = 0;
+	uint8_t queuePeak = 0;
+	uint8_t data[FlightRecorder::c_MaxRecordSize];
+
+	while (g_Now < end)
+	{
+		g_Now = std::max(g_Now, (uint64_t)ceil(std::min(std::min(nextRecord, (double)nextPoll), nextCut)));
+
+		if (g_Now >= nextCut)
+		{
+			queuePeak = std::max(queuePeak, recorder.GetQueuePeak());
+			flash.PowerCut();
+			cuts.push_back(appended);
+
+			recorder = FlightRecorder();
+			recorder.setup(&flash);
+			recovered += recorder.GetRecoveredCount();
+
+			nextRecord = std::max(nextRecord, (double)(g_Now + c_BootTime));
+			nextPoll = g_Now;
+			nextCut = g_Now - log(1.0 - Random()) * cutInterval;
+			continue;
+		}
+
+		if (g_Now >= nextRecord)
+		{
+			MakeRecord(appended, (uint8_t)options.size, data);
+			if (!recorder.Append(c_RecordType, data, (uint8_t)options.size))
+				dropped.insert(appended);
+			++appended;
+			nextRecord += recordInterval;
+		}
+
+		if (g_Now >= nextPoll)
+		{
+			recorder.loop();
+			nextPoll = g_Now + c_PollInterval;
+			if (Random() < c_HoldUpChance)
+				nextPoll += (uint64_t)(Random() * options.holdUp * 1000.0);
+		}
+	}
+	queuePeak = std::max(queuePeak, recorder.GetQueuePeak());
+
+	// read it all back, once the chip's finished an erase it might have been left in the middle of
+	flash.ResumeErase();
+	while (flash.IsBusy())
+	{
+	}
+	FlightLogReader reader(&flash);
+	uint32_t read = 0, wrong = 0, outOfOrder = 0, unverified = 0;
+	uint32_t first = 0, last = 0;
+	std::vector<bool> seen(appended, false);
+	if (reader.Rewind())
+	{
+		FlightLogReader::Record record;
+		while (reader.Next(&record))
+		{
+			uint32_t number;
+			if (!CheckRecord(record, (uint8_t)options.size, &number) || number >= appended)
+			{
+				// only the last record of a page whose trailer was cut off isn't covered by a CRC
+				if (record.pageState == FlightLogReader::EPageState::Verified || record.pageState == FlightLogReader::EPageState::Recovered)
+					++wrong;
+				else
+					++unverified;
+				continue;
+			}
+
+			if (read > 0 && number <= last)
+				++outOfOrder;
+			if (read == 0)
+				first = number;
+			last = number;
+			seen[number] = true;
+			++read;
+		}
+	}
+
+	// anything missing from the middle has to have been dropped, or lost to a cut
+	const uint32_t queueRecords = (FlightRecorder::c_QueueSize - 1) / (options.size + 2);
+	uint32_t lostToCuts = 0, missing = 0;
+	for (uint32_t i=first; i<last; ++i)
+	{
+		if (seen[i] || dropped.count(i))
+			continue;
+
+		bool cut = false;
+		for (size_t j=0; j<cuts.size() && !cut; ++j)
+			cut = i < cuts[j] && i + queueRecords + 1 >= cuts[j];
+		if (cut)
+			++lostToCuts;
+		else
+			++missing;
+	}
+
+	const double recordBytes = options.size + 2;
+	printf("%.1f h at %.0f Hz, %d byte records, %u KB of flash, %zu power cuts\n",
+		options.hours, options.rate, options.size, options.flashSize / 1024, cuts.size());
+	printf("appended %u, dropped %zu, read back %u (from #%u), lost to cuts %u, missing %u\n",
+		appended, dropped.size(), read, first, lostToCuts, missing);
+	printf("wrong %u, out of order %u, unverified %u, pages recovered %u, violations %u\n",
+		wrong, outOfOrder, unverified, recovered, flash.GetViolationCount());
+	printf("queue peak %u bytes, %.0f ms of records\n", queuePeak, queuePeak / recordBytes * recordInterval * 0.001);
+
+	if (options.pImagePath && !flash.Save(options.pImagePath))
+	{
+		fprintf(stderr, "Couldn't write %s\n", options.pImagePath);
+		return 1;
+	}
+
+	return (!dropped.empty() || wrong || outOfOrder || missing || flash.GetViolationCount()) ? 2 : 0;
+}
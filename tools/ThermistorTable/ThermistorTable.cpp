@@ -0,0 +1,166 @@
+// Generates Thermistor's lookup table for a thermistor from its Steinhart-Hart
+// coefficients, the way c_Table10k was made, and checks the table through the library's
+// own codeToMilliC() against the equation.
+//
+// The circuit's Thermistor's: the thermistor from +5V to the analog pin and a fixed
+// resistor from there to ground, so R = resistor * (1024 / ADC - 1). Each entry is the
+// equation, in milli-degrees C, at the ADC code the entry starts at, clamped to 1..1023,
+// with the entries spaced by the same segments as Thermistor.cpp's c_Segments. Every code
+// in 1/64 ADC counts whose temperature is in the checked range is then converted through
+// the table and compared to the equation at that fraction of a count.
+//
+// The table is written to stdout, ready to paste into Thermistor.cpp (or an app, and
+// passed to Thermistor's constructor), and the worst error to stderr.
+//
+// Build from this directory with:
+//   g++ -O2 -I../Host -I../../external/Thermistor ThermistorTable.cpp
+//       ../../external/Thermistor/Thermistor.cpp -o ThermistorTable
+//
+// Usage: ThermistorTable [-a A] [-b B] [-c C] [-r ohms] [-l C] [-h C] [-e C] [-n name]
+//   -a, -b, -c  coefficients, 1/K = A + B ln(R) + C ln(R)^3, default the Arduino
+//               playground's 10k: 0.001129148, 0.000234125, 8.76741e-08
+//   -r ohms     the fixed resistor, default 10000
+//   -l, -h C    range to check over, default -70 to 120
+//   -e C        worst error allowed in that range, default 0.25
+//   -n name     the table's name, default c_Table10k
+// and exits with 2 if the table's worse than that anywhere in the range.
+
+#include <Arduino.h>
+#include <Thermistor.h>
+
+#include <unistd.h>
+#include <algorithm>
+
+namespace
+{
+	// Thermistor.cpp's c_Segments: the first ADC code of each segment and log2 of the
+	// codes per entry. The table has an entry at the start of each step and one more at
+	// 1024 to interpolate up to.
+	struct Segment
+	{
+		uint16_t start;
+		uint8_t shift;
+	};
+
+	const Segment c_Segments[] = {
+		{    0, 0 },
+		{   16, 2 },
+		{   64, 4 },
+		{  192, 5 },
+		{  832, 4 },
+		{  960, 2 },
+		{ 1008, 0 },
+	};
+	const uint16_t c_AdcRange = 1024;
+
+	struct Options
+	{
+		double a;
+		double b;
+		double c;
+		double resistor;
+		double low;
+		double high;
+		double tolerance;
+		const char* name;
+	};
+
+	// degrees C at a (fractional) ADC code
+	double Equation(const Options& options, double adc)
+	{
+		adc = std::min(std::max(adc, 1.0), c_AdcRange - 1.0);
+		const double lnR = log(options.resistor * c_AdcRange / adc - options.resistor);
+		return 1.0 / (options.a + options.b * lnR + options.c * lnR * lnR * lnR) - 273.15;
+	}
+
+	void Usage()
+	{
+		fprintf(stderr, "Usage: ThermistorTable [-a A] [-b B] [-c C] [-r ohms] [-l C] [-h C] [-e C] [-n name]\n");
+	}
+}
+
+unsigned long micros()
+{
+	return 0;
+}
+
+unsigned long millis()
+{
+	return 0;
+}
+
+int analogRead(uint8_t)
+{
+	return 0;
+}
+
+int main(int argc, char** argv)
+{
+	Options options;
+	options.a = 0.001129148;
+	options.b = 0.000234125;
+	options.c = 0.0000000876741;
+	options.resistor = 10000;
+	options.low = -70;
+	options.high = 120;
+	options.tolerance = 0.25;
+	options.name = "c_Table10k";
+
+	int opt;
+	while ((opt = getopt(argc, argv, "a:b:c:r:l:h:e:n:")) != -1)
+	{
+		switch (opt)
+		{
+		case 'a': options.a = atof(optarg); break;
+		case 'b': options.b = atof(optarg); break;
+		case 'c': options.c = atof(optarg); break;
+		case 'r': options.resistor = atof(optarg); break;
+		case 'l': options.low = atof(optarg); break;
+		case 'h': options.high = atof(optarg); break;
+		case 'e': options.tolerance = atof(optarg); break;
+		case 'n': options.name = optarg; break;
+		default: Usage(); return 1;
+		}
+	}
+
+	int32_t table[Thermistor::c_TableSize];
+	uint8_t count = 0;
+	const uint8_t segmentCount = sizeof(c_Segments) / sizeof(c_Segments[0]);
+	for (uint8_t s=0; s<segmentCount; ++s)
+	{
+		const uint16_t end = (s + 1 < segmentCount ? c_Segments[s + 1].start : c_AdcRange);
+		for (uint16_t code=c_Segments[s].start; code<end; code += 1 << c_Segments[s].shift)
+			table[count++] = (int32_t)floor(Equation(options, code) * 1000 + 0.5);
+	}
+	table[count++] = (int32_t)floor(Equation(options, c_AdcRange) * 1000 + 0.5);
+	if (count != Thermistor::c_TableSize)
+	{
+		fprintf(stderr, "The segments make %u entries, but Thermistor has %u\n", count, Thermistor::c_TableSize);
+		return 1;
+	}
+
+	printf("const int32_t Thermistor::%s[Thermistor::c_TableSize] PROGMEM = {\n", options.name);
+	for (uint8_t i=0; i<count; ++i)
+		printf("%s%7d,%s", i % 8 == 0 ? "\t" : "", table[i], i % 8 == 7 || i + 1 == count ? "\n" : " ");
+	printf("};\n");
+
+	// code is in 1/64 counts, as codeToMilliC() takes it
+	double worst = 0;
+	double worstTemp = 0;
+	for (uint32_t code=0; code<(uint32_t)c_AdcRange << 6; ++code)
+	{
+		const double temp = Equation(options, code / 64.0);
+		if (temp < options.low || temp > options.high)
+			continue;
+
+		const double error = fabs(Thermistor::codeToMilliC(table, code) * 0.001 - temp);
+		if (error > worst)
+		{
+			worst = error;
+			worstTemp = temp;
+		}
+	}
+	fprintf(stderr, "worst error between %.0f and %.0f C: %.3f C at %.1f C\n", options.low, options.high, worst, worstTemp);
+
+	return worst > options.tolerance ? 2 : 0;
+}
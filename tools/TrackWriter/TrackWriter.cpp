@@ -0,0 +1,262 @@
+// Writes live KML and GPX tracks from the ground station's logs as they're written.
+//
+// Follows BalloonTracker's CSV output (the balloon from its Telemetry rows, and the
+// tracker itself from its Logging rows) and/or an APRS log, and appends each position
+// to a KML and a GPX track per source in the output directory: Balloon, Tracker and
+// APRS. Points are only ever appended, over the tail of the file, so this keeps up at
+// 10 Hz for hours in constant memory. Live.kml has a NetworkLink to each track that
+// refreshes on an interval, so opening it in Google Earth gives a live view.
+//
+// Build from this directory with:
+//   g++ -O2 -I../Common TrackWriter.cpp ../Common/TelemetryReader.cpp ../Common/TrackFile.cpp -o TrackWriter
+//
+// Usage: TrackWriter [options] log...
+//   -o dir      where to write the tracks, default the current directory
+//   -f          keep following the logs as they're written
+//   -r s        how often Google Earth should reload the tracks, default 5
+//   -d date     YYYY-MM-DD, the UTC date of the flight for the tracker's PPS times, default today
+//   -p file     a prediction KML (from Predictor) to link to from Live.kml as well
+//   -N name     flight name for the KML
+
+#include <TelemetryReader.h>
+#include <TrackFile.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+namespace
+{
+	const useconds_t c_PollInterval = 200000;    // us, between looks at the logs when following
+
+	struct TrackInfo
+	{
+		const char* name;
+		const char* color;      // aabbggrr
+	};
+
+	// indexed by TelemetryReader::ESource
+	const TrackInfo c_Tracks[] = {
+		{"Balloon", "7fff0000"},
+		{"Tracker", "7f00ff00"},
+		{"APRS",    "7fff00ff"},
+	};
+
+	struct Options
+	{
+		std::string directory;
+		bool follow;
+		int refresh;
+		double date;            // s since 1970 at UTC midnight on the day of the flight
+		const char* prediction;
+		const char* name;
+	};
+
+	struct Track
+	{
+		TrackFile kml;
+		TrackFile gpx;
+		double lastTimeOfDay;   // to notice the PPS time going past midnight
+		double dayOffset;
+	};
+
+	bool ParseDate(const char* text, double* pDate)
+	{
+		tm date;
+		memset(&date, 0, sizeof(date));
+		if (sscanf(text, "%d-%d-%d", &date.tm_year, &date.tm_mon, &date.tm_mday) != 3)
+			return false;
+
+		date.tm_year -= 1900;
+		date.tm_mon -= 1;
+		*pDate = (double)timegm(&date);
+		return true;
+	}
+
+	// the little file that ties the tracks together, replaced in one go so it's never half written
+	bool WriteLive(const Options& options, Track* const* tracks)
+	{
+		const std::string path = options.directory + "/Live.kml";
+		const std::string temp = path + ".tmp";
+		FILE* pFile = fopen(temp.c_str(), "w");
+		if (!pFile)
+			return false;
+
+		fprintf(pFile, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n");
+		fprintf(pFile, "<kml xmlns=\"http://www.opengis.net/kml/2.2\">\n");
+		fprintf(pFile, "<Document>\n<name>%s</name>\n<description>Live tracks for %s</description>\n", options.name, options.name);
+
+		for (int i=0; i<TelemetryReader::ESource::EnumCount; ++i)
+		{
+			if (!tracks[i])
+				continue;
+			fprintf(pFile, "<NetworkLink>\n<name>%s</name>\n<Link>\n<href>%s.kml</href>\n", c_Tracks[i].name, c_Tracks[i].name);
+			fprintf(pFile, "<refreshMode>onInterval</refreshMode>\n<refreshInterval>%d</refreshInterval>\n</Link>\n</NetworkLink>\n", options.refresh);
+		}
+
+		if (options.prediction)
+		{
+			fprintf(pFile, "<NetworkLink>\n<name>Prediction</name>\n<Link>\n<href>%s</href>\n", options.prediction);
+			fprintf(pFile, "<refreshMode>onInterval</refreshMode>\n<refreshInterval>%d</refreshInterval>\n</Link>\n</NetworkLink>\n", options.refresh);
+		}
+
+		fprintf(pFile, "</Document></kml>\n");
+		fclose(pFile);
+		return rename(temp.c_str(), path.c_str()) == 0;
+	}
+
+	Track* OpenTrack(const Options& options, TelemetryReader::ESource::Enum source)
+	{
+		const TrackInfo& info = c_Tracks[source];
+		const std::string name = std::string(options.name) + " " + info.name;
+		const std::string base = options.directory + "/" + info.name;
+
+		Track* pTrack = new Track;
+		pTrack->lastTimeOfDay = -1.0;
+		pTrack->dayOffset = 0.0;
+		if (!pTrack->kml.Open((base + ".kml").c_str(), TrackFile::EFormat::KML, name.c_str(), info.color) ||
+		    !pTrack->gpx.Open((base + ".gpx").c_str(), TrackFile::EFormat::GPX, name.c_str(), info.color))
+		{
+			fprintf(stderr, "Couldn't write %s.kml/.gpx\n", base.c_str());
+			delete pTrack;
+			return NULL;
+		}
+		return pTrack;
+	}
+
+	// s since 1970 UTC, or negative if there's no telling
+	double GetUTC(const Options& options, Track* pTrack, const TelemetryReader::Fix& fix)
+	{
+		switch (fix.timeBase)
+		{
+		case TelemetryReader::ETimeBase::UTC:
+			return fix.time;
+
+		case TelemetryReader::ETimeBase::TimeOfDay:
+			if (pTrack->lastTimeOfDay >= 0.0 && fix.time < pTrack->lastTimeOfDay - 43200.0)
+				pTrack->dayOffset += 86400.0;
+			pTrack->lastTimeOfDay = fix.time;
+			return options.date + pTrack->dayOffset + fix.time;
+
+		case TelemetryReader::ETimeBase::Uptime:
+			break;
+		}
+		return -1.0;
+	}
+
+	void Usage()
+	{
+		fprintf(stderr, "Usage: TrackWriter [-o dir] [-f] [-r refresh] [-d YYYY-MM-DD] [-p prediction.kml] [-N name] log...\n");
+	}
+}
+
+int main(int argc, char** argv)
+{
+	Options options;
+	options.directory = ".";
+	options.follow = false;
+	options.refresh = 5;
+	options.date = floor(time(NULL) / 86400.0) * 86400.0;
+	options.prediction = NULL;
+	options.name = "Flight";
+
+	int opt;
+	while ((opt = getopt(argc, argv, "o:fr:d:p:N:")) != -1)
+	{
+		switch (opt)
+		{
+		case 'o': options.directory = optarg; break;
+		case 'f': options.follow = true; break;
+		case 'r': options.refresh = std::max(atoi(optarg), 1); break;
+		case 'p': options.prediction = optarg; break;
+		case 'N': options.name = optarg; break;
+		case 'd':
+			if (!ParseDate(optarg, &options.date))
+			{
+				Usage();
+				return 1;
+			}
+			break;
+		default: Usage(); return 1;
+		}
+	}
+	if (optind >= argc)
+	{
+		Usage();
+		return 1;
+	}
+
+	std::vector<TelemetryReader*> readers;
+	for (int i=optind; i<argc; ++i)
+	{
+		readers.push_back(new TelemetryReader(argv[i], options.follow));
+		if (!readers.back()->IsOpen())
+		{
+			fprintf(stderr, "Couldn't open %s\n", argv[i]);
+			return 1;
+		}
+	}
+
+	Track* tracks[TelemetryReader::ESource::EnumCount] = {};
+	if (!WriteLive(options, tracks))
+	{
+		fprintf(stderr, "Couldn't write %s/Live.kml\n", options.directory.c_str());
+		return 1;
+	}
+
+	for (;;)
+	{
+		bool updated = false;
+		for (size_t i=0; i<readers.size(); ++i)
+		{
+			TelemetryReader::Fix fix;
+			while (readers[i]->Read(&fix))
+			{
+				Track*& pTrack = tracks[fix.source];
+				if (!pTrack)
+				{
+					pTrack = OpenTrack(options, fix.source);
+					if (!pTrack)
+						return 1;
+					WriteLive(options, tracks);
+				}
+
+				const double utc = GetUTC(options, pTrack, fix);
+				pTrack->kml.AddPoint(fix.lat, fix.lon, fix.alt, utc);
+				pTrack->gpx.AddPoint(fix.lat, fix.lon, fix.alt, utc);
+				updated = true;
+			}
+		}
+
+		if (updated)
+		{
+			for (int i=0; i<TelemetryReader::ESource::EnumCount; ++i)
+			{
+				if (tracks[i] && !(tracks[i]->kml.Flush() && tracks[i]->gpx.Flush()))
+					fprintf(stderr, "Couldn't write to the %s track\n", c_Tracks[i].name);
+			}
+		}
+
+		if (!options.follow)
+			break;
+		usleep(c_PollInterval);
+	}
+
+	for (int i=0; i<TelemetryReader::ESource::EnumCount; ++i)
+	{
+		if (tracks[i])
+		{
+			fprintf(stderr, "%s: %lu points\n", c_Tracks[i].name, tracks[i]->kml.GetPointCount());
+			delete tracks[i];
+		}
+	}
+	for (size_t i=0; i<readers.size(); ++i)
+		delete readers[i];
+	return 0;
+}
@@ -0,0 +1,381 @@
+// Runs CaptureSerial's SoftUART against simulated serial lines and counts the bytes it
+// gets wrong, at 4800 to 19200 baud, on 8 and 16 MHz boards.
+//
+// Receiving, the other end sends random bytes with random gaps, its clock off by the
+// given error. Each edge reaches OnEdge() when the pin change interrupt gets to run,
+// which is sometimes held off by other interrupts, timestamped by micros() (4 us steps
+// at 16 MHz, 8 at 8), and edges that happen while it's held off are merged into one
+// interrupt that sees the latest level, as on the AVR. The app polls every millisecond
+// or so. Transmitting, TxBit() is run from a model of Timer1's compare interrupt, with
+// the same hold offs, and the line is read back by a model of a hardware UART sampling
+// at 16x the baud rate, its clock off the other way.
+//
+// Build from this directory with:
+//   g++ -O2 -I../Host -I../../libraries/Core -I../../libraries/CaptureSerial
+//       UARTSim.cpp ../../libraries/CaptureSerial/SoftUART.cpp -o UARTSim
+//
+// Usage: UARTSim [-n bytes] [-l latency] [-p probability] [-e error] [-s seed]
+//   -n bytes        per run each way, default 20000
+//   -l latency      us, the longest another interrupt holds ours off, default 10, about
+//                   what Timebase's capture or the TWI's interrupt takes at 16 MHz
+//   -p probability  that an interrupt is held off at all, default 0.2
+//   -e error        %, how far off the other end's clock is, default 1, for a resonator
+//   -s seed
+// and exits with 2 if any byte came through wrong.
+
+#include <Arduino.h>
+#include <Core.h>
+#include <SoftUART.h>
+
+#include <unistd.h>
+#include <algorithm>
+#include <vector>
+
+unsigned long millis() { return 0; }
+unsigned long micros() { return 0; }
+
+namespace
+{
+	const double c_ISREntry        = 3.0;      // us from an edge or compare match to the pin being read or written
+	const double c_PollInterval    = 1000.0;   // us, and as much again at random
+	const double c_TxStartDelay    = 32;       // Timer1 ticks, as in CaptureSerial
+	const double c_MaxIdleBits     = 3.0;      // the longest gap between bytes, when there is one
+
+	struct Options
+	{
+		int bytes;
+		double latency;
+		double probability;
+		double error;
+	};
+
+	struct Edge
+	{
+		double time;    // us
+		uint8_t level;  // after the edge
+	};
+
+	// a line's level over time, starting idle
+	class Line
+	{
+	public:
+		void Add(double time, uint8_t level)
+		{
+			if (level != GetLevel())
+			{
+				Edge edge = {time, level};
+				m_Edges.push_back(edge);
+			}
+		}
+
+		uint8_t GetLevel() const
+		{
+			return m_Edges.empty() ? HIGH : m_Edges.back().level;
+		}
+
+		uint8_t GetLevel(double time) const
+		{
+			size_t lo = 0, hi = m_Edges.size();
+			while (lo < hi)
+			{
+				const size_t mid = (lo + hi) / 2;
+				if (m_Edges[mid].time <= time)
+					lo = mid + 1;
+				else
+					hi = mid;
+			}
+			return lo == 0 ? HIGH : m_Edges[lo - 1].level;
+		}
+
+		const std::vector<Edge>& GetEdges() const { return m_Edges; }
+
+	private:
+		std::vector<Edge> m_Edges;
+	};
+
+	struct Result
+	{
+		int sent;
+		int wrong;              // counting missing and extra bytes
+		int framingErrors;
+		double worstEdge;       // of a bit period, the latest an edge was, against its frame's start
+	};
+
+	double Random()
+	{
+		return rand() / (RAND_MAX + 1.0);
+	}
+
+	double HoldOff(const Options& options)
+	{
+		return c_ISREntry + (Random() < options.probability ? Random() * options.latency : 0.0);
+	}
+
+	// the edit distance, so a dropped byte counts once rather than throwing out all the
+	// ones after it, within a band either side of the diagonal that's wide enough for
+	// however far the two have slipped apart
+	int CountWrong(const std::vector<uint8_t>& sent, const std::vector<uint8_t>& received)
+	{
+		const int n = (int)sent.size();
+		const int m = (int)received.size();
+		const int band = abs(n - m) + 64;
+
+		const int width = 2 * band + 1;
+		const int c_Far = 1 << 30;
+		std::vector<int> previous(width, c_Far), current(width, c_Far);
+		for (int j=0; j<=std::min(m, band); ++j)
+			previous[j + band] = j;
+
+		// cell (i, j) lives at j - i + band
+		for (int i=1; i<=n; ++i)
+		{
+			std::fill(current.begin(), current.end(), c_Far);
+			for (int j=std::max(0, i - band); j<=std::min(m, i + band); ++j)
+			{
+				const int k = j - i + band;
+				int best = (k + 1 < width ? previous[k + 1] + 1 : c_Far);            // (i-1, j), dropped
+				if (j > 0)
+				{
+					best = std::min(best, previous[k] + (sent[i - 1] != received[j - 1]));   // (i-1, j-1)
+					if (k > 0)
+						best = std::min(best, current[k - 1] + 1);                        // (i, j-1), extra
+				}
+				current[k] = best;
+			}
+			previous.swap(current);
+		}
+		return previous[m - n + band];
+	}
+
+	// 8N1 from an ideal transmitter with bitTime us bits, random gaps between bytes
+	void Send(const std::vector<uint8_t>& bytes, double bitTime, Line* pLine)
+	{
+		double time = 1000.0;
+		for (size_t i=0; i<bytes.size(); ++i)
+		{
+			if (Random() < 0.5)
+				time += Random() * c_MaxIdleBits * bitTime;
+
+			pLine->Add(time, LOW);
+			for (int bit=0; bit<8; ++bit)
+				pLine->Add(time + (bit + 1) * bitTime, (bytes[i] >> bit) & 0x01 ? HIGH : LOW);
+			pLine->Add(time + 9 * bitTime, HIGH);
+			time += 10 * bitTime;
+		}
+	}
+
+	// a hardware UART, 16x oversampling with a majority vote of the middle three samples of each bit
+	std::vector<uint8_t> Receive(const Line& line, double bitTime, int* pFramingErrors)
+	{
+		std::vector<uint8_t> bytes;
+		const std::vector<Edge>& edges = line.GetEdges();
+		if (edges.empty())
+			return bytes;
+
+		const double sample = bitTime / 16.0;
+		const double end = edges.back().time + 20 * bitTime;
+		double time = Random() * sample;
+		while (time < end)
+		{
+			if (line.GetLevel(time) == HIGH)
+			{
+				time += sample;
+				continue;
+			}
+
+			// the first low sample starts the frame, bit n's middle is 16n + 8 samples on
+			const double start = time;
+			int bits[10];
+			for (int bit=0; bit<10; ++bit)
+			{
+				const double middle = start + (bit * 16 + 8) * sample;
+				bits[bit] = (line.GetLevel(middle - sample) + line.GetLevel(middle) + line.GetLevel(middle + sample)) >= 2;
+				if (bit == 0 && bits[0])
+					break;
+			}
+			if (bits[0])
+			{
+				time = start + sample;
+				continue;
+			}
+
+			uint8_t byte = 0;
+			for (int bit=0; bit<8; ++bit)
+				byte |= bits[bit + 1] << bit;
+			if (bits[9])
+				bytes.push_back(byte);
+			else
+				++*pFramingErrors;
+
+			// back to hunting for a start bit from the middle of the stop bit
+			time = start + (9 * 16 + 8) * sample;
+		}
+		return bytes;
+	}
+
+	// the other end sends to SoftUART through the pin change interrupt
+	Result TestReceive(const Options& options, double cpuMHz, uint32_t baud)
+	{
+		const double resolution = 64.0 / cpuMHz;     // micros() is Timer0 at clk/64
+		const double bitTime = 1.0e6 / baud * (1.0 + options.error * 0.01);
+
+		std::vector<uint8_t> sent(options.bytes);
+		for (size_t i=0; i<sent.size(); ++i)
+			sent[i] = rand() & 0xFF;
+
+		Line line;
+		Send(sent, bitTime, &line);
+
+		SoftUART uart;
+		uart.begin((1000000ul * 256 + baud / 2) / baud);
+		const double phase = Random() * resolution;
+		const double microsBase = 100000.0;     // keeps micros() clear of 0
+
+		Result result = {options.bytes, 0, 0, 0.0};
+		std::vector<uint8_t> received;
+		const std::vector<Edge>& edges = line.GetEdges();
+		double nextPoll = Random() * c_PollInterval;
+		size_t next = 0;
+		double isr = edges[0].time + HoldOff(options);
+		const double end = edges.back().time + 10 * bitTime + 2 * c_PollInterval;
+		while (next < edges.size() || nextPoll < end)
+		{
+			// the interrupt for the next edge runs once it's no longer held off, and sees
+			// whatever the line's doing by then
+			if (next >= edges.size() || nextPoll < isr)
+			{
+				uart.Poll((uint32_t)(floor((nextPoll + phase) / resolution) * resolution + microsBase));
+				for (int c; (c = uart.read()) >= 0; )
+					received.push_back((uint8_t)c);
+				nextPoll += c_PollInterval * (1.0 + Random());
+				continue;
+			}
+
+			const uint32_t stamp = (uint32_t)(floor((isr + phase) / resolution) * resolution + microsBase);
+			result.worstEdge = std::max(result.worstEdge, (stamp - microsBase - edges[next].time) / bitTime);
+			uart.OnEdge(stamp, line.GetLevel(isr));
+			while (next < edges.size() && edges[next].time <= isr)
+				++next;
+			if (next < edges.size())
+				isr = edges[next].time + HoldOff(options);
+		}
+
+		result.wrong = CountWrong(sent, received);
+		result.framingErrors = uart.GetFramingErrorCount();
+		return result;
+	}
+
+	// SoftUART sends from Timer1's compare interrupt, to a hardware UART
+	Result TestTransmit(const Options& options, double cpuMHz, uint32_t baud)
+	{
+		const double tick = 8.0 / cpuMHz;            // Timer1 at clk/8
+		const uint32_t period = (uint32_t)((cpuMHz * 1.0e6 / 8 * 16 + baud / 2) / baud);
+		const double bitTime = 1.0e6 / baud;
+
+		SoftUART uart;
+		uart.begin((1000000ul * 256 + baud / 2) / baud);
+
+		Result result = {options.bytes, 0, 0, 0.0};
+		std::vector<uint8_t> sent;
+		Line line;
+
+		double time = 1000.0;
+		uint32_t next = 0;
+		double start = 0.0;
+		int bit = 0;
+		bool transmitting = false;
+		while ((int)sent.size() < options.bytes || transmitting)
+		{
+			// the app writes whenever there's room, and now and then leaves a gap
+			if (Random() > 0.01)
+			{
+				for (uint8_t byte = rand() & 0xFF; (int)sent.size() < options.bytes && uart.Write(byte); byte = rand() & 0xFF)
+					sent.push_back(byte);
+			}
+
+			if (!transmitting)
+			{
+				next = (uint32_t)(floor(time / tick) + c_TxStartDelay) << 4;
+				bit = 0;
+				transmitting = true;
+			}
+
+			const double match = (next >> 4) * tick;
+			uint8_t level;
+			if (!uart.TxBit(&level))
+			{
+				transmitting = false;
+				time = match + Random() * c_MaxIdleBits * bitTime;
+				continue;
+			}
+
+			// each frame's bits against its start bit, which is all the other end goes by
+			if (bit % 10 == 0)
+				start = match;
+			const double edge = match + HoldOff(options);
+			line.Add(edge, level);
+			result.worstEdge = std::max(result.worstEdge, (edge - c_ISREntry - (start + bit % 10 * bitTime)) / bitTime);
+			next += period;
+			++bit;
+			time = match;
+		}
+
+		const std::vector<uint8_t> received = Receive(line, bitTime * (1.0 - options.error * 0.01), &result.framingErrors);
+		result.wrong = CountWrong(sent, received);
+		return result;
+	}
+
+	void Print(const char* direction, double cpuMHz, uint32_t baud, const Result& result)
+	{
+		printf("%-8s %3.0f MHz %6u %8d %8d %8.5f%% %8d %10.1f%%\n",
+			direction, cpuMHz, baud, result.sent, result.wrong, 100.0 * result.wrong / result.sent,
+			result.framingErrors, result.worstEdge * 100.0);
+	}
+
+	void Usage()
+	{
+		fprintf(stderr, "Usage: UARTSim [-n bytes] [-l latency] [-p probability] [-e error] [-s seed]\n");
+	}
+}
+
+int main(int argc, char** argv)
+{
+	Options options;
+	options.bytes = 20000;
+	options.latency = 10.0;
+	options.probability = 0.2;
+	options.error = 1.0;
+
+	int opt;
+	while ((opt = getopt(argc, argv, "n:l:p:e:s:")) != -1)
+	{
+		switch (opt)
+		{
+		case 'n': options.bytes = std::max(atoi(optarg), 1); break;
+		case 'l': options.latency = atof(optarg); break;
+		case 'p': options.probability = atof(optarg); break;
+		case 'e': options.error = atof(optarg); break;
+		case 's': srand(atoi(optarg)); break;
+		default: Usage(); return 1;
+		}
+	}
+
+	const double c_Clocks[] = {8.0, 16.0};
+	const uint32_t c_Bauds[] = {4800, 9600, 19200};
+
+	printf("held off up to %.0f us %.0f%% of the time, clocks %.1f%% apart\n", options.latency, options.probability * 100.0, options.error);
+	printf("%-8s %7s %6s %8s %8s %9s %8s %11s\n", "", "clock", "baud", "bytes", "wrong", "rate", "framing", "worst edge");
+	int wrong = 0;
+	for (size_t i=0; i<_countof(c_Clocks); ++i)
+	{
+		for (size_t j=0; j<_countof(c_Bauds); ++j)
+		{
+			const Result rx = TestReceive(options, c_Clocks[i], c_Bauds[j]);
+			const Result tx = TestTransmit(options, c_Clocks[i], c_Bauds[j]);
+			Print("receive", c_Clocks[i], c_Bauds[j], rx);
+			Print("transmit", c_Clocks[i], c_Bauds[j], tx);
+			wrong += rx.wrong + tx.wrong;
+		}
+	}
+	return wrong ? 2 : 0;
+}